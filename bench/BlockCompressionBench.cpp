@@ -0,0 +1,89 @@
+// NOTE: Encoder throughput in MPixel/s for every block format, SIMD level and thread count.
+//  Usage: BlockCompressionBench [size] [iterations]
+
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // std::atoi
+#include <random>
+#include <vector>
+
+
+auto _makeTestImage(ui32 size) -> std::vector<ui8>;
+
+
+int main(int argc, char** argv)
+{
+    const ui32 size = argc > 1 ? static_cast<ui32>(std::atoi(argv[1])) : 2048;
+    const ui32 iterations = argc > 2 ? static_cast<ui32>(std::atoi(argv[2])) : 5;
+
+    const auto pixels = _makeTestImage(size);
+    const f32 megaPixels = static_cast<f32>(size) * size / 1'000'000.0f;
+
+    std::vector<ui32> threadCounts;
+    for (ui32 threads = 1; threads < GetCpuFeatures().hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(GetCpuFeatures().hardwareThreads);
+
+    std::printf("%ux%u image, %u iterations, best of\n", size, size, iterations);
+    std::printf("%-6s %-8s %8s %12s\n", "format", "simd", "threads", "MPixel/s");
+
+    constexpr BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+    constexpr SimdLevel simdLevels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+
+    for (const auto format : formats) {
+        std::vector<ui8> output(GetCompressedSize(format, size, size));
+
+        for (const auto simdLevel : simdLevels) {
+            if (IsSimdLevelSupported(simdLevel) == false) {
+                continue;
+            }
+
+            for (const auto threads : threadCounts) {
+                JobSystem jobSystem;
+                jobSystem.Init(threads - 1);
+                f64 bestSeconds = 1e9;
+
+                for (ui32 i = 0; i < iterations; ++i) {
+                    const auto start = std::chrono::steady_clock::now();
+                    CompressImage(format, pixels.data(), size, size, output.data(), simdLevel, threads, jobSystem.GetParallelFor());
+                    const auto end = std::chrono::steady_clock::now();
+
+                    bestSeconds = std::min(bestSeconds, std::chrono::duration<f64>(end - start).count());
+                }
+                jobSystem.Shutdown();
+
+                std::printf("%-6s %-8s %8u %12.1f\n", GetBlockFormatName(format), GetSimdLevelName(simdLevel),
+                            threads, megaPixels / bestSeconds);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+// NOTE: Smooth gradients with noisy patches, so both the endpoint fit and the index search get some work
+std::vector<ui8> _makeTestImage(ui32 size)
+{
+    std::vector<ui8> pixels(static_cast<size_t>(size) * size * 4);
+    std::mt19937 random(1234);
+
+    for (ui32 y = 0; y < size; ++y) {
+        for (ui32 x = 0; x < size; ++x) {
+            ui8* pixel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+            const bool isNoisy = ((x / 32) + (y / 32)) % 3 == 0;
+
+            pixel[0] = static_cast<ui8>(x * 255 / size);
+            pixel[1] = static_cast<ui8>(y * 255 / size);
+            pixel[2] = static_cast<ui8>(isNoisy ? random() & 0xff : (x + y) * 127 / size);
+            pixel[3] = static_cast<ui8>(255 - (x * 127 / size));
+        }
+    }
+
+    return pixels;
+}
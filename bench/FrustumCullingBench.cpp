@@ -0,0 +1,108 @@
+// NOTE: Culling throughput in objects/ms for every bounding volume, SIMD level and thread count.
+//  Usage: FrustumCullingBench [objectCount] [iterations]
+
+#include "FrustumCulling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // std::atoi
+#include <random>
+#include <vector>
+
+
+auto _makeTestBounds(ui32 objectCount)  -> CullingBounds;
+auto _makeTestFrustum()                 -> Frustum;
+
+
+int main(int argc, char** argv)
+{
+    const ui32 objectCount = argc > 1 ? static_cast<ui32>(std::atoi(argv[1])) : 1'000'000;
+    const ui32 iterations = argc > 2 ? static_cast<ui32>(std::atoi(argv[2])) : 20;
+
+    const auto bounds = _makeTestBounds(objectCount);
+    const auto frustum = _makeTestFrustum();
+
+    std::vector<ui32> threadCounts;
+    for (ui32 threads = 1; threads < GetCpuFeatures().hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(GetCpuFeatures().hardwareThreads);
+
+    std::printf("%u objects, %u iterations, best of\n", objectCount, iterations);
+    std::printf("%-7s %-8s %8s %10s %14s\n", "volume", "simd", "threads", "visible", "objects/ms");
+
+    constexpr CullVolume volumes[] = { CullVolume::Sphere, CullVolume::AABB };
+    constexpr SimdLevel simdLevels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON };
+
+    FrustumCuller culler;
+    std::vector<ui32> visible;
+
+    for (const auto volume : volumes) {
+        for (const auto simdLevel : simdLevels) {
+            if (IsSimdLevelSupported(simdLevel) == false) {
+                continue;
+            }
+            culler.SetSimdLevel(simdLevel);
+
+            for (const auto threads : threadCounts) {
+                JobSystem jobSystem;
+                jobSystem.Init(threads - 1);
+                f64 bestMilliseconds = 1e9;
+
+                for (ui32 i = 0; i < iterations; ++i) {
+                    const auto start = std::chrono::steady_clock::now();
+                    culler.Cull(frustum, bounds, volume, visible, threads, jobSystem.GetParallelFor());
+                    const auto end = std::chrono::steady_clock::now();
+
+                    bestMilliseconds = std::min(bestMilliseconds, std::chrono::duration<f64, std::milli>(end - start).count());
+                }
+                jobSystem.Shutdown();
+
+                std::printf("%-7s %-8s %8u %10zu %14.0f\n", volume == CullVolume::Sphere ? "sphere" : "aabb",
+                            GetSimdLevelName(simdLevel), threads, visible.size(), objectCount / bestMilliseconds);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+// NOTE: Objects scattered in a cube around the camera, so roughly a quarter of them end up visible
+//  and the compaction isn't trivially all or nothing
+CullingBounds _makeTestBounds(ui32 objectCount)
+{
+    CullingBounds bounds;
+    bounds.Reserve(objectCount);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<f32> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<f32> size(0.1f, 2.0f);
+
+    for (ui32 i = 0; i < objectCount; ++i) {
+        const f32 center[3] = { position(random), position(random), position(random) };
+        const f32 halfExtents[3] = { size(random), size(random), size(random) };
+        const f32 radius = std::max({ halfExtents[0], halfExtents[1], halfExtents[2] }) * 1.7320508f;
+
+        bounds.Add(center, radius, halfExtents);
+    }
+
+    return bounds;
+}
+
+// NOTE: 90 degree perspective looking down -z from the origin, near 0.1, far 150, written out in glm's column-major layout
+Frustum _makeTestFrustum()
+{
+    const f32 nearZ = 0.1f;
+    const f32 farZ = 150.0f;
+    const f32 viewProjection[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, -1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, farZ / (nearZ - farZ), -1.0f,
+        0.0f, 0.0f, -(farZ * nearZ) / (farZ - nearZ), 0.0f,
+    };
+
+    return ExtractFrustumPlanes(viewProjection);
+}
@@ -0,0 +1,146 @@
+// NOTE: Scheduling overhead of the job system against a std::thread per task:
+//  empty jobs per ms, cost of one parallel for, and a parallel for over real work.
+//  Usage: JobSystemBench [jobCount] [iterations]
+
+#include "JobSystem.hpp"
+#include "CpuFeatures.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib> // std::atoi
+#include <vector>
+
+
+// NOTE: What the modules did before the job system, one thread per task, joined at the end
+auto _threadPerTaskParallelFor(ui32 taskCount, const std::function<void(ui32)>& task) -> void;
+template<typename Function>
+auto _bestMilliseconds(ui32 iterations, Function&& function)                         -> f64;
+
+
+int main(int argc, char** argv)
+{
+    const ui32 jobCount = argc > 1 ? static_cast<ui32>(std::atoi(argv[1])) : 100'000;
+    const ui32 iterations = argc > 2 ? static_cast<ui32>(std::atoi(argv[2])) : 5;
+    const ui32 threadCount = GetCpuFeatures().hardwareThreads;
+
+    JobSystem jobSystem;
+    jobSystem.Init(threadCount - 1);
+
+    std::printf("%u threads, %u iterations, best of\n", threadCount, iterations);
+    std::printf("%-28s %-16s %14s\n", "test", "scheduler", "result");
+
+    // NOTE: Pure scheduling cost, the jobs do nothing
+    {
+        const f64 jobMilliseconds = _bestMilliseconds(iterations, [&]() {
+            JobCounter counter;
+            for (ui32 i = 0; i < jobCount; ++i) {
+                jobSystem.Run([]() {}, &counter);
+            }
+            jobSystem.Wait(counter);
+        });
+
+        // NOTE: Creating threads is slow enough that a fraction of the jobs gives a stable number
+        const ui32 threadJobCount = std::max(jobCount / 100, 1u);
+        const f64 threadMilliseconds = _bestMilliseconds(iterations, [&]() {
+            _threadPerTaskParallelFor(threadJobCount, [](ui32) {});
+        });
+
+        std::printf("%-28s %-16s %11.0f /ms\n", "empty jobs", "job system", jobCount / jobMilliseconds);
+        std::printf("%-28s %-16s %11.0f /ms\n", "empty jobs", "thread per task", threadJobCount / threadMilliseconds);
+    }
+
+    // NOTE: One small parallel for per call, what a frame does a few times for culling, transforms and sorting
+    {
+        constexpr ui32 kCalls = 1000;
+        std::vector<f32> values(threadCount * 1024, 1.0f);
+        auto task = [&](ui32 chunk) {
+            for (ui32 i = chunk * 1024; i < (chunk + 1) * 1024; ++i) {
+                values[i] = std::sqrt(values[i] + 1.0f);
+            }
+        };
+
+        const f64 jobMilliseconds = _bestMilliseconds(iterations, [&]() {
+            for (ui32 call = 0; call < kCalls; ++call) {
+                jobSystem.ParallelFor(threadCount, task);
+            }
+        });
+        const f64 threadMilliseconds = _bestMilliseconds(iterations, [&]() {
+            for (ui32 call = 0; call < kCalls; ++call) {
+                _threadPerTaskParallelFor(threadCount, task);
+            }
+        });
+
+        std::printf("%-28s %-16s %11.2f us\n", "parallel for overhead", "job system", jobMilliseconds * 1000.0 / kCalls);
+        std::printf("%-28s %-16s %11.2f us\n", "parallel for overhead", "thread per task", threadMilliseconds * 1000.0 / kCalls);
+    }
+
+    // NOTE: Uneven work, later elements cost more, small ranges let idle threads steal the expensive ones
+    {
+        constexpr ui32 kElementCount = 1 << 16;
+        std::vector<f32> values(kElementCount, 0.0f);
+        auto work = [&](ui32 first, ui32 last) {
+            for (ui32 i = first; i < last; ++i) {
+                f32 value = static_cast<f32>(i);
+                for (ui32 j = 0; j < i / 1024; ++j) {
+                    value = std::sqrt(value + static_cast<f32>(j));
+                }
+                values[i] = value;
+            }
+        };
+
+        const f64 jobMilliseconds = _bestMilliseconds(iterations, [&]() {
+            jobSystem.ParallelForRange(kElementCount, 256, work);
+        });
+        const f64 threadMilliseconds = _bestMilliseconds(iterations, [&]() {
+            const ui32 rangeSize = (kElementCount + threadCount - 1) / threadCount;
+            _threadPerTaskParallelFor(threadCount, [&](ui32 range) {
+                work(range * rangeSize, std::min((range + 1) * rangeSize, kElementCount));
+            });
+        });
+
+        std::printf("%-28s %-16s %11.2f ms\n", "uneven parallel for", "job system", jobMilliseconds);
+        std::printf("%-28s %-16s %11.2f ms\n", "uneven parallel for", "thread per task", threadMilliseconds);
+    }
+
+    const auto stats = jobSystem.GetStats();
+    std::printf("executed %llu jobs, %llu stolen, %llu run inline\n", static_cast<unsigned long long>(stats.executedJobs),
+                static_cast<unsigned long long>(stats.stolenJobs), static_cast<unsigned long long>(stats.inlineJobs));
+
+    jobSystem.Shutdown();
+
+    return 0;
+}
+
+
+
+void _threadPerTaskParallelFor(ui32 taskCount, const std::function<void(ui32)>& task)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(taskCount);
+
+    for (ui32 i = 0; i < taskCount; ++i) {
+        threads.emplace_back(task, i);
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+template<typename Function>
+f64 _bestMilliseconds(ui32 iterations, Function&& function)
+{
+    f64 bestMilliseconds = 1e9;
+
+    for (ui32 i = 0; i < iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+
+        bestMilliseconds = std::min(bestMilliseconds, std::chrono::duration<f64, std::milli>(end - start).count());
+    }
+
+    return bestMilliseconds;
+}
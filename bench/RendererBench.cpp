@@ -0,0 +1,1151 @@
+// NOTE: Whole-frame benchmark of VkBackend on a generated scene. Runs a fixed number of frames and reports
+//  per-frame CPU, render thread and GPU time, heap allocations, driver host allocations per scope
+//  device memory per category and heap budget, and the driver objects the backend holds, as JSON.
+//  With --compare the results are checked against a stored baseline and the exit code is 1 on a regression,
+//  with --max-allocations it's 1 when the frames made more heap allocations than that on average.
+//  With --idle-seconds the scene stops after the measured frames and the process CPU time of that idle stretch is
+//  measured, --on-demand only draws when something changed, the default keeps drawing the unchanged frame.
+//  --pipeline-stats reports what every pass of the main view fed through the pipeline, --overdraw-view renders the
+//  overdraw heat map and reports the fragments shaded per pixel (--overdraw is the scene's depth complexity).
+//  Every run reports what each step of VkBackend::Init() took and how long it was until the first frame was submitted.
+//  --eviction-check forces a texture eviction once the command cache is warm and is 1 when cached buckets that bind
+//  the rewritten descriptor sets were executed again.
+//  --graph-check declares a small render graph with known culling before anything else and is 1 when a pass is
+//  culled that shouldn't be or the other way around.
+//  Usage: RendererBench [--objects N] [--meshes M] [--materials K] [--overdraw F] [--transparent F] [--seed S]
+//                       [--frames N] [--warmup N] [--width W] [--height H] [--headless] [--cpu] [--host-arena]
+//                       [--out results.json] [--compare baseline.json] [--threshold 0.05] [--max-allocations 0]
+//                       [--memory-budget MB] [--lod-error PX] [--no-meshlet-culling]
+//                       [--no-occlusion-culling] [--capture-every N] [--capture-format ppm|png|raw] [--capture-dir DIR]
+//                       [--on-demand] [--idle-seconds S] [--low-latency] [--views N] [--pipeline-cache PATH]
+//                       [--no-command-cache] [--paused] [--pipeline-stats] [--overdraw-view] [--eviction-check]
+//                       [--graph-check]
+
+#include "VkBackend.hpp"
+#include "RenderGraph.hpp"
+#include "SyntheticScene.hpp"
+#include "JobSystem.hpp"
+#include "CpuFeatures.hpp"
+#include "Window.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // std::malloc, std::atoi, std::strtod
+#include <fstream>
+#include <functional>
+#include <new>
+#include <numbers>
+#include <optional>
+#include <sstream>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <ctime>
+#endif
+
+
+// NOTE: Every operator new of the process, both the main and the render thread
+std::atomic<ui64> g_allocationCount{ 0 };
+
+void* operator new(std::size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+
+struct BenchOptions
+{
+    SyntheticSceneDesc scene{ .seed = 1, .objectCount = 10'000, .meshCount = 4, .materialCount = 16,
+                              .overdraw = 4.0f, .transparentFraction = 0.25f };
+    ui32 frames = 300;
+    ui32 warmupFrames = 30;
+    ui32 width = 1280;
+    ui32 height = 720;
+    bool isHeadless = false;
+    bool useCpuDevice = false;
+    // NOTE: Command and object scope driver allocations come from the host allocator's pools instead of malloc
+    bool useHostArena = false;
+    std::string outputPath;
+    std::string baselinePath;
+    // NOTE: Relative, 0.05 flags anything more than 5% worse than the baseline
+    f64 threshold = 0.05;
+    // NOTE: Heap allocations per frame the run may make, --max-allocations 0 checks that steady-state frames don't allocate
+    std::optional<f64> maxAllocationsPerFrame;
+    // NOTE: Caps the device-local heaps, so the eviction policy can be exercised on any GPU. 0 leaves the budget to the driver.
+    ui32 memoryBudgetMegabytes = 0;
+    // NOTE: Screen-space error of the mesh LOD selection in pixels, 0 draws everything at full detail
+    f32 lodPixelError = 1.0f;
+    // NOTE: Off draws whole LOD levels directly instead of culling meshlets on the GPU
+    bool useMeshletCulling = true;
+    // NOTE: Off skips the Hi-Z pass and the second cull phase, meshlets are only frustum and cone culled
+    bool useOcclusionCulling = true;
+    // NOTE: Every Nth measured frame is captured and written to captureDirectory, 0 turns capture off
+    ui32 captureInterval = 0;
+    ImageFileFormat captureFormat = ImageFileFormat::Png;
+    std::string captureDirectory = ".";
+    // NOTE: Draw only when NeedsRedraw(), presented with FIFO. Needs a window, headless runs draw the same either way.
+    bool isOnDemand = false;
+    // NOTE: Length of the idle phase after the measured frames, 0 skips it
+    f64 idleSeconds = 0.0;
+    // NOTE: Paced frames with late-latched uniforms, simulation-to-present latency is only measured with it
+    bool isLowLatency = false;
+    // NOTE: Views rendered every frame, the ones after the main view are offscreen and orbit the scene evenly
+    ui32 viewCount = 1;
+    // NOTE: Loaded at Init() when it matches the device, written back at Shutdown(). Empty keeps the cache in memory.
+    std::string pipelineCachePath;
+    // NOTE: Off records every draw into the frame's command buffer instead of reusing the buckets that didn't change
+    bool useCommandCache = true;
+    // NOTE: The scene doesn't spin, warmup included, so only what the camera and LOD hysteresis do changes the draws
+    bool isPaused = false;
+    // NOTE: Pipeline statistics queries around every pass of the main view
+    bool usePipelineStatistics = false;
+    // NOTE: Renders the overdraw heat map instead of the shaded scene, counts fragments per pixel
+    bool useOverdrawView = false;
+    // NOTE: After everything else, evicts texture mips under a warm command cache and checks nothing stale is reused
+    bool useEvictionCheck = false;
+    // NOTE: Before the backend starts, checks which passes of a known render graph get culled
+    bool useGraphCheck = false;
+};
+
+struct FrameResult
+{
+    vulkan::FrameTiming timing;
+    // NOTE: Made during DrawFrame() on the main thread, the render thread's are only in the run's total
+    ui64 allocations;
+};
+
+struct Summary
+{
+    f64 cpuMedian;
+    f64 cpuP95;
+    f64 cpuMax;
+    f64 renderMedian;
+    f64 renderP95;
+    // NOTE: Negative when the device has no timestamps
+    f64 gpuMedian;
+    f64 gpuP95;
+    // NOTE: Hi-Z pyramid build, negative without occlusion culling or timestamps
+    f64 hizMedian;
+    f64 hizP95;
+    // NOTE: Simulation to present, negative without low latency mode
+    f64 latencyMedian;
+    f64 latencyP95;
+    // NOTE: Both threads, from the first measured frame until the last one is done on the GPU
+    f64 allocationsPerFrame;
+    // NOTE: Geometry pool binds, one per vertex layout and frame when nothing rebinds in between.
+    //  Buckets the command cache reuses don't bind again.
+    f64 geometryBindsPerFrame;
+    // NOTE: Over the draws that survived culling, with the selected levels and at LOD 0
+    f64 trianglesPerFrame;
+    f64 trianglesPerFrameWithoutLod;
+    f64 lodSwitchesPerFrame;
+    // NOTE: Meshlets of those draws the cull pass looked at, and what it culled of them
+    f64 meshletsPerFrame;
+    f64 meshletsCulledPerFrame;
+    f64 trianglesCulledPerFrame;
+    // NOTE: What the late phase didn't draw because it was behind the Hi-Z pyramid
+    f64 objectsOccludedPerFrame;
+    f64 trianglesOccludedPerFrame;
+    // NOTE: Command cache buckets executed per frame, recorded again or reused, and the recording time of the former
+    f64 bucketsRecordedPerFrame;
+    f64 bucketsReusedPerFrame;
+    f64 recordMillisecondsPerFrame;
+    // NOTE: Estimated, the reused draws at the average recording cost of a draw
+    f64 savedMillisecondsPerFrame;
+    // NOTE: Pipeline statistics of every main view pass per measured frame, in PassStatistics order
+    std::array<std::array<f64, 6>, vulkan::kMaxStatisticsPasses> passStatisticsPerFrame;
+    // NOTE: Fragments that passed the depth test per pixel over the measured frames, 1.0 is no overdraw
+    f64 overdrawAverage;
+};
+
+// NOTE: The stretch after the measured frames with the scene stopped. Power isn't measured, process CPU time stands in.
+struct IdleSummary
+{
+    f64 wallSeconds;
+    // NOTE: Every thread of the process, user and kernel
+    f64 cpuSeconds;
+    f64 cpuPercent;
+    ui64 framesDrawn;
+    ui64 framesRepresented;
+};
+
+// NOTE: The frame right after a forced eviction, it has to record every bucket it draws again
+struct EvictionCheck
+{
+    ui32 droppedTextureMips;
+    ui64 bucketsRecorded;
+    ui64 bucketsReused;
+    bool isPassing;
+};
+
+// NOTE: Passes of the checked graph whose culling isn't the expected one
+struct GraphCheck
+{
+    ui32 passCount;
+    std::vector<std::string> wrongPasses;
+    bool isPassing;
+};
+
+// NOTE: What the driver allocated on the host during the measured frames, reallocations included
+struct HostAllocationSummary
+{
+    std::array<f64, vulkan::kHostAllocationScopeCount> allocationsPerFrame;
+    f64 totalAllocationsPerFrame;
+    vulkan::HostAllocatorStats stats;
+};
+
+constexpr const char* kHostScopeNames[vulkan::kHostAllocationScopeCount] = { "command", "object", "cache", "device", "instance" };
+constexpr const char* kPassStatisticNames[] = { "ia_vertices", "ia_primitives", "vs_invocations", "clipping_primitives",
+                                                "fs_invocations", "cs_invocations" };
+constexpr const char* kMemoryCategoryNames[vulkan::kMemoryCategoryCount] = { "geometry", "textures", "uniforms", "staging", "render_targets", "readback" };
+
+// NOTE: Lower is better for all of them, the ones missing from either file are skipped
+constexpr const char* kComparedMetrics[] = { "cpu_ms_median", "cpu_ms_p95", "render_ms_median", "render_ms_p95",
+                                             "gpu_ms_median", "gpu_ms_p95", "hiz_ms_median", "hiz_ms_p95",
+                                             "latency_ms_median", "latency_ms_p95",
+                                             "allocations_per_frame", "driver_allocations_per_frame",
+                                             "device_memory_blocks", "buffers", "images", "pipelines", "descriptor_sets",
+                                             "eviction_stalls", "geometry_binds_per_frame", "geometry_fragmented_bytes",
+                                             "triangles_per_frame", "idle_cpu_percent" };
+// NOTE: Upper bound on how long the on-demand idle loop sleeps without events
+constexpr f64 kIdleTimeoutSeconds = 0.1;
+// NOTE: Enough for every frame in flight and swapchain image to have its cache slots recorded with the stopped scene
+constexpr ui32 kEvictionWarmFrames = 8;
+// NOTE: Far below anything the scene fits in, every handler gets asked. 0 would remove the cap instead.
+constexpr vk::DeviceSize kEvictionCheckBudget = 1;
+
+
+auto _parseOptions(int argc, char** argv)                                    -> BenchOptions;
+auto _percentile(std::vector<f64> values, f64 fraction)                      -> f64;
+auto _summarize(const std::vector<FrameResult>& frames, ui64 allocations)   -> Summary;
+auto _summarizeHostAllocations(const vulkan::HostAllocatorStats& before, const vulkan::HostAllocatorStats& after,
+                               ui32 frameCount)                              -> HostAllocationSummary;
+auto _processCpuSeconds()                                                    -> f64;
+auto _runIdle(const BenchOptions& options, vulkan::VkBackend& backend, Window& window) -> IdleSummary;
+auto _runEvictionCheck(const BenchOptions& options, vulkan::VkBackend& backend, Window& window) -> EvictionCheck;
+auto _runGraphCheck()                                                        -> GraphCheck;
+auto _writeJson(const BenchOptions& options, const std::string& deviceName, const Summary& summary,
+                const HostAllocationSummary& host, const vulkan::BackendStats& stats, const IdleSummary* idle,
+                const std::vector<FrameResult>& frames)                      -> std::string;
+auto _findJsonNumber(const std::string& json, const std::string& key)        -> std::optional<f64>;
+auto _compare(const std::string& results, const std::string& baseline, f64 threshold) -> bool;
+
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto options = _parseOptions(argc, argv);
+        const auto graphCheck = options.useGraphCheck ? std::optional(_runGraphCheck()) : std::nullopt;
+        const auto scene = BuildSyntheticScene(options.scene);
+
+        JobSystem jobSystem;
+        jobSystem.Init(GetCpuFeatures().hardwareThreads - 1);
+
+        Window window;
+        if (options.isHeadless == false) {
+            window.Init(options.width, options.height, "RendererBench");
+        }
+
+        std::vector<vulkan::ViewConfig> views;
+        for (ui32 i = 1; i < options.viewCount; ++i) {
+            views.push_back({ .window = nullptr,
+                              .width = options.width,
+                              .height = options.height,
+                              .orbit = 2.0f * std::numbers::pi_v<f32> * static_cast<f32>(i) / static_cast<f32>(options.viewCount) });
+        }
+
+        // NOTE: Fixed time step, so every run animates the same way no matter how fast the frames are
+        const vulkan::BackendConfig config{ .window = options.isHeadless ? nullptr : &window,
+                                            .width = options.width,
+                                            .height = options.height,
+                                            .deviceType = options.useCpuDevice ? std::optional(vk::PhysicalDeviceType::eCpu) : std::nullopt,
+                                            .scene = &scene,
+                                            .fixedTimeStep = 1.0f / 60.0f,
+                                            .trackHostAllocations = true,
+                                            .hostAllocatorBackend = options.useHostArena ? vulkan::HostAllocatorBackend::Arena
+                                                                                         : vulkan::HostAllocatorBackend::Heap,
+                                            .deviceMemoryBudget = static_cast<vk::DeviceSize>(options.memoryBudgetMegabytes) * 1024 * 1024,
+                                            .meshLods = {},
+                                            .lodPixelError = options.lodPixelError,
+                                            .meshletCulling = options.useMeshletCulling,
+                                            .occlusionCulling = options.useOcclusionCulling,
+                                            .frameCapture = options.captureInterval > 0,
+                                            .captureFormat = options.captureFormat,
+                                            .captureDirectory = options.captureDirectory,
+                                            .captureSchedule = {},
+                                            .onDemand = options.isOnDemand,
+                                            .lowLatency = options.isLowLatency,
+                                            .views = std::move(views),
+                                            .pipelineCachePath = options.pipelineCachePath,
+                                            .commandCache = options.useCommandCache,
+                                            .pipelineStatistics = options.usePipelineStatistics,
+                                            .overdraw = options.useOverdrawView };
+
+        vulkan::VkBackend backend;
+        backend.Init(config, jobSystem);
+        if (options.isPaused) {
+            backend.SetAnimating(false);
+        }
+
+        for (ui32 i = 0; i < options.warmupFrames; ++i) {
+            if (options.isHeadless == false) {
+                window.PollEvents();
+            }
+            backend.DrawFrame();
+        }
+        backend.WaitIdle();
+
+        std::vector<vulkan::FrameTiming> timings(options.frames);
+        std::vector<FrameResult> frames(options.frames);
+        backend.SetFrameTimings(timings);
+        // NOTE: Warmup frames aren't captured, the schedule starts with the first measured frame
+        backend.SetCaptureSchedule(vulkan::CaptureSchedule{ .interval = options.captureInterval, .firstFrame = 0, .frameCount = 0 });
+        const auto statsBefore = backend.GetStats();
+        const ui64 runAllocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+
+        for (ui32 i = 0; i < options.frames; ++i) {
+            if (options.isHeadless == false) {
+                window.PollEvents();
+            }
+
+            const ui64 allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+            backend.DrawFrame();
+            frames[i].allocations = g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        }
+        backend.WaitIdle();
+        const ui64 runAllocations = g_allocationCount.load(std::memory_order_relaxed) - runAllocationsBefore;
+
+        for (ui32 i = 0; i < options.frames; ++i) {
+            frames[i].timing = timings[i];
+        }
+
+        const auto stats = backend.GetStats();
+        auto summary = _summarize(frames, runAllocations);
+        summary.geometryBindsPerFrame = static_cast<f64>(stats.geometry.bindCount - statsBefore.geometry.bindCount) / static_cast<f64>(options.frames);
+        summary.trianglesPerFrame = static_cast<f64>(stats.lod.trianglesSubmitted - statsBefore.lod.trianglesSubmitted) / static_cast<f64>(options.frames);
+        summary.trianglesPerFrameWithoutLod = static_cast<f64>(stats.lod.trianglesWithoutLod - statsBefore.lod.trianglesWithoutLod) / static_cast<f64>(options.frames);
+        summary.lodSwitchesPerFrame = static_cast<f64>(stats.lod.lodSwitches - statsBefore.lod.lodSwitches) / static_cast<f64>(options.frames);
+        summary.meshletsPerFrame = static_cast<f64>(stats.meshlets.meshletsTested - statsBefore.meshlets.meshletsTested) / static_cast<f64>(options.frames);
+        summary.meshletsCulledPerFrame = static_cast<f64>(stats.meshlets.meshletsCulled - statsBefore.meshlets.meshletsCulled) / static_cast<f64>(options.frames);
+        summary.trianglesCulledPerFrame = static_cast<f64>(stats.meshlets.trianglesCulled - statsBefore.meshlets.trianglesCulled) / static_cast<f64>(options.frames);
+        summary.objectsOccludedPerFrame = static_cast<f64>(stats.occlusion.objectsOccluded - statsBefore.occlusion.objectsOccluded) / static_cast<f64>(options.frames);
+        summary.trianglesOccludedPerFrame = static_cast<f64>(stats.occlusion.trianglesOccluded - statsBefore.occlusion.trianglesOccluded) / static_cast<f64>(options.frames);
+        summary.bucketsRecordedPerFrame = static_cast<f64>(stats.commands.bucketsRecorded - statsBefore.commands.bucketsRecorded) / static_cast<f64>(options.frames);
+        summary.bucketsReusedPerFrame = static_cast<f64>(stats.commands.bucketsReused - statsBefore.commands.bucketsReused) / static_cast<f64>(options.frames);
+        summary.recordMillisecondsPerFrame = (stats.commands.recordMilliseconds - statsBefore.commands.recordMilliseconds) / static_cast<f64>(options.frames);
+        summary.savedMillisecondsPerFrame = (stats.commands.savedMilliseconds - statsBefore.commands.savedMilliseconds) / static_cast<f64>(options.frames);
+        const ui64 statisticsFrames = stats.pipelineStatistics.framesMeasured - statsBefore.pipelineStatistics.framesMeasured;
+        for (ui32 i = 0; i < stats.pipelineStatistics.passCount && statisticsFrames > 0; ++i) {
+            const auto& after = stats.pipelineStatistics.passes[i];
+            const auto& before = statsBefore.pipelineStatistics.passes[i];
+            const ui64 deltas[] = { after.inputAssemblyVertices - before.inputAssemblyVertices,
+                                    after.inputAssemblyPrimitives - before.inputAssemblyPrimitives,
+                                    after.vertexShaderInvocations - before.vertexShaderInvocations,
+                                    after.clippingPrimitives - before.clippingPrimitives,
+                                    after.fragmentShaderInvocations - before.fragmentShaderInvocations,
+                                    after.computeShaderInvocations - before.computeShaderInvocations };
+            for (size_t j = 0; j < std::size(deltas); ++j) {
+                summary.passStatisticsPerFrame[i][j] = static_cast<f64>(deltas[j]) / static_cast<f64>(statisticsFrames);
+            }
+        }
+        const ui64 overdrawPixels = stats.overdraw.pixels - statsBefore.overdraw.pixels;
+        summary.overdrawAverage = overdrawPixels > 0
+                                ? static_cast<f64>(stats.overdraw.fragmentsShaded - statsBefore.overdraw.fragmentsShaded) / static_cast<f64>(overdrawPixels)
+                                : 0.0;
+        const auto host = _summarizeHostAllocations(statsBefore.hostAllocations, stats.hostAllocations, options.frames);
+        const auto deviceName = backend.GetDeviceName();
+
+        std::optional<IdleSummary> idle;
+        if (options.idleSeconds > 0.0) {
+            idle = _runIdle(options, backend, window);
+        }
+        std::optional<EvictionCheck> evictionCheck;
+        if (options.useEvictionCheck && stats.commands.isEnabled) {
+            evictionCheck = _runEvictionCheck(options, backend, window);
+        }
+        const auto json = _writeJson(options, deviceName, summary, host, stats, idle ? &idle.value() : nullptr, frames);
+
+        backend.Shutdown();
+        if (options.isHeadless == false) {
+            window.Shutdown();
+        }
+        jobSystem.Shutdown();
+
+        std::printf("%u objects, %u meshes, %u materials, overdraw %.1f, %u frames on %s\n",
+                    options.scene.objectCount, options.scene.meshCount, options.scene.materialCount, options.scene.overdraw,
+                    options.frames, deviceName.c_str());
+        std::printf("%-12s %10s %10s %10s\n", "", "median ms", "p95 ms", "max ms");
+        std::printf("%-12s %10.3f %10.3f %10.3f\n", "cpu", summary.cpuMedian, summary.cpuP95, summary.cpuMax);
+        std::printf("%-12s %10.3f %10.3f\n", "render", summary.renderMedian, summary.renderP95);
+        if (summary.gpuMedian >= 0.0) {
+            std::printf("%-12s %10.3f %10.3f\n", "gpu", summary.gpuMedian, summary.gpuP95);
+        } else {
+            std::printf("%-12s %10s\n", "gpu", "n/a");
+        }
+        if (summary.hizMedian >= 0.0) {
+            std::printf("%-12s %10.3f %10.3f\n", "hi-z", summary.hizMedian, summary.hizP95);
+        }
+        if (summary.latencyMedian >= 0.0) {
+            std::printf("%-12s %10.3f %10.3f\n", "latency", summary.latencyMedian, summary.latencyP95);
+            const auto& pacing = stats.latency.pacing;
+            std::printf("%s pacing, %.2f ms predicted period, %.2f ms lead, %.1f ms slept over %llu frames\n",
+                        stats.latency.usesPresentWait ? "present wait" : "fence", pacing.periodMilliseconds,
+                        pacing.leadMilliseconds, pacing.sleepMilliseconds, static_cast<unsigned long long>(pacing.framesPaced));
+        }
+        std::printf("%u views, %u swapchains, %zu pipeline cache bytes loaded\n", stats.views.viewCount,
+                    stats.views.swapchainCount, stats.views.pipelineCacheBytesLoaded);
+        std::printf("%u shaders from %u files, %u shader modules created, %u pipelines from module identifiers, %u compiled\n",
+                    stats.shaders.shaderCount, stats.shaders.filesRead, stats.shaders.modulesCreated,
+                    stats.shaders.pipelinesFromIdentifiers, stats.shaders.pipelinesCompiled);
+        const auto& init = stats.init;
+        std::printf("init %.2f ms (%.2f ms of steps, %.2f ms critical path), first frame %.2f ms after Init() started\n",
+                    init.graph.wallMilliseconds, init.graph.serialMilliseconds, init.graph.criticalPathMilliseconds,
+                    init.firstFrameMilliseconds);
+        for (const auto& step : init.graph.steps) {
+            std::printf("  %-22s %8.3f ms at %8.3f ms\n", step.name.c_str(), step.milliseconds, step.startMilliseconds);
+        }
+        if (stats.commands.isEnabled) {
+            const f64 bucketsPerFrame = summary.bucketsRecordedPerFrame + summary.bucketsReusedPerFrame;
+            std::printf("%.2f of %.2f command buckets recorded per frame (%.1f%%), %.3f ms recording, ~%.3f ms saved per frame\n",
+                        summary.bucketsRecordedPerFrame, bucketsPerFrame,
+                        bucketsPerFrame > 0.0 ? 100.0 * summary.bucketsRecordedPerFrame / bucketsPerFrame : 0.0,
+                        summary.recordMillisecondsPerFrame, summary.savedMillisecondsPerFrame);
+        } else {
+            std::printf("command cache off\n");
+        }
+        if (stats.pipelineStatistics.isEnabled) {
+            std::printf("%-16s %12s %12s %12s %12s %12s %12s\n", "pass per frame", "ia verts", "ia prims", "vs invocs",
+                        "clip prims", "fs invocs", "cs invocs");
+            for (ui32 i = 0; i < stats.pipelineStatistics.passCount; ++i) {
+                const auto& perFrame = summary.passStatisticsPerFrame[i];
+                std::printf("%-16s %12.0f %12.0f %12.0f %12.0f %12.0f %12.0f\n", stats.pipelineStatistics.passes[i].name.c_str(),
+                            perFrame[0], perFrame[1], perFrame[2], perFrame[3], perFrame[4], perFrame[5]);
+            }
+        } else if (options.usePipelineStatistics) {
+            std::printf("pipeline statistics not supported by the device\n");
+        }
+        if (stats.overdraw.isEnabled) {
+            std::printf("%.2f fragments shaded per pixel, %.2f in the last frame\n", summary.overdrawAverage,
+                        stats.overdraw.lastFrameOverdraw);
+        } else if (options.useOverdrawView) {
+            std::printf("overdraw view not supported by the device\n");
+        }
+        std::printf("%.2f allocations per frame\n", summary.allocationsPerFrame);
+        std::printf("%.0f triangles per frame, %.0f without LOD (%.1f%%), %.2f LOD switches per frame, %u levels, %.1f px error\n",
+                    summary.trianglesPerFrame, summary.trianglesPerFrameWithoutLod,
+                    summary.trianglesPerFrameWithoutLod > 0.0 ? 100.0 * summary.trianglesPerFrame / summary.trianglesPerFrameWithoutLod : 100.0,
+                    summary.lodSwitchesPerFrame, stats.lod.levelCount, options.lodPixelError);
+        if (stats.meshlets.isEnabled) {
+            std::printf("%.0f of %.0f meshlets culled per frame, %.0f triangles culled per frame (%.1f%%), %u meshlets\n",
+                        summary.meshletsCulledPerFrame, summary.meshletsPerFrame, summary.trianglesCulledPerFrame,
+                        summary.trianglesPerFrame > 0.0 ? 100.0 * summary.trianglesCulledPerFrame / summary.trianglesPerFrame : 0.0,
+                        stats.meshlets.meshletCount);
+        } else {
+            std::printf("meshlet culling off, %u meshlets\n", stats.meshlets.meshletCount);
+        }
+        if (stats.occlusion.isEnabled) {
+            std::printf("%.1f objects and %.0f triangles occluded per frame, %u pyramid levels\n",
+                        summary.objectsOccludedPerFrame, summary.trianglesOccludedPerFrame, stats.occlusion.pyramidLevels);
+        } else {
+            std::printf("occlusion culling off\n");
+        }
+        if (stats.capture.isEnabled) {
+            const auto& capture = stats.capture;
+            std::printf("%llu frames captured, %llu written, %llu dropped, %llu failed, %.1f MB, %.2f ms encode per frame\n",
+                        static_cast<unsigned long long>(capture.framesCaptured), static_cast<unsigned long long>(capture.framesWritten),
+                        static_cast<unsigned long long>(capture.framesDropped), static_cast<unsigned long long>(capture.framesFailed),
+                        static_cast<f64>(capture.bytesWritten) / (1024.0 * 1024.0),
+                        capture.framesWritten > 0 ? capture.encodeMilliseconds / static_cast<f64>(capture.framesWritten) : 0.0);
+        } else if (options.captureInterval > 0) {
+            std::printf("frame capture not supported by the swapchain\n");
+        }
+        if (idle.has_value()) {
+            std::printf("idle %.1f s %s: %llu frames drawn, %llu re-presented, %.3f s CPU (%.1f%% of one core)\n",
+                        idle->wallSeconds, stats.present.isOnDemand ? "on demand" : "continuous",
+                        static_cast<unsigned long long>(idle->framesDrawn), static_cast<unsigned long long>(idle->framesRepresented),
+                        idle->cpuSeconds, idle->cpuPercent);
+        }
+        std::printf("%-12s %10s %12s %8s\n", "arena", "capacity", "peak bytes", "spills");
+        for (const auto& [name, arena] : { std::pair("frame", stats.frameArena), std::pair("scratch", stats.scratch) }) {
+            std::printf("%-12s %10zu %12zu %8llu\n", name, arena.capacity, arena.peakBytes,
+                        static_cast<unsigned long long>(arena.spillCount));
+        }
+
+        const auto& allocator = stats.allocator;
+        std::printf("device memory, %s\n", allocator.hasBudgetExtension ? "VK_EXT_memory_budget" : "estimated budget");
+        std::printf("%-12s %10s %10s %10s\n", "heap", "budget MB", "usage MB", "ours MB");
+        for (ui32 i = 0; i < allocator.heapCount; ++i) {
+            const auto& heap = allocator.heaps[i];
+            std::printf("%-2u %-9s %10.1f %10.1f %10.1f\n", i, heap.isDeviceLocal ? "device" : "host",
+                        static_cast<f64>(heap.budget) / (1024.0 * 1024.0), static_cast<f64>(heap.usage) / (1024.0 * 1024.0),
+                        static_cast<f64>(heap.allocatorUsed) / (1024.0 * 1024.0));
+        }
+        for (ui32 i = 0; i < vulkan::kMemoryCategoryCount; ++i) {
+            std::printf("%-14s %10.1f MB\n", kMemoryCategoryNames[i], static_cast<f64>(allocator.categoryBytes[i]) / (1024.0 * 1024.0));
+        }
+        std::printf("%u demoted allocations, %u evictions freed %.1f MB in %u stalls: %u staging releases, "
+                    "%u dropped mips, %u demoted buffers\n",
+                    allocator.demotedAllocations, allocator.evictionCount, static_cast<f64>(allocator.evictedBytes) / (1024.0 * 1024.0),
+                    stats.eviction.stalls, stats.eviction.stagingReleases, stats.eviction.droppedTextureMips, stats.eviction.demotedBuffers);
+
+        const auto& geometry = stats.geometry;
+        std::printf("geometry pool: %u meshes, vertices %.1f/%.1f MB, indices %.1f/%.1f MB, %llu fragmented bytes, "
+                    "%u grows, %u defragments, %.2f binds per frame\n",
+                    geometry.meshCount, static_cast<f64>(geometry.vertexBytesUsed) / (1024.0 * 1024.0),
+                    static_cast<f64>(geometry.vertexCapacity) / (1024.0 * 1024.0), static_cast<f64>(geometry.indexBytesUsed) / (1024.0 * 1024.0),
+                    static_cast<f64>(geometry.indexCapacity) / (1024.0 * 1024.0), static_cast<unsigned long long>(geometry.fragmentedBytes),
+                    geometry.growCount, geometry.defragmentCount, summary.geometryBindsPerFrame);
+
+        std::printf("%.1f driver host allocations per frame, %s backend\n", host.totalAllocationsPerFrame,
+                    options.useHostArena ? "arena" : "heap");
+        std::printf("%-12s %10s %12s %12s\n", "scope", "per frame", "live bytes", "peak bytes");
+        for (ui32 i = 0; i < vulkan::kHostAllocationScopeCount; ++i) {
+            const auto& scope = host.stats.scopes[i];
+            std::printf("%-12s %10.1f %12llu %12llu\n", kHostScopeNames[i], host.allocationsPerFrame[i],
+                        static_cast<unsigned long long>(scope.liveBytes), static_cast<unsigned long long>(scope.peakBytes));
+        }
+
+        if (options.outputPath.empty() == false) {
+            std::ofstream file(options.outputPath);
+            if (!file) {
+                throw std::runtime_error("Failed to open " + options.outputPath + "!");
+            }
+            file << json;
+        }
+
+        bool isPassing = true;
+        if (evictionCheck.has_value()) {
+            const auto& check = evictionCheck.value();
+            std::printf("eviction check: %u texture mips dropped, %llu buckets recorded and %llu reused right after\n",
+                        check.droppedTextureMips, static_cast<unsigned long long>(check.bucketsRecorded),
+                        static_cast<unsigned long long>(check.bucketsReused));
+            if (check.droppedTextureMips == 0) {
+                std::printf("eviction check: no texture mips could be dropped\n");
+            }
+            isPassing = check.isPassing && isPassing;
+        } else if (options.useEvictionCheck) {
+            std::printf("eviction check skipped, the command cache is off\n");
+        }
+        if (graphCheck.has_value()) {
+            const auto& check = graphCheck.value();
+            std::printf("graph check: %u passes, %zu culled wrong\n", check.passCount, check.wrongPasses.size());
+            for (const auto& name : check.wrongPasses) {
+                std::printf("graph check: %s\n", name.c_str());
+            }
+            isPassing = check.isPassing && isPassing;
+        }
+        if (options.maxAllocationsPerFrame.has_value() && summary.allocationsPerFrame > options.maxAllocationsPerFrame.value()) {
+            std::printf("%.2f allocations per frame, more than the allowed %.2f\n", summary.allocationsPerFrame,
+                        options.maxAllocationsPerFrame.value());
+            isPassing = false;
+        }
+
+        if (options.baselinePath.empty() == false) {
+            std::ifstream file(options.baselinePath);
+            if (!file) {
+                throw std::runtime_error("Failed to open " + options.baselinePath + "!");
+            }
+            std::stringstream baseline;
+            baseline << file.rdbuf();
+
+            isPassing = _compare(json, baseline.str(), options.threshold) && isPassing;
+        }
+
+        if (isPassing == false) {
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+BenchOptions _parseOptions(int argc, char** argv)
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + argument + "!");
+            }
+            return argv[++i];
+        };
+
+        if (argument == "--objects") {
+            options.scene.objectCount = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--meshes") {
+            options.scene.meshCount = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--materials") {
+            options.scene.materialCount = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--overdraw") {
+            options.scene.overdraw = static_cast<f32>(std::atof(value()));
+        } else if (argument == "--transparent") {
+            options.scene.transparentFraction = static_cast<f32>(std::atof(value()));
+        } else if (argument == "--seed") {
+            options.scene.seed = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--frames") {
+            options.frames = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--warmup") {
+            options.warmupFrames = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--width") {
+            options.width = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--height") {
+            options.height = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--headless") {
+            options.isHeadless = true;
+        } else if (argument == "--cpu") {
+            options.useCpuDevice = true;
+        } else if (argument == "--host-arena") {
+            options.useHostArena = true;
+        } else if (argument == "--out") {
+            options.outputPath = value();
+        } else if (argument == "--compare") {
+            options.baselinePath = value();
+        } else if (argument == "--threshold") {
+            options.threshold = std::atof(value());
+        } else if (argument == "--max-allocations") {
+            options.maxAllocationsPerFrame = std::atof(value());
+        } else if (argument == "--memory-budget") {
+            options.memoryBudgetMegabytes = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--lod-error") {
+            options.lodPixelError = static_cast<f32>(std::atof(value()));
+        } else if (argument == "--no-meshlet-culling") {
+            options.useMeshletCulling = false;
+        } else if (argument == "--no-occlusion-culling") {
+            options.useOcclusionCulling = false;
+        } else if (argument == "--capture-every") {
+            options.captureInterval = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--capture-format") {
+            const std::string format = value();
+            if (format == "ppm") {
+                options.captureFormat = ImageFileFormat::Ppm;
+            } else if (format == "png") {
+                options.captureFormat = ImageFileFormat::Png;
+            } else if (format == "raw") {
+                options.captureFormat = ImageFileFormat::Raw;
+            } else {
+                throw std::runtime_error("Unknown capture format " + format + "!");
+            }
+        } else if (argument == "--capture-dir") {
+            options.captureDirectory = value();
+        } else if (argument == "--on-demand") {
+            options.isOnDemand = true;
+        } else if (argument == "--idle-seconds") {
+            options.idleSeconds = std::atof(value());
+        } else if (argument == "--low-latency") {
+            options.isLowLatency = true;
+        } else if (argument == "--views") {
+            options.viewCount = static_cast<ui32>(std::atoi(value()));
+        } else if (argument == "--pipeline-cache") {
+            options.pipelineCachePath = value();
+        } else if (argument == "--no-command-cache") {
+            options.useCommandCache = false;
+        } else if (argument == "--eviction-check") {
+            options.useEvictionCheck = true;
+        } else if (argument == "--paused") {
+            options.isPaused = true;
+        } else if (argument == "--pipeline-stats") {
+            options.usePipelineStatistics = true;
+        } else if (argument == "--overdraw-view") {
+            options.useOverdrawView = true;
+        } else if (argument == "--graph-check") {
+            options.useGraphCheck = true;
+        } else {
+            throw std::runtime_error("Unknown argument " + argument + "!");
+        }
+    }
+
+    if (options.frames == 0) {
+        throw std::runtime_error("Need at least one frame!");
+    }
+    if (options.viewCount == 0) {
+        throw std::runtime_error("Need at least one view!");
+    }
+
+    return options;
+}
+
+// NOTE: Nearest rank
+f64 _percentile(std::vector<f64> values, f64 fraction)
+{
+    if (values.empty()) {
+        return -1.0;
+    }
+
+    const auto rank = static_cast<size_t>(fraction * static_cast<f64>(values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+Summary _summarize(const std::vector<FrameResult>& frames, ui64 allocations)
+{
+    std::vector<f64> cpu;
+    std::vector<f64> render;
+    std::vector<f64> gpu;
+    std::vector<f64> hiz;
+    std::vector<f64> latency;
+
+    for (const auto& frame : frames) {
+        cpu.push_back(frame.timing.cpuMilliseconds);
+        render.push_back(frame.timing.renderMilliseconds);
+        if (frame.timing.gpuMilliseconds >= 0.0) {
+            gpu.push_back(frame.timing.gpuMilliseconds);
+        }
+        if (frame.timing.hizMilliseconds >= 0.0) {
+            hiz.push_back(frame.timing.hizMilliseconds);
+        }
+        if (frame.timing.latencyMilliseconds >= 0.0) {
+            latency.push_back(frame.timing.latencyMilliseconds);
+        }
+    }
+
+    return { .cpuMedian = _percentile(cpu, 0.5),
+             .cpuP95 = _percentile(cpu, 0.95),
+             .cpuMax = *std::max_element(cpu.begin(), cpu.end()),
+             .renderMedian = _percentile(render, 0.5),
+             .renderP95 = _percentile(render, 0.95),
+             .gpuMedian = _percentile(gpu, 0.5),
+             .gpuP95 = _percentile(gpu, 0.95),
+             .hizMedian = _percentile(hiz, 0.5),
+             .hizP95 = _percentile(hiz, 0.95),
+             .latencyMedian = _percentile(latency, 0.5),
+             .latencyP95 = _percentile(latency, 0.95),
+             .allocationsPerFrame = static_cast<f64>(allocations) / static_cast<f64>(frames.size()),
+             .geometryBindsPerFrame = 0.0,
+             .trianglesPerFrame = 0.0,
+             .trianglesPerFrameWithoutLod = 0.0,
+             .lodSwitchesPerFrame = 0.0,
+             .meshletsPerFrame = 0.0,
+             .meshletsCulledPerFrame = 0.0,
+             .trianglesCulledPerFrame = 0.0,
+             .objectsOccludedPerFrame = 0.0,
+             .trianglesOccludedPerFrame = 0.0,
+             .bucketsRecordedPerFrame = 0.0,
+             .bucketsReusedPerFrame = 0.0,
+             .recordMillisecondsPerFrame = 0.0,
+             .savedMillisecondsPerFrame = 0.0,
+             .passStatisticsPerFrame = {},
+             .overdrawAverage = 0.0 };
+}
+
+HostAllocationSummary _summarizeHostAllocations(const vulkan::HostAllocatorStats& before, const vulkan::HostAllocatorStats& after,
+                                                ui32 frameCount)
+{
+    HostAllocationSummary summary{ .allocationsPerFrame = {},
+                                   .totalAllocationsPerFrame = 0.0,
+                                   .stats = after };
+
+    for (ui32 i = 0; i < vulkan::kHostAllocationScopeCount; ++i) {
+        const ui64 allocations = (after.scopes[i].allocations + after.scopes[i].reallocations)
+                               - (before.scopes[i].allocations + before.scopes[i].reallocations);
+        summary.allocationsPerFrame[i] = static_cast<f64>(allocations) / static_cast<f64>(frameCount);
+        summary.totalAllocationsPerFrame += summary.allocationsPerFrame[i];
+    }
+
+    return summary;
+}
+
+// NOTE: User and kernel time of every thread, std::clock() is that on POSIX but wall time on Windows
+f64 _processCpuSeconds()
+{
+#if defined(_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+    auto toSeconds = [](const FILETIME& time) {
+        return static_cast<f64>((static_cast<ui64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+    return static_cast<f64>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// NOTE: Nothing on screen changes, so continuous drawing only burns time. On demand draws the frame once after
+//  the scene stops and then sleeps in WaitEvents(), headless has no events and sleeps for the timeout instead.
+IdleSummary _runIdle(const BenchOptions& options, vulkan::VkBackend& backend, Window& window)
+{
+    backend.SetCaptureSchedule({});
+    backend.SetAnimating(false);
+    const auto presentBefore = backend.GetStats().present;
+    const f64 cpuBefore = _processCpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<f64>(options.idleSeconds));
+
+    while (std::chrono::steady_clock::now() < end) {
+        if (options.isOnDemand == false || backend.NeedsRedraw()) {
+            if (options.isHeadless == false) {
+                window.PollEvents();
+                window.ConsumeDamage();
+            }
+            backend.DrawFrame();
+        } else if (options.isHeadless) {
+            std::this_thread::sleep_for(std::chrono::duration<f64>(kIdleTimeoutSeconds));
+        } else {
+            window.WaitEvents(kIdleTimeoutSeconds);
+            if (window.ConsumeDamage()) {
+                backend.PresentLastFrame();
+            }
+        }
+    }
+    backend.WaitIdle();
+
+    const f64 wallSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    const f64 cpuSeconds = _processCpuSeconds() - cpuBefore;
+    const auto presentAfter = backend.GetStats().present;
+    return { .wallSeconds = wallSeconds,
+             .cpuSeconds = cpuSeconds,
+             .cpuPercent = 100.0 * cpuSeconds / wallSeconds,
+             .framesDrawn = presentAfter.framesDrawn - presentBefore.framesDrawn,
+             .framesRepresented = presentAfter.framesRepresented - presentBefore.framesRepresented };
+}
+
+// NOTE: The scene stops so the warm frames fill the cache with buckets that stay valid, then the budget drops so the
+//  next DrawFrame() evicts before it draws. That frame reuses nothing when the eviction invalidated the cache.
+EvictionCheck _runEvictionCheck(const BenchOptions& options, vulkan::VkBackend& backend, Window& window)
+{
+    backend.SetCaptureSchedule({});
+    backend.SetAnimating(false);
+    auto drawFrame = [&]() {
+        if (options.isHeadless == false) {
+            window.PollEvents();
+        }
+        backend.DrawFrame();
+    };
+
+    for (ui32 i = 0; i < kEvictionWarmFrames; ++i) {
+        drawFrame();
+    }
+    backend.WaitIdle();
+    const auto before = backend.GetStats();
+
+    backend.SetDeviceMemoryBudget(kEvictionCheckBudget);
+    drawFrame();
+    backend.WaitIdle();
+    const auto after = backend.GetStats();
+    backend.SetDeviceMemoryBudget(static_cast<vk::DeviceSize>(options.memoryBudgetMegabytes) * 1024 * 1024);
+
+    const ui64 bucketsReused = after.commands.bucketsReused - before.commands.bucketsReused;
+    return { .droppedTextureMips = after.eviction.droppedTextureMips - before.eviction.droppedTextureMips,
+             .bucketsRecorded = after.commands.bucketsRecorded - before.commands.bucketsRecorded,
+             .bucketsReused = bucketsReused,
+             .isPassing = bucketsReused == 0 };
+}
+
+// NOTE: Every group ends in a pass that loads and writes its image. Nobody reads 'hud' after 'hud_blend' or 'lit'
+//  after 'lit_late', so both go and with 'hud_blend' the clear it loaded. 'lit_blend' feeds 'composite' and stays.
+GraphCheck _runGraphCheck()
+{
+    using vulkan::RenderGraph;
+    const vulkan::RGImageDesc desc{ .format = vk::Format::eR8G8B8A8Unorm, .extent = { .width = 64, .height = 64 } };
+    const auto load = vk::AttachmentLoadOp::eLoad;
+    const auto clear = vk::AttachmentLoadOp::eClear;
+
+    RenderGraph graph;
+    const auto backbuffer = graph.ImportImage("backbuffer", desc, vk::ImageLayout::ePresentSrcKHR);
+    const auto hud = graph.CreateImage("hud", desc);
+    const auto lit = graph.CreateImage("lit", desc);
+
+    struct ExpectedPass
+    {
+        const char* name;
+        std::function<void(RenderGraph::PassBuilder&)> setup;
+        bool isCulled;
+    };
+    const ExpectedPass passes[] = {
+        { "scene", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(backbuffer, clear); }, false },
+        { "hud", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(hud, clear); }, true },
+        { "hud_blend", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(hud, load); }, true },
+        { "lit", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(lit, clear); }, false },
+        { "lit_blend", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(lit, load); }, false },
+        { "composite", [&](RenderGraph::PassBuilder& builder) {
+              builder.ReadTexture(lit);
+              builder.WriteColor(backbuffer, load);
+          }, false },
+        { "lit_late", [&](RenderGraph::PassBuilder& builder) { builder.WriteColor(lit, load); }, true },
+    };
+    for (const auto& pass : passes) {
+        graph.AddPass(pass.name, pass.setup, nullptr);
+    }
+
+    GraphCheck check{ .passCount = static_cast<ui32>(std::size(passes)), .wrongPasses = {}, .isPassing = true };
+    const auto culled = graph.FindCulledPasses();
+    for (ui32 i = 0; i < check.passCount; ++i) {
+        if (culled[i] != passes[i].isCulled) {
+            check.wrongPasses.push_back(std::string(passes[i].name) + (culled[i] ? " was culled" : " wasn't culled"));
+        }
+    }
+    check.isPassing = check.wrongPasses.empty();
+    return check;
+}
+
+// NOTE: Flat enough that _findJsonNumber() can read the baseline back without a JSON library,
+//  so per-scope keys carry the scope name instead of being nested
+std::string _writeJson(const BenchOptions& options, const std::string& deviceName, const Summary& summary,
+                       const HostAllocationSummary& host, const vulkan::BackendStats& stats, const IdleSummary* idle,
+                       const std::vector<FrameResult>& frames)
+{
+    const auto& objects = stats.objects;
+
+    std::string json;
+    char line[1024];
+
+    auto append = [&](const char* format, auto... arguments) {
+        std::snprintf(line, sizeof(line), format, arguments...);
+        json += line;
+    };
+
+    std::string escapedName;
+    for (const char c : deviceName) {
+        if (c == '"' || c == '\\') {
+            escapedName += '\\';
+        }
+        escapedName += c;
+    }
+
+    append("{\n");
+    append("  \"device\": \"%s\",\n", escapedName.c_str());
+    append("  \"config\": { \"seed\": %u, \"objects\": %u, \"meshes\": %u, \"materials\": %u, \"overdraw\": %.3f, "
+           "\"transparent\": %.3f, \"frames\": %u, \"warmup\": %u, \"width\": %u, \"height\": %u, \"headless\": %s, "
+           "\"host_arena\": %s, \"memory_budget_mb\": %u, \"lod_pixel_error\": %.3f, \"meshlet_culling\": %s, "
+           "\"occlusion_culling\": %s, \"capture_every\": %u, \"capture_format\": \"%s\", \"on_demand\": %s, "
+           "\"idle_seconds\": %.2f, \"low_latency\": %s, \"views\": %u, \"command_cache\": %s, \"paused\": %s, "
+           "\"pipeline_stats\": %s, \"overdraw_view\": %s },\n",
+           options.scene.seed, options.scene.objectCount, options.scene.meshCount, options.scene.materialCount,
+           options.scene.overdraw, options.scene.transparentFraction, options.frames, options.warmupFrames,
+           options.width, options.height, options.isHeadless ? "true" : "false", options.useHostArena ? "true" : "false",
+           options.memoryBudgetMegabytes, options.lodPixelError, options.useMeshletCulling ? "true" : "false",
+           options.useOcclusionCulling ? "true" : "false", options.captureInterval, GetImageFileExtension(options.captureFormat),
+           options.isOnDemand ? "true" : "false", options.idleSeconds, options.isLowLatency ? "true" : "false", options.viewCount,
+           options.useCommandCache ? "true" : "false", options.isPaused ? "true" : "false",
+           options.usePipelineStatistics ? "true" : "false", options.useOverdrawView ? "true" : "false");
+    append("  \"summary\": { \"cpu_ms_median\": %.4f, \"cpu_ms_p95\": %.4f, \"cpu_ms_max\": %.4f, "
+           "\"render_ms_median\": %.4f, \"render_ms_p95\": %.4f, ",
+           summary.cpuMedian, summary.cpuP95, summary.cpuMax, summary.renderMedian, summary.renderP95);
+    if (summary.gpuMedian >= 0.0) {
+        append("\"gpu_ms_median\": %.4f, \"gpu_ms_p95\": %.4f, ", summary.gpuMedian, summary.gpuP95);
+    }
+    if (summary.hizMedian >= 0.0) {
+        append("\"hiz_ms_median\": %.4f, \"hiz_ms_p95\": %.4f, ", summary.hizMedian, summary.hizP95);
+    }
+    if (summary.latencyMedian >= 0.0) {
+        append("\"latency_ms_median\": %.4f, \"latency_ms_p95\": %.4f, ", summary.latencyMedian, summary.latencyP95);
+    }
+    append("\"allocations_per_frame\": %.2f, \"driver_allocations_per_frame\": %.2f },\n",
+           summary.allocationsPerFrame, host.totalAllocationsPerFrame);
+    append("  \"host_allocations\": { ");
+    for (ui32 i = 0; i < vulkan::kHostAllocationScopeCount; ++i) {
+        const auto& scope = host.stats.scopes[i];
+        append("\"%s_per_frame\": %.2f, \"%s_peak_bytes\": %llu, \"%s_peak_internal_bytes\": %llu, ",
+               kHostScopeNames[i], host.allocationsPerFrame[i],
+               kHostScopeNames[i], static_cast<unsigned long long>(scope.peakBytes),
+               kHostScopeNames[i], static_cast<unsigned long long>(scope.peakInternalBytes));
+    }
+    append("\"arena_bytes_reserved\": %llu },\n", static_cast<unsigned long long>(host.stats.arenaBytesReserved));
+    append("  \"arenas\": { \"frame_capacity\": %zu, \"frame_peak_bytes\": %zu, \"frame_spills\": %llu, "
+           "\"scratch_capacity\": %zu, \"scratch_peak_bytes\": %zu, \"scratch_spills\": %llu },\n",
+           stats.frameArena.capacity, stats.frameArena.peakBytes, static_cast<unsigned long long>(stats.frameArena.spillCount),
+           stats.scratch.capacity, stats.scratch.peakBytes, static_cast<unsigned long long>(stats.scratch.spillCount));
+    // NOTE: Budget and usage summed over the device-local heaps, usage is the whole process with VK_EXT_memory_budget
+    const auto& allocator = stats.allocator;
+    vk::DeviceSize deviceLocalBudget = 0;
+    vk::DeviceSize deviceLocalUsage = 0;
+    for (ui32 i = 0; i < allocator.heapCount; ++i) {
+        if (allocator.heaps[i].isDeviceLocal) {
+            deviceLocalBudget += allocator.heaps[i].budget;
+            deviceLocalUsage += allocator.heaps[i].usage;
+        }
+    }
+    append("  \"memory\": { \"has_budget_extension\": %s, \"device_local_budget\": %llu, \"device_local_usage\": %llu, ",
+           allocator.hasBudgetExtension ? "true" : "false",
+           static_cast<unsigned long long>(deviceLocalBudget), static_cast<unsigned long long>(deviceLocalUsage));
+    for (ui32 i = 0; i < vulkan::kMemoryCategoryCount; ++i) {
+        append("\"%s_bytes\": %llu, ", kMemoryCategoryNames[i], static_cast<unsigned long long>(allocator.categoryBytes[i]));
+    }
+    append("\"demoted_allocations\": %u, \"evictions\": %u, \"evicted_bytes\": %llu, \"eviction_stalls\": %u, "
+           "\"staging_releases\": %u, \"dropped_texture_mips\": %u, \"demoted_buffers\": %u },\n",
+           allocator.demotedAllocations, allocator.evictionCount, static_cast<unsigned long long>(allocator.evictedBytes),
+           stats.eviction.stalls, stats.eviction.stagingReleases, stats.eviction.droppedTextureMips, stats.eviction.demotedBuffers);
+    append("  \"lod\": { \"triangles_per_frame\": %.1f, \"triangles_per_frame_without_lod\": %.1f, "
+           "\"lod_switches_per_frame\": %.2f, \"lod_levels\": %u },\n",
+           summary.trianglesPerFrame, summary.trianglesPerFrameWithoutLod, summary.lodSwitchesPerFrame, stats.lod.levelCount);
+    append("  \"meshlets\": { \"enabled\": %s, \"meshlets\": %u, \"meshlets_per_frame\": %.1f, \"meshlets_culled_per_frame\": %.1f, "
+           "\"triangles_culled_per_frame\": %.1f },\n",
+           stats.meshlets.isEnabled ? "true" : "false", stats.meshlets.meshletCount, summary.meshletsPerFrame,
+           summary.meshletsCulledPerFrame, summary.trianglesCulledPerFrame);
+    append("  \"occlusion\": { \"enabled\": %s, \"pyramid_levels\": %u, \"objects_occluded_per_frame\": %.2f, "
+           "\"triangles_occluded_per_frame\": %.1f },\n",
+           stats.occlusion.isEnabled ? "true" : "false", stats.occlusion.pyramidLevels, summary.objectsOccludedPerFrame,
+           summary.trianglesOccludedPerFrame);
+    const auto& capture = stats.capture;
+    append("  \"capture\": { \"enabled\": %s, \"frames_captured\": %llu, \"frames_written\": %llu, \"frames_dropped\": %llu, "
+           "\"frames_failed\": %llu, \"capture_bytes_written\": %llu, \"encode_ms_total\": %.3f },\n",
+           capture.isEnabled ? "true" : "false", static_cast<unsigned long long>(capture.framesCaptured),
+           static_cast<unsigned long long>(capture.framesWritten), static_cast<unsigned long long>(capture.framesDropped),
+           static_cast<unsigned long long>(capture.framesFailed), static_cast<unsigned long long>(capture.bytesWritten),
+           capture.encodeMilliseconds);
+    const auto& pacing = stats.latency.pacing;
+    append("  \"latency\": { \"enabled\": %s, \"present_wait\": %s, \"frames_paced\": %llu, \"pacing_sleep_ms_total\": %.3f, "
+           "\"predicted_period_ms\": %.4f, \"pacing_lead_ms\": %.4f },\n",
+           stats.latency.isEnabled ? "true" : "false", stats.latency.usesPresentWait ? "true" : "false",
+           static_cast<unsigned long long>(pacing.framesPaced), pacing.sleepMilliseconds, pacing.periodMilliseconds,
+           pacing.leadMilliseconds);
+    append("  \"views\": { \"view_count\": %u, \"swapchain_count\": %u, \"pipeline_cache_loaded_bytes\": %zu },\n",
+           stats.views.viewCount, stats.views.swapchainCount, stats.views.pipelineCacheBytesLoaded);
+    const auto& shaders = stats.shaders;
+    append("  \"shaders\": { \"module_identifiers\": %s, \"files_read\": %u, \"shaders\": %u, \"duplicate_files\": %u, "
+           "\"modules_created\": %u, \"pipelines_from_identifiers\": %u, \"pipelines_compiled\": %u },\n",
+           shaders.usesModuleIdentifiers ? "true" : "false", shaders.filesRead, shaders.shaderCount, shaders.duplicateFiles,
+           shaders.modulesCreated, shaders.pipelinesFromIdentifiers, shaders.pipelinesCompiled);
+    append("  \"commands\": { \"command_cache\": %s, \"command_buffers\": %u, \"buckets_recorded_per_frame\": %.3f, "
+           "\"buckets_reused_per_frame\": %.3f, \"record_ms_per_frame\": %.4f, \"saved_ms_per_frame\": %.4f },\n",
+           stats.commands.isEnabled ? "true" : "false", stats.commands.commandBufferCount, summary.bucketsRecordedPerFrame,
+           summary.bucketsReusedPerFrame, summary.recordMillisecondsPerFrame, summary.savedMillisecondsPerFrame);
+    // NOTE: Pass names are CamelCase, the keys get them in snake_case
+    append("  \"pipeline_statistics\": { \"enabled\": %s, ", stats.pipelineStatistics.isEnabled ? "true" : "false");
+    for (ui32 i = 0; i < stats.pipelineStatistics.passCount; ++i) {
+        std::string passKey;
+        for (const char c : stats.pipelineStatistics.passes[i].name) {
+            if (c >= 'A' && c <= 'Z') {
+                passKey += passKey.empty() ? "" : "_";
+                passKey += static_cast<char>(c - 'A' + 'a');
+            } else {
+                passKey += c;
+            }
+        }
+        for (size_t j = 0; j < std::size(kPassStatisticNames); ++j) {
+            append("\"%s_%s_per_frame\": %.1f, ", passKey.c_str(), kPassStatisticNames[j], summary.passStatisticsPerFrame[i][j]);
+        }
+    }
+    append("\"frames_measured\": %llu },\n", static_cast<unsigned long long>(stats.pipelineStatistics.framesMeasured));
+    append("  \"overdraw\": { \"enabled\": %s, \"fragments_per_pixel\": %.4f, \"last_frame_fragments_per_pixel\": %.4f },\n",
+           stats.overdraw.isEnabled ? "true" : "false", summary.overdrawAverage, stats.overdraw.lastFrameOverdraw);
+    const auto& init = stats.init;
+    append("  \"init\": { ");
+    for (const auto& step : init.graph.steps) {
+        append("\"%s_ms\": %.3f, \"%s_start_ms\": %.3f, ", step.name.c_str(), step.milliseconds, step.name.c_str(), step.startMilliseconds);
+    }
+    append("\"init_wall_ms\": %.3f, \"init_serial_ms\": %.3f, \"init_critical_path_ms\": %.3f, \"first_frame_ms\": %.3f },\n",
+           init.graph.wallMilliseconds, init.graph.serialMilliseconds, init.graph.criticalPathMilliseconds, init.firstFrameMilliseconds);
+    if (idle != nullptr) {
+        append("  \"idle\": { \"idle_on_demand\": %s, \"idle_wall_seconds\": %.3f, \"idle_cpu_seconds\": %.4f, "
+               "\"idle_cpu_percent\": %.3f, \"idle_frames_drawn\": %llu, \"idle_frames_represented\": %llu },\n",
+               stats.present.isOnDemand ? "true" : "false", idle->wallSeconds, idle->cpuSeconds, idle->cpuPercent,
+               static_cast<unsigned long long>(idle->framesDrawn), static_cast<unsigned long long>(idle->framesRepresented));
+    }
+    const auto& geometry = stats.geometry;
+    append("  \"geometry\": { \"meshes\": %u, \"vertex_capacity\": %llu, \"vertex_bytes_used\": %llu, \"index_capacity\": %llu, "
+           "\"index_bytes_used\": %llu, \"geometry_fragmented_bytes\": %llu, \"grows\": %u, \"defragments\": %u, "
+           "\"geometry_binds_per_frame\": %.2f },\n",
+           geometry.meshCount, static_cast<unsigned long long>(geometry.vertexCapacity), static_cast<unsigned long long>(geometry.vertexBytesUsed),
+           static_cast<unsigned long long>(geometry.indexCapacity), static_cast<unsigned long long>(geometry.indexBytesUsed),
+           static_cast<unsigned long long>(geometry.fragmentedBytes), geometry.growCount, geometry.defragmentCount,
+           summary.geometryBindsPerFrame);
+    append("  \"objects\": { \"device_memory_blocks\": %u, \"buffers\": %u, \"images\": %u, \"image_views\": %u, "
+           "\"samplers\": %u, \"pipelines\": %u, \"descriptor_sets\": %u, \"command_buffers\": %u, "
+           "\"semaphores\": %u, \"fences\": %u },\n",
+           objects.deviceMemoryBlocks, objects.buffers, objects.images, objects.imageViews, objects.samplers,
+           objects.pipelines, objects.descriptorSets, objects.commandBuffers, objects.semaphores, objects.fences);
+
+    append("  \"frames\": [\n");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const auto& frame = frames[i];
+        append("    { \"cpu_ms\": %.4f, \"render_ms\": %.4f, \"gpu_ms\": %.4f, \"hiz_ms\": %.4f, \"latency_ms\": %.4f, \"allocations\": %llu }%s\n",
+               frame.timing.cpuMilliseconds, frame.timing.renderMilliseconds, frame.timing.gpuMilliseconds, frame.timing.hizMilliseconds,
+               frame.timing.latencyMilliseconds,
+               static_cast<unsigned long long>(frame.allocations), i + 1 < frames.size() ? "," : "");
+    }
+    append("  ]\n");
+    append("}\n");
+
+    return json;
+}
+
+// NOTE: First "key": number in the text, keys are unique in what _writeJson() produces
+std::optional<f64> _findJsonNumber(const std::string& json, const std::string& key)
+{
+    const std::string quotedKey = '"' + key + "\":";
+    const auto position = json.find(quotedKey);
+    if (position == std::string::npos) {
+        return std::nullopt;
+    }
+
+    const char* begin = json.c_str() + position + quotedKey.size();
+    char* end = nullptr;
+    const f64 value = std::strtod(begin, &end);
+    if (end == begin) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+// NOTE: A metric regresses when it's worse than the baseline by more than 'threshold' of the baseline.
+//  Results from a different scene or device aren't comparable, that only gets a warning.
+bool _compare(const std::string& results, const std::string& baseline, f64 threshold)
+{
+    auto section = [](const std::string& json, const char* key) {
+        const auto begin = json.find(key);
+        return begin == std::string::npos ? std::string() : json.substr(begin, json.find('\n', begin) - begin);
+    };
+    if (section(results, "\"config\"") != section(baseline, "\"config\"")) {
+        std::printf("warning: baseline was recorded with a different configuration\n");
+    }
+    if (section(results, "\"device\"") != section(baseline, "\"device\"")) {
+        std::printf("warning: baseline was recorded on a different device\n");
+    }
+
+    std::printf("%-24s %12s %12s %9s\n", "metric", "baseline", "current", "change");
+
+    bool isPassing = true;
+    for (const char* metric : kComparedMetrics) {
+        const auto baselineValue = _findJsonNumber(baseline, metric);
+        const auto currentValue = _findJsonNumber(results, metric);
+        if (baselineValue.has_value() == false || currentValue.has_value() == false) {
+            continue;
+        }
+
+        const f64 change = baselineValue.value() > 0.0 ? currentValue.value() / baselineValue.value() - 1.0
+                                                       : (currentValue.value() > 0.0 ? 1.0 : 0.0);
+        const bool isRegression = change > threshold;
+        isPassing = isPassing && isRegression == false;
+
+        std::printf("%-24s %12.4f %12.4f %+8.1f%%%s\n", metric, baselineValue.value(), currentValue.value(),
+                    100.0 * change, isRegression ? "  REGRESSION" : "");
+    }
+
+    std::printf(isPassing ? "no regressions beyond %.1f%%\n" : "regressions beyond %.1f%%\n", 100.0 * threshold);
+
+    return isPassing;
+}
@@ -0,0 +1,124 @@
+// NOTE: Transform update time for a scene of roots with two levels of children below them,
+//  once with everything moving and once with a few roots moving, for every SIMD level and thread count.
+//  Usage: TransformHierarchyBench [transformCount] [iterations]
+
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib> // std::atoi
+#include <random>
+#include <vector>
+
+
+auto _makeTestHierarchy(ui32 transformCount, std::vector<TransformId>& roots) -> TransformHierarchy;
+
+
+int main(int argc, char** argv)
+{
+    const ui32 transformCount = argc > 1 ? static_cast<ui32>(std::atoi(argv[1])) : 1'000'000;
+    const ui32 iterations = argc > 2 ? static_cast<ui32>(std::atoi(argv[2])) : 10;
+
+    std::vector<TransformId> roots;
+    auto hierarchy = _makeTestHierarchy(transformCount, roots);
+
+    // NOTE: Stands in for the mapped per-frame buffer, one per frame in flight
+    std::vector<f32> uploadBuffers[2];
+    TransformUploadTarget targets[2];
+    for (ui32 i = 0; i < 2; ++i) {
+        uploadBuffers[i].resize(static_cast<size_t>(hierarchy.GetCount()) * 16);
+        targets[i] = TransformUploadTarget{ .worldMatrices = uploadBuffers[i].data(), .version = 0 };
+    }
+
+    std::vector<ui32> threadCounts;
+    for (ui32 threads = 1; threads < GetCpuFeatures().hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(GetCpuFeatures().hardwareThreads);
+
+    std::printf("%u transforms, %zu roots, %u iterations, best of\n", hierarchy.GetCount(), roots.size(), iterations);
+    std::printf("%-8s %-8s %8s %10s %10s %14s\n", "moving", "simd", "threads", "updated", "ms", "transforms/ms");
+
+    constexpr SimdLevel simdLevels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON };
+    // NOTE: Every root vs every hundredth root
+    constexpr ui32 rootStrides[] = { 1, 100 };
+
+    ui32 frame = 0;
+    for (const ui32 rootStride : rootStrides) {
+        for (const auto simdLevel : simdLevels) {
+            if (IsSimdLevelSupported(simdLevel) == false) {
+                continue;
+            }
+            hierarchy.SetSimdLevel(simdLevel);
+
+            for (const auto threads : threadCounts) {
+                JobSystem jobSystem;
+                jobSystem.Init(threads - 1);
+                f64 bestMilliseconds = 1e9;
+                ui32 updatedCount = 0;
+
+                for (ui32 i = 0; i < iterations; ++i, ++frame) {
+                    const f32 angle = 0.01f * static_cast<f32>(frame);
+                    const f32 rotation[4] = { 0.0f, 0.0f, std::sin(angle * 0.5f), std::cos(angle * 0.5f) };
+                    for (size_t root = 0; root < roots.size(); root += rootStride) {
+                        hierarchy.SetRotation(roots[root], rotation);
+                    }
+
+                    const auto start = std::chrono::steady_clock::now();
+                    hierarchy.Update(&targets[frame % 2], threads, jobSystem.GetParallelFor());
+                    const auto end = std::chrono::steady_clock::now();
+
+                    bestMilliseconds = std::min(bestMilliseconds, std::chrono::duration<f64, std::milli>(end - start).count());
+                    updatedCount = hierarchy.GetStats().updatedCount;
+                }
+                jobSystem.Shutdown();
+
+                std::printf("%-8s %-8s %8u %10u %10.2f %14.0f\n", rootStride == 1 ? "all" : "1%", GetSimdLevelName(simdLevel),
+                            threads, updatedCount, bestMilliseconds, updatedCount / bestMilliseconds);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+// NOTE: Every root has 'kChildren' children with 'kChildren' children each, created breadth-first per root,
+//  so the hierarchy has to sort them by depth
+TransformHierarchy _makeTestHierarchy(ui32 transformCount, std::vector<TransformId>& roots)
+{
+    constexpr ui32 kChildren = 16;
+    constexpr ui32 kSubtreeSize = 1 + kChildren + kChildren * kChildren;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<f32> position(-10.0f, 10.0f);
+
+    TransformHierarchy hierarchy;
+    hierarchy.Reserve(transformCount);
+
+    auto createNode = [&](TransformId parent) {
+        const TransformId id = hierarchy.Create(parent);
+        const f32 translation[3] = { position(random), position(random), position(random) };
+        const f32 rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        const f32 scale[3] = { 0.5f, 0.5f, 0.5f };
+        hierarchy.SetLocal(id, translation, rotation, scale);
+        return id;
+    };
+
+    for (ui32 subtree = 0; subtree < std::max(transformCount / kSubtreeSize, 1u); ++subtree) {
+        const TransformId root = createNode(kInvalidTransform);
+        roots.push_back(root);
+
+        for (ui32 child = 0; child < kChildren; ++child) {
+            const TransformId childId = createNode(root);
+            for (ui32 grandchild = 0; grandchild < kChildren; ++grandchild) {
+                createNode(childId);
+            }
+        }
+    }
+
+    return hierarchy;
+}
@@ -6,3 +6,6 @@ for %%f in (.\vkglsl\*.vert) do (
 for %%f in (.\vkglsl\*.frag) do (
 	glslangValidator.exe -V %%f -o .\spirv\%%~nf.fspv
 )
+for %%f in (.\vkglsl\*.comp) do (
+	glslangValidator.exe -V %%f -o .\spirv\%%~nf.cspv
+)
@@ -3,11 +3,18 @@
 
 
 in layout(location = 0) vec3 in_fragColor;
+in layout(location = 1) vec2 in_texCoord;
 
 out layout(location = 0) vec4 out_color;
 
+uniform layout(binding = 1) sampler2D u_albedo;
+
+uniform layout(push_constant) PushConstants {
+    vec4 color;
+} pc;
+
 
 void main()
 {
-    out_color = vec4(in_fragColor, 1.0);
+    out_color = texture(u_albedo, in_texCoord) * vec4(in_fragColor, 1.0) * pc.color;
 }
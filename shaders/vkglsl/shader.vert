@@ -4,18 +4,25 @@
 
 in layout(location = 0) vec2 in_position;
 in layout(location = 1) vec3 in_color;
+in layout(location = 2) vec2 in_texCoord;
 
 out layout(location = 0) vec3 out_fragColor;
+out layout(location = 1) vec2 out_texCoord;
 
 uniform layout(binding = 0) ubo_MVP {
-    mat4 model;
     mat4 view;
     mat4 projection;
 } ubo_mvp;
 
+// NOTE: World matrices of every transform, the draw passes the index as firstInstance
+readonly buffer layout(std430, binding = 2) Transforms {
+    mat4 world[];
+} u_transforms;
+
 
 void main()
 {
     out_fragColor = in_color;
-    gl_Position = ubo_mvp.projection * ubo_mvp.view * ubo_mvp.model * vec4(in_position, 0.0, 1.0);
+    out_texCoord = in_texCoord;
+    gl_Position = ubo_mvp.projection * ubo_mvp.view * u_transforms.world[gl_InstanceIndex] * vec4(in_position, 0.0, 1.0);
 }
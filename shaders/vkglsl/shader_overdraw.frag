@@ -0,0 +1,29 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+// NOTE: Overdraw analysis, replaces shader.frag. Every fragment that passed the depth test bumps the frame's counter
+//  and adds a fixed step through additive blending, so the image is an overdraw heat map and the counter its sum.
+layout(early_fragment_tests) in;
+
+out layout(location = 0) vec4 out_color;
+
+// NOTE: One counter per frame in flight, read back and zeroed by the host once the frame is done
+buffer layout(std430, binding = 9) Overdraw {
+    uint fragments[];
+} u_overdraw;
+
+uniform layout(push_constant) PushConstants {
+    vec4 color;
+    uint frameSlot;
+} pc;
+
+// NOTE: Eight layers to white
+const float kOverdrawStep = 1.0 / 8.0;
+
+
+void main()
+{
+    atomicAdd(u_overdraw.fragments[pc.frameSlot], 1u);
+    out_color = vec4(vec3(kOverdrawStep), 1.0);
+}
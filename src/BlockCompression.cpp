@@ -0,0 +1,522 @@
+#include "BlockCompression.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if LV_ARCH_X86
+    #include <immintrin.h>
+#endif
+
+
+// NOTE: 16 pixels as four channel arrays, so the kernels can work on 4 (SSE) or 8 (AVX2) pixels per instruction
+struct BlockSoA
+{
+    alignas(32) f32 channels[4][16];
+};
+
+// NOTE: The only hot loops of the encoders, everything else runs once per block
+struct BlockKernels
+{
+    void (*computeBounds)(const BlockSoA& block, f32* minValues, f32* maxValues);
+    // NOTE: Projects every pixel onto 'axis' starting from 'origin' and quantizes to [0, maxLevel]
+    void (*projectIndices)(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices);
+};
+
+
+auto _getBlockKernels(SimdLevel simdLevel)                                      -> const BlockKernels&;
+auto _loadBlock(const ui8* block)                                               -> BlockSoA;
+auto _chooseEndpoints(const BlockSoA& block, const BlockKernels& kernels,
+                      ui32 channelCount, f32 insetDivisor,
+                      f32* endpoint0, f32* endpoint1)                           -> void;
+
+auto _encodeBC1(const BlockSoA& block, const BlockKernels& kernels, ui8* output)                -> void;
+auto _encodeBC4(const BlockSoA& block, const BlockKernels& kernels, ui32 channel, ui8* output)  -> void;
+auto _encodeBC7(const BlockSoA& block, const BlockKernels& kernels, ui8* output)                -> void;
+
+auto _computeBoundsScalar(const BlockSoA& block, f32* minValues, f32* maxValues)                                    -> void;
+auto _projectIndicesScalar(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)   -> void;
+#if LV_ARCH_X86
+auto _computeBoundsSSE2(const BlockSoA& block, f32* minValues, f32* maxValues)                                      -> void;
+auto _projectIndicesSSE2(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)     -> void;
+LV_TARGET_AVX2
+auto _computeBoundsAVX2(const BlockSoA& block, f32* minValues, f32* maxValues)                                      -> void;
+LV_TARGET_AVX2
+auto _projectIndicesAVX2(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)     -> void;
+#endif
+
+
+ui32 GetBlockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+ui64 GetCompressedSize(BlockFormat format, ui32 width, ui32 height)
+{
+    const ui64 blocksX = (width + kBlockDim - 1) / kBlockDim;
+    const ui64 blocksY = (height + kBlockDim - 1) / kBlockDim;
+
+    return blocksX * blocksY * GetBlockBytes(format);
+}
+
+const char* GetBlockFormatName(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+void CompressBlock(BlockFormat format, const ui8* block, ui8* output, SimdLevel simdLevel)
+{
+    const auto& kernels = _getBlockKernels(simdLevel);
+    const auto soa = _loadBlock(block);
+
+    switch (format) {
+    case BlockFormat::BC1:
+        _encodeBC1(soa, kernels, output);
+        break;
+    case BlockFormat::BC3:
+        _encodeBC4(soa, kernels, 3, output);
+        _encodeBC1(soa, kernels, output + 8);
+        break;
+    case BlockFormat::BC5:
+        _encodeBC4(soa, kernels, 0, output);
+        _encodeBC4(soa, kernels, 1, output + 8);
+        break;
+    case BlockFormat::BC7:
+        _encodeBC7(soa, kernels, output);
+        break;
+    }
+}
+
+void CompressImage(BlockFormat format, const ui8* pixels, ui32 width, ui32 height, ui8* output,
+                   SimdLevel simdLevel, ui32 threadCount, const ParallelFor& parallelFor)
+{
+    if (IsSimdLevelSupported(simdLevel) == false) {
+        throw std::runtime_error("CompressImage(): Requested SIMD level is not supported by this CPU!");
+    }
+
+    const ui32 blocksX = (width + kBlockDim - 1) / kBlockDim;
+    const ui32 blocksY = (height + kBlockDim - 1) / kBlockDim;
+    const ui32 blockBytes = GetBlockBytes(format);
+
+    auto compressRows = [&](ui32 firstRow, ui32 lastRow) {
+        ui8 block[kBlockDim * kBlockDim * 4];
+
+        for (ui32 by = firstRow; by < lastRow; ++by) {
+            for (ui32 bx = 0; bx < blocksX; ++bx) {
+                for (ui32 y = 0; y < kBlockDim; ++y) {
+                    const ui32 py = std::min(by * kBlockDim + y, height - 1);
+                    for (ui32 x = 0; x < kBlockDim; ++x) {
+                        const ui32 px = std::min(bx * kBlockDim + x, width - 1);
+                        const ui8* source = pixels + (static_cast<size_t>(py) * width + px) * 4;
+                        std::copy(source, source + 4, block + (y * kBlockDim + x) * 4);
+                    }
+                }
+
+                CompressBlock(format, block, output + (static_cast<size_t>(by) * blocksX + bx) * blockBytes, simdLevel);
+            }
+        }
+    };
+
+    threadCount = std::clamp(threadCount, 1u, blocksY);
+    if (threadCount == 1 || parallelFor == nullptr) {
+        compressRows(0, blocksY);
+        return;
+    }
+
+    const ui32 rowsPerThread = (blocksY + threadCount - 1) / threadCount;
+    parallelFor(threadCount, [&](ui32 chunk) {
+        const ui32 firstRow = std::min(chunk * rowsPerThread, blocksY);
+        compressRows(firstRow, std::min(firstRow + rowsPerThread, blocksY));
+    });
+}
+
+
+
+const BlockKernels& _getBlockKernels(SimdLevel simdLevel)
+{
+    static const BlockKernels scalarKernels{ _computeBoundsScalar, _projectIndicesScalar };
+#if LV_ARCH_X86
+    static const BlockKernels sse2Kernels{ _computeBoundsSSE2, _projectIndicesSSE2 };
+    static const BlockKernels avx2Kernels{ _computeBoundsAVX2, _projectIndicesAVX2 };
+
+    switch (simdLevel) {
+    case SimdLevel::SSE2: return sse2Kernels;
+    case SimdLevel::AVX2: return avx2Kernels;
+    default: break;
+    }
+#endif
+    // NOTE: No NEON kernels yet, ARM builds use the scalar ones
+
+    return scalarKernels;
+}
+
+BlockSoA _loadBlock(const ui8* block)
+{
+    BlockSoA soa;
+
+    for (ui32 i = 0; i < 16; ++i) {
+        for (ui32 c = 0; c < 4; ++c) {
+            soa.channels[c][i] = block[i * 4 + c];
+        }
+    }
+
+    return soa;
+}
+
+// NOTE: Bounding box of the block, inset a bit because the extremes are rarely worth an exact endpoint.
+//  The box diagonal is flipped for channels that go down while the channel with the widest range goes up,
+//  otherwise gradients like red->green would be encoded along the wrong diagonal.
+void _chooseEndpoints(const BlockSoA& block, const BlockKernels& kernels, ui32 channelCount, f32 insetDivisor,
+                      f32* endpoint0, f32* endpoint1)
+{
+    f32 minValues[4];
+    f32 maxValues[4];
+    kernels.computeBounds(block, minValues, maxValues);
+
+    ui32 mainChannel = 0;
+    for (ui32 c = 1; c < channelCount; ++c) {
+        if (maxValues[c] - minValues[c] > maxValues[mainChannel] - minValues[mainChannel]) {
+            mainChannel = c;
+        }
+    }
+
+    f32 mean[4] = {};
+    for (ui32 c = 0; c < channelCount; ++c) {
+        for (ui32 i = 0; i < 16; ++i) {
+            mean[c] += block.channels[c][i];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    for (ui32 c = 0; c < channelCount; ++c) {
+        const f32 inset = (maxValues[c] - minValues[c]) / insetDivisor;
+        endpoint0[c] = minValues[c] + inset;
+        endpoint1[c] = maxValues[c] - inset;
+
+        if (c == mainChannel) {
+            continue;
+        }
+
+        f32 covariance = 0.0f;
+        for (ui32 i = 0; i < 16; ++i) {
+            covariance += (block.channels[mainChannel][i] - mean[mainChannel]) * (block.channels[c][i] - mean[c]);
+        }
+        if (covariance < 0.0f) {
+            std::swap(endpoint0[c], endpoint1[c]);
+        }
+    }
+}
+
+
+void _encodeBC1(const BlockSoA& block, const BlockKernels& kernels, ui8* output)
+{
+    f32 endpoint0[4];
+    f32 endpoint1[4];
+    _chooseEndpoints(block, kernels, 3, 16.0f, endpoint0, endpoint1);
+
+    auto to565 = [](const f32* color) -> ui16 {
+        const auto r = static_cast<ui32>(std::nearbyint(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+        const auto g = static_cast<ui32>(std::nearbyint(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+        const auto b = static_cast<ui32>(std::nearbyint(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+        return static_cast<ui16>((r << 11) | (g << 5) | b);
+    };
+    auto from565 = [](ui16 color, f32* result) {
+        const ui32 r = (color >> 11) & 31;
+        const ui32 g = (color >> 5) & 63;
+        const ui32 b = color & 31;
+        result[0] = static_cast<f32>((r << 3) | (r >> 2));
+        result[1] = static_cast<f32>((g << 2) | (g >> 4));
+        result[2] = static_cast<f32>((b << 3) | (b >> 2));
+        result[3] = 0.0f;
+    };
+
+    // NOTE: color0 > color1 selects the 4-color mode, equal colors fall into 3-color mode where index 0 is still color0
+    ui16 color0 = to565(endpoint1);
+    ui16 color1 = to565(endpoint0);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    ui32 indexBits = 0;
+    if (color0 != color1) {
+        f32 origin[4];
+        f32 end[4];
+        from565(color0, origin);
+        from565(color1, end);
+        const f32 axis[4] = { end[0] - origin[0], end[1] - origin[1], end[2] - origin[2], 0.0f };
+
+        ui8 levels[16];
+        kernels.projectIndices(block, origin, axis, 3.0f, levels);
+
+        // NOTE: Palette order is color0, color1, 2/3*c0 + 1/3*c1, 1/3*c0 + 2/3*c1
+        constexpr ui32 kLevelToIndex[4] = { 0, 2, 3, 1 };
+        for (ui32 i = 0; i < 16; ++i) {
+            indexBits |= kLevelToIndex[levels[i]] << (i * 2);
+        }
+    }
+
+    output[0] = static_cast<ui8>(color0 & 0xff);
+    output[1] = static_cast<ui8>(color0 >> 8);
+    output[2] = static_cast<ui8>(color1 & 0xff);
+    output[3] = static_cast<ui8>(color1 >> 8);
+    for (ui32 i = 0; i < 4; ++i) {
+        output[4 + i] = static_cast<ui8>(indexBits >> (i * 8));
+    }
+}
+
+void _encodeBC4(const BlockSoA& block, const BlockKernels& kernels, ui32 channel, ui8* output)
+{
+    f32 minValues[4];
+    f32 maxValues[4];
+    kernels.computeBounds(block, minValues, maxValues);
+
+    // NOTE: value0 > value1 selects the 8-value mode
+    const auto value0 = static_cast<ui8>(maxValues[channel]);
+    const auto value1 = static_cast<ui8>(minValues[channel]);
+
+    ui64 indexBits = 0;
+    if (value0 != value1) {
+        f32 origin[4] = {};
+        f32 axis[4] = {};
+        origin[channel] = value0;
+        axis[channel] = static_cast<f32>(value1) - static_cast<f32>(value0);
+
+        ui8 levels[16];
+        kernels.projectIndices(block, origin, axis, 7.0f, levels);
+
+        // NOTE: Palette order is value0, value1, then the 6 interpolated values from value0 to value1
+        for (ui32 i = 0; i < 16; ++i) {
+            const ui64 index = levels[i] == 0 ? 0 : (levels[i] == 7 ? 1 : levels[i] + 1);
+            indexBits |= index << (i * 3);
+        }
+    }
+
+    output[0] = value0;
+    output[1] = value1;
+    for (ui32 i = 0; i < 6; ++i) {
+        output[2 + i] = static_cast<ui8>(indexBits >> (i * 8));
+    }
+}
+
+// NOTE: Mode 6: 7-bit RGBA endpoints with a p-bit each and 4-bit indices, single subset.
+//  Layout: mode (7 bits: 1000000) | R0 R1 G0 G1 B0 B1 A0 A1 (7 bits each) | P0 P1 | anchor index (3 bits) | 15 x 4-bit indices
+void _encodeBC7(const BlockSoA& block, const BlockKernels& kernels, ui8* output)
+{
+    f32 endpoint0[4];
+    f32 endpoint1[4];
+    _chooseEndpoints(block, kernels, 4, 32.0f, endpoint0, endpoint1);
+
+    ui32 quantized[2][4];
+    ui32 pBits[2];
+    f32 reconstructed[2][4];
+
+    const f32* endpoints[2] = { endpoint0, endpoint1 };
+    for (ui32 e = 0; e < 2; ++e) {
+        f32 bestError = std::numeric_limits<f32>::max();
+
+        for (ui32 p = 0; p < 2; ++p) {
+            ui32 candidate[4];
+            f32 error = 0.0f;
+            for (ui32 c = 0; c < 4; ++c) {
+                const f32 value = std::clamp(endpoints[e][c], 0.0f, 255.0f);
+                candidate[c] = static_cast<ui32>(std::clamp(std::nearbyint((value - p) / 2.0f), 0.0f, 127.0f));
+                const f32 difference = static_cast<f32>((candidate[c] << 1) | p) - value;
+                error += difference * difference;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                pBits[e] = p;
+                std::copy(candidate, candidate + 4, quantized[e]);
+            }
+        }
+
+        for (ui32 c = 0; c < 4; ++c) {
+            reconstructed[e][c] = static_cast<f32>((quantized[e][c] << 1) | pBits[e]);
+        }
+    }
+
+    ui8 indices[16] = {};
+    const f32 axis[4] = { reconstructed[1][0] - reconstructed[0][0], reconstructed[1][1] - reconstructed[0][1],
+                          reconstructed[1][2] - reconstructed[0][2], reconstructed[1][3] - reconstructed[0][3] };
+    kernels.projectIndices(block, reconstructed[0], axis, 15.0f, indices);
+
+    // NOTE: The anchor index only stores 3 bits, its top bit must be 0
+    if (indices[0] >= 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (auto& index : indices) {
+            index = static_cast<ui8>(15 - index);
+        }
+    }
+
+    ui64 bits[2] = {};
+    ui32 position = 0;
+    auto write = [&bits, &position](ui64 value, ui32 count) {
+        const ui32 word = position / 64;
+        const ui32 shift = position % 64;
+        bits[word] |= value << shift;
+        if (shift + count > 64) {
+            bits[word + 1] |= value >> (64 - shift);
+        }
+        position += count;
+    };
+
+    write(1 << 6, 7);
+    for (ui32 c = 0; c < 4; ++c) {
+        write(quantized[0][c], 7);
+        write(quantized[1][c], 7);
+    }
+    write(pBits[0], 1);
+    write(pBits[1], 1);
+    write(indices[0], 3);
+    for (ui32 i = 1; i < 16; ++i) {
+        write(indices[i], 4);
+    }
+
+    for (ui32 i = 0; i < 16; ++i) {
+        output[i] = static_cast<ui8>(bits[i / 8] >> ((i % 8) * 8));
+    }
+}
+
+
+void _computeBoundsScalar(const BlockSoA& block, f32* minValues, f32* maxValues)
+{
+    for (ui32 c = 0; c < 4; ++c) {
+        minValues[c] = block.channels[c][0];
+        maxValues[c] = block.channels[c][0];
+        for (ui32 i = 1; i < 16; ++i) {
+            minValues[c] = std::min(minValues[c], block.channels[c][i]);
+            maxValues[c] = std::max(maxValues[c], block.channels[c][i]);
+        }
+    }
+}
+
+// NOTE: The SIMD versions do exactly the same operations in the same order, so every level produces identical blocks
+void _projectIndicesScalar(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)
+{
+    const f32 lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+    if (lengthSquared == 0.0f) {
+        std::fill(indices, indices + 16, 0);
+        return;
+    }
+    const f32 scale = maxLevel / lengthSquared;
+
+    for (ui32 i = 0; i < 16; ++i) {
+        f32 dot = (block.channels[0][i] - origin[0]) * axis[0];
+        dot = dot + (block.channels[1][i] - origin[1]) * axis[1];
+        dot = dot + (block.channels[2][i] - origin[2]) * axis[2];
+        dot = dot + (block.channels[3][i] - origin[3]) * axis[3];
+
+        const f32 level = std::min(std::max(dot * scale, 0.0f), maxLevel);
+        indices[i] = static_cast<ui8>(std::nearbyint(level));
+    }
+}
+
+#if LV_ARCH_X86
+void _computeBoundsSSE2(const BlockSoA& block, f32* minValues, f32* maxValues)
+{
+    for (ui32 c = 0; c < 4; ++c) {
+        const f32* channel = block.channels[c];
+
+        __m128 minimum = _mm_min_ps(_mm_min_ps(_mm_load_ps(channel), _mm_load_ps(channel + 4)),
+                                    _mm_min_ps(_mm_load_ps(channel + 8), _mm_load_ps(channel + 12)));
+        __m128 maximum = _mm_max_ps(_mm_max_ps(_mm_load_ps(channel), _mm_load_ps(channel + 4)),
+                                    _mm_max_ps(_mm_load_ps(channel + 8), _mm_load_ps(channel + 12)));
+
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+        maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        minValues[c] = _mm_cvtss_f32(minimum);
+        maxValues[c] = _mm_cvtss_f32(maximum);
+    }
+}
+
+void _projectIndicesSSE2(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)
+{
+    const f32 lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+    if (lengthSquared == 0.0f) {
+        std::fill(indices, indices + 16, 0);
+        return;
+    }
+    const __m128 scale = _mm_set1_ps(maxLevel / lengthSquared);
+    const __m128 maxLevels = _mm_set1_ps(maxLevel);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128i levels[4];
+    for (ui32 i = 0; i < 4; ++i) {
+        __m128 dot = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.channels[0] + i * 4), _mm_set1_ps(origin[0])), _mm_set1_ps(axis[0]));
+        dot = _mm_add_ps(dot, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.channels[1] + i * 4), _mm_set1_ps(origin[1])), _mm_set1_ps(axis[1])));
+        dot = _mm_add_ps(dot, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.channels[2] + i * 4), _mm_set1_ps(origin[2])), _mm_set1_ps(axis[2])));
+        dot = _mm_add_ps(dot, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.channels[3] + i * 4), _mm_set1_ps(origin[3])), _mm_set1_ps(axis[3])));
+
+        const __m128 level = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dot, scale), zero), maxLevels);
+        levels[i] = _mm_cvtps_epi32(level);
+    }
+
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(levels[0], levels[1]), _mm_packs_epi32(levels[2], levels[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), packed);
+}
+
+LV_TARGET_AVX2
+void _computeBoundsAVX2(const BlockSoA& block, f32* minValues, f32* maxValues)
+{
+    for (ui32 c = 0; c < 4; ++c) {
+        const f32* channel = block.channels[c];
+        const __m256 low = _mm256_load_ps(channel);
+        const __m256 high = _mm256_load_ps(channel + 8);
+
+        const __m256 minimum8 = _mm256_min_ps(low, high);
+        const __m256 maximum8 = _mm256_max_ps(low, high);
+        __m128 minimum = _mm_min_ps(_mm256_castps256_ps128(minimum8), _mm256_extractf128_ps(minimum8, 1));
+        __m128 maximum = _mm_max_ps(_mm256_castps256_ps128(maximum8), _mm256_extractf128_ps(maximum8, 1));
+
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+        maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        minValues[c] = _mm_cvtss_f32(minimum);
+        maxValues[c] = _mm_cvtss_f32(maximum);
+    }
+}
+
+LV_TARGET_AVX2
+void _projectIndicesAVX2(const BlockSoA& block, const f32* origin, const f32* axis, f32 maxLevel, ui8* indices)
+{
+    const f32 lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+    if (lengthSquared == 0.0f) {
+        std::fill(indices, indices + 16, 0);
+        return;
+    }
+    const __m256 scale = _mm256_set1_ps(maxLevel / lengthSquared);
+    const __m256 maxLevels = _mm256_set1_ps(maxLevel);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256i levels[2];
+    for (ui32 i = 0; i < 2; ++i) {
+        __m256 dot = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.channels[0] + i * 8), _mm256_set1_ps(origin[0])), _mm256_set1_ps(axis[0]));
+        dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.channels[1] + i * 8), _mm256_set1_ps(origin[1])), _mm256_set1_ps(axis[1])));
+        dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.channels[2] + i * 8), _mm256_set1_ps(origin[2])), _mm256_set1_ps(axis[2])));
+        dot = _mm256_add_ps(dot, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.channels[3] + i * 8), _mm256_set1_ps(origin[3])), _mm256_set1_ps(axis[3])));
+
+        const __m256 level = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(dot, scale), zero), maxLevels);
+        levels[i] = _mm256_cvtps_epi32(level);
+    }
+
+    // NOTE: AVX2 packs work per 128-bit lane, the permute puts the 16 results back in pixel order
+    const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(levels[0], levels[1]), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), packed);
+}
+#endif
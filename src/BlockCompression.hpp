@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core.hpp"
+#include "CpuFeatures.hpp"
+#include "JobSystem.hpp"
+
+
+// NOTE: Formats the encoder can produce. Everything is encoded from RGBA8:
+//  BC1 - RGB, 4 bpp, alpha is ignored
+//  BC3 - RGBA, 8 bpp, BC1 color + BC4 alpha
+//  BC5 - RG, 8 bpp, two BC4 channels, for normal maps
+//  BC7 - RGBA, 8 bpp, mode 6 only (one subset, 4-bit indices), good enough for a real-time encoder
+enum class BlockFormat : ui32
+{
+    BC1 = 0,
+    BC3,
+    BC5,
+    BC7
+};
+
+constexpr ui32 kBlockDim = 4;
+
+
+ui32 GetBlockBytes(BlockFormat format);
+ui64 GetCompressedSize(BlockFormat format, ui32 width, ui32 height);
+const char* GetBlockFormatName(BlockFormat format);
+
+// NOTE: 'block' is 4x4 RGBA8 pixels row by row, 'output' gets GetBlockBytes(format) bytes
+void CompressBlock(BlockFormat format, const ui8* block, ui8* output, SimdLevel simdLevel);
+// NOTE: 'pixels' is tightly packed RGBA8. Partial blocks at the right/bottom edges repeat the last column/row.
+//  Rows of blocks are split into 'threadCount' chunks run through 'parallelFor', the output is the same for any
+//  thread count and SIMD level.
+void CompressImage(BlockFormat format, const ui8* pixels, ui32 width, ui32 height, ui8* output,
+                   SimdLevel simdLevel = GetBestSimdLevel(), ui32 threadCount = 1, const ParallelFor& parallelFor = nullptr);
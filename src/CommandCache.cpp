@@ -0,0 +1,119 @@
+#include "CommandCache.hpp"
+
+#include <stdexcept> // std::runtime_error
+
+
+constexpr ui32 kNoSlot = ~0u;
+
+
+namespace vulkan
+{
+
+void CommandCache::Init(const vk::Device& device, ui32 queueFamilyIndex, ui32 slotCount,
+                        const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_recordingSlot = kNoSlot;
+    m_recordingDraws = 0;
+
+    // NOTE: Slots are recorded again one by one, beginning one resets it
+    const vk::CommandPoolCreateInfo commandPoolInfo{ .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                                     .queueFamilyIndex = queueFamilyIndex };
+    m_commandPool = m_device.createCommandPool(commandPoolInfo, m_allocationCallbacks);
+
+    const vk::CommandBufferAllocateInfo allocateInfo{ .commandPool = m_commandPool,
+                                                      .level = vk::CommandBufferLevel::eSecondary,
+                                                      .commandBufferCount = slotCount };
+    const auto commandBuffers = m_device.allocateCommandBuffers(allocateInfo);
+
+    m_slots.reserve(slotCount);
+    for (const auto& commandBuffer : commandBuffers) {
+        m_slots.push_back(Slot{ .commandBuffer = commandBuffer, .version = 0, .generation = 0, .isRecorded = false });
+    }
+}
+
+void CommandCache::Shutdown()
+{
+    if (m_slots.empty()) {
+        return;
+    }
+
+    // NOTE: Destroying the pool frees its command buffers
+    m_device.destroyCommandPool(m_commandPool, m_allocationCallbacks);
+    m_slots.clear();
+}
+
+CachedCommands CommandCache::Acquire(ui32 slot, ui64 version, ui32 drawCount, const vk::CommandBufferInheritanceInfo& inheritance)
+{
+    if (m_recordingSlot != kNoSlot) {
+        throw std::runtime_error("CommandCache::Acquire(): Another slot is still recording!");
+    }
+
+    auto& entry = m_slots[slot];
+    const ui32 generation = m_generation.load(std::memory_order_acquire);
+    if (entry.isRecorded && entry.version == version && entry.generation == generation) {
+        m_bucketsReused.fetch_add(1, std::memory_order_relaxed);
+        m_drawsReused.fetch_add(drawCount, std::memory_order_relaxed);
+        return { .commandBuffer = entry.commandBuffer, .isRecording = false };
+    }
+
+    const vk::CommandBufferBeginInfo beginInfo{ .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                                                .pInheritanceInfo = &inheritance };
+    entry.commandBuffer.begin(beginInfo);
+    entry.version = version;
+    entry.generation = generation;
+    entry.isRecorded = false;
+
+    m_recordingSlot = slot;
+    m_recordingDraws = drawCount;
+    m_recordStart = std::chrono::steady_clock::now();
+    return { .commandBuffer = entry.commandBuffer, .isRecording = true };
+}
+
+void CommandCache::EndRecording()
+{
+    if (m_recordingSlot == kNoSlot) {
+        throw std::runtime_error("CommandCache::EndRecording(): No slot is recording!");
+    }
+
+    auto& entry = m_slots[m_recordingSlot];
+    entry.commandBuffer.end();
+    entry.isRecorded = true;
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_recordStart);
+    m_recordNanoseconds.fetch_add(static_cast<ui64>(elapsed.count()), std::memory_order_relaxed);
+    m_bucketsRecorded.fetch_add(1, std::memory_order_relaxed);
+    m_drawsRecorded.fetch_add(m_recordingDraws, std::memory_order_relaxed);
+    m_recordingSlot = kNoSlot;
+}
+
+void CommandCache::Invalidate()
+{
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+ui32 CommandCache::GetSlotCount() const
+{
+    return static_cast<ui32>(m_slots.size());
+}
+
+CommandCacheStats CommandCache::GetStats() const
+{
+    const ui64 drawsRecorded = m_drawsRecorded.load(std::memory_order_relaxed);
+    const ui64 drawsReused = m_drawsReused.load(std::memory_order_relaxed);
+    const f64 recordMilliseconds = static_cast<f64>(m_recordNanoseconds.load(std::memory_order_relaxed)) / 1e6;
+    const f64 savedMilliseconds = drawsRecorded > 0 ? recordMilliseconds * static_cast<f64>(drawsReused) / static_cast<f64>(drawsRecorded)
+                                                    : 0.0;
+
+    return { .bucketsRecorded = m_bucketsRecorded.load(std::memory_order_relaxed),
+             .bucketsReused = m_bucketsReused.load(std::memory_order_relaxed),
+             .drawsRecorded = drawsRecorded,
+             .drawsReused = drawsReused,
+             .recordMilliseconds = recordMilliseconds,
+             .savedMilliseconds = savedMilliseconds,
+             .commandBufferCount = static_cast<ui32>(m_slots.size()),
+             .isEnabled = m_slots.empty() == false };
+}
+
+}
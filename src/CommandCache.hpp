@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: Totals since Init()
+struct CommandCacheStats
+{
+    // NOTE: Every executed bucket was either recorded again or reused as it was
+    ui64 bucketsRecorded;
+    ui64 bucketsReused;
+    ui64 drawsRecorded;
+    ui64 drawsReused;
+    // NOTE: Spent recording buckets, from Acquire() to EndRecording()
+    f64 recordMilliseconds;
+    // NOTE: Reused draws at the average cost of a recorded one
+    f64 savedMilliseconds;
+    ui32 commandBufferCount;
+    bool isEnabled;
+};
+
+struct CachedCommands
+{
+    vk::CommandBuffer commandBuffer;
+    // NOTE: The content changed, the command buffer is begun and has to be recorded and ended with EndRecording()
+    bool isRecording;
+};
+
+
+// NOTE: Secondary command buffers that are only recorded again when what they draw changed. Callers split their draws
+//  into buckets, give every bucket a slot of its own and a version of its content, a hash of the draws for example.
+//  A slot whose version didn't change since it was recorded is executed as it is.
+//  A slot must not be pending on the GPU when it's acquired, callers keep one per frame in flight for that.
+//  All slots come from one pool, so every method but Invalidate() and GetStats() belongs to one thread.
+class CommandCache
+{
+public:
+    CommandCache() = default;
+
+    CommandCache(const CommandCache&) = delete;
+    CommandCache& operator=(const CommandCache&) = delete;
+
+    void Init(const vk::Device& device, ui32 queueFamilyIndex, ui32 slotCount, const vk::AllocationCallbacks* allocationCallbacks);
+    // NOTE: The device must be done with every slot
+    void Shutdown();
+
+    // NOTE: 'drawCount' is only counted in the stats. 'inheritance' is only read when the slot has to be recorded.
+    CachedCommands Acquire(ui32 slot, ui64 version, ui32 drawCount, const vk::CommandBufferInheritanceInfo& inheritance);
+    void EndRecording();
+    // NOTE: Any thread. Every slot is recorded again on its next Acquire(), for when something the versions don't
+    //  cover changed, like the buffers the draws read from.
+    void Invalidate();
+
+    ui32 GetSlotCount() const;
+    CommandCacheStats GetStats() const;
+
+private:
+    struct Slot
+    {
+        vk::CommandBuffer commandBuffer;
+        ui64 version;
+        ui32 generation;
+        bool isRecorded;
+    };
+
+private:
+    vk::Device                      m_device;
+    const vk::AllocationCallbacks*  m_allocationCallbacks;
+    vk::CommandPool                 m_commandPool;
+
+    std::vector<Slot>               m_slots;
+    std::atomic<ui32>               m_generation{ 0 };
+    // NOTE: Slot being recorded, ~0u when none is
+    ui32                            m_recordingSlot;
+    ui32                            m_recordingDraws;
+    std::chrono::steady_clock::time_point m_recordStart;
+
+    // NOTE: Written by the recording thread, read by GetStats()
+    std::atomic<ui64>               m_bucketsRecorded{ 0 };
+    std::atomic<ui64>               m_bucketsReused{ 0 };
+    std::atomic<ui64>               m_drawsRecorded{ 0 };
+    std::atomic<ui64>               m_drawsReused{ 0 };
+    std::atomic<ui64>               m_recordNanoseconds{ 0 };
+};
+
+}
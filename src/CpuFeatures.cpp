@@ -0,0 +1,86 @@
+#include "CpuFeatures.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#if LV_ARCH_X86 && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+
+auto _queryCpuFeatures() -> CpuFeatures;
+
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures features = _queryCpuFeatures();
+    return features;
+}
+
+SimdLevel GetBestSimdLevel()
+{
+    const auto& features = GetCpuFeatures();
+
+    if (features.avx2) {
+        return SimdLevel::AVX2;
+    }
+    if (features.sse2) {
+        return SimdLevel::SSE2;
+    }
+    if (features.neon) {
+        return SimdLevel::NEON;
+    }
+    return SimdLevel::Scalar;
+}
+
+bool IsSimdLevelSupported(SimdLevel level)
+{
+    const auto& features = GetCpuFeatures();
+
+    switch (level) {
+    case SimdLevel::Scalar: return true;
+    case SimdLevel::SSE2:   return features.sse2;
+    case SimdLevel::AVX2:   return features.avx2;
+    case SimdLevel::NEON:   return features.neon;
+    }
+    return false;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE2:   return "sse2";
+    case SimdLevel::AVX2:   return "avx2";
+    case SimdLevel::NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+
+
+CpuFeatures _queryCpuFeatures()
+{
+    CpuFeatures features{ .sse2 = false,
+                          .avx2 = false,
+                          .neon = LV_ARCH_ARM64 == 1,
+                          .hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u) };
+
+#if LV_ARCH_X86
+    #if defined(_MSC_VER) && !defined(__clang__)
+        i32 info[4];
+        __cpuid(info, 1);
+        features.sse2 = (info[3] & (1 << 26)) != 0;
+        // NOTE: AVX2 also needs the OS to save YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        features.avx2 = osSavesYmm && (info[1] & (1 << 5)) != 0;
+    #else
+        __builtin_cpu_init();
+        features.sse2 = __builtin_cpu_supports("sse2");
+        features.avx2 = __builtin_cpu_supports("avx2");
+    #endif
+#endif
+
+    return features;
+}
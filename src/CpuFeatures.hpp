@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core.hpp"
+
+
+// NOTE: SIMD kernels live next to their scalar versions in the same file and are compiled for a higher ISA
+//  with these attributes, so the rest of the program doesn't need -mavx2. Only call them after checking GetCpuFeatures().
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define LV_ARCH_X86 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #define LV_TARGET_AVX2
+    #else
+        #define LV_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define LV_ARCH_X86 0
+    #define LV_TARGET_AVX2
+#endif
+
+// NOTE: NEON is baseline on AArch64, so it needs neither attributes nor a runtime check
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #define LV_ARCH_ARM64 1
+#else
+    #define LV_ARCH_ARM64 0
+#endif
+
+
+enum class SimdLevel : ui32
+{
+    Scalar = 0,
+    // NOTE: SSE2 is baseline on x86-64, no runtime check needed
+    SSE2,
+    AVX2,
+    NEON
+};
+
+struct CpuFeatures
+{
+    bool sse2;
+    bool avx2;
+    bool neon;
+    ui32 hardwareThreads;
+};
+
+
+const CpuFeatures& GetCpuFeatures();
+// NOTE: Highest level the CPU supports, what kernels use when the caller doesn't ask for a specific one
+SimdLevel GetBestSimdLevel();
+bool IsSimdLevelSupported(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
@@ -0,0 +1,237 @@
+#include "DepthPyramid.hpp"
+
+#include "TextureContainer.hpp"
+
+#include <algorithm>
+
+
+constexpr vk::Format kPyramidFormat = vk::Format::eR32Sfloat;
+// NOTE: Has to match hiz_build's local size
+constexpr ui32 kBuildGroupSize = 8;
+
+
+auto _recordPyramidBarrier(vk::CommandBuffer commandBuffer, vk::Image image, ui32 baseMipLevel, ui32 levelCount,
+                           vk::ImageLayout oldLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess) -> void;
+
+
+namespace vulkan
+{
+
+void DepthPyramid::Init(const vk::Device& device, DeviceAllocator& allocator, SamplerCache& samplers, vk::Extent2D extent,
+                        ShaderRegistry& shaders, ShaderHandle shader, vk::PipelineCache pipelineCache,
+                        const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_extent = extent;
+    m_levelCount = GetMipLevelCount(extent.width, extent.height);
+
+    const vk::ImageCreateInfo imageInfo{ .imageType = vk::ImageType::e2D,
+                                         .format = kPyramidFormat,
+                                         .extent = { .width = extent.width, .height = extent.height, .depth = 1 },
+                                         .mipLevels = m_levelCount,
+                                         .arrayLayers = 1,
+                                         .samples = vk::SampleCountFlagBits::e1,
+                                         .tiling = vk::ImageTiling::eOptimal,
+                                         .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+                                         .sharingMode = vk::SharingMode::eExclusive,
+                                         .initialLayout = vk::ImageLayout::eUndefined };
+    m_image = allocator.CreateImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::RenderTargets, m_allocation);
+
+    vk::ImageViewCreateInfo imageViewInfo{ .image = m_image,
+                                           .viewType = vk::ImageViewType::e2D,
+                                           .format = kPyramidFormat,
+                                           .subresourceRange = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                 .baseMipLevel = 0,
+                                                                 .levelCount = m_levelCount,
+                                                                 .baseArrayLayer = 0,
+                                                                 .layerCount = 1 } };
+    m_view = device.createImageView(imageViewInfo, allocationCallbacks);
+
+    m_levelViews.resize(m_levelCount);
+    imageViewInfo.subresourceRange.levelCount = 1;
+    for (ui32 level = 0; level < m_levelCount; ++level) {
+        imageViewInfo.subresourceRange.baseMipLevel = level;
+        m_levelViews[level] = device.createImageView(imageViewInfo, allocationCallbacks);
+    }
+
+    // NOTE: Only ever read with texelFetch, nothing is filtered
+    const vk::SamplerCreateInfo samplerInfo{ .magFilter = vk::Filter::eNearest,
+                                             .minFilter = vk::Filter::eNearest,
+                                             .mipmapMode = vk::SamplerMipmapMode::eNearest,
+                                             .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+                                             .mipLodBias = 0.0f,
+                                             .anisotropyEnable = VK_FALSE,
+                                             .maxAnisotropy = 1.0f,
+                                             .compareEnable = VK_FALSE,
+                                             .compareOp = vk::CompareOp::eAlways,
+                                             .minLod = 0.0f,
+                                             .maxLod = VK_LOD_CLAMP_NONE,
+                                             .borderColor = vk::BorderColor::eFloatOpaqueBlack,
+                                             .unnormalizedCoordinates = VK_FALSE };
+    m_sampler = samplers.Get(samplerInfo);
+
+    const vk::DescriptorSetLayoutBinding layoutBindings[] = {
+        { .binding = 0,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+          .pImmutableSamplers = nullptr },
+        { .binding = 1,
+          .descriptorType = vk::DescriptorType::eStorageImage,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+          .pImmutableSamplers = nullptr }
+    };
+    const vk::DescriptorSetLayoutCreateInfo descriptorLayoutInfo{ .bindingCount = 2,
+                                                                  .pBindings = layoutBindings };
+    m_descriptorSetLayout = device.createDescriptorSetLayout(descriptorLayoutInfo, allocationCallbacks);
+
+    const vk::DescriptorPoolSize poolSizes[] = {
+        { .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = m_levelCount },
+        { .type = vk::DescriptorType::eStorageImage, .descriptorCount = m_levelCount }
+    };
+    const vk::DescriptorPoolCreateInfo poolInfo{ .maxSets = m_levelCount,
+                                                 .poolSizeCount = 2,
+                                                 .pPoolSizes = poolSizes };
+    m_descriptorPool = device.createDescriptorPool(poolInfo, allocationCallbacks);
+
+    // NOTE: One set per dispatch. Level 0's source is the depth buffer, SetDepthView() writes it.
+    const std::vector<vk::DescriptorSetLayout> layouts(m_levelCount, m_descriptorSetLayout);
+    const vk::DescriptorSetAllocateInfo descriptorSetInfo{ .descriptorPool = m_descriptorPool,
+                                                           .descriptorSetCount = m_levelCount,
+                                                           .pSetLayouts = layouts.data() };
+    m_descriptorSets = device.allocateDescriptorSets(descriptorSetInfo);
+
+    for (ui32 level = 0; level < m_levelCount; ++level) {
+        const vk::DescriptorImageInfo sourceInfo{ .sampler = m_sampler,
+                                                  .imageView = level > 0 ? m_levelViews[level - 1] : vk::ImageView(),
+                                                  .imageLayout = vk::ImageLayout::eGeneral };
+        const vk::DescriptorImageInfo destinationInfo{ .imageView = m_levelViews[level],
+                                                       .imageLayout = vk::ImageLayout::eGeneral };
+        const vk::WriteDescriptorSet descriptorWrites[] = {
+            { .dstSet = m_descriptorSets[level],
+              .dstBinding = 0,
+              .dstArrayElement = 0,
+              .descriptorCount = 1,
+              .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+              .pImageInfo = &sourceInfo },
+            { .dstSet = m_descriptorSets[level],
+              .dstBinding = 1,
+              .dstArrayElement = 0,
+              .descriptorCount = 1,
+              .descriptorType = vk::DescriptorType::eStorageImage,
+              .pImageInfo = &destinationInfo }
+        };
+        const ui32 firstWrite = level > 0 ? 0 : 1;
+        device.updateDescriptorSets(2 - firstWrite, descriptorWrites + firstWrite, 0, nullptr);
+    }
+
+    const vk::PipelineLayoutCreateInfo pipelineLayoutInfo{ .setLayoutCount = 1,
+                                                           .pSetLayouts = &m_descriptorSetLayout };
+    m_pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo, allocationCallbacks);
+
+    const vk::ComputePipelineCreateInfo computePipelineInfo{ .stage = { .stage = vk::ShaderStageFlagBits::eCompute,
+                                                                        .pName = "main" },
+                                                             .layout = m_pipelineLayout };
+    m_pipeline = shaders.CreateComputePipeline(pipelineCache, computePipelineInfo, shader);
+}
+
+void DepthPyramid::Shutdown()
+{
+    if (!m_image) {
+        return;
+    }
+
+    m_device.destroyPipeline(m_pipeline, m_allocationCallbacks);
+    m_device.destroyPipelineLayout(m_pipelineLayout, m_allocationCallbacks);
+    m_device.destroyDescriptorPool(m_descriptorPool, m_allocationCallbacks);
+    m_device.destroyDescriptorSetLayout(m_descriptorSetLayout, m_allocationCallbacks);
+    m_descriptorSets.clear();
+
+    for (auto view : m_levelViews) {
+        m_device.destroyImageView(view, m_allocationCallbacks);
+    }
+    m_levelViews.clear();
+    m_device.destroyImageView(m_view, m_allocationCallbacks);
+    m_allocator->DestroyImage(m_image, m_allocation);
+    m_image = nullptr;
+}
+
+void DepthPyramid::SetDepthView(vk::ImageView depthView)
+{
+    const vk::DescriptorImageInfo sourceInfo{ .sampler = m_sampler,
+                                              .imageView = depthView,
+                                              .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+    const vk::WriteDescriptorSet descriptorWrite{ .dstSet = m_descriptorSets[0],
+                                                  .dstBinding = 0,
+                                                  .dstArrayElement = 0,
+                                                  .descriptorCount = 1,
+                                                  .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                                  .pImageInfo = &sourceInfo };
+    m_device.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+}
+
+// NOTE: Last frame's contents are never read, the first barrier discards them. It also waits for the compute
+//  shaders of earlier submissions that still read the pyramid.
+void DepthPyramid::Build(vk::CommandBuffer commandBuffer) const
+{
+    _recordPyramidBarrier(commandBuffer, m_image, 0, m_levelCount, vk::ImageLayout::eUndefined,
+                          vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+    for (ui32 level = 0; level < m_levelCount; ++level) {
+        const ui32 width = std::max(m_extent.width >> level, 1u);
+        const ui32 height = std::max(m_extent.height >> level, 1u);
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout, 0, 1, &m_descriptorSets[level], 0, nullptr);
+        commandBuffer.dispatch((width + kBuildGroupSize - 1) / kBuildGroupSize, (height + kBuildGroupSize - 1) / kBuildGroupSize, 1);
+
+        // NOTE: The next level reads this one, the last barrier leaves the level for the cull pass
+        _recordPyramidBarrier(commandBuffer, m_image, level, 1, vk::ImageLayout::eGeneral,
+                              vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+    }
+}
+
+vk::ImageView DepthPyramid::GetView() const
+{
+    return m_view;
+}
+
+vk::Sampler DepthPyramid::GetSampler() const
+{
+    return m_sampler;
+}
+
+ui32 DepthPyramid::GetLevelCount() const
+{
+    return m_levelCount;
+}
+
+}
+
+
+
+// NOTE: Compute to compute, the pyramid never leaves eGeneral once it's there
+void _recordPyramidBarrier(vk::CommandBuffer commandBuffer, vk::Image image, ui32 baseMipLevel, ui32 levelCount,
+                           vk::ImageLayout oldLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess)
+{
+    const vk::ImageMemoryBarrier barrier{ .srcAccessMask = srcAccess,
+                                          .dstAccessMask = dstAccess,
+                                          .oldLayout = oldLayout,
+                                          .newLayout = vk::ImageLayout::eGeneral,
+                                          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                          .image = image,
+                                          .subresourceRange = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                .baseMipLevel = baseMipLevel,
+                                                                .levelCount = levelCount,
+                                                                .baseArrayLayer = 0,
+                                                                .layerCount = 1 } };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags(), nullptr, nullptr, barrier);
+}
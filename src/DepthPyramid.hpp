@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core.hpp"
+#include "DeviceAllocator.hpp"
+#include "TextureManager.hpp"
+#include "ShaderRegistry.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: Hi-Z pyramid, every texel holds the farthest depth of what it covers in the depth buffer. Level 0 is the
+//  depth buffer's size, the rest follow the usual mip chain, so the last texel of a level whose parent is odd-sized
+//  also covers the leftover row/column: depth texel p ends up in level L texel min(p >> L, levelSize - 1).
+//  Rebuilt by compute every frame, one dispatch per level. R32_SFLOAT, every level stays in eGeneral.
+class DepthPyramid
+{
+public:
+    DepthPyramid() = default;
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    // NOTE: 'shader' is hiz_build, only needed during Init(). The pipeline is created through 'pipelineCache'.
+    void Init(const vk::Device& device, DeviceAllocator& allocator, SamplerCache& samplers, vk::Extent2D extent,
+              ShaderRegistry& shaders, ShaderHandle shader, vk::PipelineCache pipelineCache,
+              const vk::AllocationCallbacks* allocationCallbacks);
+    void Shutdown();
+
+    // NOTE: Level 0 is read from 'depthView' in eShaderReadOnlyOptimal, again whenever the view changes
+    void SetDepthView(vk::ImageView depthView);
+    // NOTE: The depth writes have to be visible to compute shaders already. Afterwards every level is.
+    void Build(vk::CommandBuffer commandBuffer) const;
+
+    // NOTE: Every level, for texelFetch with an explicit level
+    vk::ImageView GetView() const;
+    vk::Sampler GetSampler() const;
+    ui32 GetLevelCount() const;
+
+private:
+    vk::Device                      m_device;
+    const vk::AllocationCallbacks*  m_allocationCallbacks;
+    DeviceAllocator*                m_allocator;
+
+    vk::Image                       m_image;
+    Allocation                      m_allocation;
+    vk::Extent2D                    m_extent;
+    ui32                            m_levelCount;
+    vk::ImageView                   m_view;
+    // NOTE: One per level, the destination of its dispatch and the source of the next one
+    std::vector<vk::ImageView>      m_levelViews;
+    // NOTE: Owned by the sampler cache
+    vk::Sampler                     m_sampler;
+
+    vk::DescriptorSetLayout         m_descriptorSetLayout;
+    vk::DescriptorPool              m_descriptorPool;
+    std::vector<vk::DescriptorSet>  m_descriptorSets;
+    vk::PipelineLayout              m_pipelineLayout;
+    vk::Pipeline                    m_pipeline;
+};
+
+}
@@ -0,0 +1,432 @@
+#include "DeviceAllocator.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+
+
+constexpr vk::DeviceSize kBlockSize = 64 * 1024 * 1024;
+// NOTE: Without VK_EXT_memory_budget a heap is assumed to be this much ours, the rest is left to the OS and other apps
+constexpr f64 kFallbackBudgetFraction = 0.8;
+// NOTE: Eviction starts above the first fraction of the budget and stops below the second
+constexpr f64 kPressureThreshold = 0.95;
+constexpr f64 kEvictionTarget = 0.85;
+
+
+auto _appendMemoryTypes(const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+                        const ui32 memoryTypeBits,
+                        const vk::MemoryPropertyFlags properties,
+                        std::array<ui32, VK_MAX_MEMORY_TYPES>& types,
+                        ui32& typeCount)                                                -> void;
+
+
+namespace vulkan
+{
+
+void DeviceAllocator::Init(const vk::PhysicalDevice& physicalDevice, const vk::Device& device, const vk::AllocationCallbacks* allocationCallbacks,
+                           bool hasMemoryBudget)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_memoryProperties = physicalDevice.getMemoryProperties();
+    m_bufferImageGranularity = physicalDevice.getProperties().limits.bufferImageGranularity;
+    m_allocationCount = 0;
+
+    m_hasMemoryBudget = hasMemoryBudget;
+    m_budgetLimit = 0;
+    m_heaps = {};
+    for (ui32 i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+        const auto& heap = m_memoryProperties.memoryHeaps[i];
+        m_heaps[i] = HeapBudget{ .size = heap.size,
+                                 .budget = 0,
+                                 .usage = 0,
+                                 .allocatorReserved = 0,
+                                 .allocatorUsed = 0,
+                                 .isDeviceLocal = static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) };
+    }
+    m_categoryBytes = {};
+    m_demotedAllocations = 0;
+
+    m_handlers.clear();
+    m_isEvictionExhausted = false;
+    m_evictionCount = 0;
+    m_evictedBytes = 0;
+
+    UpdateBudget();
+}
+
+void DeviceAllocator::Shutdown()
+{
+    for (ui32 i = 0; i < m_blocks.size(); ++i) {
+        if (m_blocks[i].memory) {
+            _DestroyBlock(i);
+        }
+    }
+    m_blocks.clear();
+}
+
+// NOTE: Geometry is only read by the GPU, in host-visible memory it's slower but still works.
+//  Readback prefers host-cached memory, plain host-visible memory is slower to read but works the same.
+//  Everything else that needs device-local memory either gets it or the driver runs out.
+Allocation DeviceAllocator::Allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, MemoryCategory category)
+{
+    std::array<ui32, VK_MAX_MEMORY_TYPES> candidates;
+    ui32 candidateCount = 0;
+    _appendMemoryTypes(m_memoryProperties, requirements.memoryTypeBits, properties, candidates, candidateCount);
+    const ui32 preferredCount = candidateCount;
+
+    if (category == MemoryCategory::Geometry && (properties & vk::MemoryPropertyFlagBits::eDeviceLocal)) {
+        _appendMemoryTypes(m_memoryProperties, requirements.memoryTypeBits,
+                           vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                           candidates, candidateCount);
+    }
+    if (category == MemoryCategory::Readback && (properties & vk::MemoryPropertyFlagBits::eHostCached)) {
+        _appendMemoryTypes(m_memoryProperties, requirements.memoryTypeBits,
+                           vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                           candidates, candidateCount);
+    }
+
+    if (candidateCount == 0) {
+        throw std::runtime_error("DeviceAllocator::Allocate(): Failed to find suitable memory type!");
+    }
+
+    // NOTE: First only where the budget allows it, then wherever the driver still gives us memory
+    for (const bool isBudgetChecked : { true, false }) {
+        for (ui32 i = 0; i < candidateCount; ++i) {
+            if (isBudgetChecked && _HasRoom(candidates[i], requirements.size) == false) {
+                continue;
+            }
+
+            auto allocation = _TryAllocate(candidates[i], requirements);
+            if (allocation.has_value() == false) {
+                continue;
+            }
+
+            allocation->category = category;
+            m_categoryBytes[static_cast<ui32>(category)] += allocation->size;
+            if (i >= preferredCount && category == MemoryCategory::Geometry) {
+                ++m_demotedAllocations;
+            }
+            // NOTE: Something new that the handlers may be able to evict
+            m_isEvictionExhausted = false;
+
+            return allocation.value();
+        }
+    }
+
+    throw std::runtime_error("DeviceAllocator::Allocate(): Out of device memory!");
+}
+
+void DeviceAllocator::Free(const Allocation& allocation)
+{
+    if (!allocation.memory) {
+        return;
+    }
+
+    auto& block = m_blocks[allocation.block];
+    block.ranges.Free(allocation.offset, allocation.size);
+    --m_allocationCount;
+    m_categoryBytes[static_cast<ui32>(allocation.category)] -= allocation.size;
+    m_heaps[m_memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex].allocatorUsed -= allocation.size;
+
+    if (--block.allocationCount == 0) {
+        _DestroyBlock(allocation.block);
+    }
+}
+
+vk::Buffer DeviceAllocator::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                         MemoryCategory category, Allocation& allocation)
+{
+    vk::BufferCreateInfo bufferInfo{ .size = size,
+                                     .usage = usage,
+                                     .sharingMode = vk::SharingMode::eExclusive };
+
+    const auto buffer = m_device.createBuffer(bufferInfo, m_allocationCallbacks);
+
+    allocation = Allocate(m_device.getBufferMemoryRequirements(buffer), properties, category);
+    m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+
+    return buffer;
+}
+
+vk::Image DeviceAllocator::CreateImage(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties, MemoryCategory category,
+                                       Allocation& allocation)
+{
+    const auto image = m_device.createImage(imageInfo, m_allocationCallbacks);
+
+    allocation = Allocate(m_device.getImageMemoryRequirements(image), properties, category);
+    m_device.bindImageMemory(image, allocation.memory, allocation.offset);
+
+    return image;
+}
+
+void DeviceAllocator::DestroyBuffer(vk::Buffer buffer, const Allocation& allocation)
+{
+    m_device.destroyBuffer(buffer, m_allocationCallbacks);
+    Free(allocation);
+}
+
+void DeviceAllocator::DestroyImage(vk::Image image, const Allocation& allocation)
+{
+    m_device.destroyImage(image, m_allocationCallbacks);
+    Free(allocation);
+}
+
+// NOTE: Usage follows our own blocks between updates, what others allocated in the meantime shows up in the next one
+void DeviceAllocator::UpdateBudget()
+{
+    if (m_hasMemoryBudget) {
+        const auto properties = m_physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                                                      vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+        for (ui32 i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+            m_heaps[i].budget = budget.heapBudget[i];
+            m_heaps[i].usage = budget.heapUsage[i];
+        }
+    } else {
+        for (ui32 i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+            m_heaps[i].budget = static_cast<vk::DeviceSize>(kFallbackBudgetFraction * static_cast<f64>(m_heaps[i].size));
+            m_heaps[i].usage = m_heaps[i].allocatorReserved;
+        }
+    }
+
+    if (m_budgetLimit > 0) {
+        for (ui32 i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+            if (m_heaps[i].isDeviceLocal) {
+                m_heaps[i].budget = std::min(m_heaps[i].budget, m_budgetLimit);
+            }
+        }
+    }
+}
+
+void DeviceAllocator::SetBudgetLimit(vk::DeviceSize limit)
+{
+    m_budgetLimit = limit;
+    UpdateBudget();
+}
+
+ui32 DeviceAllocator::GetHeapIndex(const Allocation& allocation) const
+{
+    return m_memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+}
+
+void DeviceAllocator::AddEvictionHandler(ui32 priority, EvictionHandler handler)
+{
+    const auto position = std::upper_bound(m_handlers.begin(), m_handlers.end(), priority,
+                                           [](ui32 value, const Handler& entry) { return value < entry.priority; });
+    m_handlers.insert(position, Handler{ .priority = priority, .evict = std::move(handler) });
+}
+
+bool DeviceAllocator::NeedsEviction() const
+{
+    if (m_handlers.empty() || m_isEvictionExhausted) {
+        return false;
+    }
+
+    for (ui32 i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+        if (_IsUnderPressure(i)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+vk::DeviceSize DeviceAllocator::EnforceBudget()
+{
+    vk::DeviceSize totalFreed = 0;
+
+    for (ui32 heapIndex = 0; heapIndex < m_memoryProperties.memoryHeapCount; ++heapIndex) {
+        if (_IsUnderPressure(heapIndex) == false) {
+            continue;
+        }
+
+        const auto target = static_cast<vk::DeviceSize>(kEvictionTarget * static_cast<f64>(m_heaps[heapIndex].budget));
+        for (const auto& handler : m_handlers) {
+            const auto committed = _GetCommittedUsage(heapIndex);
+            if (committed <= target) {
+                break;
+            }
+
+            const auto freed = handler.evict(heapIndex, committed - target);
+            if (freed > 0) {
+                ++m_evictionCount;
+                m_evictedBytes += freed;
+                totalFreed += freed;
+            }
+        }
+    }
+
+    m_isEvictionExhausted = totalFreed == 0;
+
+    return totalFreed;
+}
+
+DeviceAllocatorStats DeviceAllocator::GetStats() const
+{
+    DeviceAllocatorStats stats{ .blockCount = 0,
+                                .allocationCount = m_allocationCount,
+                                .bytesReserved = 0,
+                                .bytesUsed = 0,
+                                .categoryBytes = m_categoryBytes,
+                                .heaps = m_heaps,
+                                .heapCount = m_memoryProperties.memoryHeapCount,
+                                .hasBudgetExtension = m_hasMemoryBudget,
+                                .demotedAllocations = m_demotedAllocations,
+                                .evictionCount = m_evictionCount,
+                                .evictedBytes = m_evictedBytes };
+
+    for (const auto& block : m_blocks) {
+        if (block.memory) {
+            ++stats.blockCount;
+            stats.bytesReserved += block.ranges.GetSize();
+            stats.bytesUsed += block.ranges.GetSize() - block.ranges.GetFreeSize();
+        }
+    }
+
+    return stats;
+}
+
+
+std::optional<Allocation> DeviceAllocator::_TryAllocate(ui32 memoryTypeIndex, const vk::MemoryRequirements& requirements)
+{
+    // NOTE: Linear and optimal resources share blocks, aligning everything to the granularity keeps them apart
+    const auto alignment = std::max(requirements.alignment, m_bufferImageGranularity);
+
+    ui32 blockIndex = ~0u;
+    vk::DeviceSize offset = RangeAllocator::kInvalidOffset;
+
+    try {
+        if (requirements.size > kBlockSize / 2) {
+            blockIndex = _CreateBlock(memoryTypeIndex, requirements.size);
+            m_blocks[blockIndex].isDedicated = true;
+            offset = m_blocks[blockIndex].ranges.Allocate(requirements.size, alignment);
+        } else {
+            for (ui32 i = 0; i < m_blocks.size() && offset == RangeAllocator::kInvalidOffset; ++i) {
+                auto& block = m_blocks[i];
+                if (block.memory && block.isDedicated == false && block.memoryTypeIndex == memoryTypeIndex) {
+                    offset = block.ranges.Allocate(requirements.size, alignment);
+                    blockIndex = i;
+                }
+            }
+
+            if (offset == RangeAllocator::kInvalidOffset) {
+                blockIndex = _CreateBlock(memoryTypeIndex, kBlockSize);
+                offset = m_blocks[blockIndex].ranges.Allocate(requirements.size, alignment);
+            }
+        }
+    }
+    catch (const vk::OutOfDeviceMemoryError&) {
+        return std::nullopt;
+    }
+
+    auto& block = m_blocks[blockIndex];
+    ++block.allocationCount;
+    ++m_allocationCount;
+    m_heaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].allocatorUsed += requirements.size;
+
+    return Allocation{ .memory = block.memory,
+                       .offset = offset,
+                       .size = requirements.size,
+                       .mapped = block.mapped ? block.mapped + offset : nullptr,
+                       .memoryTypeIndex = memoryTypeIndex,
+                       .block = blockIndex,
+                       .category = MemoryCategory::Geometry };
+}
+
+bool DeviceAllocator::_HasRoom(ui32 memoryTypeIndex, vk::DeviceSize size) const
+{
+    const bool isDedicated = size > kBlockSize / 2;
+
+    if (isDedicated == false) {
+        for (const auto& block : m_blocks) {
+            if (block.memory && block.isDedicated == false && block.memoryTypeIndex == memoryTypeIndex
+                && block.ranges.GetLargestFreeRange() >= size) {
+                return true;
+            }
+        }
+    }
+
+    const auto& heap = m_heaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    return heap.usage + (isDedicated ? size : kBlockSize) <= heap.budget;
+}
+
+bool DeviceAllocator::_IsUnderPressure(ui32 heapIndex) const
+{
+    const auto& heap = m_heaps[heapIndex];
+    return heap.budget > 0 && static_cast<f64>(_GetCommittedUsage(heapIndex)) > kPressureThreshold * static_cast<f64>(heap.budget);
+}
+
+vk::DeviceSize DeviceAllocator::_GetCommittedUsage(ui32 heapIndex) const
+{
+    const auto& heap = m_heaps[heapIndex];
+    const auto allocatorFree = heap.allocatorReserved - heap.allocatorUsed;
+    return heap.usage > allocatorFree ? heap.usage - allocatorFree : 0;
+}
+
+ui32 DeviceAllocator::_CreateBlock(ui32 memoryTypeIndex, vk::DeviceSize size)
+{
+    vk::MemoryAllocateInfo allocateInfo{ .allocationSize = size,
+                                         .memoryTypeIndex = memoryTypeIndex };
+
+    Block block{ .memory = m_device.allocateMemory(allocateInfo, m_allocationCallbacks),
+                 .memoryTypeIndex = memoryTypeIndex,
+                 .ranges = RangeAllocator(size),
+                 .mapped = nullptr,
+                 .allocationCount = 0,
+                 .isDedicated = false };
+
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block.mapped = static_cast<ui8*>(m_device.mapMemory(block.memory, 0, VK_WHOLE_SIZE));
+    }
+
+    auto& heap = m_heaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    heap.allocatorReserved += size;
+    heap.usage += size;
+
+    for (ui32 i = 0; i < m_blocks.size(); ++i) {
+        if (!m_blocks[i].memory) {
+            m_blocks[i] = std::move(block);
+            return i;
+        }
+    }
+
+    m_blocks.push_back(std::move(block));
+    return static_cast<ui32>(m_blocks.size() - 1);
+}
+
+void DeviceAllocator::_DestroyBlock(ui32 blockIndex)
+{
+    auto& block = m_blocks[blockIndex];
+
+    if (block.mapped) {
+        m_device.unmapMemory(block.memory);
+    }
+    m_device.freeMemory(block.memory, m_allocationCallbacks);
+
+    auto& heap = m_heaps[m_memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex];
+    const auto size = block.ranges.GetSize();
+    heap.allocatorReserved -= size;
+    heap.usage -= std::min(heap.usage, size);
+
+    block = Block{};
+}
+
+}
+
+
+
+// NOTE: In memory type order, which the spec sorts from fastest to slowest for the same properties. Types already in the list are skipped.
+void _appendMemoryTypes(const vk::PhysicalDeviceMemoryProperties& memoryProperties, const ui32 memoryTypeBits,
+                        const vk::MemoryPropertyFlags properties, std::array<ui32, VK_MAX_MEMORY_TYPES>& types, ui32& typeCount)
+{
+    for (ui32 i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+        if ((memoryTypeBits & (1 << i)) == 0 || properties != (memoryProperties.memoryTypes[i].propertyFlags & properties)) {
+            continue;
+        }
+        if (std::find(types.begin(), types.begin() + typeCount, i) == types.begin() + typeCount) {
+            types[typeCount++] = i;
+        }
+    }
+}
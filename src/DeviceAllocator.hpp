@@ -0,0 +1,179 @@
+#pragma once
+
+#include "core.hpp"
+#include "RangeAllocator.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: What the memory is for, usage is tracked per category
+enum class MemoryCategory : ui8
+{
+    Geometry,
+    Textures,
+    // NOTE: Uniform and storage buffers the host rewrites every frame
+    Uniforms,
+    Staging,
+    RenderTargets,
+    // NOTE: Host-visible buffers the GPU copies into and the host reads back
+    Readback
+};
+constexpr ui32 kMemoryCategoryCount = 6;
+
+struct Allocation
+{
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    // NOTE: Host-visible blocks are persistently mapped, nullptr otherwise
+    ui8* mapped;
+    ui32 memoryTypeIndex;
+    ui32 block;
+    MemoryCategory category;
+};
+
+struct HeapBudget
+{
+    vk::DeviceSize size;
+    // NOTE: How much the process may use right now. From VK_EXT_memory_budget, otherwise a fixed fraction of the heap.
+    vk::DeviceSize budget;
+    // NOTE: The whole process with VK_EXT_memory_budget, other allocators and the driver included. Only ours without it.
+    vk::DeviceSize usage;
+    // NOTE: Blocks of this allocator in the heap and the part of them handed out
+    vk::DeviceSize allocatorReserved;
+    vk::DeviceSize allocatorUsed;
+    bool isDeviceLocal;
+};
+
+struct DeviceAllocatorStats
+{
+    ui32 blockCount;
+    ui32 allocationCount;
+    vk::DeviceSize bytesReserved;
+    vk::DeviceSize bytesUsed;
+    std::array<vk::DeviceSize, kMemoryCategoryCount> categoryBytes;
+    std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> heaps;
+    ui32 heapCount;
+    bool hasBudgetExtension;
+    // NOTE: Geometry that went to host-visible memory because the device-local heaps were over budget or out of memory
+    ui32 demotedAllocations;
+    // NOTE: What the eviction handlers freed in EnforceBudget()
+    ui32 evictionCount;
+    vk::DeviceSize evictedBytes;
+};
+
+
+// NOTE: Sub-allocates buffers and images from big vk::DeviceMemory blocks, one set of blocks per memory type.
+//  Drivers limit the number of live allocations (maxMemoryAllocationCount can be as low as 4096),
+//  so one vkAllocateMemory per resource doesn't scale past a tutorial.
+//  New blocks go to the first memory type whose heap still has budget left. Geometry falls back to host-visible memory
+//  when no device-local heap has, and every other candidate type is tried before running out of memory throws.
+//  Giving memory back is up to the eviction handlers, EnforceBudget() calls them in priority order.
+class DeviceAllocator
+{
+public:
+    // NOTE: Frees up to 'bytes' in heap 'heapIndex', returns how much it actually freed
+    using EvictionHandler = std::function<vk::DeviceSize(ui32 heapIndex, vk::DeviceSize bytes)>;
+
+    DeviceAllocator() = default;
+
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+    // NOTE: 'allocationCallbacks' may be nullptr, otherwise it has to outlive the allocator.
+    //  'hasMemoryBudget' when 'device' was created with VK_EXT_memory_budget.
+    void Init(const vk::PhysicalDevice& physicalDevice, const vk::Device& device, const vk::AllocationCallbacks* allocationCallbacks,
+              bool hasMemoryBudget);
+    void Shutdown();
+
+    Allocation Allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, MemoryCategory category);
+    void Free(const Allocation& allocation);
+
+    vk::Buffer CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                            MemoryCategory category, Allocation& allocation);
+    vk::Image CreateImage(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties, MemoryCategory category,
+                          Allocation& allocation);
+    void DestroyBuffer(vk::Buffer buffer, const Allocation& allocation);
+    void DestroyImage(vk::Image image, const Allocation& allocation);
+
+    // NOTE: Re-reads the heap budgets, cheap enough to do every frame
+    void UpdateBudget();
+    // NOTE: Caps the budget of every device-local heap, 0 removes the cap. Makes the eviction policy testable on any GPU.
+    void SetBudgetLimit(vk::DeviceSize limit);
+    ui32 GetHeapIndex(const Allocation& allocation) const;
+
+    // NOTE: Lower priorities are asked first
+    void AddEvictionHandler(ui32 priority, EvictionHandler handler);
+    // NOTE: True when a heap is over the pressure threshold and the handlers might still free something.
+    //  After an EnforceBudget() that freed nothing it stays false until the next allocation.
+    bool NeedsEviction() const;
+    // NOTE: Runs the handlers for every heap over the threshold until it's back under the target.
+    //  Only call it where nothing they free can still be in use by the GPU. Returns the bytes freed.
+    vk::DeviceSize EnforceBudget();
+
+    DeviceAllocatorStats GetStats() const;
+
+private:
+    struct Block
+    {
+        vk::DeviceMemory memory;
+        ui32 memoryTypeIndex;
+        RangeAllocator ranges;
+        ui8* mapped;
+        ui32 allocationCount;
+        // NOTE: Resources bigger than half a block get a block of their own
+        bool isDedicated;
+    };
+
+    struct Handler
+    {
+        ui32 priority;
+        EvictionHandler evict;
+    };
+
+    // NOTE: Without a new block when one of the existing ones has space, nullopt when the driver is out of memory
+    std::optional<Allocation> _TryAllocate(ui32 memoryTypeIndex, const vk::MemoryRequirements& requirements);
+    // NOTE: Whether the allocation fits in an existing block or the heap has budget left for a new one
+    bool _HasRoom(ui32 memoryTypeIndex, vk::DeviceSize size) const;
+    bool _IsUnderPressure(ui32 heapIndex) const;
+    // NOTE: Usage minus the free space in our blocks, which we can still allocate from without asking the driver
+    vk::DeviceSize _GetCommittedUsage(ui32 heapIndex) const;
+
+    ui32 _CreateBlock(ui32 memoryTypeIndex, vk::DeviceSize size);
+    void _DestroyBlock(ui32 blockIndex);
+
+private:
+    vk::PhysicalDevice                  m_physicalDevice;
+    vk::Device                          m_device;
+    const vk::AllocationCallbacks*      m_allocationCallbacks;
+    vk::PhysicalDeviceMemoryProperties  m_memoryProperties;
+    vk::DeviceSize                      m_bufferImageGranularity;
+
+    // NOTE: Destroyed blocks leave a hole (null memory) that the next block reuses, so Allocation::block stays valid
+    std::vector<Block>                  m_blocks;
+    ui32                                m_allocationCount;
+
+    bool                                m_hasMemoryBudget;
+    vk::DeviceSize                      m_budgetLimit;
+    // NOTE: Budget and usage as of the last UpdateBudget(), usage follows our own blocks in between
+    std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> m_heaps;
+    std::array<vk::DeviceSize, kMemoryCategoryCount> m_categoryBytes;
+    ui32                                m_demotedAllocations;
+
+    // NOTE: Sorted by priority
+    std::vector<Handler>                m_handlers;
+    bool                                m_isEvictionExhausted;
+    ui32                                m_evictionCount;
+    vk::DeviceSize                      m_evictedBytes;
+};
+
+}
@@ -0,0 +1,225 @@
+#include "FrameCapture.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+
+constexpr ui32 kNoReadback = ~0u;
+// NOTE: Pushed to the encode queue by Shutdown(), the encoder exits when it pops it
+constexpr ui32 kStopEncoder = ~0u - 1;
+
+
+namespace vulkan
+{
+
+bool IsCaptureFrame(const CaptureSchedule& schedule, ui64 frame)
+{
+    if (schedule.interval == 0 || frame < schedule.firstFrame) {
+        return false;
+    }
+
+    const ui64 offset = frame - schedule.firstFrame;
+    if (offset % schedule.interval != 0) {
+        return false;
+    }
+    return schedule.frameCount == 0 || offset / schedule.interval < schedule.frameCount;
+}
+
+bool IsCaptureFormatSupported(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+void FrameCapture::Init(DeviceAllocator& allocator, vk::Extent2D extent, vk::Format format, ui32 readbackCount, ui32 frameSlots,
+                        ImageFileFormat fileFormat, std::string_view directory)
+{
+    if (IsCaptureFormatSupported(format) == false) {
+        throw std::runtime_error("FrameCapture::Init(): Unsupported image format!");
+    }
+
+    m_allocator = &allocator;
+    m_extent = extent;
+    m_isBgra = format == vk::Format::eB8G8R8A8Unorm || format == vk::Format::eB8G8R8A8Srgb;
+    m_fileFormat = fileFormat;
+    m_directory = directory;
+
+    m_framesCaptured.store(0, std::memory_order_relaxed);
+    m_framesWritten.store(0, std::memory_order_relaxed);
+    m_framesDropped.store(0, std::memory_order_relaxed);
+    m_framesFailed.store(0, std::memory_order_relaxed);
+    m_bytesWritten.store(0, std::memory_order_relaxed);
+    m_encodeMicroseconds.store(0, std::memory_order_relaxed);
+    m_encodesInFlight.store(0, std::memory_order_relaxed);
+
+    // NOTE: The CPU reads every byte back, cached memory makes that a lot faster than write-combined memory
+    const vk::DeviceSize bufferSize = static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+    const auto memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+                                | vk::MemoryPropertyFlagBits::eHostCached;
+
+    m_readbacks.resize(readbackCount);
+    m_freeReadbacks.Init(readbackCount);
+    // NOTE: Room for every readback and the stop marker
+    m_encodeQueue.Init(readbackCount + 1);
+    for (ui32 i = 0; i < readbackCount; ++i) {
+        auto& readback = m_readbacks[i];
+        readback.buffer = allocator.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst, memoryProperties,
+                                                 MemoryCategory::Readback, readback.allocation);
+        readback.frameIndex = 0;
+        m_freeReadbacks.Push(i);
+    }
+    m_pendingReadbacks.assign(frameSlots, kNoReadback);
+
+    m_encoderThread = std::thread([this]() { _EncoderLoop(); });
+}
+
+void FrameCapture::Shutdown()
+{
+    if (m_encoderThread.joinable() == false) {
+        return;
+    }
+
+    for (ui32 slot = 0; slot < static_cast<ui32>(m_pendingReadbacks.size()); ++slot) {
+        Complete(slot);
+    }
+    m_encodeQueue.Push(kStopEncoder);
+    m_encoderThread.join();
+
+    for (const auto& readback : m_readbacks) {
+        m_allocator->DestroyBuffer(readback.buffer, readback.allocation);
+    }
+    m_readbacks.clear();
+    m_pendingReadbacks.clear();
+}
+
+bool FrameCapture::Record(vk::CommandBuffer commandBuffer, vk::Image image, ui32 frameSlot, ui64 frameIndex)
+{
+    ui32 index;
+    if (m_freeReadbacks.TryPop(index) == false) {
+        m_framesDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto& readback = m_readbacks[index];
+    readback.frameIndex = frameIndex;
+
+    // NOTE: Rows tightly packed, the buffer is exactly what the encoder expects
+    const vk::BufferImageCopy region{ .bufferOffset = 0,
+                                      .bufferRowLength = 0,
+                                      .bufferImageHeight = 0,
+                                      .imageSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                            .mipLevel = 0,
+                                                            .baseArrayLayer = 0,
+                                                            .layerCount = 1 },
+                                      .imageOffset = { .x = 0, .y = 0, .z = 0 },
+                                      .imageExtent = { .width = m_extent.width, .height = m_extent.height, .depth = 1 } };
+    commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, readback.buffer, region);
+
+    const vk::BufferMemoryBarrier barrier{ .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                           .dstAccessMask = vk::AccessFlagBits::eHostRead,
+                                           .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                           .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                           .buffer = readback.buffer,
+                                           .offset = 0,
+                                           .size = VK_WHOLE_SIZE };
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                  vk::DependencyFlags(), nullptr, barrier, nullptr);
+
+    m_pendingReadbacks[frameSlot] = index;
+    m_framesCaptured.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameCapture::Complete(ui32 frameSlot)
+{
+    const ui32 index = m_pendingReadbacks[frameSlot];
+    if (index == kNoReadback) {
+        return;
+    }
+    m_pendingReadbacks[frameSlot] = kNoReadback;
+
+    // NOTE: Never blocks, the queue has room for every readback
+    m_encodesInFlight.fetch_add(1, std::memory_order_relaxed);
+    m_encodeQueue.Push(index);
+}
+
+void FrameCapture::Flush()
+{
+    ui32 count = m_encodesInFlight.load(std::memory_order_acquire);
+    while (count != 0) {
+        m_encodesInFlight.wait(count, std::memory_order_acquire);
+        count = m_encodesInFlight.load(std::memory_order_acquire);
+    }
+}
+
+CaptureStats FrameCapture::GetStats() const
+{
+    return { .framesCaptured = m_framesCaptured.load(std::memory_order_relaxed),
+             .framesWritten = m_framesWritten.load(std::memory_order_relaxed),
+             .framesDropped = m_framesDropped.load(std::memory_order_relaxed),
+             .framesFailed = m_framesFailed.load(std::memory_order_relaxed),
+             .bytesWritten = m_bytesWritten.load(std::memory_order_relaxed),
+             .encodeMilliseconds = static_cast<f64>(m_encodeMicroseconds.load(std::memory_order_relaxed)) * 1e-3,
+             .readbackCount = static_cast<ui32>(m_readbacks.size()),
+             .isEnabled = m_encoderThread.joinable() };
+}
+
+// NOTE: The buffer goes back to the render thread before the in-flight count drops, so after Flush() every one is free
+void FrameCapture::_EncoderLoop()
+{
+    while (true) {
+        const ui32 index = m_encodeQueue.Pop();
+        if (index == kStopEncoder) {
+            break;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            _Write(m_readbacks[index]);
+            m_framesWritten.fetch_add(1, std::memory_order_relaxed);
+        }
+        catch (...) {
+            m_framesFailed.fetch_add(1, std::memory_order_relaxed);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        m_encodeMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+                                       std::memory_order_relaxed);
+
+        m_freeReadbacks.Push(index);
+        m_encodesInFlight.fetch_sub(1, std::memory_order_release);
+        m_encodesInFlight.notify_all();
+    }
+}
+
+void FrameCapture::_Write(const Readback& readback)
+{
+    EncodeImage(m_fileFormat, readback.allocation.mapped, m_extent.width, m_extent.height, m_isBgra, m_file);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/frame_%06llu.%s", static_cast<unsigned long long>(readback.frameIndex),
+                  GetImageFileExtension(m_fileFormat));
+    m_path.assign(m_directory);
+    m_path.append(name);
+
+    std::ofstream file(m_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("FrameCapture::_Write(): Failed to open " + m_path);
+    }
+    file.write(reinterpret_cast<const char*>(m_file.data()), static_cast<std::streamsize>(m_file.size()));
+    if (!file) {
+        throw std::runtime_error("FrameCapture::_Write(): Failed to write " + m_path);
+    }
+    m_bytesWritten.fetch_add(m_file.size(), std::memory_order_relaxed);
+}
+
+}
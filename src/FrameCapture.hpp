@@ -0,0 +1,123 @@
+#pragma once
+
+#include "core.hpp"
+#include "DeviceAllocator.hpp"
+#include "ImageWriter.hpp"
+#include "SpscQueue.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: Which frames are captured, counted from when the schedule was set. Every 'interval'th frame starting at
+//  'firstFrame', 'frameCount' of them, 0 never stops. An interval of 1 with a count is a burst, 0 captures nothing.
+struct CaptureSchedule
+{
+    ui32 interval = 0;
+    ui64 firstFrame = 0;
+    ui32 frameCount = 0;
+};
+
+// NOTE: Totals since Init()
+struct CaptureStats
+{
+    // NOTE: Copies recorded into a frame's command buffer
+    ui64 framesCaptured;
+    ui64 framesWritten;
+    // NOTE: Scheduled, but every readback buffer was still waiting for the GPU or the encoder, so it was skipped
+    //  instead of stalling the render thread
+    ui64 framesDropped;
+    // NOTE: Encoding or writing threw, the frame is lost and the encoder goes on with the next one
+    ui64 framesFailed;
+    ui64 bytesWritten;
+    // NOTE: Encoder thread, encoding and writing to disk
+    f64 encodeMilliseconds;
+    ui32 readbackCount;
+    bool isEnabled;
+};
+
+bool IsCaptureFrame(const CaptureSchedule& schedule, ui64 frame);
+// NOTE: 8-bit RGBA and BGRA, UNORM or SRGB, the texel bytes go into the file as they are
+bool IsCaptureFormatSupported(vk::Format format);
+
+
+// NOTE: Copies frames into a ring of host-visible readback buffers and writes them to disk on its own thread.
+//  The copy is recorded into the frame's command buffer, once the frame's fence has signaled the buffer goes to the
+//  encoder thread and comes back when the file is written. Buffers pass render thread -> encoder -> render thread
+//  through two SpscQueues, like the backend's snapshots, and a frame that finds none free is dropped,
+//  so the render thread never waits for the encoder or the disk.
+class FrameCapture
+{
+public:
+    FrameCapture() = default;
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // NOTE: Frames are 'extent' images in 'format', see IsCaptureFormatSupported(). 'frameSlots' is the number of
+    //  frames in flight, files go to 'directory' as frame_<index>.<extension>. Starts the encoder thread.
+    void Init(DeviceAllocator& allocator, vk::Extent2D extent, vk::Format format, ui32 readbackCount, ui32 frameSlots,
+              ImageFileFormat fileFormat, std::string_view directory);
+    // NOTE: The device has to be idle, copies still pending are handed to the encoder and written first
+    void Shutdown();
+
+    // NOTE: Render thread. 'image' is in eTransferSrcOptimal and its writes are visible to transfers.
+    //  False when the frame was dropped.
+    bool Record(vk::CommandBuffer commandBuffer, vk::Image image, ui32 frameSlot, ui64 frameIndex);
+    // NOTE: Render thread, once the fence of the frame last recorded in 'frameSlot' has signaled
+    void Complete(ui32 frameSlot);
+    // NOTE: Waits until every frame handed to the encoder is on disk. Completes nothing by itself.
+    void Flush();
+
+    CaptureStats GetStats() const;
+
+private:
+    struct Readback
+    {
+        vk::Buffer buffer;
+        Allocation allocation;
+        // NOTE: Written by the render thread before the buffer is pushed to the encoder
+        ui64 frameIndex;
+    };
+
+    void _EncoderLoop();
+    void _Write(const Readback& readback);
+
+private:
+    DeviceAllocator*        m_allocator = nullptr;
+    vk::Extent2D            m_extent;
+    bool                    m_isBgra;
+    ImageFileFormat         m_fileFormat;
+    std::string             m_directory;
+
+    std::vector<Readback>   m_readbacks;
+    // NOTE: Render thread only, per frame slot the readback its copy went to, kNoReadback when it has none
+    std::vector<ui32>       m_pendingReadbacks;
+    SpscQueue               m_freeReadbacks;
+    SpscQueue               m_encodeQueue;
+    std::thread             m_encoderThread;
+    // NOTE: Handed to the encoder and not written yet, Flush() sleeps on it
+    std::atomic<ui32>       m_encodesInFlight{ 0 };
+    // NOTE: Encoder thread only, reused so steady-state frames don't allocate
+    std::vector<ui8>        m_file;
+    std::string             m_path;
+
+    std::atomic<ui64>       m_framesCaptured{ 0 };
+    std::atomic<ui64>       m_framesWritten{ 0 };
+    std::atomic<ui64>       m_framesDropped{ 0 };
+    std::atomic<ui64>       m_framesFailed{ 0 };
+    std::atomic<ui64>       m_bytesWritten{ 0 };
+    // NOTE: Microseconds, integer adds are lock-free everywhere
+    std::atomic<ui64>       m_encodeMicroseconds{ 0 };
+};
+
+}
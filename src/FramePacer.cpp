@@ -0,0 +1,100 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+
+// NOTE: Weight of the newest sample in the smoothed period and work time
+constexpr f64 kSmoothing = 0.1;
+// NOTE: Longer gaps between completions are idle time (a paused or on-demand scene), not the frame rate
+constexpr i64 kMaxPeriodNanoseconds = 250'000'000;
+
+
+void FramePacer::Init(f64 marginMilliseconds)
+{
+    m_marginMilliseconds = marginMilliseconds;
+    m_workMilliseconds = 0.0;
+    m_framesPaced = 0;
+    m_sleepMilliseconds = 0.0;
+
+    m_previousFrame = 0;
+    m_previousCompletion = Clock::time_point();
+    m_hasCompletion = false;
+
+    m_sequence.store(0, std::memory_order_relaxed);
+    m_lastFrame.store(0, std::memory_order_relaxed);
+    m_lastCompletion.store(0, std::memory_order_relaxed);
+    m_periodNanoseconds.store(0, std::memory_order_relaxed);
+}
+
+void FramePacer::OnFrameComplete(ui64 frameIndex, Clock::time_point time)
+{
+    i64 period = m_periodNanoseconds.load(std::memory_order_relaxed);
+    if (m_hasCompletion && frameIndex > m_previousFrame) {
+        const i64 sample = std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_previousCompletion).count()
+                         / static_cast<i64>(frameIndex - m_previousFrame);
+        if (sample <= kMaxPeriodNanoseconds) {
+            period = period == 0 ? sample : period + static_cast<i64>(kSmoothing * static_cast<f64>(sample - period));
+        }
+    }
+    m_previousFrame = frameIndex;
+    m_previousCompletion = time;
+    m_hasCompletion = true;
+
+    const ui64 sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_lastFrame.store(frameIndex, std::memory_order_relaxed);
+    m_lastCompletion.store(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(),
+                           std::memory_order_relaxed);
+    m_periodNanoseconds.store(period, std::memory_order_relaxed);
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+FramePacer::Clock::time_point FramePacer::GetStartTime(ui64 frameIndex) const
+{
+    ui64 lastFrame;
+    i64 lastCompletion;
+    i64 period;
+    ui64 sequence;
+    do {
+        sequence = m_sequence.load(std::memory_order_acquire);
+        lastFrame = m_lastFrame.load(std::memory_order_relaxed);
+        lastCompletion = m_lastCompletion.load(std::memory_order_relaxed);
+        period = m_periodNanoseconds.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != m_sequence.load(std::memory_order_relaxed));
+
+    if (sequence == 0 || frameIndex <= lastFrame + 1) {
+        return Clock::time_point();
+    }
+
+    // NOTE: The frame before this one completes a period after each frame still ahead of it
+    const auto previousCompletion = Clock::time_point(std::chrono::nanoseconds(lastCompletion + period * static_cast<i64>(frameIndex - 1 - lastFrame)));
+    const auto lead = std::chrono::duration<f64, std::milli>(m_workMilliseconds + m_marginMilliseconds);
+    return previousCompletion - std::chrono::duration_cast<Clock::duration>(lead);
+}
+
+void FramePacer::WaitForStart(ui64 frameIndex)
+{
+    const auto start = GetStartTime(frameIndex);
+    const auto now = Clock::now();
+    if (start > now) {
+        std::this_thread::sleep_until(start);
+        m_sleepMilliseconds += std::chrono::duration<f64, std::milli>(Clock::now() - now).count();
+    }
+    ++m_framesPaced;
+}
+
+void FramePacer::OnFrameWork(f64 milliseconds)
+{
+    m_workMilliseconds = m_framesPaced <= 1 ? milliseconds : m_workMilliseconds + kSmoothing * (milliseconds - m_workMilliseconds);
+}
+
+FramePacingStats FramePacer::GetStats() const
+{
+    return { .framesPaced = m_framesPaced,
+             .sleepMilliseconds = m_sleepMilliseconds,
+             .periodMilliseconds = static_cast<f64>(m_periodNanoseconds.load(std::memory_order_relaxed)) * 1e-6,
+             .leadMilliseconds = m_workMilliseconds + m_marginMilliseconds };
+}
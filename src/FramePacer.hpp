@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <atomic>
+#include <chrono>
+
+
+// NOTE: Totals since Init(), main thread
+struct FramePacingStats
+{
+    ui64 framesPaced;
+    // NOTE: Main thread, sleeping until the predicted start instead of simulating early
+    f64 sleepMilliseconds;
+    // NOTE: Current predictions, from one completed frame to the next and how early the main thread starts
+    f64 periodMilliseconds;
+    f64 leadMilliseconds;
+};
+
+
+// NOTE: Predicts when the main thread should start a frame, so it's ready just as the frame before it completes and
+//  doesn't sit in a queue getting older. The render thread reports when frames complete (presented, or done on the GPU),
+//  from that and the smoothed time between completions the main thread predicts when the previous frame will be done
+//  and starts its part of the frame that long before, plus a margin. The two threads share a few atomics behind a
+//  sequence counter, neither ever waits for the other here.
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacer() = default;
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // NOTE: Not thread-safe, call before either side starts
+    void Init(f64 marginMilliseconds);
+
+    // NOTE: Render thread, frames complete in order
+    void OnFrameComplete(ui64 frameIndex, Clock::time_point time);
+
+    // NOTE: Main thread. Right away until the first frame completed, or when the frame before this one already has.
+    Clock::time_point GetStartTime(ui64 frameIndex) const;
+    // NOTE: Main thread, sleeps until GetStartTime()
+    void WaitForStart(ui64 frameIndex);
+    // NOTE: Main thread, how long its part of a frame took, what the start is moved ahead by
+    void OnFrameWork(f64 milliseconds);
+
+    FramePacingStats GetStats() const;
+
+private:
+    f64                     m_marginMilliseconds;
+
+    // NOTE: Main thread only, smoothed
+    f64                     m_workMilliseconds;
+    ui64                    m_framesPaced;
+    f64                     m_sleepMilliseconds;
+
+    // NOTE: Render thread only
+    ui64                    m_previousFrame;
+    Clock::time_point       m_previousCompletion;
+    bool                    m_hasCompletion;
+
+    // NOTE: Written by the render thread inside an odd sequence, read by the main thread until it sees the same even one.
+    //  Times are nanoseconds of Clock, the period is smoothed. Sequence 0 means nothing has completed yet.
+    std::atomic<ui64>       m_sequence{ 0 };
+    std::atomic<ui64>       m_lastFrame{ 0 };
+    std::atomic<i64>        m_lastCompletion{ 0 };
+    std::atomic<i64>        m_periodNanoseconds{ 0 };
+};
@@ -0,0 +1,353 @@
+#include "FrustumCulling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if LV_ARCH_X86
+    #include <immintrin.h>
+#elif LV_ARCH_ARM64
+    #include <arm_neon.h>
+#endif
+
+
+// NOTE: Below this many objects the threads cost more than the culling itself
+constexpr ui32 kParallelCullThreshold = 16 * 1024;
+// NOTE: Chunk boundaries stay multiples of the widest kernel, so only the last chunk has a scalar tail
+constexpr ui32 kChunkAlignment = 64;
+
+
+
+auto _cullScalar(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume,
+                 ui32 first, ui32 last, ui32* visible)                                                  -> ui32;
+#if LV_ARCH_X86
+auto _cullSSE2(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume,
+               ui32 first, ui32 last, ui32* visible)                                                    -> ui32;
+LV_TARGET_AVX2
+auto _cullAVX2(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume,
+               ui32 first, ui32 last, ui32* visible)                                                    -> ui32;
+#elif LV_ARCH_ARM64
+auto _cullNEON(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume,
+               ui32 first, ui32 last, ui32* visible)                                                    -> ui32;
+#endif
+
+
+void CullingBounds::Clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void CullingBounds::Reserve(ui32 count)
+{
+    centerX.reserve(count);
+    centerY.reserve(count);
+    centerZ.reserve(count);
+    radius.reserve(count);
+    extentX.reserve(count);
+    extentY.reserve(count);
+    extentZ.reserve(count);
+}
+
+ui32 CullingBounds::Add(const f32* center, f32 sphereRadius, const f32* halfExtents)
+{
+    centerX.push_back(center[0]);
+    centerY.push_back(center[1]);
+    centerZ.push_back(center[2]);
+    radius.push_back(sphereRadius);
+    extentX.push_back(halfExtents[0]);
+    extentY.push_back(halfExtents[1]);
+    extentZ.push_back(halfExtents[2]);
+
+    return GetCount() - 1;
+}
+
+void CullingBounds::Set(ui32 index, const f32* center, f32 sphereRadius, const f32* halfExtents)
+{
+    centerX[index] = center[0];
+    centerY[index] = center[1];
+    centerZ[index] = center[2];
+    radius[index] = sphereRadius;
+    extentX[index] = halfExtents[0];
+    extentY[index] = halfExtents[1];
+    extentZ[index] = halfExtents[2];
+}
+
+ui32 CullingBounds::GetCount() const
+{
+    return static_cast<ui32>(centerX.size());
+}
+
+
+// NOTE: Gribb/Hartmann: every plane is a sum or difference of the clip matrix rows.
+//  Vulkan clips z to [0, w], so the near plane is just the third row.
+Frustum ExtractFrustumPlanes(const f32* viewProjection)
+{
+    auto row = [viewProjection](ui32 r, ui32 c) { return viewProjection[c * 4 + r]; };
+
+    Frustum frustum;
+    for (ui32 c = 0; c < 4; ++c) {
+        frustum.planes[Frustum::kLeft][c]   = row(3, c) + row(0, c);
+        frustum.planes[Frustum::kRight][c]  = row(3, c) - row(0, c);
+        frustum.planes[Frustum::kBottom][c] = row(3, c) + row(1, c);
+        frustum.planes[Frustum::kTop][c]    = row(3, c) - row(1, c);
+        frustum.planes[Frustum::kNear][c]   = row(2, c);
+        frustum.planes[Frustum::kFar][c]    = row(3, c) - row(2, c);
+    }
+
+    // NOTE: Normalized planes give real distances, which is what the radius/extents are compared against
+    for (auto& plane : frustum.planes) {
+        const f32 length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (ui32 c = 0; c < 4; ++c) {
+            plane[c] /= length;
+        }
+    }
+
+    return frustum;
+}
+
+
+void FrustumCuller::SetSimdLevel(SimdLevel simdLevel)
+{
+    m_simdLevel = IsSimdLevelSupported(simdLevel) ? simdLevel : SimdLevel::Scalar;
+}
+
+SimdLevel FrustumCuller::GetSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, std::vector<ui32>& visible,
+                         ui32 threadCount, const ParallelFor& parallelFor)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const ui32 count = bounds.GetCount();
+
+    visible.resize(count);
+
+    const ui32 chunkCount = (threadCount > 1 && count >= kParallelCullThreshold) ? threadCount : 1;
+    const ui32 chunkSize = ((count + chunkCount - 1) / chunkCount + kChunkAlignment - 1) / kChunkAlignment * kChunkAlignment;
+    m_chunkVisibleCounts.assign(chunkCount, 0);
+
+    auto cullChunk = [&](ui32 chunk) {
+        const ui32 first = std::min(chunk * chunkSize, count);
+        const ui32 last = std::min(first + chunkSize, count);
+        m_chunkVisibleCounts[chunk] = CullRange(frustum, bounds, volume, first, last, visible.data() + first, m_simdLevel);
+    };
+
+    if (chunkCount == 1) {
+        cullChunk(0);
+    } else if (parallelFor) {
+        parallelFor(chunkCount, cullChunk);
+    } else {
+        for (ui32 chunk = 0; chunk < chunkCount; ++chunk) {
+            cullChunk(chunk);
+        }
+    }
+
+    // NOTE: Chunks are in index order, moving them down keeps the list sorted
+    ui32 visibleCount = m_chunkVisibleCounts[0];
+    for (ui32 chunk = 1; chunk < chunkCount; ++chunk) {
+        const ui32 first = std::min(chunk * chunkSize, count);
+        std::copy(visible.begin() + first, visible.begin() + first + m_chunkVisibleCounts[chunk], visible.begin() + visibleCount);
+        visibleCount += m_chunkVisibleCounts[chunk];
+    }
+    visible.resize(visibleCount);
+
+    const auto end = std::chrono::steady_clock::now();
+    m_stats = CullingStats{ .testedCount = count,
+                            .visibleCount = visibleCount,
+                            .cullMilliseconds = std::chrono::duration<f32, std::milli>(end - start).count() };
+}
+
+const CullingStats& FrustumCuller::GetStats() const
+{
+    return m_stats;
+}
+
+
+ui32 CullRange(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last,
+               ui32* visible, SimdLevel simdLevel)
+{
+    switch (simdLevel) {
+#if LV_ARCH_X86
+    case SimdLevel::SSE2: return _cullSSE2(frustum, bounds, volume, first, last, visible);
+    case SimdLevel::AVX2: return _cullAVX2(frustum, bounds, volume, first, last, visible);
+#elif LV_ARCH_ARM64
+    case SimdLevel::NEON: return _cullNEON(frustum, bounds, volume, first, last, visible);
+#endif
+    default: return _cullScalar(frustum, bounds, volume, first, last, visible);
+    }
+}
+
+
+
+
+// NOTE: Every kernel does the same operations in the same order:
+//  distance = ((nx * cx + ny * cy) + nz * cz) + d, visible when distance >= -radius for all six planes,
+//  where radius is the sphere radius or the box extents projected onto the plane normal.
+//  Indices are written unconditionally and the count only advances for visible objects, which avoids branches.
+ui32 _cullScalar(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last, ui32* visible)
+{
+    ui32 visibleCount = 0;
+
+    for (ui32 i = first; i < last; ++i) {
+        bool isVisible = true;
+
+        for (const auto& plane : frustum.planes) {
+            const f32 distance = plane[0] * bounds.centerX[i] + plane[1] * bounds.centerY[i] + plane[2] * bounds.centerZ[i] + plane[3];
+            const f32 radius = volume == CullVolume::Sphere
+                             ? bounds.radius[i]
+                             : std::abs(plane[0]) * bounds.extentX[i] + std::abs(plane[1]) * bounds.extentY[i] + std::abs(plane[2]) * bounds.extentZ[i];
+            isVisible &= distance >= -radius;
+        }
+
+        visible[visibleCount] = i;
+        visibleCount += isVisible ? 1 : 0;
+    }
+
+    return visibleCount;
+}
+
+#if LV_ARCH_X86
+ui32 _cullSSE2(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last, ui32* visible)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const ui32 simdLast = first + (last - first) / 4 * 4;
+    ui32 visibleCount = 0;
+
+    for (ui32 i = first; i < simdLast; i += 4) {
+        const __m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+        const __m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+        const __m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        if (volume == CullVolume::Sphere) {
+            const __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&bounds.radius[i]), signMask);
+
+            for (const auto& plane : frustum.planes) {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), centerX), _mm_mul_ps(_mm_set1_ps(plane[1]), centerY));
+                distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane[2]), centerZ)), _mm_set1_ps(plane[3]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+        } else {
+            const __m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+            const __m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+            const __m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+
+            for (const auto& plane : frustum.planes) {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), centerX), _mm_mul_ps(_mm_set1_ps(plane[1]), centerY));
+                distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane[2]), centerZ)), _mm_set1_ps(plane[3]));
+
+                __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane[0])), extentX), _mm_mul_ps(_mm_set1_ps(std::abs(plane[1])), extentY));
+                radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane[2])), extentZ));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(radius, signMask)));
+            }
+        }
+
+        const ui32 mask = static_cast<ui32>(_mm_movemask_ps(inside));
+        for (ui32 lane = 0; lane < 4; ++lane) {
+            visible[visibleCount] = i + lane;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+
+    return visibleCount + _cullScalar(frustum, bounds, volume, simdLast, last, visible + visibleCount);
+}
+
+LV_TARGET_AVX2
+ui32 _cullAVX2(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last, ui32* visible)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const ui32 simdLast = first + (last - first) / 8 * 8;
+    ui32 visibleCount = 0;
+
+    for (ui32 i = first; i < simdLast; i += 8) {
+        const __m256 centerX = _mm256_loadu_ps(&bounds.centerX[i]);
+        const __m256 centerY = _mm256_loadu_ps(&bounds.centerY[i]);
+        const __m256 centerZ = _mm256_loadu_ps(&bounds.centerZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        if (volume == CullVolume::Sphere) {
+            const __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(&bounds.radius[i]), signMask);
+
+            for (const auto& plane : frustum.planes) {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), centerX), _mm256_mul_ps(_mm256_set1_ps(plane[1]), centerY));
+                distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[2]), centerZ)), _mm256_set1_ps(plane[3]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+        } else {
+            const __m256 extentX = _mm256_loadu_ps(&bounds.extentX[i]);
+            const __m256 extentY = _mm256_loadu_ps(&bounds.extentY[i]);
+            const __m256 extentZ = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+            for (const auto& plane : frustum.planes) {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), centerX), _mm256_mul_ps(_mm256_set1_ps(plane[1]), centerY));
+                distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[2]), centerZ)), _mm256_set1_ps(plane[3]));
+
+                __m256 radius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane[0])), extentX), _mm256_mul_ps(_mm256_set1_ps(std::abs(plane[1])), extentY));
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane[2])), extentZ));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, signMask), _CMP_GE_OQ));
+            }
+        }
+
+        const ui32 mask = static_cast<ui32>(_mm256_movemask_ps(inside));
+        for (ui32 lane = 0; lane < 8; ++lane) {
+            visible[visibleCount] = i + lane;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+
+    return visibleCount + _cullScalar(frustum, bounds, volume, simdLast, last, visible + visibleCount);
+}
+#elif LV_ARCH_ARM64
+ui32 _cullNEON(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last, ui32* visible)
+{
+    const ui32 simdLast = first + (last - first) / 4 * 4;
+    ui32 visibleCount = 0;
+
+    for (ui32 i = first; i < simdLast; i += 4) {
+        const float32x4_t centerX = vld1q_f32(&bounds.centerX[i]);
+        const float32x4_t centerY = vld1q_f32(&bounds.centerY[i]);
+        const float32x4_t centerZ = vld1q_f32(&bounds.centerZ[i]);
+        uint32x4_t inside = vdupq_n_u32(~0u);
+
+        if (volume == CullVolume::Sphere) {
+            const float32x4_t negativeRadius = vnegq_f32(vld1q_f32(&bounds.radius[i]));
+
+            for (const auto& plane : frustum.planes) {
+                float32x4_t distance = vaddq_f32(vmulq_n_f32(centerX, plane[0]), vmulq_n_f32(centerY, plane[1]));
+                distance = vaddq_f32(vaddq_f32(distance, vmulq_n_f32(centerZ, plane[2])), vdupq_n_f32(plane[3]));
+                inside = vandq_u32(inside, vcgeq_f32(distance, negativeRadius));
+            }
+        } else {
+            const float32x4_t extentX = vld1q_f32(&bounds.extentX[i]);
+            const float32x4_t extentY = vld1q_f32(&bounds.extentY[i]);
+            const float32x4_t extentZ = vld1q_f32(&bounds.extentZ[i]);
+
+            for (const auto& plane : frustum.planes) {
+                float32x4_t distance = vaddq_f32(vmulq_n_f32(centerX, plane[0]), vmulq_n_f32(centerY, plane[1]));
+                distance = vaddq_f32(vaddq_f32(distance, vmulq_n_f32(centerZ, plane[2])), vdupq_n_f32(plane[3]));
+
+                float32x4_t radius = vaddq_f32(vmulq_n_f32(extentX, std::abs(plane[0])), vmulq_n_f32(extentY, std::abs(plane[1])));
+                radius = vaddq_f32(radius, vmulq_n_f32(extentZ, std::abs(plane[2])));
+                inside = vandq_u32(inside, vcgeq_f32(distance, vnegq_f32(radius)));
+            }
+        }
+
+        ui32 lanes[4];
+        vst1q_u32(lanes, inside);
+        for (ui32 lane = 0; lane < 4; ++lane) {
+            visible[visibleCount] = i + lane;
+            visibleCount += lanes[lane] & 1;
+        }
+    }
+
+    return visibleCount + _cullScalar(frustum, bounds, volume, simdLast, last, visible + visibleCount);
+}
+#endif
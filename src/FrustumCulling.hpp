@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core.hpp"
+#include "CpuFeatures.hpp"
+#include "JobSystem.hpp"
+
+#include <functional>
+#include <vector>
+
+
+// NOTE: Planes are (normal, distance) with normals pointing inside, a point p is inside when dot(n, p) + d >= 0
+struct Frustum
+{
+    enum Plane : ui32
+    {
+        kLeft = 0,
+        kRight,
+        kBottom,
+        kTop,
+        kNear,
+        kFar,
+        kPlaneCount
+    };
+
+    alignas(16) f32 planes[kPlaneCount][4];
+};
+
+enum class CullVolume : ui32
+{
+    Sphere = 0,
+    AABB
+};
+
+// NOTE: One entry per object, structure-of-arrays so the kernels load 4/8 objects with one instruction.
+//  Both volumes share the center, the sphere is cheaper, the box is tighter for flat and long objects.
+struct CullingBounds
+{
+    std::vector<f32> centerX;
+    std::vector<f32> centerY;
+    std::vector<f32> centerZ;
+    std::vector<f32> radius;
+    std::vector<f32> extentX;
+    std::vector<f32> extentY;
+    std::vector<f32> extentZ;
+
+    void Clear();
+    void Reserve(ui32 count);
+    ui32 Add(const f32* center, f32 sphereRadius, const f32* halfExtents);
+    void Set(ui32 index, const f32* center, f32 sphereRadius, const f32* halfExtents);
+    ui32 GetCount() const;
+};
+
+struct CullingStats
+{
+    ui32 testedCount;
+    ui32 visibleCount;
+    f32 cullMilliseconds;
+};
+
+
+// NOTE: 'viewProjection' is a column-major 4x4 matrix (glm layout) with Vulkan's [0, 1] clip depth.
+//  Pass projection * view * model to get the planes in the space the bounds are stored in.
+Frustum ExtractFrustumPlanes(const f32* viewProjection);
+
+
+class FrustumCuller
+{
+public:
+    using ParallelFor = ::ParallelFor;
+
+    FrustumCuller() = default;
+
+    void SetSimdLevel(SimdLevel simdLevel);
+    SimdLevel GetSimdLevel() const;
+
+    // NOTE: Fills 'visible' with the indices of objects that touch the frustum, in ascending order.
+    //  With threadCount > 1 the objects are split into chunks, each chunk writes its own part of 'visible'
+    //  and the parts are compacted afterwards, so the result is the same as single-threaded.
+    void Cull(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, std::vector<ui32>& visible,
+              ui32 threadCount = 1, const ParallelFor& parallelFor = nullptr);
+
+    const CullingStats& GetStats() const;
+
+private:
+    SimdLevel m_simdLevel = GetBestSimdLevel();
+    std::vector<ui32> m_chunkVisibleCounts;
+
+    CullingStats m_stats{};
+};
+
+
+// NOTE: Tests objects [first, last) and writes visible indices to 'visible', returns how many were written.
+//  The kernels are exposed for the benchmark, FrustumCuller is what the renderer uses.
+ui32 CullRange(const Frustum& frustum, const CullingBounds& bounds, CullVolume volume, ui32 first, ui32 last,
+               ui32* visible, SimdLevel simdLevel);
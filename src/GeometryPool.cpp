@@ -0,0 +1,250 @@
+#include "GeometryPool.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <tuple>
+#include <utility> // std::pair
+
+
+// NOTE: In elements, a pool created empty still gets buffers to grow from
+constexpr ui32 kMinCapacity = 1024;
+
+
+auto _recordTransferBarrier(vk::CommandBuffer commandBuffer)                  -> void;
+auto _makeBufferCopy(ui64 source, ui64 destination, ui64 count, ui32 elementSize) -> vk::BufferCopy;
+
+
+namespace vulkan
+{
+
+void GeometryPool::Init(DeviceAllocator& allocator, ui32 vertexStride, vk::IndexType indexType, ui32 vertexCapacity, ui32 indexCapacity)
+{
+    m_allocator = &allocator;
+    m_indexType = indexType;
+    m_memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    m_growCount = 0;
+    m_defragmentCount = 0;
+    m_bindCount.store(0, std::memory_order_relaxed);
+
+    // NOTE: Transfer source too, growing and relocating copy out of them
+    m_vertices.elementSize = vertexStride;
+    m_vertices.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eVertexBuffer;
+    m_indices.elementSize = indexType == vk::IndexType::eUint32 ? 4 : 2;
+    m_indices.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eIndexBuffer;
+
+    for (auto [part, capacity] : { std::pair(&m_vertices, vertexCapacity), std::pair(&m_indices, indexCapacity) }) {
+        capacity = std::max(capacity, kMinCapacity);
+        part->buffer = _CreateBuffer(*part, capacity, part->allocation);
+        part->ranges.Reset(capacity);
+    }
+}
+
+void GeometryPool::Shutdown()
+{
+    for (auto* part : { &m_vertices, &m_indices }) {
+        if (part->buffer) {
+            m_allocator->DestroyBuffer(part->buffer, part->allocation);
+        }
+        part->buffer = nullptr;
+    }
+    m_meshes.clear();
+}
+
+MeshHandle GeometryPool::AddMesh(UploadBatch& batch, const void* vertices, ui32 vertexCount, const void* indices, ui32 indexCount)
+{
+    if (vertexCount == 0 || indexCount == 0) {
+        throw std::runtime_error("GeometryPool::AddMesh(): Mesh has no vertices or indices!");
+    }
+
+    const ui32 vertexOffset = _Allocate(batch, m_vertices, vertexCount);
+    const ui32 firstIndex = _Allocate(batch, m_indices, indexCount);
+
+    batch.CopyToBuffer(vertices, static_cast<vk::DeviceSize>(vertexCount) * m_vertices.elementSize,
+                       m_vertices.buffer, static_cast<vk::DeviceSize>(vertexOffset) * m_vertices.elementSize);
+    batch.CopyToBuffer(indices, static_cast<vk::DeviceSize>(indexCount) * m_indices.elementSize,
+                       m_indices.buffer, static_cast<vk::DeviceSize>(firstIndex) * m_indices.elementSize);
+
+    const MeshRecord record{ .firstIndex = firstIndex,
+                             .indexCount = indexCount,
+                             .vertexOffset = static_cast<i32>(vertexOffset),
+                             .vertexCount = vertexCount };
+
+    for (MeshHandle i = 0; i < m_meshes.size(); ++i) {
+        if (m_meshes[i].indexCount == 0) {
+            m_meshes[i] = record;
+            return i;
+        }
+    }
+
+    m_meshes.push_back(record);
+    return static_cast<MeshHandle>(m_meshes.size() - 1);
+}
+
+void GeometryPool::RemoveMesh(MeshHandle handle)
+{
+    auto& mesh = m_meshes[handle];
+    if (mesh.indexCount == 0) {
+        return;
+    }
+
+    m_vertices.ranges.Free(static_cast<ui64>(mesh.vertexOffset), mesh.vertexCount);
+    m_indices.ranges.Free(mesh.firstIndex, mesh.indexCount);
+
+    mesh = MeshRecord{ .firstIndex = 0, .indexCount = 0, .vertexOffset = 0, .vertexCount = 0 };
+}
+
+void GeometryPool::Defragment(UploadBatch& batch)
+{
+    _Relocate(batch, m_memoryProperties);
+    ++m_defragmentCount;
+}
+
+vk::DeviceSize GeometryPool::Demote(UploadBatch& batch, ui32 heapIndex)
+{
+    if (m_vertices.allocation.mapped != nullptr || m_allocator->GetHeapIndex(m_vertices.allocation) != heapIndex) {
+        return 0;
+    }
+
+    const vk::DeviceSize bytes = m_vertices.allocation.size + m_indices.allocation.size;
+    _Relocate(batch, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    // NOTE: On integrated GPUs host-visible memory is in the same heap, moving there frees nothing
+    return m_allocator->GetHeapIndex(m_vertices.allocation) != heapIndex ? bytes : 0;
+}
+
+const MeshRecord& GeometryPool::GetMesh(MeshHandle handle) const
+{
+    return m_meshes[handle];
+}
+
+void GeometryPool::Bind(vk::CommandBuffer commandBuffer) const
+{
+    commandBuffer.bindVertexBuffers(0, m_vertices.buffer, { 0 });
+    commandBuffer.bindIndexBuffer(m_indices.buffer, 0, m_indexType);
+    m_bindCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+    GeometryPoolStats stats{ .meshCount = 0,
+                             .vertexCapacity = m_vertices.ranges.GetSize() * m_vertices.elementSize,
+                             .vertexBytesUsed = (m_vertices.ranges.GetSize() - m_vertices.ranges.GetFreeSize()) * m_vertices.elementSize,
+                             .indexCapacity = m_indices.ranges.GetSize() * m_indices.elementSize,
+                             .indexBytesUsed = (m_indices.ranges.GetSize() - m_indices.ranges.GetFreeSize()) * m_indices.elementSize,
+                             .fragmentedBytes = 0,
+                             .growCount = m_growCount,
+                             .defragmentCount = m_defragmentCount,
+                             .bindCount = m_bindCount.load(std::memory_order_relaxed) };
+
+    for (const auto* part : { &m_vertices, &m_indices }) {
+        stats.fragmentedBytes += (part->ranges.GetFreeSize() - part->ranges.GetLargestFreeRange()) * part->elementSize;
+    }
+    stats.meshCount = static_cast<ui32>(std::count_if(m_meshes.begin(), m_meshes.end(),
+                                                      [](const MeshRecord& mesh) { return mesh.indexCount > 0; }));
+
+    return stats;
+}
+
+
+// NOTE: Doubles at least, so a scene streamed in mesh by mesh only copies the pool a logarithmic number of times
+ui32 GeometryPool::_Allocate(UploadBatch& batch, PoolBuffer& part, ui32 count)
+{
+    ui64 offset = part.ranges.Allocate(count);
+
+    if (offset == RangeAllocator::kInvalidOffset) {
+        const ui64 capacity = part.ranges.GetSize();
+        _Grow(batch, part, std::max(capacity * 2, capacity + count));
+        offset = part.ranges.Allocate(count);
+    }
+
+    return static_cast<ui32>(offset);
+}
+
+// NOTE: Uploads recorded earlier in the batch may still be writing the old buffer, and later ones may write
+//  ranges the copy fills, hence a barrier on both sides
+void GeometryPool::_Grow(UploadBatch& batch, PoolBuffer& part, ui64 capacity)
+{
+    Allocation allocation;
+    const auto buffer = _CreateBuffer(part, capacity, allocation);
+
+    const auto commandBuffer = batch.GetCommandBuffer();
+    const auto copyRegion = _makeBufferCopy(0, 0, part.ranges.GetSize(), part.elementSize);
+
+    _recordTransferBarrier(commandBuffer);
+    commandBuffer.copyBuffer(part.buffer, buffer, 1, &copyRegion);
+    _recordTransferBarrier(commandBuffer);
+
+    batch.ReleaseAfterSubmit(part.buffer, part.allocation);
+    part.buffer = buffer;
+    part.allocation = allocation;
+    part.ranges.Grow(capacity);
+    ++m_growCount;
+}
+
+void GeometryPool::_Relocate(UploadBatch& batch, vk::MemoryPropertyFlags properties)
+{
+    RangeAllocator vertexRanges(m_vertices.ranges.GetSize());
+    RangeAllocator indexRanges(m_indices.ranges.GetSize());
+    std::vector<vk::BufferCopy> vertexCopies;
+    std::vector<vk::BufferCopy> indexCopies;
+
+    // NOTE: Fresh allocators hand out ranges back to back, so the meshes end up packed in handle order
+    for (auto& mesh : m_meshes) {
+        if (mesh.indexCount == 0) {
+            continue;
+        }
+
+        const ui64 vertexOffset = vertexRanges.Allocate(mesh.vertexCount);
+        const ui64 firstIndex = indexRanges.Allocate(mesh.indexCount);
+        vertexCopies.push_back(_makeBufferCopy(static_cast<ui64>(mesh.vertexOffset), vertexOffset, mesh.vertexCount, m_vertices.elementSize));
+        indexCopies.push_back(_makeBufferCopy(mesh.firstIndex, firstIndex, mesh.indexCount, m_indices.elementSize));
+
+        mesh.vertexOffset = static_cast<i32>(vertexOffset);
+        mesh.firstIndex = static_cast<ui32>(firstIndex);
+    }
+
+    m_memoryProperties = properties;
+    const auto commandBuffer = batch.GetCommandBuffer();
+    _recordTransferBarrier(commandBuffer);
+
+    for (auto [part, ranges, copies] : { std::tuple(&m_vertices, &vertexRanges, &vertexCopies),
+                                         std::tuple(&m_indices, &indexRanges, &indexCopies) }) {
+        Allocation allocation;
+        const auto buffer = _CreateBuffer(*part, ranges->GetSize(), allocation);
+        if (copies->empty() == false) {
+            commandBuffer.copyBuffer(part->buffer, buffer, *copies);
+        }
+
+        batch.ReleaseAfterSubmit(part->buffer, part->allocation);
+        part->buffer = buffer;
+        part->allocation = allocation;
+        part->ranges = std::move(*ranges);
+    }
+
+    _recordTransferBarrier(commandBuffer);
+}
+
+vk::Buffer GeometryPool::_CreateBuffer(const PoolBuffer& part, ui64 capacity, Allocation& allocation) const
+{
+    return m_allocator->CreateBuffer(capacity * part.elementSize, part.usage, m_memoryProperties, MemoryCategory::Geometry, allocation);
+}
+
+}
+
+
+
+void _recordTransferBarrier(vk::CommandBuffer commandBuffer)
+{
+    const vk::MemoryBarrier barrier{ .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                     .dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlags(), barrier, nullptr, nullptr);
+}
+
+vk::BufferCopy _makeBufferCopy(ui64 source, ui64 destination, ui64 count, ui32 elementSize)
+{
+    return vk::BufferCopy{ .srcOffset = source * elementSize,
+                           .dstOffset = destination * elementSize,
+                           .size = count * elementSize };
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "core.hpp"
+#include "DeviceAllocator.hpp"
+#include "RangeAllocator.hpp"
+#include "UploadBatch.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <vector>
+
+
+namespace vulkan
+{
+
+using MeshHandle = ui32;
+constexpr MeshHandle kInvalidMesh = ~0u;
+
+// NOTE: Where a mesh lives in the pool's buffers, straight from and to vkCmdDrawIndexed
+struct MeshRecord
+{
+    ui32 firstIndex;
+    ui32 indexCount;
+    i32 vertexOffset;
+    ui32 vertexCount;
+};
+
+struct GeometryPoolStats
+{
+    ui32 meshCount;
+    vk::DeviceSize vertexCapacity;
+    vk::DeviceSize vertexBytesUsed;
+    vk::DeviceSize indexCapacity;
+    vk::DeviceSize indexBytesUsed;
+    // NOTE: Free bytes outside the largest free range of each buffer, what Defragment() would win back
+    vk::DeviceSize fragmentedBytes;
+    ui32 growCount;
+    ui32 defragmentCount;
+    // NOTE: Bind() calls since Init(), each binds the vertex and the index buffer
+    ui64 bindCount;
+};
+
+
+// NOTE: One vertex and one index buffer for every mesh of a vertex layout, sub-allocated in elements,
+//  so a mesh is just a firstIndex/vertexOffset pair and the whole scene binds its geometry once per frame.
+//  Indices stay relative to the mesh's first vertex, 16-bit indices work for any pool size.
+//  Buffers grow by copying on the GPU when a mesh doesn't fit. Everything that changes records
+//  (AddMesh() growing, Defragment(), Demote()) must happen while the GPU isn't drawing from the pool.
+class GeometryPool
+{
+public:
+    GeometryPool() = default;
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // NOTE: Capacities are in vertices and indices, a scene loaded up front can size the pool exactly
+    void Init(DeviceAllocator& allocator, ui32 vertexStride, vk::IndexType indexType, ui32 vertexCapacity, ui32 indexCapacity);
+    void Shutdown();
+
+    // NOTE: The upload, and the copy when the pool has to grow, are recorded into 'batch'
+    MeshHandle AddMesh(UploadBatch& batch, const void* vertices, ui32 vertexCount, const void* indices, ui32 indexCount);
+    void RemoveMesh(MeshHandle handle);
+    // NOTE: Packs every mesh to the front of new buffers, the copies are recorded into 'batch'
+    void Defragment(UploadBatch& batch);
+    // NOTE: Eviction, moves the buffers to host-visible memory when they are in heap 'heapIndex'.
+    //  Returns the device memory that is freed once 'batch' is submitted.
+    vk::DeviceSize Demote(UploadBatch& batch, ui32 heapIndex);
+
+    const MeshRecord& GetMesh(MeshHandle handle) const;
+    // NOTE: Binds the vertex buffer to binding 0 and the index buffer, any thread that records
+    void Bind(vk::CommandBuffer commandBuffer) const;
+
+    GeometryPoolStats GetStats() const;
+
+private:
+    struct PoolBuffer
+    {
+        vk::Buffer buffer;
+        Allocation allocation;
+        // NOTE: In elements, not bytes
+        RangeAllocator ranges;
+        ui32 elementSize;
+        vk::BufferUsageFlags usage;
+    };
+
+    // NOTE: Grows the buffer when there is no free range big enough
+    ui32 _Allocate(UploadBatch& batch, PoolBuffer& part, ui32 count);
+    void _Grow(UploadBatch& batch, PoolBuffer& part, ui64 capacity);
+    // NOTE: Copies every mesh, packed, into new buffers with 'properties' and releases the old ones after the batch
+    void _Relocate(UploadBatch& batch, vk::MemoryPropertyFlags properties);
+    vk::Buffer _CreateBuffer(const PoolBuffer& part, ui64 capacity, Allocation& allocation) const;
+
+private:
+    DeviceAllocator*            m_allocator;
+    vk::IndexType               m_indexType;
+    vk::MemoryPropertyFlags     m_memoryProperties;
+
+    PoolBuffer                  m_vertices;
+    PoolBuffer                  m_indices;
+    // NOTE: Removed meshes leave an empty slot (indexCount == 0) that is reused
+    std::vector<MeshRecord>     m_meshes;
+
+    ui32                        m_growCount;
+    ui32                        m_defragmentCount;
+    mutable std::atomic<ui64>   m_bindCount{ 0 };
+};
+
+}
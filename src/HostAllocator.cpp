@@ -0,0 +1,315 @@
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <bit> // std::bit_width
+#include <cstdlib> // std::malloc, std::free
+#include <cstring> // std::memcpy
+
+
+// NOTE: Slots are powers of two from 32 bytes to 64 KiB, bigger allocations always go to malloc
+constexpr ui32 kMinSlotShift = 5;
+constexpr ui32 kMaxSlotShift = 16;
+constexpr ui32 kSizeClassCount = kMaxSlotShift - kMinSlotShift + 1;
+// NOTE: Chunks start on a page, so a slot is aligned to its own size up to this
+constexpr size_t kChunkAlignment = 4096;
+constexpr size_t kChunkSize = 256 * 1024;
+constexpr ui32 kHeapSizeClass = ~0u;
+
+// NOTE: Sits right in front of every pointer handed to the driver
+struct AllocationHeader
+{
+    // NOTE: What malloc returned or the start of the slot
+    void* base;
+    size_t size;
+    ui32 scope;
+    ui32 sizeClass;
+};
+
+
+auto _alignAddress(size_t value, size_t alignment)      -> size_t;
+auto _getHeader(void* memory)                           -> AllocationHeader*;
+auto _updatePeak(std::atomic<ui64>& peak, ui64 value)   -> void;
+
+
+namespace vulkan
+{
+
+void HostAllocator::Init(HostAllocatorBackend backend)
+{
+    m_callbacks = vk::AllocationCallbacks{ .pUserData = this,
+                                           .pfnAllocation = &HostAllocator::_Allocate,
+                                           .pfnReallocation = &HostAllocator::_Reallocate,
+                                           .pfnFree = &HostAllocator::_Free,
+                                           .pfnInternalAllocation = &HostAllocator::_InternalAllocate,
+                                           .pfnInternalFree = &HostAllocator::_InternalFree };
+    m_backend.store(backend, std::memory_order_relaxed);
+
+    for (auto& scope : m_scopes) {
+        for (auto* counter : { &scope.allocations, &scope.reallocations, &scope.frees, &scope.liveAllocations, &scope.liveBytes,
+                               &scope.peakAllocations, &scope.peakBytes, &scope.internalBytes, &scope.peakInternalBytes }) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
+
+    m_sizeClasses.assign(kSizeClassCount, SizeClass{ .freeList = nullptr });
+    m_arenaAllocations.store(0, std::memory_order_relaxed);
+    m_arenaBytesReserved.store(0, std::memory_order_relaxed);
+}
+
+// NOTE: Pools with live slots are left alone, the driver would still be writing to them
+void HostAllocator::Shutdown()
+{
+    std::lock_guard lock(m_arenaMutex);
+
+    if (m_arenaAllocations.load(std::memory_order_relaxed) == 0) {
+        for (void* chunk : m_chunks) {
+            std::free(chunk);
+        }
+    }
+    m_chunks.clear();
+    m_sizeClasses.clear();
+    m_arenaBytesReserved.store(0, std::memory_order_relaxed);
+}
+
+void HostAllocator::SetBackend(HostAllocatorBackend backend)
+{
+    m_backend.store(backend, std::memory_order_relaxed);
+}
+
+const vk::AllocationCallbacks* HostAllocator::GetCallbacks() const
+{
+    return &m_callbacks;
+}
+
+HostAllocatorStats HostAllocator::GetStats() const
+{
+    HostAllocatorStats stats{ .scopes = {},
+                              .arenaAllocations = m_arenaAllocations.load(std::memory_order_relaxed),
+                              .arenaBytesReserved = m_arenaBytesReserved.load(std::memory_order_relaxed),
+                              .backend = m_backend.load(std::memory_order_relaxed) };
+
+    for (ui32 i = 0; i < kHostAllocationScopeCount; ++i) {
+        const auto& scope = m_scopes[i];
+        stats.scopes[i] = HostScopeStats{ .allocations = scope.allocations.load(std::memory_order_relaxed),
+                                          .reallocations = scope.reallocations.load(std::memory_order_relaxed),
+                                          .frees = scope.frees.load(std::memory_order_relaxed),
+                                          .liveAllocations = scope.liveAllocations.load(std::memory_order_relaxed),
+                                          .liveBytes = scope.liveBytes.load(std::memory_order_relaxed),
+                                          .peakAllocations = scope.peakAllocations.load(std::memory_order_relaxed),
+                                          .peakBytes = scope.peakBytes.load(std::memory_order_relaxed),
+                                          .internalBytes = scope.internalBytes.load(std::memory_order_relaxed),
+                                          .peakInternalBytes = scope.peakInternalBytes.load(std::memory_order_relaxed) };
+    }
+
+    return stats;
+}
+
+
+void* HostAllocator::_Allocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    auto& allocator = *static_cast<HostAllocator*>(userData);
+    if (size == 0) {
+        return nullptr;
+    }
+
+    void* memory = allocator._AllocateBlock(size, alignment, static_cast<ui32>(scope));
+    if (memory != nullptr) {
+        allocator.m_scopes[scope].allocations.fetch_add(1, std::memory_order_relaxed);
+        allocator._Track(static_cast<ui32>(scope), static_cast<i64>(size), 1);
+    }
+
+    return memory;
+}
+
+// NOTE: Always moves, the driver only reallocates small bookkeeping arrays.
+//  On failure the original allocation stays untouched, as the spec requires.
+void* HostAllocator::_Reallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    auto& allocator = *static_cast<HostAllocator*>(userData);
+    if (original == nullptr) {
+        return _Allocate(userData, size, alignment, scope);
+    }
+    if (size == 0) {
+        _Free(userData, original);
+        return nullptr;
+    }
+
+    const AllocationHeader originalHeader = *_getHeader(original);
+
+    void* memory = allocator._AllocateBlock(size, alignment, static_cast<ui32>(scope));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+
+    std::memcpy(memory, original, std::min(size, originalHeader.size));
+    allocator._FreeBlock(original);
+
+    allocator.m_scopes[scope].reallocations.fetch_add(1, std::memory_order_relaxed);
+    allocator._Track(originalHeader.scope, -static_cast<i64>(originalHeader.size), -1);
+    allocator._Track(static_cast<ui32>(scope), static_cast<i64>(size), 1);
+
+    return memory;
+}
+
+void HostAllocator::_Free(void* userData, void* memory)
+{
+    auto& allocator = *static_cast<HostAllocator*>(userData);
+    if (memory == nullptr) {
+        return;
+    }
+
+    const auto* header = _getHeader(memory);
+    const ui32 scope = header->scope;
+    const auto size = static_cast<i64>(header->size);
+
+    allocator._FreeBlock(memory);
+
+    allocator.m_scopes[scope].frees.fetch_add(1, std::memory_order_relaxed);
+    allocator._Track(scope, -size, -1);
+}
+
+void HostAllocator::_InternalAllocate(void* userData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope scope)
+{
+    auto& counters = static_cast<HostAllocator*>(userData)->m_scopes[scope];
+
+    const ui64 internalBytes = counters.internalBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    _updatePeak(counters.peakInternalBytes, internalBytes);
+}
+
+void HostAllocator::_InternalFree(void* userData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope scope)
+{
+    static_cast<HostAllocator*>(userData)->m_scopes[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+
+// NOTE: The header needs pointer alignment, so smaller alignments are raised to it
+void* HostAllocator::_AllocateBlock(size_t size, size_t alignment, ui32 scope)
+{
+    alignment = std::max(alignment, alignof(AllocationHeader));
+    const size_t headerSpace = _alignAddress(sizeof(AllocationHeader), alignment);
+
+    const bool isPooledScope = scope == static_cast<ui32>(vk::SystemAllocationScope::eCommand)
+                            || scope == static_cast<ui32>(vk::SystemAllocationScope::eObject);
+    const bool useArena = m_backend.load(std::memory_order_relaxed) == HostAllocatorBackend::Arena
+                       && isPooledScope
+                       && alignment <= kChunkAlignment
+                       && headerSpace + size <= (size_t(1) << kMaxSlotShift);
+
+    void* base = nullptr;
+    ui8* memory = nullptr;
+    ui32 sizeClass = kHeapSizeClass;
+
+    if (useArena) {
+        // NOTE: The slot is at least as big as headerSpace >= alignment, and aligned to its size, so 'memory' is aligned too
+        const auto slotShift = std::max(static_cast<ui32>(std::bit_width(headerSpace + size - 1)), kMinSlotShift);
+        sizeClass = slotShift - kMinSlotShift;
+
+        base = _AllocateSlot(sizeClass);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        memory = static_cast<ui8*>(base) + headerSpace;
+        m_arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        base = std::malloc(sizeof(AllocationHeader) + alignment - 1 + size);
+        if (base == nullptr) {
+            return nullptr;
+        }
+        const auto address = reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader);
+        memory = reinterpret_cast<ui8*>(_alignAddress(address, alignment));
+    }
+
+    *_getHeader(memory) = AllocationHeader{ .base = base,
+                                            .size = size,
+                                            .scope = scope,
+                                            .sizeClass = sizeClass };
+    return memory;
+}
+
+void HostAllocator::_FreeBlock(void* memory)
+{
+    const auto* header = _getHeader(memory);
+
+    if (header->sizeClass == kHeapSizeClass) {
+        std::free(header->base);
+        return;
+    }
+
+    _FreeSlot(header->base, header->sizeClass);
+    m_arenaAllocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// NOTE: A new chunk is cut into slots of one class and all of them go onto its free list
+void* HostAllocator::_AllocateSlot(ui32 sizeClass)
+{
+    std::lock_guard lock(m_arenaMutex);
+    auto& freeList = m_sizeClasses[sizeClass].freeList;
+
+    if (freeList == nullptr) {
+        void* chunk = std::malloc(kChunkSize + kChunkAlignment - 1);
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+        m_chunks.push_back(chunk);
+        m_arenaBytesReserved.fetch_add(kChunkSize, std::memory_order_relaxed);
+
+        auto* first = reinterpret_cast<ui8*>(_alignAddress(reinterpret_cast<uintptr_t>(chunk), kChunkAlignment));
+        const size_t slotSize = size_t(1) << (sizeClass + kMinSlotShift);
+
+        for (size_t offset = kChunkSize; offset >= slotSize; offset -= slotSize) {
+            void* slot = first + offset - slotSize;
+            *static_cast<void**>(slot) = freeList;
+            freeList = slot;
+        }
+    }
+
+    void* slot = freeList;
+    freeList = *static_cast<void**>(slot);
+    return slot;
+}
+
+void HostAllocator::_FreeSlot(void* slot, ui32 sizeClass)
+{
+    std::lock_guard lock(m_arenaMutex);
+    auto& freeList = m_sizeClasses[sizeClass].freeList;
+
+    *static_cast<void**>(slot) = freeList;
+    freeList = slot;
+}
+
+// NOTE: Negative deltas wrap around on the unsigned counters, which is exactly a subtraction
+void HostAllocator::_Track(ui32 scope, i64 bytes, i64 count)
+{
+    auto& counters = m_scopes[scope];
+
+    const ui64 liveBytes = counters.liveBytes.fetch_add(static_cast<ui64>(bytes), std::memory_order_relaxed) + static_cast<ui64>(bytes);
+    const ui64 liveAllocations = counters.liveAllocations.fetch_add(static_cast<ui64>(count), std::memory_order_relaxed) + static_cast<ui64>(count);
+
+    if (bytes > 0) {
+        _updatePeak(counters.peakBytes, liveBytes);
+    }
+    if (count > 0) {
+        _updatePeak(counters.peakAllocations, liveAllocations);
+    }
+}
+
+}
+
+
+
+size_t _alignAddress(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+AllocationHeader* _getHeader(void* memory)
+{
+    return static_cast<AllocationHeader*>(memory) - 1;
+}
+
+void _updatePeak(std::atomic<ui64>& peak, ui64 value)
+{
+    ui64 current = peak.load(std::memory_order_relaxed);
+    while (value > current && peak.compare_exchange_weak(current, value, std::memory_order_relaxed) == false) {
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: Indexed by vk::SystemAllocationScope: command, object, cache, device, instance
+constexpr ui32 kHostAllocationScopeCount = 5;
+
+enum class HostAllocatorBackend : ui8
+{
+    // NOTE: Every allocation goes to malloc
+    Heap,
+    // NOTE: Command and object scope allocations come from size-class pools that are never given back until Shutdown(),
+    //  everything else still goes to malloc
+    Arena
+};
+
+struct HostScopeStats
+{
+    // NOTE: Successful pfnAllocation/pfnReallocation/pfnFree calls since Init()
+    ui64 allocations;
+    ui64 reallocations;
+    ui64 frees;
+    ui64 liveAllocations;
+    ui64 liveBytes;
+    ui64 peakAllocations;
+    ui64 peakBytes;
+    // NOTE: Memory the driver allocated itself and only told us about (pfnInternalAllocation), mostly executable code
+    ui64 internalBytes;
+    ui64 peakInternalBytes;
+};
+
+struct HostAllocatorStats
+{
+    std::array<HostScopeStats, kHostAllocationScopeCount> scopes;
+    // NOTE: Live allocations served by the arena and the pool memory behind them
+    ui64 arenaAllocations;
+    ui64 arenaBytesReserved;
+    HostAllocatorBackend backend;
+};
+
+
+// NOTE: Plugs into every create/destroy call as vk::AllocationCallbacks, so driver-side host allocations become visible.
+//  Vulkan requires an object to be destroyed with callbacks compatible with the ones it was created with,
+//  so the callbacks stay the same for the allocator's lifetime and only the backend behind them changes:
+//  every allocation remembers where it came from, switching with SetBackend() is safe at any time.
+//  The driver may call in from any thread, counters are atomic and the arena is behind a mutex.
+class HostAllocator
+{
+public:
+    HostAllocator() = default;
+
+    // NOTE: GetCallbacks() hands out 'this' as pUserData
+    HostAllocator(const HostAllocator&) = delete;
+    HostAllocator& operator=(const HostAllocator&) = delete;
+
+    void Init(HostAllocatorBackend backend);
+    // NOTE: Only after everything created with GetCallbacks() is destroyed, the arena pools are freed here
+    void Shutdown();
+
+    void SetBackend(HostAllocatorBackend backend);
+    const vk::AllocationCallbacks* GetCallbacks() const;
+
+    HostAllocatorStats GetStats() const;
+
+private:
+    struct ScopeCounters
+    {
+        std::atomic<ui64> allocations;
+        std::atomic<ui64> reallocations;
+        std::atomic<ui64> frees;
+        std::atomic<ui64> liveAllocations;
+        std::atomic<ui64> liveBytes;
+        std::atomic<ui64> peakAllocations;
+        std::atomic<ui64> peakBytes;
+        std::atomic<ui64> internalBytes;
+        std::atomic<ui64> peakInternalBytes;
+    };
+
+    // NOTE: One free list per power-of-two slot size, slots are carved from chunks on demand
+    struct SizeClass
+    {
+        void* freeList;
+    };
+
+    static void* VKAPI_PTR _Allocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void* VKAPI_PTR _Reallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void VKAPI_PTR _Free(void* userData, void* memory);
+    static void VKAPI_PTR _InternalAllocate(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static void VKAPI_PTR _InternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    void* _AllocateBlock(size_t size, size_t alignment, ui32 scope);
+    void _FreeBlock(void* memory);
+    void* _AllocateSlot(ui32 sizeClass);
+    void _FreeSlot(void* slot, ui32 sizeClass);
+    void _Track(ui32 scope, i64 bytes, i64 count);
+
+private:
+    vk::AllocationCallbacks                                     m_callbacks;
+    std::atomic<HostAllocatorBackend>                           m_backend;
+    std::array<ScopeCounters, kHostAllocationScopeCount>        m_scopes;
+
+    std::mutex                                                  m_arenaMutex;
+    std::vector<SizeClass>                                      m_sizeClasses;
+    std::vector<void*>                                          m_chunks;
+    std::atomic<ui64>                                           m_arenaAllocations;
+    std::atomic<ui64>                                           m_arenaBytesReserved;
+};
+
+}
@@ -0,0 +1,206 @@
+#include "ImageWriter.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+
+// NOTE: Deflate stored blocks carry at most this many bytes, each one costs a 5 byte header
+constexpr ui32 kStoredBlockSize = 65535;
+constexpr ui8 kPngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+
+auto _appendBigEndian(std::vector<ui8>& file, ui32 value)                          -> void;
+auto _writeRgbRow(const ui8* pixels, ui32 width, bool isBgra, ui8* row)            -> void;
+auto _crc32(ui32 crc, const ui8* data, size_t size)                                -> ui32;
+auto _adler32(ui32 adler, const ui8* data, size_t size)                            -> ui32;
+auto _encodePpm(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file) -> void;
+auto _encodePng(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file) -> void;
+auto _encodeRaw(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file) -> void;
+
+
+const char* GetImageFileExtension(ImageFileFormat format)
+{
+    switch (format) {
+    case ImageFileFormat::Ppm:
+        return "ppm";
+    case ImageFileFormat::Png:
+        return "png";
+    case ImageFileFormat::Raw:
+        return "raw";
+    }
+    return "bin";
+}
+
+void EncodeImage(ImageFileFormat format, const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file)
+{
+    file.clear();
+    switch (format) {
+    case ImageFileFormat::Ppm:
+        _encodePpm(pixels, width, height, isBgra, file);
+        return;
+    case ImageFileFormat::Png:
+        _encodePng(pixels, width, height, isBgra, file);
+        return;
+    case ImageFileFormat::Raw:
+        _encodeRaw(pixels, width, height, isBgra, file);
+        return;
+    }
+    throw std::runtime_error("EncodeImage(): Unknown image file format!");
+}
+
+
+
+void _appendBigEndian(std::vector<ui8>& file, ui32 value)
+{
+    const ui8 bytes[4] = { static_cast<ui8>(value >> 24), static_cast<ui8>(value >> 16),
+                           static_cast<ui8>(value >> 8), static_cast<ui8>(value) };
+    file.insert(file.end(), bytes, bytes + 4);
+}
+
+void _writeRgbRow(const ui8* pixels, ui32 width, bool isBgra, ui8* row)
+{
+    const ui32 red = isBgra ? 2 : 0;
+    const ui32 blue = isBgra ? 0 : 2;
+    for (ui32 x = 0; x < width; ++x) {
+        row[0] = pixels[red];
+        row[1] = pixels[1];
+        row[2] = pixels[blue];
+        row += 3;
+        pixels += 4;
+    }
+}
+
+// NOTE: The PNG/zlib CRC, reflected polynomial 0xEDB88320, byte at a time from a table built on first use
+ui32 _crc32(ui32 crc, const ui8* data, size_t size)
+{
+    static const auto table = []() {
+        std::array<ui32, 256> entries;
+        for (ui32 i = 0; i < 256; ++i) {
+            ui32 value = i;
+            for (ui32 bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// NOTE: 5552 bytes is the most that can be summed before the 32-bit sums may overflow, so the modulo is taken once per run
+ui32 _adler32(ui32 adler, const ui8* data, size_t size)
+{
+    constexpr ui32 kModulo = 65521;
+    constexpr size_t kRunLength = 5552;
+
+    ui32 a = adler & 0xFFFF;
+    ui32 b = adler >> 16;
+    while (size > 0) {
+        const size_t run = std::min(size, kRunLength);
+        for (size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= kModulo;
+        b %= kModulo;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+void _encodePpm(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file)
+{
+    char header[64];
+    const int headerSize = std::snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+    file.assign(header, header + headerSize);
+
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    file.resize(file.size() + rowBytes * height);
+    ui8* row = file.data() + headerSize;
+    for (ui32 y = 0; y < height; ++y) {
+        _writeRgbRow(pixels + static_cast<size_t>(y) * width * 4, width, isBgra, row);
+        row += rowBytes;
+    }
+}
+
+// NOTE: Signature | IHDR | one IDAT with a zlib stream of stored blocks | IEND.
+//  The filtered rows are written where the last blocks end up, then every block is moved down to make room for
+//  its header. A block never moves past the start of the next one, so the moves don't overwrite anything unread.
+void _encodePng(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file)
+{
+    file.insert(file.end(), kPngSignature, kPngSignature + sizeof(kPngSignature));
+
+    // NOTE: 8 bits, truecolor, deflate, adaptive filtering, no interlace
+    const size_t headerStart = file.size();
+    _appendBigEndian(file, 13);
+    file.insert(file.end(), { 'I', 'H', 'D', 'R' });
+    _appendBigEndian(file, width);
+    _appendBigEndian(file, height);
+    file.insert(file.end(), { 8, 2, 0, 0, 0 });
+    _appendBigEndian(file, _crc32(0, file.data() + headerStart + 4, file.size() - headerStart - 4));
+
+    // NOTE: Every row starts with its filter type, 0 is none
+    const size_t rowBytes = 1 + static_cast<size_t>(width) * 3;
+    const size_t streamSize = rowBytes * height;
+    const size_t blockCount = std::max<size_t>((streamSize + kStoredBlockSize - 1) / kStoredBlockSize, 1);
+    const size_t idatSize = 2 + blockCount * 5 + streamSize + 4;
+    if (idatSize > 0x7FFFFFFFu) {
+        throw std::runtime_error("EncodeImage(): Image is too big for one PNG chunk!");
+    }
+
+    const size_t idatStart = file.size();
+    _appendBigEndian(file, static_cast<ui32>(idatSize));
+    file.insert(file.end(), { 'I', 'D', 'A', 'T' });
+    // NOTE: Deflate, 32K window, fastest compression level, header check bits
+    file.insert(file.end(), { 0x78, 0x01 });
+
+    const size_t blocksStart = file.size();
+    file.resize(blocksStart + blockCount * 5 + streamSize);
+    ui8* stream = file.data() + blocksStart + blockCount * 5;
+    for (ui32 y = 0; y < height; ++y) {
+        ui8* row = stream + y * rowBytes;
+        row[0] = 0;
+        _writeRgbRow(pixels + static_cast<size_t>(y) * width * 4, width, isBgra, row + 1);
+    }
+    const ui32 adler = _adler32(1, stream, streamSize);
+
+    for (size_t block = 0; block < blockCount; ++block) {
+        const size_t offset = block * kStoredBlockSize;
+        const auto size = static_cast<ui32>(std::min<size_t>(kStoredBlockSize, streamSize - offset));
+        ui8* destination = file.data() + blocksStart + block * (5 + kStoredBlockSize);
+
+        std::memmove(destination + 5, stream + offset, size);
+        destination[0] = block + 1 == blockCount ? 1 : 0;
+        destination[1] = static_cast<ui8>(size);
+        destination[2] = static_cast<ui8>(size >> 8);
+        destination[3] = static_cast<ui8>(~size);
+        destination[4] = static_cast<ui8>(~size >> 8);
+    }
+
+    _appendBigEndian(file, adler);
+    _appendBigEndian(file, _crc32(0, file.data() + idatStart + 4, file.size() - idatStart - 4));
+
+    _appendBigEndian(file, 0);
+    file.insert(file.end(), { 'I', 'E', 'N', 'D' });
+    _appendBigEndian(file, _crc32(0, file.data() + file.size() - 4, 4));
+}
+
+void _encodeRaw(const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file)
+{
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    file.assign(pixels, pixels + size);
+    if (isBgra) {
+        for (size_t i = 0; i < size; i += 4) {
+            std::swap(file[i], file[i + 2]);
+        }
+    }
+}
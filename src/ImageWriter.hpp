@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <vector>
+
+
+// NOTE: What captured frames are written as. All of them are 8 bits per channel:
+//  Ppm - binary P6, RGB
+//  Png - RGB, stored (uncompressed) deflate blocks, so there is no zlib dependency and encoding is a copy plus checksums
+//  Raw - tightly packed RGBA rows, no header, the size has to be known by whoever reads it
+enum class ImageFileFormat : ui8
+{
+    Ppm = 0,
+    Png,
+    Raw
+};
+
+
+const char* GetImageFileExtension(ImageFileFormat format);
+
+// NOTE: 'pixels' is tightly packed 4-byte texels, RGBA or BGRA when 'isBgra'. The encoded file replaces the contents
+//  of 'file', which is meant to be reused, so encoding the same size again doesn't allocate.
+void EncodeImage(ImageFileFormat format, const ui8* pixels, ui32 width, ui32 height, bool isBgra, std::vector<ui8>& file);
@@ -0,0 +1,115 @@
+#include "InitGraph.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+
+
+auto _millisecondsSince(InitGraph::Clock::time_point start) -> f64;
+
+
+InitStep InitGraph::Add(std::string name, std::function<void()> function, std::initializer_list<InitStep> dependencies)
+{
+    const auto step = static_cast<InitStep>(m_steps.size());
+    for (const InitStep dependency : dependencies) {
+        if (dependency >= step) {
+            throw std::runtime_error("InitGraph::Add(): Dependencies have to be added before their dependents!");
+        }
+        m_steps[dependency].dependents.push_back(step);
+    }
+
+    m_steps.push_back(Step{ .name = std::move(name),
+                            .function = std::move(function),
+                            .dependencies = dependencies,
+                            .dependents = {},
+                            .startMilliseconds = 0.0,
+                            .milliseconds = 0.0 });
+    return step;
+}
+
+void InitGraph::Run(JobSystem& jobSystem)
+{
+    m_jobSystem = &jobSystem;
+    m_hasError.store(false, std::memory_order_relaxed);
+    m_error = nullptr;
+    m_pendingDependencies = std::make_unique<std::atomic<ui32>[]>(m_steps.size());
+    for (size_t i = 0; i < m_steps.size(); ++i) {
+        m_pendingDependencies[i].store(static_cast<ui32>(m_steps[i].dependencies.size()), std::memory_order_relaxed);
+        m_steps[i].startMilliseconds = 0.0;
+        m_steps[i].milliseconds = 0.0;
+    }
+
+    m_start = Clock::now();
+    for (InitStep step = 0; step < m_steps.size(); ++step) {
+        if (m_steps[step].dependencies.empty()) {
+            _Start(step);
+        }
+    }
+    m_jobSystem->Wait(m_counter);
+    m_wallMilliseconds = _millisecondsSince(m_start);
+
+    if (m_hasError.load(std::memory_order_acquire)) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+// NOTE: Steps are added dependencies first, so one pass in that order has every chain's length at hand
+InitGraphStats InitGraph::GetStats() const
+{
+    InitGraphStats stats{ .steps = {}, .wallMilliseconds = m_wallMilliseconds, .serialMilliseconds = 0.0, .criticalPathMilliseconds = 0.0 };
+    stats.steps.reserve(m_steps.size());
+
+    std::vector<f64> chainMilliseconds(m_steps.size(), 0.0);
+    for (size_t i = 0; i < m_steps.size(); ++i) {
+        const auto& step = m_steps[i];
+        stats.steps.push_back(InitStepStats{ .name = step.name,
+                                             .startMilliseconds = step.startMilliseconds,
+                                             .milliseconds = step.milliseconds });
+        stats.serialMilliseconds += step.milliseconds;
+
+        f64 longestDependency = 0.0;
+        for (const InitStep dependency : step.dependencies) {
+            longestDependency = std::max(longestDependency, chainMilliseconds[dependency]);
+        }
+        chainMilliseconds[i] = longestDependency + step.milliseconds;
+        stats.criticalPathMilliseconds = std::max(stats.criticalPathMilliseconds, chainMilliseconds[i]);
+    }
+    return stats;
+}
+
+void InitGraph::_Start(InitStep step)
+{
+    m_jobSystem->Run([this, step]() { _RunStep(step); }, &m_counter);
+}
+
+// NOTE: After a failure the remaining steps still go through here without running, so the counter drains
+void InitGraph::_RunStep(InitStep step)
+{
+    auto& entry = m_steps[step];
+    if (m_hasError.load(std::memory_order_acquire) == false) {
+        const auto start = Clock::now();
+        try {
+            entry.function();
+        }
+        catch (...) {
+            bool expected = false;
+            if (m_hasError.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                m_error = std::current_exception();
+            }
+        }
+        entry.startMilliseconds = std::chrono::duration<f64, std::milli>(start - m_start).count();
+        entry.milliseconds = _millisecondsSince(start);
+    }
+
+    for (const InitStep dependent : entry.dependents) {
+        if (m_pendingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _Start(dependent);
+        }
+    }
+}
+
+
+
+f64 _millisecondsSince(InitGraph::Clock::time_point start)
+{
+    return std::chrono::duration<f64, std::milli>(InitGraph::Clock::now() - start).count();
+}
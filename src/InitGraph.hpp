@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core.hpp"
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+using InitStep = ui32;
+
+struct InitStepStats
+{
+    std::string name;
+    // NOTE: From the start of Run(), 0 for steps that were skipped after a failure
+    f64 startMilliseconds;
+    f64 milliseconds;
+};
+
+// NOTE: Of the last Run()
+struct InitGraphStats
+{
+    std::vector<InitStepStats> steps;
+    // NOTE: Run() from start to end
+    f64 wallMilliseconds;
+    // NOTE: The steps one after another, what the same work took before it ran as a graph
+    f64 serialMilliseconds;
+    // NOTE: The slowest chain of dependencies, no amount of threads gets the wall time below it
+    f64 criticalPathMilliseconds;
+};
+
+
+// NOTE: Startup work as steps with dependencies. Run() starts every step without any as a job, every finished step
+//  starts the dependents it was the last dependency of, so independent chains overlap on the job system's threads.
+//  Steps are added in an order where dependencies come first, which is also a valid serial order.
+//  Once a step threw no other step starts, Run() rethrows the first exception after the running ones finished.
+class InitGraph
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    InitGraph() = default;
+
+    InitGraph(const InitGraph&) = delete;
+    InitGraph& operator=(const InitGraph&) = delete;
+
+    InitStep Add(std::string name, std::function<void()> function, std::initializer_list<InitStep> dependencies = {});
+    // NOTE: Returns when every step ran, the calling thread helps with jobs meanwhile. Steps run on any of
+    //  the job system's threads, what they share without a dependency between them has to be thread-safe.
+    void Run(JobSystem& jobSystem);
+
+    InitGraphStats GetStats() const;
+
+private:
+    struct Step
+    {
+        std::string name;
+        std::function<void()> function;
+        std::vector<InitStep> dependencies;
+        std::vector<InitStep> dependents;
+        f64 startMilliseconds;
+        f64 milliseconds;
+    };
+
+    void _Start(InitStep step);
+    void _RunStep(InitStep step);
+
+private:
+    std::vector<Step>                   m_steps;
+
+    JobSystem*                          m_jobSystem = nullptr;
+    JobCounter                          m_counter;
+    Clock::time_point                   m_start;
+    f64                                 m_wallMilliseconds = 0.0;
+
+    // NOTE: Dependencies of every step that haven't finished yet, the step starts when it reaches 0
+    std::unique_ptr<std::atomic<ui32>[]> m_pendingDependencies;
+    std::atomic<bool>                   m_hasError{ false };
+    std::exception_ptr                  m_error;
+};
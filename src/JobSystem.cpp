@@ -0,0 +1,407 @@
+#include "JobSystem.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+
+// NOTE: Twice the deque capacity: a thread can't have more jobs queued than that, plus the few being run by thieves
+constexpr ui32 kJobPoolSize = 2 * WorkStealingQueue::kCapacity;
+// NOTE: Failed steal rounds before an idle worker goes to sleep
+constexpr ui32 kIdleSpinCount = 64;
+// NOTE: Ranges per thread in ParallelForRange(), more ranges balance better, fewer cost less
+constexpr ui32 kRangesPerThread = 4;
+
+// NOTE: Which system the current thread belongs to and its state index there, 0 is the thread that called Init()
+thread_local JobSystem* t_jobSystem = nullptr;
+thread_local ui32 t_threadIndex = 0;
+
+
+auto _pinCurrentThread(ui32 core) -> void;
+auto _nextRandom(ui32& state)     -> ui32;
+
+
+bool JobCounter::IsDone() const
+{
+    return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+
+bool WorkStealingQueue::Push(Job* job)
+{
+    const i64 bottom = m_bottom.load(std::memory_order_relaxed);
+    const i64 top = m_top.load(std::memory_order_acquire);
+
+    if (bottom - top >= static_cast<i64>(kCapacity)) {
+        return false;
+    }
+
+    // NOTE: Release publishes the job (and everything written into it) to thieves that acquire m_bottom
+    m_jobs[bottom & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+
+    return true;
+}
+
+// NOTE: The seq_cst fence orders the bottom decrement against thieves reading it,
+//  the last job is raced for with a CAS on top just like a steal
+Job* WorkStealingQueue::Pop()
+{
+    const i64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false) {
+            job = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* WorkStealingQueue::Steal()
+{
+    i64 top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const i64 bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false) {
+        return nullptr;
+    }
+
+    return job;
+}
+
+
+void JobSystem::Init(ui32 workerCount, bool pinThreads)
+{
+    if (m_isRunning) {
+        throw std::runtime_error("JobSystem::Init(): Already initialized!");
+    }
+
+    m_threadStates.clear();
+    for (ui32 i = 0; i < workerCount + 1; ++i) {
+        auto state = std::make_unique<ThreadState>();
+        state->jobs = std::make_unique<Job[]>(kJobPoolSize);
+        state->random = 0x9e3779b9u * (i + 1);
+        m_threadStates.push_back(std::move(state));
+    }
+
+    t_jobSystem = this;
+    t_threadIndex = 0;
+    if (pinThreads) {
+        _pinCurrentThread(0);
+    }
+
+    m_isRunning = true;
+    m_workers.reserve(workerCount);
+    for (ui32 i = 1; i <= workerCount; ++i) {
+        m_workers.emplace_back([this, i, pinThreads]() {
+            t_jobSystem = this;
+            t_threadIndex = i;
+            if (pinThreads) {
+                _pinCurrentThread(i);
+            }
+            _WorkerLoop(i);
+        });
+    }
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_isRunning = false;
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_threadStates.clear();
+
+    if (t_jobSystem == this) {
+        t_jobSystem = nullptr;
+    }
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* counter)
+{
+    auto& state = *m_threadStates[_GetThreadIndex()];
+
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job* job = _AllocateJob(state);
+    if (job == nullptr) {
+        _Invoke(function, counter);
+        if (counter != nullptr) {
+            counter->m_pending.fetch_sub(1, std::memory_order_release);
+        }
+        state.inlineJobs.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    job->function = std::move(function);
+    job->counter = counter;
+
+    if (state.queue.Push(job) == false) {
+        state.inlineJobs.fetch_add(1, std::memory_order_relaxed);
+        _Execute(job, state);
+        return;
+    }
+
+    // NOTE: Pairs with the sleeping worker incrementing m_sleepingWorkers before checking m_queuedJobs,
+    //  one of the two always sees the other, so a wake-up can't get lost
+    m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard lock(m_sleepMutex);
+        m_wakeCondition.notify_one();
+    }
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    const ui32 threadIndex = _GetThreadIndex();
+    auto& state = *m_threadStates[threadIndex];
+
+    while (counter.IsDone() == false) {
+        if (Job* job = _FindJob(threadIndex)) {
+            _Execute(job, state);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (counter.m_hasError.load(std::memory_order_acquire)) {
+        std::rethrow_exception(counter.m_error);
+    }
+}
+
+void JobSystem::ParallelFor(ui32 taskCount, const std::function<void(ui32)>& task)
+{
+    if (taskCount == 0) {
+        return;
+    }
+
+    JobCounter counter;
+    for (ui32 i = 1; i < taskCount; ++i) {
+        Run([&task, i]() { task(i); }, &counter);
+    }
+
+    // NOTE: The jobs reference 'task' and 'counter', so they have to be done before an exception leaves this frame
+    try {
+        task(0);
+    }
+    catch (...) {
+        Wait(counter);
+        throw;
+    }
+    Wait(counter);
+}
+
+void JobSystem::ParallelForRange(ui32 count, ui32 minRangeSize, const std::function<void(ui32 first, ui32 last)>& body)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const ui32 maxRangeCount = (count + std::max(minRangeSize, 1u) - 1) / std::max(minRangeSize, 1u);
+    const ui32 rangeCount = std::min(maxRangeCount, GetThreadCount() * kRangesPerThread);
+    const ui32 rangeSize = (count + rangeCount - 1) / rangeCount;
+
+    ParallelFor(rangeCount, [&](ui32 range) {
+        const ui32 first = std::min(range * rangeSize, count);
+        body(first, std::min(first + rangeSize, count));
+    });
+}
+
+::ParallelFor JobSystem::GetParallelFor()
+{
+    return [this](ui32 taskCount, const std::function<void(ui32)>& task) { ParallelFor(taskCount, task); };
+}
+
+ui32 JobSystem::GetThreadCount() const
+{
+    return static_cast<ui32>(m_threadStates.size());
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+    JobSystemStats stats{};
+
+    for (const auto& state : m_threadStates) {
+        stats.executedJobs += state->executedJobs.load(std::memory_order_relaxed);
+        stats.stolenJobs += state->stolenJobs.load(std::memory_order_relaxed);
+        stats.inlineJobs += state->inlineJobs.load(std::memory_order_relaxed);
+    }
+
+    return stats;
+}
+
+
+void JobSystem::_WorkerLoop(ui32 threadIndex)
+{
+    auto& state = *m_threadStates[threadIndex];
+    ui32 idleRounds = 0;
+
+    while (m_isRunning.load(std::memory_order_relaxed)) {
+        if (Job* job = _FindJob(threadIndex)) {
+            _Execute(job, state);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < kIdleSpinCount) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeCondition.wait(lock, [this]() {
+            return m_queuedJobs.load(std::memory_order_seq_cst) > 0 || m_isRunning.load(std::memory_order_relaxed) == false;
+        });
+        m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        idleRounds = 0;
+    }
+}
+
+ui32 JobSystem::_GetThreadIndex() const
+{
+    if (t_jobSystem != this) {
+        throw std::runtime_error("JobSystem: Jobs can only be submitted and waited for from the Init() thread or from workers!");
+    }
+
+    return t_threadIndex;
+}
+
+Job* JobSystem::_AllocateJob(ThreadState& state)
+{
+    for (ui32 i = 0; i < kJobPoolSize; ++i) {
+        Job& job = state.jobs[state.nextJob];
+        state.nextJob = (state.nextJob + 1) & (kJobPoolSize - 1);
+
+        if (job.isBusy.load(std::memory_order_acquire) == false) {
+            job.isBusy.store(true, std::memory_order_relaxed);
+            return &job;
+        }
+    }
+
+    return nullptr;
+}
+
+// NOTE: Own queue first, then one pass over the others starting at a random victim
+Job* JobSystem::_FindJob(ui32 threadIndex)
+{
+    auto& state = *m_threadStates[threadIndex];
+
+    if (Job* job = state.queue.Pop()) {
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    const auto threadCount = static_cast<ui32>(m_threadStates.size());
+    const ui32 firstVictim = _nextRandom(state.random) % threadCount;
+
+    for (ui32 i = 0; i < threadCount; ++i) {
+        const ui32 victim = (firstVictim + i) % threadCount;
+        if (victim == threadIndex) {
+            continue;
+        }
+
+        if (Job* job = m_threadStates[victim]->queue.Steal()) {
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            state.stolenJobs.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::_Execute(Job* job, ThreadState& state)
+{
+    _Invoke(job->function, job->counter);
+    // NOTE: Captures are released here, not when the slot gets reused
+    job->function = nullptr;
+
+    JobCounter* counter = job->counter;
+    job->isBusy.store(false, std::memory_order_release);
+
+    if (counter != nullptr) {
+        counter->m_pending.fetch_sub(1, std::memory_order_release);
+    }
+    state.executedJobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// NOTE: Never throws, so whoever runs the job still releases its slot and counter. The exception is published
+//  by the counter's decrement after this.
+void JobSystem::_Invoke(const std::function<void()>& function, JobCounter* counter) noexcept
+{
+    try {
+        function();
+    }
+    catch (...) {
+        if (counter == nullptr) {
+            std::terminate();
+        }
+
+        bool expected = false;
+        if (counter->m_hasError.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            counter->m_error = std::current_exception();
+        }
+    }
+}
+
+
+
+// NOTE: Best effort, pinning fails silently when the core doesn't exist or isn't available to the process
+void _pinCurrentThread(ui32 core)
+{
+#if defined(_WIN32)
+    if (core < 64) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+    }
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core % CPU_SETSIZE, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#else
+    (void)core;
+#endif
+}
+
+// NOTE: xorshift32, only used to spread steal attempts
+ui32 _nextRandom(ui32& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// NOTE: Runs 'task(i)' for i in [0, taskCount), possibly in parallel, and returns when all are done.
+//  Same signature as the ParallelFor of RenderQueue, FrustumCuller and TransformHierarchy, JobSystem::GetParallelFor() fits all of them.
+using ParallelFor = std::function<void(ui32 taskCount, const std::function<void(ui32)>& task)>;
+
+
+// NOTE: Number of jobs that still have to finish, jobs started with it decrement it when they're done
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<ui32> m_pending{ 0 };
+    // NOTE: First exception one of the counter's jobs threw, Wait() rethrows it
+    std::atomic<bool> m_hasError{ false };
+    std::exception_ptr m_error;
+};
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter* counter;
+    // NOTE: Slot of the owner's job pool is taken until the job has run
+    std::atomic<bool> isBusy{ false };
+};
+
+// NOTE: Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models").
+//  The owner pushes and pops at the bottom (LIFO, cache-warm), other threads steal from the top (FIFO, the biggest leftovers).
+//  Fixed capacity, Push() fails when full and the caller runs the job itself.
+class WorkStealingQueue
+{
+public:
+    static constexpr ui32 kCapacity = 4096;
+
+    WorkStealingQueue() = default;
+
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+    // NOTE: Owner thread only
+    bool Push(Job* job);
+    Job* Pop();
+    // NOTE: Any thread
+    Job* Steal();
+
+private:
+    alignas(64) std::atomic<i64> m_top{ 0 };
+    alignas(64) std::atomic<i64> m_bottom{ 0 };
+    alignas(64) std::atomic<Job*> m_jobs[kCapacity];
+};
+
+struct JobSystemStats
+{
+    ui64 executedJobs;
+    ui64 stolenJobs;
+    // NOTE: Jobs run on the spot because the submitting thread's queue was full
+    ui64 inlineJobs;
+};
+
+
+// NOTE: Fixed worker threads, every thread (workers and the one that called Init()) has its own job pool and deque.
+//  Jobs can only be submitted from those threads. Idle workers steal from random victims, spin for a bit
+//  and then sleep until something is submitted. Wait() doesn't block, the waiting thread runs jobs until the counter is done.
+class JobSystem
+{
+public:
+    JobSystem() = default;
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // NOTE: 'workerCount' threads besides the calling one, so GetThreadCount() is workerCount + 1.
+    //  With 'pinThreads' worker i is pinned to core i + 1 and the calling thread to core 0.
+    void Init(ui32 workerCount, bool pinThreads = false);
+    void Shutdown();
+
+    // NOTE: 'counter' is optional, it's incremented here and decremented after 'function' ran, even if it threw.
+    //  An exception goes to the counter, without one there is nobody to report it to and std::terminate() is called.
+    void Run(std::function<void()> function, JobCounter* counter = nullptr);
+    // NOTE: Helps with jobs (any, not only the counter's) until the counter reaches zero,
+    //  then rethrows the first exception the counter's jobs threw
+    void Wait(const JobCounter& counter);
+
+    // NOTE: Runs task(0) on the calling thread and the rest as jobs, returns when all are done.
+    //  If tasks threw, the first exception is rethrown after that.
+    void ParallelFor(ui32 taskCount, const std::function<void(ui32)>& task);
+    // NOTE: Splits [0, count) into ranges of at least 'minRangeSize' elements, a few per thread for load balancing
+    void ParallelForRange(ui32 count, ui32 minRangeSize, const std::function<void(ui32 first, ui32 last)>& body);
+    // NOTE: Adapter for the modules that take a ParallelFor, valid until Shutdown()
+    ::ParallelFor GetParallelFor();
+
+    ui32 GetThreadCount() const;
+    JobSystemStats GetStats() const;
+
+private:
+    struct ThreadState
+    {
+        WorkStealingQueue queue;
+        std::unique_ptr<Job[]> jobs;
+        ui32 nextJob = 0;
+        ui32 random = 0;
+
+        alignas(64) std::atomic<ui64> executedJobs{ 0 };
+        std::atomic<ui64> stolenJobs{ 0 };
+        std::atomic<ui64> inlineJobs{ 0 };
+    };
+
+    void _WorkerLoop(ui32 threadIndex);
+    ui32 _GetThreadIndex() const;
+    Job* _AllocateJob(ThreadState& state);
+    Job* _FindJob(ui32 threadIndex);
+    void _Execute(Job* job, ThreadState& state);
+    static void _Invoke(const std::function<void()>& function, JobCounter* counter) noexcept;
+
+private:
+    std::vector<std::unique_ptr<ThreadState>> m_threadStates;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<bool> m_isRunning{ false };
+    // NOTE: Jobs pushed and not yet taken, sleeping workers wake up when it's non-zero
+    std::atomic<i64> m_queuedJobs{ 0 };
+    std::atomic<ui32> m_sleepingWorkers{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+};
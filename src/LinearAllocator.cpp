@@ -0,0 +1,232 @@
+#include "LinearAllocator.hpp"
+
+#include <algorithm>
+#include <bit> // std::bit_ceil
+#include <stdexcept> // std::runtime_error
+
+
+// NOTE: Blocks are aligned like this, bigger alignments are still honored by padding inside the block
+constexpr size_t kBlockAlignment = 64;
+
+
+auto _alignOffset(size_t value, size_t alignment)        -> size_t;
+auto _raisePeak(std::atomic<size_t>& peak, size_t value) -> void;
+
+
+LinearArena::~LinearArena()
+{
+    Shutdown();
+}
+
+void LinearArena::Init(size_t capacity, std::pmr::memory_resource* upstream)
+{
+    if (m_block != nullptr) {
+        throw std::runtime_error("LinearArena::Init(): Already initialized!");
+    }
+
+    m_upstream = upstream;
+    m_block = static_cast<ui8*>(m_upstream->allocate(capacity, kBlockAlignment));
+    m_offset = 0;
+    m_capacity.store(capacity, std::memory_order_relaxed);
+    m_peakBytes.store(0, std::memory_order_relaxed);
+    m_spillCount.store(0, std::memory_order_relaxed);
+}
+
+void LinearArena::Shutdown()
+{
+    if (m_block == nullptr) {
+        return;
+    }
+
+    _FreeSpills();
+    m_upstream->deallocate(m_block, m_capacity.load(std::memory_order_relaxed), kBlockAlignment);
+    m_block = nullptr;
+    m_offset = 0;
+    m_capacity.store(0, std::memory_order_relaxed);
+}
+
+// NOTE: Growing is the only allocation outside of spills, and only happens after a cycle that spilled
+void LinearArena::Reset()
+{
+    const size_t capacity = m_capacity.load(std::memory_order_relaxed);
+    const size_t needed = m_offset + m_spilledBytes;
+
+    _FreeSpills();
+    m_offset = 0;
+
+    if (needed > capacity) {
+        const size_t newCapacity = std::bit_ceil(needed);
+        m_upstream->deallocate(m_block, capacity, kBlockAlignment);
+        m_block = static_cast<ui8*>(m_upstream->allocate(newCapacity, kBlockAlignment));
+        m_capacity.store(newCapacity, std::memory_order_relaxed);
+    }
+}
+
+ArenaStats LinearArena::GetStats() const
+{
+    return { .capacity = m_capacity.load(std::memory_order_relaxed),
+             .peakBytes = m_peakBytes.load(std::memory_order_relaxed),
+             .spillCount = m_spillCount.load(std::memory_order_relaxed) };
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    const size_t offset = _alignOffset(reinterpret_cast<uintptr_t>(m_block) + m_offset, alignment) - reinterpret_cast<uintptr_t>(m_block);
+
+    if (offset + bytes <= m_capacity.load(std::memory_order_relaxed)) {
+        m_offset = offset + bytes;
+        _raisePeak(m_peakBytes, m_offset + m_spilledBytes);
+        return m_block + offset;
+    }
+
+    // NOTE: The header goes in front, padded so the allocation after it keeps its alignment
+    const size_t spillAlignment = std::max(alignment, alignof(Spill));
+    const size_t headerSize = _alignOffset(sizeof(Spill), spillAlignment);
+    const size_t size = headerSize + bytes;
+
+    auto* spill = static_cast<Spill*>(m_upstream->allocate(size, spillAlignment));
+    *spill = Spill{ .next = m_spills, .size = size, .alignment = spillAlignment };
+    m_spills = spill;
+    m_spilledBytes += bytes;
+
+    m_spillCount.fetch_add(1, std::memory_order_relaxed);
+    _raisePeak(m_peakBytes, m_offset + m_spilledBytes);
+
+    return reinterpret_cast<ui8*>(spill) + headerSize;
+}
+
+void LinearArena::do_deallocate(void* /*pointer*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+}
+
+bool LinearArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void LinearArena::_FreeSpills()
+{
+    while (m_spills != nullptr) {
+        Spill* next = m_spills->next;
+        m_upstream->deallocate(m_spills, m_spills->size, m_spills->alignment);
+        m_spills = next;
+    }
+    m_spilledBytes = 0;
+}
+
+
+ScratchStack::~ScratchStack()
+{
+    Shutdown();
+}
+
+void ScratchStack::Init(size_t capacity, std::pmr::memory_resource* upstream)
+{
+    if (m_block != nullptr) {
+        throw std::runtime_error("ScratchStack::Init(): Already initialized!");
+    }
+
+    m_upstream = upstream;
+    m_block = static_cast<ui8*>(m_upstream->allocate(capacity, kBlockAlignment));
+    m_capacity = capacity;
+    m_top = 0;
+    m_spilledBytes = 0;
+    m_peakBytes.store(0, std::memory_order_relaxed);
+    m_spillCount.store(0, std::memory_order_relaxed);
+}
+
+void ScratchStack::Shutdown()
+{
+    if (m_block == nullptr) {
+        return;
+    }
+
+    m_upstream->deallocate(m_block, m_capacity, kBlockAlignment);
+    m_block = nullptr;
+    m_capacity = 0;
+    m_top = 0;
+}
+
+size_t ScratchStack::GetMarker() const
+{
+    return m_top;
+}
+
+// NOTE: ~ScratchScope() calls it, so it can't throw. The top is already below the marker when an inner scope's
+//  deallocation popped something allocated before the marker was taken, then there is nothing left to free.
+void ScratchStack::Rewind(size_t marker) noexcept
+{
+    m_top = std::min(m_top, marker);
+}
+
+ArenaStats ScratchStack::GetStats() const
+{
+    return { .capacity = m_capacity,
+             .peakBytes = m_peakBytes.load(std::memory_order_relaxed),
+             .spillCount = m_spillCount.load(std::memory_order_relaxed) };
+}
+
+void* ScratchStack::do_allocate(size_t bytes, size_t alignment)
+{
+    const size_t offset = _alignOffset(reinterpret_cast<uintptr_t>(m_block) + m_top, alignment) - reinterpret_cast<uintptr_t>(m_block);
+
+    if (offset + bytes <= m_capacity) {
+        m_top = offset + bytes;
+        _raisePeak(m_peakBytes, m_top + m_spilledBytes);
+        return m_block + offset;
+    }
+
+    m_spilledBytes += bytes;
+    m_spillCount.fetch_add(1, std::memory_order_relaxed);
+    _raisePeak(m_peakBytes, m_top + m_spilledBytes);
+
+    return m_upstream->allocate(bytes, alignment);
+}
+
+// NOTE: Only the topmost allocation can be popped, anything below waits for its scope to rewind.
+//  Padding in front of it stays until then too.
+void ScratchStack::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+    auto* memory = static_cast<ui8*>(pointer);
+
+    if (memory < m_block || memory >= m_block + m_capacity) {
+        m_spilledBytes -= bytes;
+        m_upstream->deallocate(pointer, bytes, alignment);
+        return;
+    }
+
+    if (memory + bytes == m_block + m_top) {
+        m_top = static_cast<size_t>(memory - m_block);
+    }
+}
+
+bool ScratchStack::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+
+ScratchScope::ScratchScope(ScratchStack& stack)
+    : m_stack(stack)
+    , m_marker(stack.GetMarker())
+{
+}
+
+ScratchScope::~ScratchScope()
+{
+    m_stack.Rewind(m_marker);
+}
+
+
+
+size_t _alignOffset(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void _raisePeak(std::atomic<size_t>& peak, size_t value)
+{
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && peak.compare_exchange_weak(current, value, std::memory_order_relaxed) == false) {
+    }
+}
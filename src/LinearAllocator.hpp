@@ -0,0 +1,118 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <atomic>
+#include <memory_resource>
+
+
+struct ArenaStats
+{
+    size_t capacity;
+    // NOTE: Most bytes in use at once, spilled ones included, so capacity >= peakBytes means nothing spills anymore
+    size_t peakBytes;
+    // NOTE: Allocations that didn't fit and went to the upstream resource
+    ui64 spillCount;
+};
+
+
+// NOTE: Bump allocator for data that dies all at once: allocating moves a pointer, deallocating does nothing,
+//  Reset() frees everything. What doesn't fit spills to the upstream resource until the next Reset(), which then grows
+//  the block to what was actually needed, so a steady workload stops touching the heap after its first cycle.
+//  Not thread-safe, the stats can be read from any thread.
+class LinearArena : public std::pmr::memory_resource
+{
+public:
+    LinearArena() = default;
+    ~LinearArena() override;
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void Init(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    void Shutdown();
+
+    // NOTE: Everything allocated since the last Reset() becomes invalid
+    void Reset();
+
+    ArenaStats GetStats() const;
+
+private:
+    // NOTE: In front of every spilled allocation, they are chained so Reset() can free them
+    struct Spill
+    {
+        Spill* next;
+        size_t size;
+        size_t alignment;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void _FreeSpills();
+
+private:
+    std::pmr::memory_resource*  m_upstream = nullptr;
+    ui8*                        m_block = nullptr;
+    size_t                      m_offset = 0;
+    Spill*                      m_spills = nullptr;
+    size_t                      m_spilledBytes = 0;
+
+    std::atomic<size_t>         m_capacity{ 0 };
+    std::atomic<size_t>         m_peakBytes{ 0 };
+    std::atomic<ui64>           m_spillCount{ 0 };
+};
+
+
+// NOTE: Stack allocator for the temporaries of one thread. A ScratchScope remembers the top of the stack and releases
+//  everything allocated after it when it goes out of scope, freeing the topmost allocation pops it right away.
+//  Allocations that don't fit go to the upstream resource and are given back on deallocation, the block never grows.
+class ScratchStack : public std::pmr::memory_resource
+{
+public:
+    ScratchStack() = default;
+    ~ScratchStack() override;
+
+    ScratchStack(const ScratchStack&) = delete;
+    ScratchStack& operator=(const ScratchStack&) = delete;
+
+    void Init(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    void Shutdown();
+
+    size_t GetMarker() const;
+    // NOTE: Frees everything allocated after 'marker' was taken, a marker above the top changes nothing
+    void Rewind(size_t marker) noexcept;
+
+    ArenaStats GetStats() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    std::pmr::memory_resource*  m_upstream = nullptr;
+    ui8*                        m_block = nullptr;
+    size_t                      m_capacity = 0;
+    size_t                      m_top = 0;
+    size_t                      m_spilledBytes = 0;
+
+    std::atomic<size_t>         m_peakBytes{ 0 };
+    std::atomic<ui64>           m_spillCount{ 0 };
+};
+
+// NOTE: Containers using the stack must be declared after the scope, so they are destroyed before it rewinds
+class ScratchScope
+{
+public:
+    explicit ScratchScope(ScratchStack& stack);
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+private:
+    ScratchStack& m_stack;
+    size_t m_marker;
+};
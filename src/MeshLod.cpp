@@ -0,0 +1,368 @@
+#include "MeshLod.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility> // std::pair
+
+
+// NOTE: A level that keeps more than this share of the previous one's indices isn't worth storing
+constexpr f32 kMinLodReduction = 0.95f;
+
+
+// NOTE: Sum of squared distances to a set of planes as a symmetric 4x4 matrix, only the upper triangle is stored
+struct _Quadric
+{
+    f64 a00, a01, a02, a03;
+    f64 a11, a12, a13;
+    f64 a22, a23;
+    f64 a33;
+};
+
+struct _Collapse
+{
+    ui32 from;
+    ui32 to;
+    f64 cost;
+};
+
+auto _addPlaneQuadric(_Quadric& quadric, const f64* normal, f64 distance)    -> void;
+auto _accumulateQuadric(_Quadric& quadric, const _Quadric& other)            -> void;
+auto _evaluateQuadric(const _Quadric& quadric, const f32* position)          -> f64;
+auto _makeEdgeKey(ui32 from, ui32 to)                                        -> ui64;
+auto _triangleNormal(const f32* p0, const f32* p1, const f32* p2, f64* normal) -> f64;
+
+
+f32 SimplifyMesh(const f32* positions, ui32 vertexCount, ui32 positionStride, const ui16* indices, ui32 indexCount,
+                 ui32 targetIndexCount, f32 maxError, std::vector<ui16>& result)
+{
+    auto position = [&](ui32 vertex) { return positions + static_cast<size_t>(vertex) * positionStride; };
+
+    result.assign(indices, indices + indexCount);
+
+    // NOTE: Directed edges of the triangles, an edge without its reverse is on the border
+    std::vector<ui64> edges;
+    auto buildEdges = [&]() {
+        edges.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (ui32 corner = 0; corner < 3; ++corner) {
+                edges.push_back(_makeEdgeKey(result[i + corner], result[i + (corner + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+    };
+    auto hasEdge = [&](ui32 from, ui32 to) { return std::binary_search(edges.begin(), edges.end(), _makeEdgeKey(from, to)); };
+
+    // NOTE: Every vertex starts with the planes of its triangles. Border edges add a plane through the edge,
+    //  perpendicular to the triangle, which keeps border vertices on the outline.
+    std::vector<_Quadric> quadrics(vertexCount, _Quadric{});
+    buildEdges();
+    for (size_t i = 0; i < result.size(); i += 3) {
+        f64 normal[3];
+        const f32* p0 = position(result[i]);
+        if (_triangleNormal(p0, position(result[i + 1]), position(result[i + 2]), normal) == 0.0) {
+            continue;
+        }
+
+        const f64 distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+        for (ui32 corner = 0; corner < 3; ++corner) {
+            _addPlaneQuadric(quadrics[result[i + corner]], normal, distance);
+        }
+
+        for (ui32 corner = 0; corner < 3; ++corner) {
+            const ui32 from = result[i + corner];
+            const ui32 to = result[i + (corner + 1) % 3];
+            if (hasEdge(to, from)) {
+                continue;
+            }
+
+            const f32* a = position(from);
+            const f32* b = position(to);
+            const f64 edge[3] = { f64(b[0]) - a[0], f64(b[1]) - a[1], f64(b[2]) - a[2] };
+            f64 borderNormal[3] = { edge[1] * normal[2] - edge[2] * normal[1],
+                                    edge[2] * normal[0] - edge[0] * normal[2],
+                                    edge[0] * normal[1] - edge[1] * normal[0] };
+            const f64 length = std::sqrt(borderNormal[0] * borderNormal[0] + borderNormal[1] * borderNormal[1] + borderNormal[2] * borderNormal[2]);
+            if (length == 0.0) {
+                continue;
+            }
+            for (auto& component : borderNormal) {
+                component /= length;
+            }
+
+            const f64 borderDistance = -(borderNormal[0] * a[0] + borderNormal[1] * a[1] + borderNormal[2] * a[2]);
+            _addPlaneQuadric(quadrics[from], borderNormal, borderDistance);
+            _addPlaneQuadric(quadrics[to], borderNormal, borderDistance);
+        }
+    }
+
+    const f64 maxCost = static_cast<f64>(maxError) * maxError;
+    f64 error = 0.0;
+
+    std::vector<_Collapse> collapses;
+    std::vector<ui8> isBorder(vertexCount);
+    std::vector<ui8> isLocked(vertexCount);
+    std::vector<ui32> remap(vertexCount);
+    std::vector<ui32> triangleOffsets(vertexCount + 1);
+    std::vector<ui32> vertexTriangles;
+
+    // NOTE: Each pass collapses the cheapest edges whose neighbourhoods don't overlap, so every collapse in a pass
+    //  is checked against geometry that doesn't change until the pass is over
+    while (result.size() > targetIndexCount) {
+        if (edges.empty()) {
+            buildEdges();
+        }
+
+        std::fill(isBorder.begin(), isBorder.end(), 0);
+        for (const ui64 key : edges) {
+            const auto from = static_cast<ui32>(key >> 32);
+            const auto to = static_cast<ui32>(key);
+            if (hasEdge(to, from) == false) {
+                isBorder[from] = 1;
+                isBorder[to] = 1;
+            }
+        }
+
+        // NOTE: Interior edges show up in both directions, only the one with from < to adds the candidates
+        collapses.clear();
+        for (const ui64 key : edges) {
+            const auto a = static_cast<ui32>(key >> 32);
+            const auto b = static_cast<ui32>(key);
+            const bool isBorderEdge = hasEdge(b, a) == false;
+            if (isBorderEdge == false && a > b) {
+                continue;
+            }
+
+            for (const auto& [from, to] : { std::pair(a, b), std::pair(b, a) }) {
+                if (isBorder[from] && isBorderEdge == false) {
+                    continue;
+                }
+
+                _Quadric quadric = quadrics[from];
+                _accumulateQuadric(quadric, quadrics[to]);
+                collapses.push_back(_Collapse{ .from = from, .to = to, .cost = std::max(_evaluateQuadric(quadric, position(to)), 0.0) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const _Collapse& a, const _Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (const ui16 vertex : result) {
+            ++triangleOffsets[vertex + 1];
+        }
+        for (ui32 i = 0; i < vertexCount; ++i) {
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        }
+        vertexTriangles.resize(result.size());
+        for (ui32 i = 0; i < static_cast<ui32>(result.size()); ++i) {
+            vertexTriangles[triangleOffsets[result[i]]++] = i / 3;
+        }
+        for (ui32 i = vertexCount; i > 0; --i) {
+            triangleOffsets[i] = triangleOffsets[i - 1];
+        }
+        triangleOffsets[0] = 0;
+
+        std::fill(isLocked.begin(), isLocked.end(), 0);
+        for (ui32 i = 0; i < vertexCount; ++i) {
+            remap[i] = i;
+        }
+
+        auto remainingIndices = static_cast<ui32>(result.size());
+        ui32 collapseCount = 0;
+
+        for (const auto& collapse : collapses) {
+            if (collapse.cost > maxCost || remainingIndices <= targetIndexCount) {
+                break;
+            }
+            if (isLocked[collapse.from] || isLocked[collapse.to]) {
+                continue;
+            }
+
+            // NOTE: Moving 'from' onto 'to' must not turn any of the surviving triangles around
+            bool flips = false;
+            ui32 removedTriangles = 0;
+            for (ui32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1] && flips == false; ++i) {
+                const ui16* triangle = &result[3 * vertexTriangles[i]];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    ++removedTriangles;
+                    continue;
+                }
+
+                const f32* corners[3];
+                const f32* moved[3];
+                for (ui32 corner = 0; corner < 3; ++corner) {
+                    corners[corner] = position(triangle[corner]);
+                    moved[corner] = triangle[corner] == collapse.from ? position(collapse.to) : corners[corner];
+                }
+
+                f64 before[3];
+                f64 after[3];
+                _triangleNormal(corners[0], corners[1], corners[2], before);
+                if (_triangleNormal(moved[0], moved[1], moved[2], after) == 0.0
+                    || before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0) {
+                    flips = true;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            for (ui32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; ++i) {
+                const ui16* triangle = &result[3 * vertexTriangles[i]];
+                isLocked[triangle[0]] = 1;
+                isLocked[triangle[1]] = 1;
+                isLocked[triangle[2]] = 1;
+            }
+            isLocked[collapse.to] = 1;
+
+            remap[collapse.from] = collapse.to;
+            _accumulateQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            remainingIndices -= 3 * removedTriangles;
+            error = std::max(error, collapse.cost);
+            ++collapseCount;
+        }
+
+        if (collapseCount == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const auto a = static_cast<ui16>(remap[result[i]]);
+            const auto b = static_cast<ui16>(remap[result[i + 1]]);
+            const auto c = static_cast<ui16>(remap[result[i + 2]]);
+            if (a != b && b != c && c != a) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+        edges.clear();
+    }
+
+    return static_cast<f32>(std::sqrt(error));
+}
+
+void BuildMeshLods(const f32* positions, ui32 vertexCount, ui32 positionStride, std::vector<ui16>& indices,
+                   const MeshLodDesc& desc, std::vector<MeshLod>& lods)
+{
+    const auto fullIndexCount = static_cast<ui32>(indices.size());
+
+    lods.clear();
+    lods.push_back(MeshLod{ .firstIndex = 0, .indexCount = fullIndexCount, .error = 0.0f });
+
+    f32 minimum[3] = { 0.0f, 0.0f, 0.0f };
+    f32 maximum[3] = { 0.0f, 0.0f, 0.0f };
+    for (ui32 i = 0; i < vertexCount; ++i) {
+        for (ui32 axis = 0; axis < 3; ++axis) {
+            const f32 value = positions[static_cast<size_t>(i) * positionStride + axis];
+            minimum[axis] = i == 0 ? value : std::min(minimum[axis], value);
+            maximum[axis] = i == 0 ? value : std::max(maximum[axis], value);
+        }
+    }
+    const f32 extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] });
+    const f32 errorLimit = desc.maxError * extent;
+
+    // NOTE: Errors add up along the chain, so each level only gets what the previous ones left of the bound
+    std::vector<ui16> level;
+    for (const f32 ratio : desc.targetRatios) {
+        const MeshLod previous = lods.back();
+        const ui32 targetIndexCount = std::max(static_cast<ui32>(ratio * static_cast<f32>(fullIndexCount / 3)), 1u) * 3;
+        if (lods.size() == kMaxMeshLods || errorLimit <= previous.error) {
+            break;
+        }
+        if (targetIndexCount >= previous.indexCount) {
+            continue;
+        }
+
+        const f32 error = SimplifyMesh(positions, vertexCount, positionStride, indices.data() + previous.firstIndex, previous.indexCount,
+                                       targetIndexCount, errorLimit - previous.error, level);
+        if (static_cast<f32>(level.size()) > kMinLodReduction * static_cast<f32>(previous.indexCount)) {
+            break;
+        }
+
+        lods.push_back(MeshLod{ .firstIndex = static_cast<ui32>(indices.size()),
+                                .indexCount = static_cast<ui32>(level.size()),
+                                .error = previous.error + error });
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
+}
+
+ui32 SelectMeshLod(const MeshLod* lods, ui32 lodCount, f32 pixelsPerUnit, f32 pixelError, f32 hysteresis, ui32 currentLod)
+{
+    // NOTE: Errors grow along the chain, so the first level over the threshold ends the search
+    ui32 lod = 0;
+    while (lod + 1 < lodCount && lods[lod + 1].error * pixelsPerUnit <= pixelError) {
+        ++lod;
+    }
+
+    currentLod = std::min(currentLod, lodCount - 1);
+    if (lod <= currentLod) {
+        return lod;
+    }
+
+    const f32 coarserError = pixelError * (1.0f - hysteresis);
+    while (currentLod < lod && lods[currentLod + 1].error * pixelsPerUnit <= coarserError) {
+        ++currentLod;
+    }
+    return currentLod;
+}
+
+
+
+void _addPlaneQuadric(_Quadric& quadric, const f64* normal, f64 distance)
+{
+    const f64 a = normal[0];
+    const f64 b = normal[1];
+    const f64 c = normal[2];
+    const f64 d = distance;
+
+    quadric.a00 += a * a; quadric.a01 += a * b; quadric.a02 += a * c; quadric.a03 += a * d;
+    quadric.a11 += b * b; quadric.a12 += b * c; quadric.a13 += b * d;
+    quadric.a22 += c * c; quadric.a23 += c * d;
+    quadric.a33 += d * d;
+}
+
+void _accumulateQuadric(_Quadric& quadric, const _Quadric& other)
+{
+    quadric.a00 += other.a00; quadric.a01 += other.a01; quadric.a02 += other.a02; quadric.a03 += other.a03;
+    quadric.a11 += other.a11; quadric.a12 += other.a12; quadric.a13 += other.a13;
+    quadric.a22 += other.a22; quadric.a23 += other.a23;
+    quadric.a33 += other.a33;
+}
+
+// NOTE: v^T Q v with v = (x, y, z, 1)
+f64 _evaluateQuadric(const _Quadric& quadric, const f32* position)
+{
+    const f64 x = position[0];
+    const f64 y = position[1];
+    const f64 z = position[2];
+
+    return quadric.a00 * x * x + 2.0 * quadric.a01 * x * y + 2.0 * quadric.a02 * x * z + 2.0 * quadric.a03 * x
+         + quadric.a11 * y * y + 2.0 * quadric.a12 * y * z + 2.0 * quadric.a13 * y
+         + quadric.a22 * z * z + 2.0 * quadric.a23 * z
+         + quadric.a33;
+}
+
+ui64 _makeEdgeKey(ui32 from, ui32 to)
+{
+    return (static_cast<ui64>(from) << 32) | to;
+}
+
+// NOTE: Writes the unit normal and returns twice the area, 0 for degenerate triangles
+f64 _triangleNormal(const f32* p0, const f32* p1, const f32* p2, f64* normal)
+{
+    const f64 e1[3] = { f64(p1[0]) - p0[0], f64(p1[1]) - p0[1], f64(p1[2]) - p0[2] };
+    const f64 e2[3] = { f64(p2[0]) - p0[0], f64(p2[1]) - p0[1], f64(p2[2]) - p0[2] };
+
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+    const f64 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (length > 0.0) {
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+    }
+    return length;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <vector>
+
+
+constexpr ui32 kMaxMeshLods = 8;
+
+// NOTE: One level of a mesh, a range of the mesh's index list. Every level uses the same vertices.
+struct MeshLod
+{
+    ui32 firstIndex;
+    ui32 indexCount;
+    // NOTE: How far the surface moved from the full mesh, an upper estimate in the mesh's own units. 0 for LOD 0.
+    f32 error;
+};
+
+struct MeshLodDesc
+{
+    // NOTE: Triangle count of each level after LOD 0 relative to the full mesh, decreasing. At most kMaxMeshLods - 1 of them.
+    std::vector<f32> targetRatios = { 0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f, 0.015625f, 0.0078125f };
+    // NOTE: Relative to the largest extent of the mesh's bounding box, no level deviates more than this.
+    //  The chain ends early when the bound stops a level from getting meaningfully smaller.
+    f32 maxError = 0.02f;
+};
+
+
+// NOTE: Quadric-error edge collapse. Vertices only ever collapse onto a neighbour, so the result indexes the same
+//  vertex array. Border vertices only move along the border, so open meshes keep their outline.
+//  'positions' are xyz, 'positionStride' floats apart. Stops at 'targetIndexCount' or when the next collapse would
+//  move the surface further than 'maxError', whatever comes first. Returns the error of the result.
+f32 SimplifyMesh(const f32* positions, ui32 vertexCount, ui32 positionStride, const ui16* indices, ui32 indexCount,
+                 ui32 targetIndexCount, f32 maxError, std::vector<ui16>& result);
+
+// NOTE: Appends the simplified levels to 'indices', each one simplified from the previous level, and fills 'lods'
+//  starting with the full mesh. All levels stay in one index list, so a mesh is still one allocation.
+void BuildMeshLods(const f32* positions, ui32 vertexCount, ui32 positionStride, std::vector<ui16>& indices,
+                   const MeshLodDesc& desc, std::vector<MeshLod>& lods);
+
+// NOTE: Coarsest level whose error, projected with 'pixelsPerUnit', stays within 'pixelError'.
+//  Going coarser than 'currentLod' needs the error to be a 'hysteresis' fraction below the threshold,
+//  so an object sitting at the boundary doesn't flip between two levels every frame.
+ui32 SelectMeshLod(const MeshLod* lods, ui32 lodCount, f32 pixelsPerUnit, f32 pixelError, f32 hysteresis, ui32 currentLod);
@@ -0,0 +1,193 @@
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+// NOTE: Cosine between the cone axis and the furthest normal. Clusters that spread wider are never cone culled,
+//  a viewer would practically never see all of their triangles from behind.
+constexpr f32 kMinConeSpread = 0.1f;
+
+
+auto _computeMeshletBounds(const f32* positions, ui32 positionStride, const ui16* indices, Meshlet& meshlet) -> void;
+
+
+void BuildMeshlets(const f32* positions, ui32 vertexCount, ui32 positionStride, ui16* indices, ui32 firstIndex, ui32 indexCount,
+                   std::vector<Meshlet>& meshlets)
+{
+    ui16* triangles = indices + firstIndex;
+    const ui32 triangleCount = indexCount / 3;
+
+    // NOTE: Triangles around every vertex, a flat list with per-vertex offsets
+    std::vector<ui32> adjacencyOffsets(static_cast<size_t>(vertexCount) + 1, 0);
+    for (ui32 i = 0; i < triangleCount * 3; ++i) {
+        ++adjacencyOffsets[triangles[i] + 1];
+    }
+    for (ui32 vertex = 0; vertex < vertexCount; ++vertex) {
+        adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+    }
+    std::vector<ui32> adjacency(triangleCount * 3);
+    std::vector<ui32> adjacencyEnds(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (ui32 i = 0; i < triangleCount * 3; ++i) {
+        adjacency[adjacencyEnds[triangles[i]]++] = i / 3;
+    }
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    // NOTE: The meshlet that last took a vertex, so checking what a triangle would add is three lookups
+    std::vector<ui32> vertexMeshlet(vertexCount, ~0u);
+    std::vector<ui32> vertices;
+    std::vector<ui16> ordered;
+    ordered.reserve(triangleCount * 3);
+
+    auto countNewVertices = [&](ui32 triangle, ui32 meshlet) {
+        ui32 count = 0;
+        for (ui32 corner = 0; corner < 3; ++corner) {
+            count += vertexMeshlet[triangles[3 * triangle + corner]] != meshlet ? 1 : 0;
+        }
+        return count;
+    };
+
+    ui32 seed = 0;
+    for (ui32 meshlet = 0; ordered.size() < triangleCount * 3; ++meshlet) {
+        const auto meshletFirst = static_cast<ui32>(ordered.size());
+        vertices.clear();
+
+        while (isEmitted[seed]) {
+            ++seed;
+        }
+
+        ui32 triangle = seed;
+        ui32 meshletTriangleCount = 0;
+        while (triangle != ~0u) {
+            for (ui32 corner = 0; corner < 3; ++corner) {
+                const ui16 vertex = triangles[3 * triangle + corner];
+                if (vertexMeshlet[vertex] != meshlet) {
+                    vertexMeshlet[vertex] = meshlet;
+                    vertices.push_back(vertex);
+                }
+                ordered.push_back(vertex);
+            }
+            isEmitted[triangle] = true;
+
+            if (++meshletTriangleCount == kMeshletMaxTriangles) {
+                break;
+            }
+
+            // NOTE: Neighbours first, the one that adds the fewest vertices keeps the cluster compact
+            triangle = ~0u;
+            ui32 bestCount = 4;
+            for (const ui32 vertex : vertices) {
+                for (ui32 i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; ++i) {
+                    const ui32 candidate = adjacency[i];
+                    if (isEmitted[candidate]) {
+                        continue;
+                    }
+
+                    const ui32 count = countNewVertices(candidate, meshlet);
+                    if (count < bestCount && vertices.size() + count <= kMeshletMaxVertices) {
+                        bestCount = count;
+                        triangle = candidate;
+                    }
+                }
+                if (bestCount == 0) {
+                    break;
+                }
+            }
+
+            // NOTE: Nothing connected fits, the next triangle in index order is usually still close by.
+            //  Without this a triangle soup would end up with one triangle per meshlet.
+            if (triangle == ~0u) {
+                while (seed < triangleCount && isEmitted[seed]) {
+                    ++seed;
+                }
+                if (seed < triangleCount && vertices.size() + countNewVertices(seed, meshlet) <= kMeshletMaxVertices) {
+                    triangle = seed;
+                }
+            }
+        }
+
+        Meshlet result{ .center = { 0.0f, 0.0f, 0.0f },
+                        .radius = 0.0f,
+                        .coneAxis = { 0.0f, 0.0f, 1.0f },
+                        .coneCutoff = 1.0f,
+                        .firstIndex = firstIndex + meshletFirst,
+                        .indexCount = static_cast<ui32>(ordered.size()) - meshletFirst };
+        _computeMeshletBounds(positions, positionStride, ordered.data() + meshletFirst, result);
+        meshlets.push_back(result);
+    }
+
+    std::copy(ordered.begin(), ordered.end(), triangles);
+}
+
+
+
+// NOTE: Sphere around the box of the vertices, cone around the average triangle normal
+void _computeMeshletBounds(const f32* positions, ui32 positionStride, const ui16* indices, Meshlet& meshlet)
+{
+    auto position = [&](ui32 vertex) { return positions + static_cast<size_t>(vertex) * positionStride; };
+
+    f32 minimum[3] = { position(indices[0])[0], position(indices[0])[1], position(indices[0])[2] };
+    f32 maximum[3] = { minimum[0], minimum[1], minimum[2] };
+    for (ui32 i = 1; i < meshlet.indexCount; ++i) {
+        const f32* p = position(indices[i]);
+        for (ui32 axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::min(minimum[axis], p[axis]);
+            maximum[axis] = std::max(maximum[axis], p[axis]);
+        }
+    }
+
+    f32 radiusSquared = 0.0f;
+    for (ui32 axis = 0; axis < 3; ++axis) {
+        meshlet.center[axis] = 0.5f * (minimum[axis] + maximum[axis]);
+    }
+    for (ui32 i = 0; i < meshlet.indexCount; ++i) {
+        const f32* p = position(indices[i]);
+        const f32 dx = p[0] - meshlet.center[0];
+        const f32 dy = p[1] - meshlet.center[1];
+        const f32 dz = p[2] - meshlet.center[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // NOTE: Degenerate triangles have no facing, they are left out of the cone
+    f32 normals[kMeshletMaxTriangles][3];
+    ui32 normalCount = 0;
+    f32 axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (ui32 i = 0; i < meshlet.indexCount; i += 3) {
+        const f32* p0 = position(indices[i]);
+        const f32* p1 = position(indices[i + 1]);
+        const f32* p2 = position(indices[i + 2]);
+        const f32 e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const f32 e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        f32* normal = normals[normalCount];
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        const f32 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.0f) {
+            continue;
+        }
+        for (ui32 c = 0; c < 3; ++c) {
+            normal[c] /= length;
+            axis[c] += normal[c];
+        }
+        ++normalCount;
+    }
+
+    const f32 axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (normalCount == 0 || axisLength == 0.0f) {
+        return;
+    }
+    for (ui32 c = 0; c < 3; ++c) {
+        meshlet.coneAxis[c] = axis[c] / axisLength;
+    }
+
+    f32 minDot = 1.0f;
+    for (ui32 i = 0; i < normalCount; ++i) {
+        minDot = std::min(minDot, normals[i][0] * meshlet.coneAxis[0] + normals[i][1] * meshlet.coneAxis[1] + normals[i][2] * meshlet.coneAxis[2]);
+    }
+
+    // NOTE: The test compares against the sine of the cone's half angle
+    meshlet.coneCutoff = minDot <= kMinConeSpread ? 1.0f : std::sqrt(std::max(1.0f - minDot * minDot, 0.0f));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <vector>
+
+
+// NOTE: Fits the common mesh shader output limits, 124 leaves room for 4-byte aligned primitive indices
+constexpr ui32 kMeshletMaxVertices = 64;
+constexpr ui32 kMeshletMaxTriangles = 124;
+
+// NOTE: A cluster of neighbouring triangles, a contiguous range of the mesh's index list
+struct Meshlet
+{
+    // NOTE: Bounding sphere in the mesh's own space
+    f32 center[3];
+    f32 radius;
+    // NOTE: Every triangle normal is within the cone, so the whole cluster faces away from a viewer at 'eye' when
+    //  dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius. A cutoff of 1 never passes the test.
+    f32 coneAxis[3];
+    f32 coneCutoff;
+    ui32 firstIndex;
+    ui32 indexCount;
+};
+
+
+// NOTE: Reorders the triangles of indices[firstIndex, firstIndex + indexCount) so that every meshlet is a contiguous
+//  range of them, then appends the meshlets. Each one grows from a seed triangle through shared vertices, picking
+//  the triangle that adds the fewest new vertices, and ends at kMeshletMaxVertices or kMeshletMaxTriangles.
+//  'positions' are xyz, 'positionStride' floats apart. Front faces are counter-clockwise.
+void BuildMeshlets(const f32* positions, ui32 vertexCount, ui32 positionStride, ui16* indices, ui32 firstIndex, ui32 indexCount,
+                   std::vector<Meshlet>& meshlets);
@@ -0,0 +1,109 @@
+#include "RangeAllocator.hpp"
+
+#include <algorithm>
+
+
+RangeAllocator::RangeAllocator(ui64 size)
+{
+    Reset(size);
+}
+
+void RangeAllocator::Reset(ui64 size)
+{
+    m_freeRanges.clear();
+    m_freeRanges.push_back(Range{ .offset = 0, .size = size });
+    m_size = size;
+    m_freeSize = size;
+}
+
+void RangeAllocator::Grow(ui64 size)
+{
+    if (size <= m_size) {
+        return;
+    }
+
+    const ui64 added = size - m_size;
+    if (m_freeRanges.empty() == false && m_freeRanges.back().offset + m_freeRanges.back().size == m_size) {
+        m_freeRanges.back().size += added;
+    } else {
+        m_freeRanges.push_back(Range{ .offset = m_size, .size = added });
+    }
+    m_size = size;
+    m_freeSize += added;
+}
+
+ui64 RangeAllocator::Allocate(ui64 size, ui64 alignment)
+{
+    for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); ++range) {
+        const ui64 alignedOffset = (range->offset + alignment - 1) / alignment * alignment;
+        const ui64 rangeEnd = range->offset + range->size;
+        if (alignedOffset + size > rangeEnd) {
+            continue;
+        }
+
+        const Range front{ .offset = range->offset, .size = alignedOffset - range->offset };
+        const Range back{ .offset = alignedOffset + size, .size = rangeEnd - (alignedOffset + size) };
+
+        // NOTE: Alignment padding in front stays free, so Free() only has to know the aligned range
+        if (front.size > 0 && back.size > 0) {
+            *range = front;
+            m_freeRanges.insert(range + 1, back);
+        } else if (front.size > 0) {
+            *range = front;
+        } else if (back.size > 0) {
+            *range = back;
+        } else {
+            m_freeRanges.erase(range);
+        }
+
+        m_freeSize -= size;
+        return alignedOffset;
+    }
+
+    return kInvalidOffset;
+}
+
+void RangeAllocator::Free(ui64 offset, ui64 size)
+{
+    auto next = std::lower_bound(m_freeRanges.begin(), m_freeRanges.end(), offset,
+                                 [](const Range& range, ui64 value) { return range.offset < value; });
+    auto inserted = m_freeRanges.insert(next, Range{ .offset = offset, .size = size });
+    m_freeSize += size;
+
+    auto following = inserted + 1;
+    if (following != m_freeRanges.end() && inserted->offset + inserted->size == following->offset) {
+        inserted->size += following->size;
+        m_freeRanges.erase(following);
+    }
+    if (inserted != m_freeRanges.begin()) {
+        auto previous = inserted - 1;
+        if (previous->offset + previous->size == inserted->offset) {
+            previous->size += inserted->size;
+            m_freeRanges.erase(inserted);
+        }
+    }
+}
+
+ui64 RangeAllocator::GetSize() const
+{
+    return m_size;
+}
+
+ui64 RangeAllocator::GetFreeSize() const
+{
+    return m_freeSize;
+}
+
+ui64 RangeAllocator::GetLargestFreeRange() const
+{
+    ui64 largest = 0;
+    for (const auto& range : m_freeRanges) {
+        largest = std::max(largest, range.size);
+    }
+    return largest;
+}
+
+bool RangeAllocator::IsEmpty() const
+{
+    return m_freeSize == m_size;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <vector>
+
+
+// NOTE: First-fit offset allocator over [0, size), used to sub-allocate device memory blocks and big buffers.
+//  It only hands out offsets, the memory itself belongs to the caller.
+class RangeAllocator
+{
+public:
+    static constexpr ui64 kInvalidOffset = ~0ull;
+
+    RangeAllocator() = default;
+    explicit RangeAllocator(ui64 size);
+
+    void Reset(ui64 size);
+    // NOTE: Adds [GetSize(), size) as free space, everything allocated so far keeps its offset
+    void Grow(ui64 size);
+
+    // NOTE: Returns kInvalidOffset when there is no free range big enough
+    ui64 Allocate(ui64 size, ui64 alignment = 1);
+    void Free(ui64 offset, ui64 size);
+
+    ui64 GetSize() const;
+    ui64 GetFreeSize() const;
+    ui64 GetLargestFreeRange() const;
+    bool IsEmpty() const;
+
+private:
+    struct Range
+    {
+        ui64 offset;
+        ui64 size;
+    };
+
+    // NOTE: Sorted by offset, neighbours are always merged
+    std::vector<Range> m_freeRanges;
+    ui64 m_size = 0;
+    ui64 m_freeSize = 0;
+};
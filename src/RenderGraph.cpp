@@ -0,0 +1,1072 @@
+#include "RenderGraph.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <array>
+#include <optional>
+
+
+struct AccessInfo
+{
+    vk::ImageLayout layout;
+    vk::PipelineStageFlags stages;
+    vk::AccessFlags access;
+    vk::ImageUsageFlags usage;
+    bool isWrite;
+    bool isAttachment;
+};
+
+constexpr vk::AccessFlags kWriteAccessMask = vk::AccessFlagBits::eColorAttachmentWrite
+                                           | vk::AccessFlagBits::eDepthStencilAttachmentWrite
+                                           | vk::AccessFlagBits::eShaderWrite
+                                           | vk::AccessFlagBits::eTransferWrite;
+
+
+auto _getAccessInfo(vulkan::RGAccess access, vk::PipelineStageFlags stages, vk::AttachmentLoadOp loadOp) -> AccessInfo;
+auto _isDepthFormat(vk::Format format)                                                                  -> bool;
+auto _hasStencilComponent(vk::Format format)                                                            -> bool;
+auto _getWholeImageRange(vk::Format format)                                                             -> vk::ImageSubresourceRange;
+auto _findGraphMemoryType(const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+                          ui32 memoryTypeBits, bool preferLazy)                                         -> ui32;
+auto _alignUp(vk::DeviceSize value, vk::DeviceSize alignment)                                           -> vk::DeviceSize;
+
+
+namespace vulkan
+{
+
+void RenderGraph::PassBuilder::WriteColor(RGResource image, vk::AttachmentLoadOp loadOp, vk::ClearColorValue clearColor)
+{
+    _AddAccess(image, RGAccess::ColorWrite, vk::PipelineStageFlagBits::eColorAttachmentOutput, loadOp, clearColor);
+}
+
+void RenderGraph::PassBuilder::WriteDepth(RGResource image, vk::AttachmentLoadOp loadOp, vk::ClearDepthStencilValue clearDepth)
+{
+    constexpr auto stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+    _AddAccess(image, RGAccess::DepthWrite, stages, loadOp, clearDepth);
+}
+
+void RenderGraph::PassBuilder::ReadDepth(RGResource image)
+{
+    constexpr auto stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+    _AddAccess(image, RGAccess::DepthRead, stages, vk::AttachmentLoadOp::eLoad, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::ReadTexture(RGResource image, vk::PipelineStageFlags stages)
+{
+    _AddAccess(image, RGAccess::SampledRead, stages, vk::AttachmentLoadOp::eLoad, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::ReadStorage(RGResource image, vk::PipelineStageFlags stages)
+{
+    _AddAccess(image, RGAccess::StorageRead, stages, vk::AttachmentLoadOp::eLoad, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::WriteStorage(RGResource image, vk::PipelineStageFlags stages)
+{
+    _AddAccess(image, RGAccess::StorageWrite, stages, vk::AttachmentLoadOp::eDontCare, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::ReadTransfer(RGResource image)
+{
+    _AddAccess(image, RGAccess::TransferRead, vk::PipelineStageFlagBits::eTransfer, vk::AttachmentLoadOp::eLoad, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::WriteTransfer(RGResource image)
+{
+    _AddAccess(image, RGAccess::TransferWrite, vk::PipelineStageFlagBits::eTransfer, vk::AttachmentLoadOp::eDontCare, vk::ClearValue());
+}
+
+void RenderGraph::PassBuilder::SideEffect()
+{
+    m_graph.m_passes[m_passIndex].sideEffect = true;
+}
+
+void RenderGraph::PassBuilder::ExecuteSecondaries()
+{
+    m_graph.m_passes[m_passIndex].executesSecondaries = true;
+}
+
+void RenderGraph::PassBuilder::_AddAccess(RGResource image, RGAccess access, vk::PipelineStageFlags stages,
+                                          vk::AttachmentLoadOp loadOp, vk::ClearValue clearValue)
+{
+    if (image >= m_graph.m_resources.size()) {
+        throw std::runtime_error("RenderGraph: pass '" + m_graph.m_passes[m_passIndex].name + "' uses an invalid resource!");
+    }
+
+    m_graph.m_passes[m_passIndex].accesses.push_back(Access{ .resource = image,
+                                                             .access = access,
+                                                             .stages = stages,
+                                                             .loadOp = loadOp,
+                                                             .clearValue = clearValue });
+}
+
+
+RGResource RenderGraph::CreateImage(std::string_view name, const RGImageDesc& desc)
+{
+    m_resources.push_back(Resource{ .name = std::string(name),
+                                    .desc = desc,
+                                    .imported = false,
+                                    .finalLayout = vk::ImageLayout::eUndefined });
+
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::ImportImage(std::string_view name, const RGImageDesc& desc, vk::ImageLayout finalLayout)
+{
+    m_resources.push_back(Resource{ .name = std::string(name),
+                                    .desc = desc,
+                                    .imported = true,
+                                    .finalLayout = finalLayout });
+
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::SetImportedImage(RGResource image, vk::Image handle, vk::ImageView view)
+{
+    auto& resource = m_resources[image];
+    if (resource.imported == false) {
+        throw std::runtime_error("RenderGraph: '" + resource.name + "' is not an imported image!");
+    }
+
+    resource.image = handle;
+    resource.view = view;
+}
+
+void RenderGraph::SetDynamicRendering(bool enable)
+{
+    m_useDynamicRendering = enable;
+}
+
+void RenderGraph::SetAllocationCallbacks(const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_allocationCallbacks = allocationCallbacks;
+}
+
+void RenderGraph::AddPass(std::string_view name, const std::function<void(PassBuilder&)>& setup, ExecuteFn execute)
+{
+    m_passes.push_back(Pass{ .name = std::string(name),
+                             .execute = std::move(execute),
+                             .sideEffect = false,
+                             .executesSecondaries = false });
+
+    PassBuilder builder(*this, static_cast<ui32>(m_passes.size() - 1));
+    setup(builder);
+}
+
+
+void RenderGraph::Reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+}
+
+void RenderGraph::Compile(const vk::PhysicalDevice& physicalDevice, const vk::Device& device)
+{
+    const ui64 hash = _ComputeHash();
+    if (m_isCompiled && hash == m_compiledHash) {
+        return;
+    }
+
+    // NOTE: The graph changed its shape, old images and render passes can still be used by frames in flight
+    if (m_isCompiled) {
+        device.waitIdle();
+        _DestroyCompiled(device);
+    }
+
+    m_device = device;
+    m_compiledResources.assign(m_resources.size(), CompiledResource{ .firstPass = ~0u,
+                                                                      .lastPass = 0,
+                                                                      .isTransientAttachment = false,
+                                                                      .aliasPredecessor = kInvalidResource });
+    m_compiledPasses.assign(m_passes.size(), CompiledPass{ .culled = false });
+    m_stats = RenderGraphStats{ .passCount = static_cast<ui32>(m_passes.size()) };
+
+    _CullPasses();
+    _ComputeLifetimes();
+    _CreateImages(physicalDevice, device);
+    _CreateRenderPasses(device);
+    _ComputeBarriers();
+
+    m_compiledHash = hash;
+    m_isCompiled = true;
+}
+
+void RenderGraph::Execute(const RGContext& context)
+{
+    const auto& commandBuffer = context.commandBuffer;
+    auto* memory = context.frameMemory ? context.frameMemory : std::pmr::get_default_resource();
+
+    for (ui32 passIndex = 0; passIndex < m_passes.size(); ++passIndex) {
+        const auto& pass = m_passes[passIndex];
+        const auto& compiled = m_compiledPasses[passIndex];
+        if (compiled.culled) {
+            continue;
+        }
+
+        if (m_useDynamicRendering) {
+            _RecordBarriers2(commandBuffer, compiled.barriers, memory);
+        } else {
+            _RecordBarriers(commandBuffer, compiled.barriers, memory);
+        }
+
+        // NOTE: Outside the render pass, so the query covers load and store ops too
+        const ui32 query = context.firstStatisticsQuery + passIndex;
+        if (context.statisticsQueryPool) {
+            commandBuffer.beginQuery(context.statisticsQueryPool, query, vk::QueryControlFlags());
+        }
+
+        const bool isRendering = m_useDynamicRendering ? compiled.attachments.empty() == false : static_cast<bool>(compiled.renderPass);
+        if (!isRendering) {
+            pass.execute(context);
+        } else if (m_useDynamicRendering) {
+            _BeginRendering(commandBuffer, passIndex);
+            pass.execute(context);
+            commandBuffer.endRendering();
+        } else {
+            // NOTE: At most 8 color attachments + depth, avoids a heap allocation per pass
+            std::array<vk::ClearValue, 9> clearValues;
+            for (ui32 i = 0; i < compiled.attachments.size(); ++i) {
+                clearValues[i] = pass.accesses[compiled.attachments[i]].clearValue;
+            }
+
+            vk::RenderPassBeginInfo renderPassInfo{ .renderPass = compiled.renderPass,
+                                                    .framebuffer = _GetFramebuffer(passIndex),
+                                                    .renderArea = { .offset = {0, 0}, .extent = compiled.extent },
+                                                    .clearValueCount = static_cast<ui32>(compiled.attachments.size()),
+                                                    .pClearValues = clearValues.data() };
+
+            const auto contents = pass.executesSecondaries ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline;
+            commandBuffer.beginRenderPass(renderPassInfo, contents);
+            pass.execute(context);
+            commandBuffer.endRenderPass();
+        }
+
+        if (context.statisticsQueryPool) {
+            commandBuffer.endQuery(context.statisticsQueryPool, query);
+        }
+    }
+
+    if (m_useDynamicRendering) {
+        _RecordBarriers2(commandBuffer, m_finalBarriers, memory);
+    } else {
+        _RecordBarriers(commandBuffer, m_finalBarriers, memory);
+    }
+}
+
+void RenderGraph::Destroy(const vk::Device& device)
+{
+    if (m_isCompiled) {
+        _DestroyCompiled(device);
+    }
+
+    m_isCompiled = false;
+    m_compiledHash = 0;
+}
+
+
+vk::RenderPass RenderGraph::GetRenderPass(std::string_view passName) const
+{
+    return m_compiledPasses[_FindPass(passName)].renderPass;
+}
+
+ui32 RenderGraph::GetPassCount() const
+{
+    return static_cast<ui32>(m_passes.size());
+}
+
+const std::string& RenderGraph::GetPassName(ui32 passIndex) const
+{
+    return m_passes[passIndex].name;
+}
+
+RGAttachmentFormats RenderGraph::GetAttachmentFormats(std::string_view passName) const
+{
+    const auto passIndex = _FindPass(passName);
+    const auto& pass = m_passes[passIndex];
+
+    RGAttachmentFormats formats{ .colorCount = 0,
+                                 .depthFormat = vk::Format::eUndefined };
+    for (const auto accessIndex : m_compiledPasses[passIndex].attachments) {
+        const auto& access = pass.accesses[accessIndex];
+        const auto format = m_resources[access.resource].desc.format;
+
+        if (access.access == RGAccess::ColorWrite) {
+            formats.colorFormats[formats.colorCount++] = format;
+        } else {
+            formats.depthFormat = format;
+        }
+    }
+
+    return formats;
+}
+
+vk::ImageView RenderGraph::GetImageView(RGResource image) const
+{
+    return m_resources[image].imported ? m_resources[image].view : m_compiledResources[image].view;
+}
+
+const RenderGraphStats& RenderGraph::GetStats() const
+{
+    return m_stats;
+}
+
+
+// NOTE: FNV-1a over everything that affects compiled objects. Names are included, so GetRenderPass() stays valid
+ui64 RenderGraph::_ComputeHash() const
+{
+    ui64 hash = 14695981039346656037ull;
+    auto combine = [&hash](ui64 value) {
+        for (ui32 i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    auto combineString = [&combine](const std::string& string) {
+        for (char c : string) {
+            combine(static_cast<ui8>(c));
+        }
+    };
+
+    for (const auto& resource : m_resources) {
+        combineString(resource.name);
+        combine(static_cast<ui64>(resource.desc.format));
+        combine((static_cast<ui64>(resource.desc.extent.width) << 32) | resource.desc.extent.height);
+        combine(static_cast<ui64>(resource.desc.samples));
+        combine(resource.imported);
+        combine(static_cast<ui64>(resource.finalLayout));
+    }
+    combine(m_useDynamicRendering);
+    for (const auto& pass : m_passes) {
+        combineString(pass.name);
+        combine(pass.sideEffect);
+        for (const auto& access : pass.accesses) {
+            combine(access.resource);
+            combine(static_cast<ui64>(access.access));
+            combine(static_cast<VkPipelineStageFlags>(access.stages));
+            combine(static_cast<ui64>(access.loadOp));
+        }
+    }
+
+    return hash;
+}
+
+// NOTE: Liveness from the outputs back, in reverse declaration order. A pass lives when it writes an imported resource
+//  or one that a later live pass reads, a live pass makes what it reads needed by the passes before it.
+//  A write with loadOp eLoad reads too, but only what earlier passes wrote, so it can't keep its own pass alive.
+std::vector<bool> RenderGraph::FindCulledPasses() const
+{
+    std::vector<bool> culled(m_passes.size(), false);
+    std::vector<bool> isNeeded(m_resources.size(), false);
+    for (RGResource i = 0; i < m_resources.size(); ++i) {
+        isNeeded[i] = m_resources[i].imported;
+    }
+
+    for (ui32 passIndex = static_cast<ui32>(m_passes.size()); passIndex-- > 0;) {
+        const auto& pass = m_passes[passIndex];
+        bool isLive = pass.sideEffect;
+        for (const auto& access : pass.accesses) {
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+            if (info.isWrite && isNeeded[access.resource]) {
+                isLive = true;
+            }
+        }
+        if (isLive == false) {
+            culled[passIndex] = true;
+            continue;
+        }
+
+        for (const auto& access : pass.accesses) {
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+            if (info.isWrite == false || access.loadOp == vk::AttachmentLoadOp::eLoad) {
+                isNeeded[access.resource] = true;
+            }
+        }
+    }
+    return culled;
+}
+
+void RenderGraph::_CullPasses()
+{
+    const auto culled = FindCulledPasses();
+    for (ui32 passIndex = 0; passIndex < m_passes.size(); ++passIndex) {
+        if (culled[passIndex]) {
+            m_compiledPasses[passIndex].culled = true;
+            ++m_stats.culledPassCount;
+        }
+    }
+}
+
+void RenderGraph::_ComputeLifetimes()
+{
+    for (ui32 passIndex = 0; passIndex < m_passes.size(); ++passIndex) {
+        if (m_compiledPasses[passIndex].culled) {
+            continue;
+        }
+
+        for (const auto& access : m_passes[passIndex].accesses) {
+            auto& resource = m_compiledResources[access.resource];
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+
+            resource.firstPass = std::min(resource.firstPass, passIndex);
+            resource.lastPass = std::max(resource.lastPass, passIndex);
+            resource.usage |= info.usage;
+        }
+    }
+
+    // NOTE: An attachment that lives inside a single pass and never has its contents loaded is never needed in memory,
+    //  on tilers it can stay in tile memory for the whole pass
+    for (RGResource i = 0; i < m_resources.size(); ++i) {
+        auto& resource = m_compiledResources[i];
+        if (m_resources[i].imported || resource.firstPass != resource.lastPass) {
+            continue;
+        }
+
+        bool isTransient = true;
+        for (const auto& access : m_passes[resource.firstPass].accesses) {
+            if (access.resource != i) {
+                continue;
+            }
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+            if (info.isAttachment == false || access.loadOp == vk::AttachmentLoadOp::eLoad) {
+                isTransient = false;
+            }
+        }
+
+        if (isTransient) {
+            resource.isTransientAttachment = true;
+            resource.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        }
+    }
+}
+
+// NOTE: All graph-owned images are placed into a few big allocations. Images whose lifetimes don't overlap share
+//  the same memory range, lazily allocated memory is used for transient attachments when the device has it.
+void RenderGraph::_CreateImages(const vk::PhysicalDevice& physicalDevice, const vk::Device& device)
+{
+    struct Placement
+    {
+        RGResource resource;
+        vk::MemoryRequirements requirements;
+        ui32 memoryTypeIndex;
+    };
+    struct Bucket
+    {
+        ui32 memoryTypeIndex;
+        vk::DeviceSize size;
+        vk::DeviceSize alignment;
+        vk::DeviceSize offset;
+        std::vector<RGResource> occupants;
+    };
+
+    const auto memoryProperties = physicalDevice.getMemoryProperties();
+
+    std::vector<Placement> placements;
+    for (RGResource i = 0; i < m_resources.size(); ++i) {
+        auto& compiled = m_compiledResources[i];
+        const auto& desc = m_resources[i].desc;
+        if (m_resources[i].imported || compiled.firstPass == ~0u) {
+            continue;
+        }
+
+        vk::ImageCreateInfo imageInfo{ .flags = vk::ImageCreateFlagBits::eAlias,
+                                       .imageType = vk::ImageType::e2D,
+                                       .format = desc.format,
+                                       .extent = { .width = desc.extent.width, .height = desc.extent.height, .depth = 1 },
+                                       .mipLevels = 1,
+                                       .arrayLayers = 1,
+                                       .samples = desc.samples,
+                                       .tiling = vk::ImageTiling::eOptimal,
+                                       .usage = compiled.usage,
+                                       .sharingMode = vk::SharingMode::eExclusive,
+                                       .initialLayout = vk::ImageLayout::eUndefined };
+        compiled.image = device.createImage(imageInfo, m_allocationCallbacks);
+
+        const auto requirements = device.getImageMemoryRequirements(compiled.image);
+        const auto memoryTypeIndex = _findGraphMemoryType(memoryProperties, requirements.memoryTypeBits, compiled.isTransientAttachment);
+
+        placements.push_back(Placement{ .resource = i, .requirements = requirements, .memoryTypeIndex = memoryTypeIndex });
+
+        ++m_stats.transientImageCount;
+        m_stats.transientBytesRequested += requirements.size;
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+            ++m_stats.lazilyAllocatedImageCount;
+        }
+    }
+
+    // NOTE: Greedy interval packing, biggest images first so every bucket is sized by its first occupant
+    std::sort(placements.begin(), placements.end(), [](const Placement& a, const Placement& b) {
+        return a.requirements.size > b.requirements.size;
+    });
+
+    std::vector<Bucket> buckets;
+    for (const auto& placement : placements) {
+        const auto& candidate = m_compiledResources[placement.resource];
+
+        auto bucket = std::find_if(buckets.begin(), buckets.end(), [&](const Bucket& bucket) {
+            if (bucket.memoryTypeIndex != placement.memoryTypeIndex) {
+                return false;
+            }
+            return std::none_of(bucket.occupants.begin(), bucket.occupants.end(), [&](RGResource occupant) {
+                const auto& other = m_compiledResources[occupant];
+                return candidate.firstPass <= other.lastPass && other.firstPass <= candidate.lastPass;
+            });
+        });
+
+        if (bucket == buckets.end()) {
+            buckets.push_back(Bucket{ .memoryTypeIndex = placement.memoryTypeIndex,
+                                      .size = placement.requirements.size,
+                                      .alignment = placement.requirements.alignment });
+            bucket = buckets.end() - 1;
+        }
+
+        bucket->alignment = std::max(bucket->alignment, placement.requirements.alignment);
+        bucket->occupants.push_back(placement.resource);
+    }
+
+    // NOTE: One vk::DeviceMemory per memory type, buckets are laid out one after another inside it
+    for (ui32 typeIndex = 0; typeIndex < memoryProperties.memoryTypeCount; ++typeIndex) {
+        vk::DeviceSize blockSize = 0;
+        for (auto& bucket : buckets) {
+            if (bucket.memoryTypeIndex == typeIndex) {
+                bucket.offset = _alignUp(blockSize, bucket.alignment);
+                blockSize = bucket.offset + bucket.size;
+            }
+        }
+        if (blockSize == 0) {
+            continue;
+        }
+
+        vk::MemoryAllocateInfo allocateInfo{ .allocationSize = blockSize,
+                                             .memoryTypeIndex = typeIndex };
+        const auto memory = device.allocateMemory(allocateInfo, m_allocationCallbacks);
+        m_memoryBlocks.push_back(MemoryBlock{ .memory = memory, .size = blockSize });
+        m_stats.transientBytesAllocated += blockSize;
+
+        for (auto& bucket : buckets) {
+            if (bucket.memoryTypeIndex != typeIndex) {
+                continue;
+            }
+
+            std::sort(bucket.occupants.begin(), bucket.occupants.end(), [this](RGResource a, RGResource b) {
+                return m_compiledResources[a].firstPass < m_compiledResources[b].firstPass;
+            });
+
+            for (ui32 i = 0; i < bucket.occupants.size(); ++i) {
+                auto& compiled = m_compiledResources[bucket.occupants[i]];
+                device.bindImageMemory(compiled.image, memory, bucket.offset);
+                // NOTE: Cyclic, the first occupant of a frame follows the last occupant of the previous frame
+                compiled.aliasPredecessor = bucket.occupants[(i + bucket.occupants.size() - 1) % bucket.occupants.size()];
+            }
+        }
+    }
+
+    for (RGResource i = 0; i < m_resources.size(); ++i) {
+        auto& compiled = m_compiledResources[i];
+        const auto format = m_resources[i].desc.format;
+        if (!compiled.image) {
+            continue;
+        }
+
+        vk::ImageViewCreateInfo imageViewInfo{ .image = compiled.image,
+                                               .viewType = vk::ImageViewType::e2D,
+                                               .format = format,
+                                               .subresourceRange = { .aspectMask = _isDepthFormat(format) ? vk::ImageAspectFlagBits::eDepth
+                                                                                                          : vk::ImageAspectFlagBits::eColor,
+                                                                     .baseMipLevel = 0,
+                                                                     .levelCount = 1,
+                                                                     .baseArrayLayer = 0,
+                                                                     .layerCount = 1 } };
+        compiled.view = device.createImageView(imageViewInfo, m_allocationCallbacks);
+    }
+}
+
+void RenderGraph::_CreateRenderPasses(const vk::Device& device)
+{
+    for (ui32 passIndex = 0; passIndex < m_passes.size(); ++passIndex) {
+        const auto& pass = m_passes[passIndex];
+        auto& compiled = m_compiledPasses[passIndex];
+        if (compiled.culled) {
+            continue;
+        }
+
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorRefs;
+        std::optional<vk::AttachmentReference> depthRef;
+
+        for (ui32 accessIndex = 0; accessIndex < pass.accesses.size(); ++accessIndex) {
+            const auto& access = pass.accesses[accessIndex];
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+            if (info.isAttachment == false) {
+                continue;
+            }
+
+            const auto& resource = m_resources[access.resource];
+            const auto& compiledResource = m_compiledResources[access.resource];
+            // NOTE: Contents are only worth writing back if somebody looks at them later
+            const bool isStored = resource.imported || compiledResource.lastPass > passIndex || access.access == RGAccess::DepthRead;
+
+            // NOTE: Layout transitions are done by the graph barriers, so the render pass itself keeps the layout
+            attachments.push_back(vk::AttachmentDescription{ .format = resource.desc.format,
+                                                             .samples = resource.desc.samples,
+                                                             .loadOp = access.loadOp,
+                                                             .storeOp = isStored ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+                                                             .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
+                                                             .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
+                                                             .initialLayout = info.layout,
+                                                             .finalLayout = info.layout });
+
+            const vk::AttachmentReference reference{ .attachment = static_cast<ui32>(attachments.size() - 1),
+                                                     .layout = info.layout };
+            if (access.access == RGAccess::ColorWrite) {
+                colorRefs.push_back(reference);
+            } else {
+                depthRef = reference;
+            }
+
+            compiled.attachments.push_back(accessIndex);
+            compiled.storeOps.push_back(attachments.back().storeOp);
+            compiled.extent = resource.desc.extent;
+        }
+
+        if (attachments.empty() || m_useDynamicRendering) {
+            continue;
+        }
+
+        vk::SubpassDescription subpass{ .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
+                                        .colorAttachmentCount = static_cast<ui32>(colorRefs.size()),
+                                        .pColorAttachments = colorRefs.data(),
+                                        .pDepthStencilAttachment = depthRef.has_value() ? &depthRef.value() : nullptr };
+
+        vk::RenderPassCreateInfo renderPassInfo{ .attachmentCount = static_cast<ui32>(attachments.size()),
+                                                 .pAttachments = attachments.data(),
+                                                 .subpassCount = 1,
+                                                 .pSubpasses = &subpass };
+
+        compiled.renderPass = device.createRenderPass(renderPassInfo, m_allocationCallbacks);
+    }
+}
+
+// NOTE: Walks the passes in execution order tracking the last layout/stages/accesses of every image,
+//  and emits a barrier only when there is an actual hazard or a layout change. All barriers of a pass
+//  go into a single vkCmdPipelineBarrier.
+void RenderGraph::_ComputeBarriers()
+{
+    struct State
+    {
+        bool touched;
+        vk::ImageLayout layout;
+        // NOTE: Stages of the last write or layout transition and what it wrote
+        vk::PipelineStageFlags writeStages;
+        vk::AccessFlags writeAccess;
+        // NOTE: Reads since the last write, and the stages that already see that write
+        vk::PipelineStageFlags readStages;
+        vk::PipelineStageFlags visibleStages;
+    };
+    std::vector<State> states(m_resources.size(), State{ .touched = false, .layout = vk::ImageLayout::eUndefined });
+
+    // NOTE: What the last pass using an image does to it, it's where the next frame (or the next alias) picks up
+    auto endState = [this](RGResource resource, vk::PipelineStageFlags& stages, vk::AccessFlags& access) {
+        const auto lastPass = m_compiledResources[resource].lastPass;
+        for (const auto& a : m_passes[lastPass].accesses) {
+            if (a.resource == resource) {
+                const auto info = _getAccessInfo(a.access, a.stages, a.loadOp);
+                stages |= info.stages;
+                access |= info.access & kWriteAccessMask;
+            }
+        }
+    };
+
+    for (ui32 passIndex = 0; passIndex < m_passes.size(); ++passIndex) {
+        auto& compiled = m_compiledPasses[passIndex];
+        if (compiled.culled) {
+            continue;
+        }
+
+        auto& batch = compiled.barriers;
+        for (const auto& access : m_passes[passIndex].accesses) {
+            const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+            const auto& resource = m_resources[access.resource];
+            auto& state = states[access.resource];
+
+            Barrier barrier{ .resource = access.resource,
+                             .dstAccess = info.access,
+                             .newLayout = info.layout };
+            bool needBarrier = false;
+
+            if (state.touched == false) {
+                needBarrier = true;
+                const bool keepsContents = access.loadOp == vk::AttachmentLoadOp::eLoad;
+
+                if (resource.imported) {
+                    // NOTE: For the swapchain this chains with the semaphore wait on the same stage
+                    barrier.oldLayout = keepsContents ? resource.finalLayout : vk::ImageLayout::eUndefined;
+                    barrier.srcStages = info.stages;
+                } else {
+                    barrier.oldLayout = vk::ImageLayout::eUndefined;
+                    endState(m_compiledResources[access.resource].aliasPredecessor, barrier.srcStages, barrier.srcAccess);
+                }
+            } else if (info.isWrite || state.layout != info.layout) {
+                needBarrier = true;
+                barrier.oldLayout = state.layout;
+                barrier.srcAccess = state.writeAccess;
+                barrier.srcStages = state.writeStages | state.readStages;
+            } else if (state.writeStages && (info.stages & ~state.visibleStages)) {
+                needBarrier = true;
+                barrier.oldLayout = state.layout;
+                barrier.srcAccess = state.writeAccess;
+                barrier.srcStages = state.writeStages;
+            }
+
+            if (needBarrier) {
+                barrier.dstStages = info.stages;
+                batch.srcStages |= barrier.srcStages;
+                batch.dstStages |= barrier.dstStages;
+                batch.barriers.push_back(barrier);
+            }
+
+            const bool isTransition = needBarrier && barrier.oldLayout != barrier.newLayout;
+            if (info.isWrite || isTransition) {
+                state.writeStages = info.stages;
+                state.writeAccess = info.isWrite ? (info.access & kWriteAccessMask) : vk::AccessFlags();
+                state.readStages = info.isWrite ? vk::PipelineStageFlags() : info.stages;
+                state.visibleStages = info.stages;
+            } else {
+                state.readStages |= info.stages;
+                state.visibleStages |= info.stages;
+            }
+            state.touched = true;
+            state.layout = info.layout;
+        }
+
+        m_stats.barrierCount += static_cast<ui32>(batch.barriers.size());
+    }
+
+    for (RGResource i = 0; i < m_resources.size(); ++i) {
+        const auto& state = states[i];
+        if (m_resources[i].imported == false || state.touched == false || state.layout == m_resources[i].finalLayout) {
+            continue;
+        }
+
+        m_finalBarriers.srcStages |= state.writeStages | state.readStages;
+        m_finalBarriers.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+        m_finalBarriers.barriers.push_back(Barrier{ .resource = i,
+                                                    .srcStages = state.writeStages | state.readStages,
+                                                    .dstStages = vk::PipelineStageFlagBits::eBottomOfPipe,
+                                                    .srcAccess = state.writeAccess,
+                                                    .dstAccess = vk::AccessFlags(),
+                                                    .oldLayout = state.layout,
+                                                    .newLayout = m_resources[i].finalLayout });
+        ++m_stats.barrierCount;
+    }
+}
+
+void RenderGraph::_DestroyCompiled(const vk::Device& device)
+{
+    for (const auto& entry : m_framebuffers) {
+        device.destroyFramebuffer(entry.framebuffer, m_allocationCallbacks);
+    }
+    for (const auto& pass : m_compiledPasses) {
+        if (pass.renderPass) {
+            device.destroyRenderPass(pass.renderPass, m_allocationCallbacks);
+        }
+    }
+    for (const auto& resource : m_compiledResources) {
+        if (resource.view) {
+            device.destroyImageView(resource.view, m_allocationCallbacks);
+        }
+        if (resource.image) {
+            device.destroyImage(resource.image, m_allocationCallbacks);
+        }
+    }
+    for (const auto& block : m_memoryBlocks) {
+        device.freeMemory(block.memory, m_allocationCallbacks);
+    }
+
+    m_framebuffers.clear();
+    m_compiledPasses.clear();
+    m_compiledResources.clear();
+    m_memoryBlocks.clear();
+    m_finalBarriers = BarrierBatch();
+}
+
+
+vk::Image RenderGraph::_GetImage(RGResource image) const
+{
+    return m_resources[image].imported ? m_resources[image].image : m_compiledResources[image].image;
+}
+
+// NOTE: Imported images change every frame (swapchain images), so framebuffers are cached by the views they use
+vk::Framebuffer RenderGraph::_GetFramebuffer(ui32 passIndex)
+{
+    const auto& pass = m_passes[passIndex];
+    const auto& compiled = m_compiledPasses[passIndex];
+
+    std::array<vk::ImageView, 9> views;
+    for (ui32 i = 0; i < compiled.attachments.size(); ++i) {
+        views[i] = GetImageView(pass.accesses[compiled.attachments[i]].resource);
+    }
+    const auto viewCount = compiled.attachments.size();
+
+    for (const auto& entry : m_framebuffers) {
+        if (entry.passIndex == passIndex && std::equal(entry.views.begin(), entry.views.end(), views.begin(), views.begin() + viewCount)) {
+            return entry.framebuffer;
+        }
+    }
+
+    vk::FramebufferCreateInfo framebufferInfo{ .renderPass = compiled.renderPass,
+                                               .attachmentCount = static_cast<ui32>(viewCount),
+                                               .pAttachments = views.data(),
+                                               .width = compiled.extent.width,
+                                               .height = compiled.extent.height,
+                                               .layers = 1 };
+
+    const auto framebuffer = m_device.createFramebuffer(framebufferInfo, m_allocationCallbacks);
+    m_framebuffers.push_back(FramebufferEntry{ .passIndex = passIndex,
+                                               .views = std::vector<vk::ImageView>(views.begin(), views.begin() + viewCount),
+                                               .framebuffer = framebuffer });
+    return framebuffer;
+}
+
+void RenderGraph::_RecordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch& batch, std::pmr::memory_resource* memory) const
+{
+    if (batch.barriers.empty()) {
+        return;
+    }
+
+    std::pmr::vector<vk::ImageMemoryBarrier> imageBarriers(memory);
+    imageBarriers.reserve(batch.barriers.size());
+
+    for (const auto& barrier : batch.barriers) {
+        imageBarriers.push_back(vk::ImageMemoryBarrier{ .srcAccessMask = barrier.srcAccess,
+                                                        .dstAccessMask = barrier.dstAccess,
+                                                        .oldLayout = barrier.oldLayout,
+                                                        .newLayout = barrier.newLayout,
+                                                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                        .image = _GetImage(barrier.resource),
+                                                        .subresourceRange = _getWholeImageRange(m_resources[barrier.resource].desc.format) });
+    }
+
+    const auto srcStages = batch.srcStages ? batch.srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+    const auto dstStages = batch.dstStages ? batch.dstStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe);
+
+    commandBuffer.pipelineBarrier(srcStages, dstStages, vk::DependencyFlags(), nullptr, nullptr, imageBarriers);
+}
+
+// NOTE: synchronization2 keeps stages per barrier, so every image waits only on what actually touched it
+void RenderGraph::_RecordBarriers2(vk::CommandBuffer commandBuffer, const BarrierBatch& batch, std::pmr::memory_resource* memory) const
+{
+    if (batch.barriers.empty()) {
+        return;
+    }
+
+    std::pmr::vector<vk::ImageMemoryBarrier2> imageBarriers(memory);
+    imageBarriers.reserve(batch.barriers.size());
+
+    // NOTE: Legacy stage and access bits have the same values in the 64-bit synchronization2 flags
+    for (const auto& barrier : batch.barriers) {
+        imageBarriers.push_back(vk::ImageMemoryBarrier2{ .srcStageMask = vk::PipelineStageFlags2(static_cast<VkPipelineStageFlags>(barrier.srcStages)),
+                                                         .srcAccessMask = vk::AccessFlags2(static_cast<VkAccessFlags>(barrier.srcAccess)),
+                                                         .dstStageMask = vk::PipelineStageFlags2(static_cast<VkPipelineStageFlags>(barrier.dstStages)),
+                                                         .dstAccessMask = vk::AccessFlags2(static_cast<VkAccessFlags>(barrier.dstAccess)),
+                                                         .oldLayout = barrier.oldLayout,
+                                                         .newLayout = barrier.newLayout,
+                                                         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                         .image = _GetImage(barrier.resource),
+                                                         .subresourceRange = _getWholeImageRange(m_resources[barrier.resource].desc.format) });
+    }
+
+    vk::DependencyInfo dependencyInfo{ .imageMemoryBarrierCount = static_cast<ui32>(imageBarriers.size()),
+                                       .pImageMemoryBarriers = imageBarriers.data() };
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void RenderGraph::_BeginRendering(vk::CommandBuffer commandBuffer, ui32 passIndex) const
+{
+    const auto& pass = m_passes[passIndex];
+    const auto& compiled = m_compiledPasses[passIndex];
+
+    std::array<vk::RenderingAttachmentInfo, 8> colorAttachments;
+    ui32 colorCount = 0;
+    vk::RenderingAttachmentInfo depthAttachment;
+    bool hasDepth = false;
+
+    for (ui32 i = 0; i < compiled.attachments.size(); ++i) {
+        const auto& access = pass.accesses[compiled.attachments[i]];
+        const auto info = _getAccessInfo(access.access, access.stages, access.loadOp);
+
+        const vk::RenderingAttachmentInfo attachment{ .imageView = GetImageView(access.resource),
+                                                      .imageLayout = info.layout,
+                                                      .loadOp = access.loadOp,
+                                                      .storeOp = compiled.storeOps[i],
+                                                      .clearValue = access.clearValue };
+        if (access.access == RGAccess::ColorWrite) {
+            colorAttachments[colorCount++] = attachment;
+        } else {
+            depthAttachment = attachment;
+            hasDepth = true;
+        }
+    }
+
+    vk::RenderingInfo renderingInfo{ .flags = pass.executesSecondaries ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers
+                                                                       : vk::RenderingFlags(),
+                                     .renderArea = { .offset = {0, 0}, .extent = compiled.extent },
+                                     .layerCount = 1,
+                                     .colorAttachmentCount = colorCount,
+                                     .pColorAttachments = colorAttachments.data(),
+                                     .pDepthAttachment = hasDepth ? &depthAttachment : nullptr };
+
+    commandBuffer.beginRendering(renderingInfo);
+}
+
+ui32 RenderGraph::_FindPass(std::string_view passName) const
+{
+    for (ui32 i = 0; i < m_passes.size(); ++i) {
+        if (m_passes[i].name == passName) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("RenderGraph: there is no pass named '" + std::string(passName) + "'!");
+}
+
+}
+
+
+
+AccessInfo _getAccessInfo(vulkan::RGAccess access, vk::PipelineStageFlags stages, vk::AttachmentLoadOp loadOp)
+{
+    using vulkan::RGAccess;
+    using Access = vk::AccessFlagBits;
+    using Usage = vk::ImageUsageFlagBits;
+
+    switch (access) {
+    case RGAccess::ColorWrite:
+        return { .layout = vk::ImageLayout::eColorAttachmentOptimal,
+                 .stages = stages,
+                 .access = loadOp == vk::AttachmentLoadOp::eLoad ? Access::eColorAttachmentWrite | Access::eColorAttachmentRead
+                                                                 : vk::AccessFlags(Access::eColorAttachmentWrite),
+                 .usage = Usage::eColorAttachment,
+                 .isWrite = true,
+                 .isAttachment = true };
+    case RGAccess::DepthWrite:
+        return { .layout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                 .stages = stages,
+                 .access = Access::eDepthStencilAttachmentWrite | Access::eDepthStencilAttachmentRead,
+                 .usage = Usage::eDepthStencilAttachment,
+                 .isWrite = true,
+                 .isAttachment = true };
+    case RGAccess::DepthRead:
+        return { .layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                 .stages = stages,
+                 .access = Access::eDepthStencilAttachmentRead,
+                 .usage = Usage::eDepthStencilAttachment,
+                 .isWrite = false,
+                 .isAttachment = true };
+    case RGAccess::SampledRead:
+        return { .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                 .stages = stages,
+                 .access = Access::eShaderRead,
+                 .usage = Usage::eSampled,
+                 .isWrite = false,
+                 .isAttachment = false };
+    case RGAccess::StorageRead:
+        return { .layout = vk::ImageLayout::eGeneral,
+                 .stages = stages,
+                 .access = Access::eShaderRead,
+                 .usage = Usage::eStorage,
+                 .isWrite = false,
+                 .isAttachment = false };
+    case RGAccess::StorageWrite:
+        return { .layout = vk::ImageLayout::eGeneral,
+                 .stages = stages,
+                 .access = Access::eShaderWrite | Access::eShaderRead,
+                 .usage = Usage::eStorage,
+                 .isWrite = true,
+                 .isAttachment = false };
+    case RGAccess::TransferRead:
+        return { .layout = vk::ImageLayout::eTransferSrcOptimal,
+                 .stages = stages,
+                 .access = Access::eTransferRead,
+                 .usage = Usage::eTransferSrc,
+                 .isWrite = false,
+                 .isAttachment = false };
+    case RGAccess::TransferWrite:
+        return { .layout = vk::ImageLayout::eTransferDstOptimal,
+                 .stages = stages,
+                 .access = Access::eTransferWrite,
+                 .usage = Usage::eTransferDst,
+                 .isWrite = true,
+                 .isAttachment = false };
+    }
+
+    throw std::runtime_error("_getAccessInfo(): Unknown access type!");
+}
+
+bool _isDepthFormat(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool _hasStencilComponent(vk::Format format)
+{
+    return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+}
+
+vk::ImageSubresourceRange _getWholeImageRange(vk::Format format)
+{
+    vk::ImageAspectFlags aspectMask = vk::ImageAspectFlagBits::eColor;
+    if (_isDepthFormat(format)) {
+        aspectMask = vk::ImageAspectFlagBits::eDepth;
+        if (_hasStencilComponent(format)) {
+            aspectMask |= vk::ImageAspectFlagBits::eStencil;
+        }
+    }
+
+    return { .aspectMask = aspectMask,
+             .baseMipLevel = 0,
+             .levelCount = VK_REMAINING_MIP_LEVELS,
+             .baseArrayLayer = 0,
+             .layerCount = VK_REMAINING_ARRAY_LAYERS };
+}
+
+// NOTE: Lazily allocated memory may have no physical backing at all, it's only good for attachments that never leave the tile
+ui32 _findGraphMemoryType(const vk::PhysicalDeviceMemoryProperties& memoryProperties, ui32 memoryTypeBits, bool preferLazy)
+{
+    const vk::MemoryPropertyFlags preferred[] = { preferLazy ? vk::MemoryPropertyFlagBits::eLazilyAllocated | vk::MemoryPropertyFlagBits::eDeviceLocal
+                                                             : vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal),
+                                                  vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                  vk::MemoryPropertyFlags() };
+
+    for (const auto properties : preferred) {
+        for (ui32 i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+            const auto flags = memoryProperties.memoryTypes[i].propertyFlags;
+            // NOTE: Lazily allocated types are never picked for images that must keep their contents
+            if (preferLazy == false && (flags & vk::MemoryPropertyFlagBits::eLazilyAllocated)) {
+                continue;
+            }
+            if ((memoryTypeBits & (1u << i)) && (flags & properties) == properties) {
+                return i;
+            }
+        }
+    }
+
+    throw std::runtime_error("_findGraphMemoryType(): Failed to find suitable memory type!");
+}
+
+vk::DeviceSize _alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
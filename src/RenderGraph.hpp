@@ -0,0 +1,274 @@
+#pragma once
+
+#include "core.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace vulkan
+{
+
+// NOTE: Handle to a graph resource, it is just an index into RenderGraph::m_resources
+using RGResource = ui32;
+constexpr RGResource kInvalidResource = ~0u;
+
+// NOTE: Every way a pass can touch an image. The graph derives layouts, stages, access masks and usage flags from it.
+enum class RGAccess : ui8
+{
+    ColorWrite,
+    DepthWrite,
+    DepthRead,
+    SampledRead,
+    StorageRead,
+    StorageWrite,
+    TransferRead,
+    TransferWrite
+};
+
+struct RGImageDesc
+{
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+};
+
+struct RGContext
+{
+    vk::CommandBuffer commandBuffer;
+    // NOTE: Index of the swapchain image the graph is executed for, passes use it to pick per-image resources
+    ui32 imageIndex;
+    // NOTE: Memory that lives until the frame's GPU work completes, for temporaries while recording.
+    //  nullptr falls back to the default resource.
+    std::pmr::memory_resource* frameMemory;
+    // NOTE: Optional, every executed pass is wrapped in query 'firstStatisticsQuery' + its index in declaration order.
+    //  The pool needs a query for every declared pass, reset before Execute().
+    vk::QueryPool statisticsQueryPool;
+    ui32 firstStatisticsQuery;
+};
+
+// NOTE: What a pipeline needs to know about a pass when there is no vk::RenderPass (dynamic rendering)
+struct RGAttachmentFormats
+{
+    std::array<vk::Format, 8> colorFormats;
+    ui32 colorCount;
+    vk::Format depthFormat;
+};
+
+struct RenderGraphStats
+{
+    ui32 passCount;
+    ui32 culledPassCount;
+    ui32 barrierCount;
+    ui32 transientImageCount;
+    ui32 lazilyAllocatedImageCount;
+    // NOTE: How much memory transient images would take without aliasing vs how much they actually take
+    vk::DeviceSize transientBytesRequested;
+    vk::DeviceSize transientBytesAllocated;
+};
+
+
+// NOTE: Frame graph in the spirit of Frostbite's FrameGraph talk.
+//  Passes declare what they read and write during setup, Compile() turns that into render passes, barriers and
+//  aliased transient memory, Execute() records everything. Passes are executed in declaration order.
+class RenderGraph
+{
+public:
+    using ExecuteFn = std::function<void(const RGContext&)>;
+
+    class PassBuilder
+    {
+    public:
+        void WriteColor(RGResource image, vk::AttachmentLoadOp loadOp,
+                        vk::ClearColorValue clearColor = vk::ClearColorValue(std::array<f32, 4>{ 0.0f, 0.0f, 0.0f, 0.0f }));
+        void WriteDepth(RGResource image, vk::AttachmentLoadOp loadOp,
+                        vk::ClearDepthStencilValue clearDepth = { .depth = 1.0f, .stencil = 0 });
+        void ReadDepth(RGResource image);
+        void ReadTexture(RGResource image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+        void ReadStorage(RGResource image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+        void WriteStorage(RGResource image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+        void ReadTransfer(RGResource image);
+        void WriteTransfer(RGResource image);
+        // NOTE: Pass is never culled, even if nobody reads what it writes
+        void SideEffect();
+        // NOTE: Inside its render pass the pass only executes secondary command buffers, which inherit
+        //  GetRenderPass() or GetAttachmentFormats()
+        void ExecuteSecondaries();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, ui32 passIndex) : m_graph(graph), m_passIndex(passIndex) {}
+
+        void _AddAccess(RGResource image, RGAccess access, vk::PipelineStageFlags stages,
+                        vk::AttachmentLoadOp loadOp, vk::ClearValue clearValue);
+
+        RenderGraph& m_graph;
+        ui32 m_passIndex;
+    };
+
+    RenderGraph() = default;
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // NOTE: Transient image owned by the graph, its memory can be shared with other transient images
+    RGResource CreateImage(std::string_view name, const RGImageDesc& desc);
+    // NOTE: Image owned by someone else (swapchain image). Actual vk::Image/vk::ImageView are bound with SetImportedImage()
+    //  before every Execute(). The graph transitions it to 'finalLayout' after the last pass that uses it.
+    RGResource ImportImage(std::string_view name, const RGImageDesc& desc, vk::ImageLayout finalLayout);
+    void SetImportedImage(RGResource image, vk::Image handle, vk::ImageView view);
+
+    // NOTE: When enabled, graphics passes are recorded with vkCmdBeginRendering and barriers with vkCmdPipelineBarrier2,
+    //  no render pass or framebuffer objects are created. Requires Vulkan 1.3 dynamicRendering and synchronization2.
+    void SetDynamicRendering(bool enable);
+    // NOTE: Used for every vulkan object the graph creates and destroys, has to stay the same until Destroy()
+    void SetAllocationCallbacks(const vk::AllocationCallbacks* allocationCallbacks);
+
+    void AddPass(std::string_view name, const std::function<void(PassBuilder&)>& setup, ExecuteFn execute);
+
+    // NOTE: Clears declared passes and resources, but keeps compiled vulkan objects. If the graph is declared
+    //  the same way again Compile() reuses them, so rebuilding the graph every frame is cheap.
+    void Reset();
+    void Compile(const vk::PhysicalDevice& physicalDevice, const vk::Device& device);
+    // NOTE: Which declared passes Compile() culls because nothing uses what they write, doesn't need a device
+    std::vector<bool> FindCulledPasses() const;
+    void Execute(const RGContext& context);
+    // NOTE: Destroys every vulkan object owned by the graph, must be called before the swapchain goes away
+    void Destroy(const vk::Device& device);
+
+    vk::RenderPass GetRenderPass(std::string_view passName) const;
+    // NOTE: Declared passes, culled ones included
+    ui32 GetPassCount() const;
+    const std::string& GetPassName(ui32 passIndex) const;
+    RGAttachmentFormats GetAttachmentFormats(std::string_view passName) const;
+    vk::ImageView GetImageView(RGResource image) const;
+    const RenderGraphStats& GetStats() const;
+
+private:
+    struct Resource
+    {
+        std::string name;
+        RGImageDesc desc;
+        bool imported;
+        vk::ImageLayout finalLayout;
+
+        // NOTE: Bound with SetImportedImage(), only for imported images
+        vk::Image image;
+        vk::ImageView view;
+    };
+
+    struct Access
+    {
+        RGResource resource;
+        RGAccess access;
+        vk::PipelineStageFlags stages;
+        vk::AttachmentLoadOp loadOp;
+        vk::ClearValue clearValue;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::vector<Access> accesses;
+        ExecuteFn execute;
+        bool sideEffect;
+        bool executesSecondaries;
+    };
+
+    // NOTE: Per-barrier stages are used as is by synchronization2, the legacy path merges them per batch
+    struct Barrier
+    {
+        RGResource resource;
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+    };
+
+    struct BarrierBatch
+    {
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        std::vector<Barrier> barriers;
+    };
+
+    // NOTE: Everything below is produced by Compile() and survives Reset()
+    struct CompiledResource
+    {
+        ui32 firstPass;
+        ui32 lastPass;
+        vk::ImageUsageFlags usage;
+        bool isTransientAttachment;
+        RGResource aliasPredecessor;
+
+        vk::Image image;
+        vk::ImageView view;
+    };
+
+    struct CompiledPass
+    {
+        bool culled;
+        BarrierBatch barriers;
+        vk::RenderPass renderPass;
+        // NOTE: Indices into Pass::accesses that are attachments, in attachment order
+        std::vector<ui32> attachments;
+        std::vector<vk::AttachmentStoreOp> storeOps;
+        vk::Extent2D extent;
+    };
+
+    struct FramebufferEntry
+    {
+        ui32 passIndex;
+        std::vector<vk::ImageView> views;
+        vk::Framebuffer framebuffer;
+    };
+
+    struct MemoryBlock
+    {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size;
+    };
+
+    ui64 _ComputeHash() const;
+    void _CullPasses();
+    void _ComputeLifetimes();
+    void _CreateImages(const vk::PhysicalDevice& physicalDevice, const vk::Device& device);
+    void _CreateRenderPasses(const vk::Device& device);
+    void _ComputeBarriers();
+    void _DestroyCompiled(const vk::Device& device);
+
+    vk::Image _GetImage(RGResource image) const;
+    vk::Framebuffer _GetFramebuffer(ui32 passIndex);
+    void _RecordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch& batch, std::pmr::memory_resource* memory) const;
+    void _RecordBarriers2(vk::CommandBuffer commandBuffer, const BarrierBatch& batch, std::pmr::memory_resource* memory) const;
+    void _BeginRendering(vk::CommandBuffer commandBuffer, ui32 passIndex) const;
+    ui32 _FindPass(std::string_view passName) const;
+
+private:
+    std::vector<Resource>           m_resources;
+    std::vector<Pass>               m_passes;
+
+    bool                            m_useDynamicRendering = false;
+    const vk::AllocationCallbacks*  m_allocationCallbacks = nullptr;
+    ui64                            m_compiledHash = 0;
+    bool                            m_isCompiled = false;
+    std::vector<CompiledResource>   m_compiledResources;
+    std::vector<CompiledPass>       m_compiledPasses;
+    std::vector<MemoryBlock>        m_memoryBlocks;
+    std::vector<FramebufferEntry>   m_framebuffers;
+    BarrierBatch                    m_finalBarriers;
+    vk::Device                      m_device;
+
+    RenderGraphStats                m_stats{};
+};
+
+}
@@ -0,0 +1,175 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+
+
+// NOTE: Below this many draws the threads cost more than the sort itself
+constexpr size_t kParallelSortThreshold = 16 * 1024;
+constexpr ui32 kRadixBuckets = 256;
+
+
+
+
+void RenderQueue::SetDepthRange(f32 nearPlane, f32 farPlane)
+{
+    m_nearPlane = nearPlane;
+    m_farPlane = farPlane;
+}
+
+void RenderQueue::Clear()
+{
+    m_commands.clear();
+    m_items.clear();
+}
+
+void RenderQueue::Submit(const DrawCommand& command, ui32 layer, bool isTransparent, f32 viewDepth)
+{
+    const auto sortKey = MakeSortKey(layer, isTransparent, command.pipeline, command.material, _QuantizeDepth(viewDepth));
+
+    m_items.push_back(DrawItem{ .sortKey = sortKey, .command = static_cast<ui32>(m_commands.size()) });
+    m_commands.push_back(command);
+}
+
+void RenderQueue::Sort(ui32 threadCount, const ParallelFor& parallelFor)
+{
+    const size_t count = m_items.size();
+
+    m_stats.drawCount = static_cast<ui32>(count);
+    _CountStateChanges(m_stats.pipelineChangesUnsorted, m_stats.materialChangesUnsorted);
+
+    const ui32 chunkCount = (threadCount > 1 && count >= kParallelSortThreshold) ? threadCount : 1;
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    // NOTE: The tasks capture too much for std::function's inline storage, only a pointer to them is handed to
+    //  'parallelFor' so sorting doesn't allocate
+    auto runChunks = [&](const auto& task) {
+        if (chunkCount == 1) {
+            task(0);
+        } else if (parallelFor) {
+            parallelFor(chunkCount, [&task](ui32 chunk) { task(chunk); });
+        } else {
+            for (ui32 chunk = 0; chunk < chunkCount; ++chunk) {
+                task(chunk);
+            }
+        }
+    };
+
+    // NOTE: Bytes that are the same in every key don't change the order, those passes are skipped.
+    //  With few layers/pipelines most of the high bytes are constant.
+    ui64 anyBits = 0;
+    ui64 allBits = ~0ull;
+    for (const auto& item : m_items) {
+        anyBits |= item.sortKey;
+        allBits &= item.sortKey;
+    }
+    const ui64 differentBits = anyBits ^ allBits;
+
+    m_scratch.resize(count);
+    m_histograms.resize(chunkCount * kRadixBuckets);
+
+    for (ui32 shift = 0; shift < 64; shift += 8) {
+        if (((differentBits >> shift) & 0xff) == 0) {
+            continue;
+        }
+
+        runChunks([&](ui32 chunk) {
+            ui32* histogram = &m_histograms[chunk * kRadixBuckets];
+            std::fill(histogram, histogram + kRadixBuckets, 0);
+
+            const size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                ++histogram[(m_items[i].sortKey >> shift) & 0xff];
+            }
+        });
+
+        // NOTE: Bucket-major, chunk-minor prefix sum keeps the sort stable
+        ui32 offset = 0;
+        for (ui32 bucket = 0; bucket < kRadixBuckets; ++bucket) {
+            for (ui32 chunk = 0; chunk < chunkCount; ++chunk) {
+                ui32& slot = m_histograms[chunk * kRadixBuckets + bucket];
+                const ui32 bucketCount = slot;
+                slot = offset;
+                offset += bucketCount;
+            }
+        }
+
+        runChunks([&](ui32 chunk) {
+            ui32* histogram = &m_histograms[chunk * kRadixBuckets];
+
+            const size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                const auto& item = m_items[i];
+                m_scratch[histogram[(item.sortKey >> shift) & 0xff]++] = item;
+            }
+        });
+
+        m_items.swap(m_scratch);
+    }
+
+    _CountStateChanges(m_stats.pipelineChangesSorted, m_stats.materialChangesSorted);
+}
+
+const std::vector<DrawItem>& RenderQueue::GetItems() const
+{
+    return m_items;
+}
+
+const DrawCommand& RenderQueue::GetCommand(const DrawItem& item) const
+{
+    return m_commands[item.command];
+}
+
+const RenderQueueStats& RenderQueue::GetStats() const
+{
+    return m_stats;
+}
+
+ui64 RenderQueue::MakeSortKey(ui32 layer, bool isTransparent, ui32 pipeline, ui32 material, ui32 depthBucket)
+{
+    constexpr ui64 kDepthMask = (1ull << kDepthBits) - 1;
+
+    ui64 key = static_cast<ui64>(layer & (kMaxLayers - 1)) << 60;
+
+    if (isTransparent == false) {
+        key |= static_cast<ui64>(pipeline & (kMaxPipelines - 1)) << 47;
+        key |= static_cast<ui64>(material & (kMaxMaterials - 1)) << 31;
+        key |= (static_cast<ui64>(depthBucket) & kDepthMask) << 7;
+    } else {
+        key |= 1ull << 59;
+        key |= (~static_cast<ui64>(depthBucket) & kDepthMask) << 35;
+        key |= static_cast<ui64>(pipeline & (kMaxPipelines - 1)) << 23;
+        key |= static_cast<ui64>(material & (kMaxMaterials - 1)) << 7;
+    }
+
+    return key;
+}
+
+
+ui32 RenderQueue::_QuantizeDepth(f32 viewDepth) const
+{
+    constexpr f32 kMaxBucket = static_cast<f32>((1u << kDepthBits) - 1);
+
+    const f32 normalized = std::clamp((viewDepth - m_nearPlane) / (m_farPlane - m_nearPlane), 0.0f, 1.0f);
+    return static_cast<ui32>(normalized * kMaxBucket);
+}
+
+void RenderQueue::_CountStateChanges(ui32& pipelineChanges, ui32& materialChanges) const
+{
+    pipelineChanges = 0;
+    materialChanges = 0;
+
+    const DrawCommand* previous = nullptr;
+    for (const auto& item : m_items) {
+        const auto& command = m_commands[item.command];
+        if (previous == nullptr || previous->pipeline != command.pipeline) {
+            ++pipelineChanges;
+        }
+        if (previous == nullptr || previous->material != command.material) {
+            ++materialChanges;
+        }
+        previous = &command;
+    }
+}
+
+
+
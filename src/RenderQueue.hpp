@@ -0,0 +1,84 @@
+#pragma once
+
+#include "core.hpp"
+#include "JobSystem.hpp"
+
+#include <functional>
+#include <vector>
+
+
+// NOTE: Everything needed to issue one draw, the queue only sorts these and never looks inside except for stats
+struct DrawCommand
+{
+    ui32 pipeline;
+    ui32 material;
+    ui32 mesh;
+    // NOTE: Level of the mesh's LOD chain
+    ui32 lod;
+    ui32 object;
+};
+
+struct DrawItem
+{
+    ui64 sortKey;
+    // NOTE: Index into RenderQueue's command array
+    ui32 command;
+};
+
+struct RenderQueueStats
+{
+    ui32 drawCount;
+    // NOTE: State changes the draws would need in submission order vs after sorting
+    ui32 pipelineChangesUnsorted;
+    ui32 materialChangesUnsorted;
+    ui32 pipelineChangesSorted;
+    ui32 materialChangesSorted;
+};
+
+
+// NOTE: Every draw gets a 64-bit key, sorting the keys gives the submission order.
+//  Opaque:      | layer:4 | 0 | pipeline:12 | material:16 | depth:24 | unused:7 |
+//  Transparent: | layer:4 | 1 | depth:24 (inverted) | pipeline:12 | material:16 | unused:7 |
+//  Opaque draws are grouped by state first and go front-to-back inside a group, transparent draws go back-to-front.
+class RenderQueue
+{
+public:
+    using ParallelFor = ::ParallelFor;
+
+    static constexpr ui32 kMaxLayers = 1 << 4;
+    static constexpr ui32 kMaxPipelines = 1 << 12;
+    static constexpr ui32 kMaxMaterials = 1 << 16;
+    static constexpr ui32 kDepthBits = 24;
+
+    RenderQueue() = default;
+
+    // NOTE: View-space depth range used to quantize depth into the key
+    void SetDepthRange(f32 nearPlane, f32 farPlane);
+    void Clear();
+    void Submit(const DrawCommand& command, ui32 layer, bool isTransparent, f32 viewDepth);
+
+    // NOTE: LSD radix sort over the keys, chunks are sorted in parallel with 'parallelFor' when there are enough draws
+    void Sort(ui32 threadCount = 1, const ParallelFor& parallelFor = nullptr);
+
+    const std::vector<DrawItem>& GetItems() const;
+    const DrawCommand& GetCommand(const DrawItem& item) const;
+    const RenderQueueStats& GetStats() const;
+
+    static ui64 MakeSortKey(ui32 layer, bool isTransparent, ui32 pipeline, ui32 material, ui32 depthBucket);
+
+private:
+    ui32 _QuantizeDepth(f32 viewDepth) const;
+    void _CountStateChanges(ui32& pipelineChanges, ui32& materialChanges) const;
+
+private:
+    f32 m_nearPlane = 0.0f;
+    f32 m_farPlane = 1.0f;
+
+    std::vector<DrawCommand> m_commands;
+    std::vector<DrawItem> m_items;
+    std::vector<DrawItem> m_scratch;
+    // NOTE: Per-chunk 256-bucket histograms, reused between sorts
+    std::vector<ui32> m_histograms;
+
+    RenderQueueStats m_stats{};
+};
@@ -0,0 +1,226 @@
+#include "ShaderRegistry.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+
+constexpr ui32 kSpirvMagic = 0x07230203;
+// NOTE: Vertex and fragment is all we have, room for the other graphics stages
+constexpr size_t kMaxPipelineStages = 5;
+
+
+auto _hashShaderCode(std::span<const ui32> code) -> ui64;
+
+
+namespace vulkan
+{
+
+void ShaderRegistry::Init(const vk::Device& device, PFN_vkGetShaderModuleCreateInfoIdentifierEXT getIdentifier,
+                          const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_getIdentifier = getIdentifier;
+    m_stats = ShaderRegistryStats{ .filesRead = 0,
+                                   .shaderCount = 0,
+                                   .duplicateFiles = 0,
+                                   .modulesCreated = 0,
+                                   .liveModules = 0,
+                                   .pipelinesFromIdentifiers = 0,
+                                   .pipelinesCompiled = 0,
+                                   .usesModuleIdentifiers = getIdentifier != nullptr };
+}
+
+void ShaderRegistry::Shutdown()
+{
+    ReleaseModules();
+    m_shaders.clear();
+    m_paths.clear();
+}
+
+ShaderHandle ShaderRegistry::Load(std::string_view path)
+{
+    for (const auto& entry : m_paths) {
+        if (entry.path == path) {
+            return entry.shader;
+        }
+    }
+
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path, error);
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::in);
+    if (error || !file) {
+        throw std::runtime_error("ShaderRegistry::Load(): Failed to open " + std::string(path) + "!");
+    }
+    if (size == 0 || size % sizeof(ui32) != 0) {
+        throw std::runtime_error("ShaderRegistry::Load(): " + std::string(path) + " isn't SPIR-V!");
+    }
+
+    std::vector<ui32> code(size / sizeof(ui32));
+    file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+    if (!file || code[0] != kSpirvMagic) {
+        throw std::runtime_error("ShaderRegistry::Load(): " + std::string(path) + " isn't SPIR-V!");
+    }
+    ++m_stats.filesRead;
+
+    const ShaderHandle shader = _AddShader(std::move(code));
+    m_paths.push_back(Path{ .path = std::string(path), .shader = shader });
+    return shader;
+}
+
+vk::ShaderModule ShaderRegistry::GetModule(ShaderHandle handle)
+{
+    auto& shader = m_shaders[handle];
+    if (!shader.module) {
+        const vk::ShaderModuleCreateInfo shaderModuleInfo{ .codeSize = shader.code.size() * sizeof(ui32),
+                                                           .pCode = shader.code.data() };
+        shader.module = m_device.createShaderModule(shaderModuleInfo, m_allocationCallbacks);
+        ++m_stats.modulesCreated;
+        ++m_stats.liveModules;
+    }
+    return shader.module;
+}
+
+void ShaderRegistry::ReleaseModules()
+{
+    for (auto& shader : m_shaders) {
+        if (shader.module) {
+            m_device.destroyShaderModule(shader.module, m_allocationCallbacks);
+            shader.module = nullptr;
+        }
+    }
+    m_stats.liveModules = 0;
+}
+
+// NOTE: The identifier attempt fails fast instead of compiling, a miss falls back to the usual creation with modules
+vk::Pipeline ShaderRegistry::CreateGraphicsPipeline(vk::PipelineCache pipelineCache, const vk::GraphicsPipelineCreateInfo& pipelineInfo,
+                                                    std::span<const ShaderHandle> shaders)
+{
+    if (shaders.size() != pipelineInfo.stageCount || shaders.size() > kMaxPipelineStages) {
+        throw std::runtime_error("ShaderRegistry::CreateGraphicsPipeline(): Every stage needs exactly one shader!");
+    }
+
+    std::array<vk::PipelineShaderStageCreateInfo, kMaxPipelineStages> stages;
+    std::array<vk::PipelineShaderStageModuleIdentifierCreateInfoEXT, kMaxPipelineStages> identifiers;
+    const auto stageSpan = std::span(stages.data(), shaders.size());
+    std::copy_n(pipelineInfo.pStages, shaders.size(), stages.begin());
+
+    auto info = pipelineInfo;
+    info.pStages = stages.data();
+
+    if (_SetIdentifiers(shaders, stageSpan, identifiers)) {
+        info.flags |= vk::PipelineCreateFlagBits::eFailOnPipelineCompileRequired;
+        const auto result = m_device.createGraphicsPipeline(pipelineCache, info, m_allocationCallbacks);
+        if (result.result == vk::Result::eSuccess) {
+            ++m_stats.pipelinesFromIdentifiers;
+            return result.value;
+        }
+        info.flags = pipelineInfo.flags;
+        std::copy_n(pipelineInfo.pStages, shaders.size(), stages.begin());
+    }
+
+    for (size_t i = 0; i < shaders.size(); ++i) {
+        stages[i].module = GetModule(shaders[i]);
+    }
+    ++m_stats.pipelinesCompiled;
+    return (vk::Pipeline&&)m_device.createGraphicsPipeline(pipelineCache, info, m_allocationCallbacks);
+}
+
+vk::Pipeline ShaderRegistry::CreateComputePipeline(vk::PipelineCache pipelineCache, const vk::ComputePipelineCreateInfo& pipelineInfo,
+                                                   ShaderHandle shader)
+{
+    vk::PipelineShaderStageModuleIdentifierCreateInfoEXT identifier;
+    auto info = pipelineInfo;
+
+    if (_SetIdentifiers(std::span(&shader, 1), std::span(&info.stage, 1), std::span(&identifier, 1))) {
+        info.flags |= vk::PipelineCreateFlagBits::eFailOnPipelineCompileRequired;
+        const auto result = m_device.createComputePipeline(pipelineCache, info, m_allocationCallbacks);
+        if (result.result == vk::Result::eSuccess) {
+            ++m_stats.pipelinesFromIdentifiers;
+            return result.value;
+        }
+        info = pipelineInfo;
+    }
+
+    info.stage.module = GetModule(shader);
+    ++m_stats.pipelinesCompiled;
+    return (vk::Pipeline&&)m_device.createComputePipeline(pipelineCache, info, m_allocationCallbacks);
+}
+
+ShaderRegistryStats ShaderRegistry::GetStats() const
+{
+    return m_stats;
+}
+
+// NOTE: The identifier comes from the code alone, the driver doesn't need a module for it
+ShaderHandle ShaderRegistry::_AddShader(std::vector<ui32>&& code)
+{
+    const ui64 hash = _hashShaderCode(code);
+    for (ShaderHandle i = 0; i < m_shaders.size(); ++i) {
+        if (m_shaders[i].hash == hash && m_shaders[i].code == code) {
+            ++m_stats.duplicateFiles;
+            return i;
+        }
+    }
+
+    Shader shader{ .hash = hash, .code = std::move(code), .module = nullptr, .identifierSize = 0, .identifier = {} };
+    if (m_getIdentifier != nullptr) {
+        const VkShaderModuleCreateInfo shaderModuleInfo{ .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                                         .pNext = nullptr,
+                                                         .flags = 0,
+                                                         .codeSize = shader.code.size() * sizeof(ui32),
+                                                         .pCode = shader.code.data() };
+        VkShaderModuleIdentifierEXT identifier{ .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT,
+                                                .pNext = nullptr,
+                                                .identifierSize = 0,
+                                                .identifier = {} };
+        m_getIdentifier(m_device, &shaderModuleInfo, &identifier);
+        shader.identifierSize = std::min<ui32>(identifier.identifierSize, VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT);
+        std::copy_n(identifier.identifier, shader.identifierSize, shader.identifier);
+    }
+
+    m_shaders.push_back(std::move(shader));
+    ++m_stats.shaderCount;
+    return static_cast<ShaderHandle>(m_shaders.size() - 1);
+}
+
+bool ShaderRegistry::_SetIdentifiers(std::span<const ShaderHandle> shaders, std::span<vk::PipelineShaderStageCreateInfo> stages,
+                                     std::span<vk::PipelineShaderStageModuleIdentifierCreateInfoEXT> identifiers) const
+{
+    if (m_getIdentifier == nullptr) {
+        return false;
+    }
+    for (const ShaderHandle shader : shaders) {
+        if (m_shaders[shader].identifierSize == 0) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < shaders.size(); ++i) {
+        const auto& shader = m_shaders[shaders[i]];
+        identifiers[i] = vk::PipelineShaderStageModuleIdentifierCreateInfoEXT{ .pNext = stages[i].pNext,
+                                                                               .identifierSize = shader.identifierSize,
+                                                                               .pIdentifier = shader.identifier };
+        stages[i].pNext = &identifiers[i];
+        stages[i].module = nullptr;
+    }
+    return true;
+}
+
+}
+
+
+
+// NOTE: FNV-1a over whole words, only used to skip most of the code comparisons
+ui64 _hashShaderCode(std::span<const ui32> code)
+{
+    ui64 hash = 14695981039346656037ull;
+    for (const ui32 word : code) {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "core.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace vulkan
+{
+
+using ShaderHandle = ui32;
+constexpr ShaderHandle kInvalidShader = ~0u;
+
+// NOTE: Totals since Init()
+struct ShaderRegistryStats
+{
+    // NOTE: Files read from disk, every path is read once
+    ui32 filesRead;
+    // NOTE: Distinct SPIR-V, files with the same code share one
+    ui32 shaderCount;
+    ui32 duplicateFiles;
+    ui32 modulesCreated;
+    ui32 liveModules;
+    // NOTE: Found in the pipeline cache by module identifier, no module had to be created for them
+    ui32 pipelinesFromIdentifiers;
+    ui32 pipelinesCompiled;
+    bool usesModuleIdentifiers;
+};
+
+
+// NOTE: Owns the SPIR-V of every shader for the lifetime of the device, so pipelines created again later don't go back
+//  to the disk. Shaders are keyed by a hash of their code, two paths with the same code are one shader.
+//  Modules are only created when a pipeline has to be compiled. With VK_EXT_shader_module_identifier a pipeline is
+//  first looked up in the pipeline cache by the identifiers of its shaders, only a miss creates their modules.
+class ShaderRegistry
+{
+public:
+    ShaderRegistry() = default;
+
+    ShaderRegistry(const ShaderRegistry&) = delete;
+    ShaderRegistry& operator=(const ShaderRegistry&) = delete;
+
+    // NOTE: 'getIdentifier' is vkGetShaderModuleCreateInfoIdentifierEXT, null without VK_EXT_shader_module_identifier.
+    //  The device also needs pipelineCreationCacheControl for it.
+    void Init(const vk::Device& device, PFN_vkGetShaderModuleCreateInfoIdentifierEXT getIdentifier,
+              const vk::AllocationCallbacks* allocationCallbacks);
+    void Shutdown();
+
+    // NOTE: Reads the file the first time 'path' is asked for, the same handle every time after
+    ShaderHandle Load(std::string_view path);
+    // NOTE: Created on first use, stays until ReleaseModules()
+    vk::ShaderModule GetModule(ShaderHandle handle);
+    // NOTE: Pipelines don't need their modules after they're created. The code stays, a later GetModule() creates it again.
+    void ReleaseModules();
+
+    // NOTE: 'shaders' go into the stages of 'pipelineInfo' in the same order, the stages' modules are filled in here
+    vk::Pipeline CreateGraphicsPipeline(vk::PipelineCache pipelineCache, const vk::GraphicsPipelineCreateInfo& pipelineInfo,
+                                        std::span<const ShaderHandle> shaders);
+    vk::Pipeline CreateComputePipeline(vk::PipelineCache pipelineCache, const vk::ComputePipelineCreateInfo& pipelineInfo,
+                                       ShaderHandle shader);
+
+    ShaderRegistryStats GetStats() const;
+
+private:
+    struct Shader
+    {
+        ui64 hash;
+        std::vector<ui32> code;
+        vk::ShaderModule module;
+        ui32 identifierSize;
+        ui8 identifier[VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT];
+    };
+
+    struct Path
+    {
+        std::string path;
+        ShaderHandle shader;
+    };
+
+    ShaderHandle _AddShader(std::vector<ui32>&& code);
+    // NOTE: False when a shader has no identifier, the pipeline has to be compiled from modules then
+    bool _SetIdentifiers(std::span<const ShaderHandle> shaders, std::span<vk::PipelineShaderStageCreateInfo> stages,
+                         std::span<vk::PipelineShaderStageModuleIdentifierCreateInfoEXT> identifiers) const;
+
+private:
+    vk::Device                                      m_device;
+    const vk::AllocationCallbacks*                  m_allocationCallbacks;
+    PFN_vkGetShaderModuleCreateInfoIdentifierEXT    m_getIdentifier;
+
+    std::vector<Shader>                             m_shaders;
+    std::vector<Path>                               m_paths;
+    ShaderRegistryStats                             m_stats;
+};
+
+}
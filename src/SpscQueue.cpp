@@ -0,0 +1,70 @@
+#include "SpscQueue.hpp"
+
+#include <bit>
+
+
+void SpscQueue::Init(ui32 capacity)
+{
+    m_capacity = std::bit_ceil(capacity > 0 ? capacity : 1);
+    m_values = std::make_unique<ui32[]>(m_capacity);
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+}
+
+// NOTE: Release on m_tail publishes the value, acquire on m_head makes sure the consumer is done with the slot
+bool SpscQueue::TryPush(ui32 value)
+{
+    const ui32 tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == m_capacity) {
+        return false;
+    }
+
+    m_values[tail & (m_capacity - 1)] = value;
+    m_tail.store(tail + 1, std::memory_order_release);
+    m_tail.notify_one();
+
+    return true;
+}
+
+void SpscQueue::Push(ui32 value)
+{
+    while (TryPush(value) == false) {
+        // NOTE: Sleeps only while the consumer hasn't moved since the queue was seen full
+        const ui32 head = m_head.load(std::memory_order_acquire);
+        if (m_tail.load(std::memory_order_relaxed) - head == m_capacity) {
+            m_head.wait(head, std::memory_order_acquire);
+        }
+    }
+}
+
+bool SpscQueue::TryPop(ui32& value)
+{
+    const ui32 head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    value = m_values[head & (m_capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    m_head.notify_one();
+
+    return true;
+}
+
+ui32 SpscQueue::Pop()
+{
+    ui32 value;
+    while (TryPop(value) == false) {
+        const ui32 tail = m_tail.load(std::memory_order_acquire);
+        if (tail == m_head.load(std::memory_order_relaxed)) {
+            m_tail.wait(tail, std::memory_order_acquire);
+        }
+    }
+
+    return value;
+}
+
+ui32 SpscQueue::GetCapacity() const
+{
+    return m_capacity;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <atomic>
+#include <memory>
+
+
+// NOTE: Lock-free ring of ui32 for exactly one producer and one consumer thread, usually indices into an array
+//  of bigger objects the two threads pass back and forth. The blocking calls sleep on the index the other side advances
+//  (C++20 atomic wait/notify), so a full or empty queue costs no CPU.
+class SpscQueue
+{
+public:
+    SpscQueue() = default;
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // NOTE: Not thread-safe, call before either side starts. Capacity is rounded up to a power of two.
+    void Init(ui32 capacity);
+
+    // NOTE: Producer thread only
+    bool TryPush(ui32 value);
+    void Push(ui32 value);
+    // NOTE: Consumer thread only
+    bool TryPop(ui32& value);
+    ui32 Pop();
+
+    ui32 GetCapacity() const;
+
+private:
+    // NOTE: Both only ever grow, the difference is the size. Separate cache lines, so the two sides don't false share.
+    alignas(64) std::atomic<ui32> m_head{ 0 };
+    alignas(64) std::atomic<ui32> m_tail{ 0 };
+
+    alignas(64) std::unique_ptr<ui32[]> m_values;
+    ui32 m_capacity = 0;
+};
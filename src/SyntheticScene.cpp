@@ -0,0 +1,127 @@
+#include "SyntheticScene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept> // std::runtime_error
+
+
+constexpr f32 kPi = 3.14159265358979f;
+// NOTE: Camera distance and depth spread of the objects, both well inside the backend's near and far planes
+constexpr f32 kCameraDistance = 3.0f;
+constexpr f32 kDepthRange = 1.0f;
+constexpr f32 kFovY = 45.0f * kPi / 180.0f;
+constexpr ui32 kMaxPolygonSides = 4096;
+
+
+// NOTE: splitmix64, std:: distributions aren't specified exactly, so they'd give different scenes on different standard libraries
+struct _Random
+{
+    ui64 state;
+
+    ui64 Next();
+    // NOTE: [0, 1)
+    f32 NextFloat();
+    f32 NextFloat(f32 min, f32 max);
+};
+
+auto _makePolygon(ui32 sides) -> SyntheticMesh;
+
+
+SyntheticScene BuildSyntheticScene(const SyntheticSceneDesc& desc)
+{
+    if (desc.meshCount == 0 || desc.materialCount == 0) {
+        throw std::runtime_error("BuildSyntheticScene(): Need at least one mesh and one material!");
+    }
+
+    SyntheticScene scene;
+    _Random random{ .state = desc.seed };
+
+    scene.camera = SyntheticCamera{ .eye = { 0.0f, 0.0f, kCameraDistance },
+                                    .target = { 0.0f, 0.0f, 0.0f },
+                                    .up = { 0.0f, 1.0f, 0.0f },
+                                    .fovY = kFovY };
+
+    scene.meshes.reserve(desc.meshCount);
+    for (ui32 i = 0; i < desc.meshCount; ++i) {
+        scene.meshes.push_back(_makePolygon(std::min(4u << std::min(i, 10u), kMaxPolygonSides)));
+    }
+
+    // NOTE: The first materials are opaque, so the transparent share doesn't depend on rounding per material
+    const auto transparentCount = static_cast<ui32>(std::lround(desc.transparentFraction * static_cast<f32>(desc.materialCount)));
+    scene.materials.reserve(desc.materialCount);
+    for (ui32 i = 0; i < desc.materialCount; ++i) {
+        const bool isTransparent = i >= desc.materialCount - std::min(transparentCount, desc.materialCount);
+        scene.materials.push_back(SyntheticMaterial{ .color = { random.NextFloat(0.2f, 1.0f),
+                                                                random.NextFloat(0.2f, 1.0f),
+                                                                random.NextFloat(0.2f, 1.0f),
+                                                                isTransparent ? 0.5f : 1.0f } });
+    }
+
+    // NOTE: Visible square at z = 0, assuming a square aspect. Objects are unit quads before scaling,
+    //  so overdraw * viewArea = objectCount * scale^2.
+    const f32 halfView = kCameraDistance * std::tan(0.5f * kFovY);
+    const f32 viewArea = 4.0f * halfView * halfView;
+    const f32 scale = desc.objectCount > 0 ? std::sqrt(desc.overdraw * viewArea / static_cast<f32>(desc.objectCount)) : 0.0f;
+    const f32 halfRange = std::max(halfView - 0.5f * scale, 0.0f);
+
+    scene.objects.reserve(desc.objectCount);
+    for (ui32 i = 0; i < desc.objectCount; ++i) {
+        SyntheticObject object{ .position = { random.NextFloat(-halfRange, halfRange),
+                                              random.NextFloat(-halfRange, halfRange),
+                                              random.NextFloat(-kDepthRange, 0.0f) },
+                                .scale = scale,
+                                .mesh = static_cast<ui32>(random.Next() % desc.meshCount),
+                                .material = static_cast<ui32>(random.Next() % desc.materialCount) };
+        scene.objects.push_back(object);
+    }
+
+    return scene;
+}
+
+
+
+ui64 _Random::Next()
+{
+    state += 0x9e3779b97f4a7c15ull;
+    ui64 z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+f32 _Random::NextFloat()
+{
+    // NOTE: Top 24 bits, exactly representable
+    return static_cast<f32>(Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+f32 _Random::NextFloat(f32 min, f32 max)
+{
+    return min + (max - min) * NextFloat();
+}
+
+// NOTE: Center vertex plus a ring on the circle of radius 0.5, fanned. Vertices are offset by half a side,
+//  so the 4-sided one is an axis-aligned square and bigger ones approach the circle.
+SyntheticMesh _makePolygon(ui32 sides)
+{
+    SyntheticMesh mesh;
+    mesh.positions.reserve(2 * (sides + 1));
+    mesh.texCoords.reserve(2 * (sides + 1));
+    mesh.indices.reserve(3 * sides);
+
+    mesh.positions.insert(mesh.positions.end(), { 0.0f, 0.0f });
+    mesh.texCoords.insert(mesh.texCoords.end(), { 0.5f, 0.5f });
+
+    for (ui32 i = 0; i < sides; ++i) {
+        const f32 angle = 2.0f * kPi * (static_cast<f32>(i) + 0.5f) / static_cast<f32>(sides);
+        const f32 x = 0.5f * std::cos(angle);
+        const f32 y = 0.5f * std::sin(angle);
+
+        mesh.positions.insert(mesh.positions.end(), { x, y });
+        mesh.texCoords.insert(mesh.texCoords.end(), { x + 0.5f, y + 0.5f });
+
+        mesh.indices.insert(mesh.indices.end(), { 0, static_cast<ui16>(1 + i), static_cast<ui16>(1 + (i + 1) % sides) });
+    }
+
+    return mesh;
+}
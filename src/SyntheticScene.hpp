@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <vector>
+
+
+// NOTE: Knobs of a generated scene. The same description and seed always produce the same scene on every platform.
+struct SyntheticSceneDesc
+{
+    ui32 seed;
+    ui32 objectCount;
+    ui32 meshCount;
+    ui32 materialCount;
+    // NOTE: Sum of the objects' projected area over the screen area, 1 covers the screen about once
+    f32 overdraw;
+    // NOTE: Share of the materials that are blended
+    f32 transparentFraction;
+};
+
+// NOTE: Flat mesh in the XY plane inside [-0.5, 0.5], counter-clockwise seen from +Z
+struct SyntheticMesh
+{
+    // NOTE: xy pairs
+    std::vector<f32> positions;
+    // NOTE: uv pairs
+    std::vector<f32> texCoords;
+    std::vector<ui16> indices;
+};
+
+struct SyntheticMaterial
+{
+    // NOTE: alpha < 1 means transparent
+    f32 color[4];
+};
+
+struct SyntheticObject
+{
+    f32 position[3];
+    f32 scale;
+    ui32 mesh;
+    ui32 material;
+};
+
+// NOTE: Camera looks down -Z at the objects, they fill the view at z = 0
+struct SyntheticCamera
+{
+    f32 eye[3];
+    f32 target[3];
+    f32 up[3];
+    f32 fovY;
+};
+
+struct SyntheticScene
+{
+    SyntheticCamera camera;
+    std::vector<SyntheticMesh> meshes;
+    std::vector<SyntheticMaterial> materials;
+    std::vector<SyntheticObject> objects;
+};
+
+
+// NOTE: Mesh i is a regular polygon with 4 << i sides (clamped to what ui16 indices can address), so meshes differ
+//  in vertex and triangle count. Objects are spread over the view at slightly different depths and sized so their
+//  total area matches 'overdraw', perspective makes that approximate.
+SyntheticScene BuildSyntheticScene(const SyntheticSceneDesc& desc);
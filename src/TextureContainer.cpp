@@ -0,0 +1,302 @@
+#include "TextureContainer.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <bit> // std::bit_width
+#include <fstream>
+#include <string>
+
+
+auto _makeLevels(ContainerFormat format, ui32 width, ui32 height, ui32 mipCount) -> std::vector<ContainerLevel>;
+
+
+TextureContainer TextureContainer::Build(const ui8* pixels, ui32 width, ui32 height, bool isSrgb, bool generateMips,
+                                         const std::vector<BlockFormat>& blockFormats, SimdLevel simdLevel, ui32 threadCount,
+                                         const ParallelFor& parallelFor)
+{
+    TextureContainer container;
+    container.m_width = width;
+    container.m_height = height;
+    container.m_mipCount = generateMips ? GetMipLevelCount(width, height) : 1;
+    container.m_isSrgb = isSrgb;
+
+    std::vector<ContainerLevel> sourceLevels;
+    const auto chain = GenerateMipChain(pixels, width, height, container.m_mipCount, sourceLevels);
+
+    for (const auto blockFormat : blockFormats) {
+        std::vector<ContainerLevel> levels;
+        const auto compressed = CompressMipChain(blockFormat, chain.data(), sourceLevels, levels, simdLevel, threadCount, parallelFor);
+        container.AddPayload(ToContainerFormat(blockFormat), compressed.data(), compressed.size());
+    }
+    // NOTE: Always there as the last resort and as the source for load-time transcoding
+    container.AddPayload(ContainerFormat::RGBA8, chain.data(), chain.size());
+
+    return container;
+}
+
+void TextureContainer::Load(std::string_view path)
+{
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::in);
+    if (!file) {
+        throw std::runtime_error("TextureContainer::Load(): Failed to open " + std::string(path));
+    }
+
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != kMagic || header.version != kVersion) {
+        throw std::runtime_error("TextureContainer::Load(): " + std::string(path) + " is not a texture container or has a wrong version");
+    }
+    if (header.mipCount == 0 || header.mipCount > GetMipLevelCount(header.width, header.height)) {
+        throw std::runtime_error("TextureContainer::Load(): " + std::string(path) + " has an invalid mip count");
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_mipCount = header.mipCount;
+    m_isSrgb = (header.flags & kFlagSrgb) != 0;
+    m_payloads.clear();
+
+    ui64 dataSize = 0;
+    for (ui32 i = 0; i < header.payloadCount; ++i) {
+        ui32 formatAndReserved[2];
+        file.read(reinterpret_cast<char*>(formatAndReserved), sizeof(formatAndReserved));
+
+        ContainerPayload payload{ .format = static_cast<ContainerFormat>(formatAndReserved[0]),
+                                  .offset = ~0ull,
+                                  .size = 0,
+                                  .levels = _makeLevels(static_cast<ContainerFormat>(formatAndReserved[0]), m_width, m_height, m_mipCount) };
+
+        for (auto& level : payload.levels) {
+            ui64 offsetAndSize[2];
+            file.read(reinterpret_cast<char*>(offsetAndSize), sizeof(offsetAndSize));
+
+            if (offsetAndSize[1] != level.size) {
+                throw std::runtime_error("TextureContainer::Load(): " + std::string(path) + " has a level of unexpected size");
+            }
+            payload.offset = std::min(payload.offset, offsetAndSize[0]);
+            payload.size += level.size;
+            level.offset = offsetAndSize[0];
+        }
+
+        for (auto& level : payload.levels) {
+            level.offset -= payload.offset;
+        }
+        dataSize = std::max(dataSize, payload.offset + payload.size);
+        m_payloads.push_back(std::move(payload));
+    }
+
+    m_data.resize(dataSize);
+    file.read(reinterpret_cast<char*>(m_data.data()), static_cast<std::streamsize>(dataSize));
+    if (!file) {
+        throw std::runtime_error("TextureContainer::Load(): " + std::string(path) + " is truncated");
+    }
+}
+
+void TextureContainer::Save(std::string_view path) const
+{
+    std::ofstream file(std::string(path), std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("TextureContainer::Save(): Failed to open " + std::string(path));
+    }
+
+    const FileHeader header{ .magic = kMagic,
+                             .version = kVersion,
+                             .width = m_width,
+                             .height = m_height,
+                             .mipCount = m_mipCount,
+                             .flags = m_isSrgb ? kFlagSrgb : 0,
+                             .payloadCount = static_cast<ui32>(m_payloads.size()),
+                             .reserved = 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const auto& payload : m_payloads) {
+        const ui32 formatAndReserved[2] = { static_cast<ui32>(payload.format), 0 };
+        file.write(reinterpret_cast<const char*>(formatAndReserved), sizeof(formatAndReserved));
+
+        for (const auto& level : payload.levels) {
+            const ui64 offsetAndSize[2] = { payload.offset + level.offset, level.size };
+            file.write(reinterpret_cast<const char*>(offsetAndSize), sizeof(offsetAndSize));
+        }
+    }
+
+    file.write(reinterpret_cast<const char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+}
+
+void TextureContainer::AddPayload(ContainerFormat format, const ui8* data, ui64 size)
+{
+    auto levels = _makeLevels(format, m_width, m_height, m_mipCount);
+    const ui64 expectedSize = levels.back().offset + levels.back().size;
+
+    if (size != expectedSize) {
+        throw std::runtime_error("TextureContainer::AddPayload(): Payload size doesn't match the format and mip count!");
+    }
+    if (FindPayload(format) != nullptr) {
+        throw std::runtime_error("TextureContainer::AddPayload(): The container already has a payload of this format!");
+    }
+
+    // NOTE: Keeps every payload 16-byte aligned, so a staging copy of it satisfies any block size
+    const ui64 offset = (m_data.size() + 15) & ~15ull;
+    m_data.resize(offset + size);
+    std::copy(data, data + size, m_data.begin() + offset);
+
+    m_payloads.push_back(ContainerPayload{ .format = format,
+                                           .offset = offset,
+                                           .size = size,
+                                           .levels = std::move(levels) });
+}
+
+ui32 TextureContainer::GetWidth() const
+{
+    return m_width;
+}
+
+ui32 TextureContainer::GetHeight() const
+{
+    return m_height;
+}
+
+ui32 TextureContainer::GetMipCount() const
+{
+    return m_mipCount;
+}
+
+bool TextureContainer::IsSrgb() const
+{
+    return m_isSrgb;
+}
+
+const std::vector<ContainerPayload>& TextureContainer::GetPayloads() const
+{
+    return m_payloads;
+}
+
+const ContainerPayload* TextureContainer::FindPayload(ContainerFormat format) const
+{
+    for (const auto& payload : m_payloads) {
+        if (payload.format == format) {
+            return &payload;
+        }
+    }
+    return nullptr;
+}
+
+const ui8* TextureContainer::GetPayloadData(const ContainerPayload& payload) const
+{
+    return m_data.data() + payload.offset;
+}
+
+
+ui32 GetMipLevelCount(ui32 width, ui32 height)
+{
+    return static_cast<ui32>(std::bit_width(std::max(width, height)));
+}
+
+ContainerFormat ToContainerFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return ContainerFormat::BC1;
+    case BlockFormat::BC3: return ContainerFormat::BC3;
+    case BlockFormat::BC5: return ContainerFormat::BC5;
+    case BlockFormat::BC7: return ContainerFormat::BC7;
+    }
+    throw std::runtime_error("ToContainerFormat(): Unknown block format!");
+}
+
+const char* GetContainerFormatName(ContainerFormat format)
+{
+    switch (format) {
+    case ContainerFormat::RGBA8:   return "RGBA8";
+    case ContainerFormat::BC1:     return "BC1";
+    case ContainerFormat::BC3:     return "BC3";
+    case ContainerFormat::BC5:     return "BC5";
+    case ContainerFormat::BC7:     return "BC7";
+    case ContainerFormat::ASTC4x4: return "ASTC4x4";
+    }
+    return "unknown";
+}
+
+ui64 GetContainerLevelSize(ContainerFormat format, ui32 width, ui32 height)
+{
+    switch (format) {
+    case ContainerFormat::RGBA8:   return static_cast<ui64>(width) * height * 4;
+    case ContainerFormat::BC1:     return GetCompressedSize(BlockFormat::BC1, width, height);
+    case ContainerFormat::BC3:     return GetCompressedSize(BlockFormat::BC3, width, height);
+    case ContainerFormat::BC5:     return GetCompressedSize(BlockFormat::BC5, width, height);
+    case ContainerFormat::BC7:     return GetCompressedSize(BlockFormat::BC7, width, height);
+    // NOTE: 4x4 blocks of 16 bytes, same as BC7
+    case ContainerFormat::ASTC4x4: return GetCompressedSize(BlockFormat::BC7, width, height);
+    }
+    throw std::runtime_error("GetContainerLevelSize(): Unknown container format!");
+}
+
+// NOTE: Odd sizes clamp the last row/column. Filtering is done on the stored values,
+//  which is slightly too dark for sRGB data but matches what most offline tools do by default.
+std::vector<ui8> GenerateMipChain(const ui8* pixels, ui32 width, ui32 height, ui32 mipCount, std::vector<ContainerLevel>& levels)
+{
+    levels = _makeLevels(ContainerFormat::RGBA8, width, height, mipCount);
+
+    std::vector<ui8> chain(levels.back().offset + levels.back().size);
+    std::copy(pixels, pixels + levels[0].size, chain.begin());
+
+    for (ui32 level = 1; level < mipCount; ++level) {
+        const auto& source = levels[level - 1];
+        const auto& destination = levels[level];
+
+        const ui8* src = chain.data() + source.offset;
+        ui8* dst = chain.data() + destination.offset;
+
+        for (ui32 y = 0; y < destination.height; ++y) {
+            const ui32 y0 = std::min(y * 2, source.height - 1);
+            const ui32 y1 = std::min(y * 2 + 1, source.height - 1);
+
+            for (ui32 x = 0; x < destination.width; ++x) {
+                const ui32 x0 = std::min(x * 2, source.width - 1);
+                const ui32 x1 = std::min(x * 2 + 1, source.width - 1);
+
+                for (ui32 c = 0; c < 4; ++c) {
+                    const ui32 sum = src[(y0 * source.width + x0) * 4 + c] + src[(y0 * source.width + x1) * 4 + c]
+                                   + src[(y1 * source.width + x0) * 4 + c] + src[(y1 * source.width + x1) * 4 + c];
+                    dst[(y * destination.width + x) * 4 + c] = static_cast<ui8>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return chain;
+}
+
+std::vector<ui8> CompressMipChain(BlockFormat format, const ui8* chain, const std::vector<ContainerLevel>& sourceLevels,
+                                  std::vector<ContainerLevel>& levels, SimdLevel simdLevel, ui32 threadCount,
+                                  const ParallelFor& parallelFor)
+{
+    levels = _makeLevels(ToContainerFormat(format), sourceLevels[0].width, sourceLevels[0].height,
+                         static_cast<ui32>(sourceLevels.size()));
+
+    std::vector<ui8> compressed(levels.back().offset + levels.back().size);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        CompressImage(format, chain + sourceLevels[i].offset, sourceLevels[i].width, sourceLevels[i].height,
+                      compressed.data() + levels[i].offset, simdLevel, threadCount, parallelFor);
+    }
+
+    return compressed;
+}
+
+
+
+std::vector<ContainerLevel> _makeLevels(ContainerFormat format, ui32 width, ui32 height, ui32 mipCount)
+{
+    std::vector<ContainerLevel> levels;
+    levels.reserve(mipCount);
+
+    ui64 offset = 0;
+    for (ui32 i = 0; i < mipCount; ++i) {
+        const ui32 levelWidth = std::max(width >> i, 1u);
+        const ui32 levelHeight = std::max(height >> i, 1u);
+        const ui64 size = GetContainerLevelSize(format, levelWidth, levelHeight);
+
+        levels.push_back(ContainerLevel{ .width = levelWidth, .height = levelHeight, .offset = offset, .size = size });
+        offset += size;
+    }
+
+    return levels;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core.hpp"
+#include "BlockCompression.hpp"
+
+#include <string_view>
+#include <vector>
+
+
+enum class ContainerFormat : ui32
+{
+    RGBA8 = 0,
+    BC1,
+    BC3,
+    BC5,
+    BC7,
+    // NOTE: No encoder for it, payloads come from external tools through AddPayload()
+    ASTC4x4
+};
+
+struct ContainerLevel
+{
+    ui32 width;
+    ui32 height;
+    // NOTE: Relative to the start of the payload
+    ui64 offset;
+    ui64 size;
+};
+
+struct ContainerPayload
+{
+    ContainerFormat format;
+    // NOTE: Offset of the payload in the container data, all levels are stored back to back
+    ui64 offset;
+    ui64 size;
+    std::vector<ContainerLevel> levels;
+};
+
+
+// NOTE: One texture stored in several formats, every format with the full mip chain.
+//  Textures are compressed offline (see tools/TextureCompressor.cpp), at load time the renderer uploads the first
+//  payload the device can sample and can still transcode the RGBA8 payload when none of them fits.
+//  File layout: FileHeader | payloadCount x (ui32 format, ui32 reserved, mipCount x (ui64 offset, ui64 size)) | data
+class TextureContainer
+{
+public:
+    static constexpr ui32 kMagic = 0x5854564C; // NOTE: "LVTX"
+    static constexpr ui32 kVersion = 1;
+
+    TextureContainer() = default;
+
+    // NOTE: Stores the RGBA8 mip chain and one payload per block format, in the given order of preference
+    static TextureContainer Build(const ui8* pixels, ui32 width, ui32 height, bool isSrgb, bool generateMips,
+                                  const std::vector<BlockFormat>& blockFormats,
+                                  SimdLevel simdLevel = GetBestSimdLevel(), ui32 threadCount = 1,
+                                  const ParallelFor& parallelFor = nullptr);
+
+    void Load(std::string_view path);
+    void Save(std::string_view path) const;
+
+    // NOTE: 'data' holds every mip level back to back, its size has to match the format and mip count
+    void AddPayload(ContainerFormat format, const ui8* data, ui64 size);
+
+    ui32 GetWidth() const;
+    ui32 GetHeight() const;
+    ui32 GetMipCount() const;
+    bool IsSrgb() const;
+
+    const std::vector<ContainerPayload>& GetPayloads() const;
+    const ContainerPayload* FindPayload(ContainerFormat format) const;
+    const ui8* GetPayloadData(const ContainerPayload& payload) const;
+
+private:
+    struct FileHeader
+    {
+        ui32 magic;
+        ui32 version;
+        ui32 width;
+        ui32 height;
+        ui32 mipCount;
+        ui32 flags;
+        ui32 payloadCount;
+        ui32 reserved;
+    };
+
+    static constexpr ui32 kFlagSrgb = 1 << 0;
+
+private:
+    ui32 m_width = 0;
+    ui32 m_height = 0;
+    ui32 m_mipCount = 0;
+    bool m_isSrgb = false;
+
+    std::vector<ContainerPayload> m_payloads;
+    std::vector<ui8> m_data;
+};
+
+
+ui32 GetMipLevelCount(ui32 width, ui32 height);
+ContainerFormat ToContainerFormat(BlockFormat format);
+const char* GetContainerFormatName(ContainerFormat format);
+// NOTE: Bytes of one mip level of the given size
+ui64 GetContainerLevelSize(ContainerFormat format, ui32 width, ui32 height);
+
+// NOTE: RGBA8 mip chain with a 2x2 box filter, levels are stored back to back starting with 'pixels' itself
+std::vector<ui8> GenerateMipChain(const ui8* pixels, ui32 width, ui32 height, ui32 mipCount, std::vector<ContainerLevel>& levels);
+// NOTE: Encodes every level of an RGBA8 chain, also used to transcode at load time
+std::vector<ui8> CompressMipChain(BlockFormat format, const ui8* chain, const std::vector<ContainerLevel>& sourceLevels,
+                                  std::vector<ContainerLevel>& levels, SimdLevel simdLevel, ui32 threadCount,
+                                  const ParallelFor& parallelFor);
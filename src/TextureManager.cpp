@@ -0,0 +1,559 @@
+#include "TextureManager.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <vector>
+
+
+// NOTE: Formats tried when a container has no payload the device can sample, both keep alpha
+constexpr BlockFormat kTranscodeFormats[] = { BlockFormat::BC7, BlockFormat::BC3 };
+
+
+auto _getTexelSize(vk::Format format)                                                       -> ui32;
+auto _toVkFormat(ContainerFormat format, bool isSrgb)                                       -> vk::Format;
+auto _hashSamplerInfo(const vk::SamplerCreateInfo& samplerInfo)                             -> ui64;
+auto _recordImageBarrier(vk::CommandBuffer commandBuffer, vk::Image image,
+                         ui32 baseMipLevel, ui32 levelCount,
+                         vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                         vk::PipelineStageFlags srcStages, vk::AccessFlags srcAccess,
+                         vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess)       -> void;
+
+
+namespace vulkan
+{
+
+void SamplerCache::Init(const vk::Device& device, const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+}
+
+void SamplerCache::Shutdown()
+{
+    for (const auto& entry : m_entries) {
+        m_device.destroySampler(entry.sampler, m_allocationCallbacks);
+    }
+    m_entries.clear();
+}
+
+vk::Sampler SamplerCache::Get(const vk::SamplerCreateInfo& samplerInfo)
+{
+    const auto hash = _hashSamplerInfo(samplerInfo);
+
+    for (const auto& entry : m_entries) {
+        if (entry.hash == hash && entry.info == samplerInfo) {
+            return entry.sampler;
+        }
+    }
+
+    const auto sampler = m_device.createSampler(samplerInfo, m_allocationCallbacks);
+    m_entries.push_back(Entry{ .hash = hash, .info = samplerInfo, .sampler = sampler });
+
+    return sampler;
+}
+
+ui32 SamplerCache::GetSamplerCount() const
+{
+    return static_cast<ui32>(m_entries.size());
+}
+
+
+void TextureManager::Init(const vk::PhysicalDevice& physicalDevice, const vk::Device& device, DeviceAllocator& allocator,
+                          const vk::PhysicalDeviceFeatures& enabledFeatures, JobSystem& jobSystem,
+                          const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_jobSystem = &jobSystem;
+    m_isBCEnabled = enabledFeatures.textureCompressionBC;
+    m_isASTCEnabled = enabledFeatures.textureCompressionASTC_LDR;
+    m_droppedMipCount = 0;
+
+    m_samplerCache.Init(device, allocationCallbacks);
+}
+
+void TextureManager::Shutdown()
+{
+    for (TextureHandle i = 0; i < m_textures.size(); ++i) {
+        DestroyTexture(i);
+    }
+    m_textures.clear();
+
+    m_samplerCache.Shutdown();
+}
+
+TextureHandle TextureManager::CreateTexture(UploadBatch& batch, const TextureDesc& desc, const void* pixels)
+{
+    const ui32 mipLevels = desc.generateMips ? GetMipLevelCount(desc.width, desc.height) : 1;
+    const bool isGpuMips = mipLevels > 1 && _CanBlitMips(desc.format);
+
+    constexpr auto usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    const auto texture = _CreateImage(desc.format, desc.width, desc.height, mipLevels, usage);
+
+    if (mipLevels > 1 && isGpuMips == false) {
+        _UploadMipsCpu(batch, texture, pixels);
+    } else if (isGpuMips == false) {
+        const std::vector<ContainerLevel> levels{ { .width = desc.width,
+                                                    .height = desc.height,
+                                                    .offset = 0,
+                                                    .size = static_cast<ui64>(desc.width) * desc.height * _getTexelSize(desc.format) } };
+        _UploadLevels(batch, texture, static_cast<const ui8*>(pixels), levels[0].size, levels);
+    } else {
+        const auto commandBuffer = batch.GetCommandBuffer();
+        const auto size = static_cast<vk::DeviceSize>(desc.width) * desc.height * _getTexelSize(desc.format);
+        const auto staging = batch.Stage(pixels, size);
+
+        _recordImageBarrier(commandBuffer, texture.image, 0, mipLevels,
+                            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                            vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags(),
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+
+        vk::BufferImageCopy copyRegion{ .bufferOffset = staging.offset,
+                                        .bufferRowLength = 0,
+                                        .bufferImageHeight = 0,
+                                        .imageSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                              .mipLevel = 0,
+                                                              .baseArrayLayer = 0,
+                                                              .layerCount = 1 },
+                                        .imageOffset = { .x = 0, .y = 0, .z = 0 },
+                                        .imageExtent = { .width = desc.width, .height = desc.height, .depth = 1 } };
+        commandBuffer.copyBufferToImage(staging.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, 1, &copyRegion);
+
+        _GenerateMipsGpu(commandBuffer, texture);
+    }
+
+    return _AddTexture(texture);
+}
+
+TextureHandle TextureManager::CreateTexture(UploadBatch& batch, const TextureContainer& container)
+{
+    constexpr auto usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    const bool isSrgb = container.IsSrgb();
+
+    for (const auto& payload : container.GetPayloads()) {
+        const auto format = _toVkFormat(payload.format, isSrgb);
+        if (payload.format == ContainerFormat::RGBA8 || _IsFormatSampleable(format) == false) {
+            continue;
+        }
+
+        const auto texture = _CreateImage(format, container.GetWidth(), container.GetHeight(), container.GetMipCount(), usage);
+        _UploadLevels(batch, texture, container.GetPayloadData(payload), payload.size, payload.levels);
+        return _AddTexture(texture);
+    }
+
+    const auto* source = container.FindPayload(ContainerFormat::RGBA8);
+    if (source == nullptr) {
+        throw std::runtime_error("TextureManager::CreateTexture(): None of the container formats is supported by the device!");
+    }
+
+    for (const auto blockFormat : kTranscodeFormats) {
+        const auto format = _toVkFormat(ToContainerFormat(blockFormat), isSrgb);
+        if (_IsFormatSampleable(format) == false) {
+            continue;
+        }
+
+        std::vector<ContainerLevel> levels;
+        const auto compressed = CompressMipChain(blockFormat, container.GetPayloadData(*source), source->levels, levels,
+                                                 GetBestSimdLevel(), m_jobSystem->GetThreadCount(), m_jobSystem->GetParallelFor());
+
+        const auto texture = _CreateImage(format, container.GetWidth(), container.GetHeight(), container.GetMipCount(), usage);
+        _UploadLevels(batch, texture, compressed.data(), compressed.size(), levels);
+        return _AddTexture(texture);
+    }
+
+    const auto texture = _CreateImage(_toVkFormat(ContainerFormat::RGBA8, isSrgb), container.GetWidth(), container.GetHeight(),
+                                      container.GetMipCount(), usage);
+    _UploadLevels(batch, texture, container.GetPayloadData(*source), source->size, source->levels);
+    return _AddTexture(texture);
+}
+
+void TextureManager::DestroyTexture(TextureHandle handle)
+{
+    auto& texture = m_textures[handle];
+    if (!texture.image) {
+        return;
+    }
+
+    m_device.destroyImageView(texture.view, m_allocationCallbacks);
+    m_allocator->DestroyImage(texture.image, texture.allocation);
+
+    texture = Texture{};
+}
+
+const Texture& TextureManager::GetTexture(TextureHandle handle) const
+{
+    return m_textures[handle];
+}
+
+SamplerCache& TextureManager::GetSamplerCache()
+{
+    return m_samplerCache;
+}
+
+const SamplerCache& TextureManager::GetSamplerCache() const
+{
+    return m_samplerCache;
+}
+
+ui32 TextureManager::GetTextureCount() const
+{
+    return static_cast<ui32>(std::count_if(m_textures.begin(), m_textures.end(),
+                                           [](const Texture& texture) { return static_cast<bool>(texture.image); }));
+}
+
+// NOTE: Dropping a level leaves about a quarter of the texture, the copies of all chosen textures go into one submit
+vk::DeviceSize TextureManager::DropTopMips(UploadBatch& batch, ui32 heapIndex, vk::DeviceSize bytes)
+{
+    std::vector<TextureHandle> candidates;
+    for (TextureHandle i = 0; i < m_textures.size(); ++i) {
+        const auto& texture = m_textures[i];
+        if (texture.image && texture.mipLevels > 1 && m_allocator->GetHeapIndex(texture.allocation) == heapIndex) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        return 0;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](TextureHandle a, TextureHandle b) {
+        return m_textures[a].allocation.size > m_textures[b].allocation.size;
+    });
+
+    std::vector<Texture> replaced;
+    vk::DeviceSize expected = 0;
+    vk::DeviceSize replacementBytes = 0;
+
+    batch.Begin();
+    const auto commandBuffer = batch.GetCommandBuffer();
+
+    for (const auto handle : candidates) {
+        if (expected >= bytes) {
+            break;
+        }
+
+        const Texture original = m_textures[handle];
+        const Texture smaller = _CreateImage(original.format,
+                                             std::max(original.extent.width / 2, 1u), std::max(original.extent.height / 2, 1u),
+                                             original.mipLevels - 1, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled);
+
+        std::vector<vk::ImageCopy> copyRegions;
+        copyRegions.reserve(smaller.mipLevels);
+        for (ui32 level = 0; level < smaller.mipLevels; ++level) {
+            // NOTE: Block-compressed levels smaller than a block still use the real texel extent
+            copyRegions.push_back(vk::ImageCopy{ .srcSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                     .mipLevel = level + 1,
+                                                                     .baseArrayLayer = 0,
+                                                                     .layerCount = 1 },
+                                                 .srcOffset = { .x = 0, .y = 0, .z = 0 },
+                                                 .dstSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                     .mipLevel = level,
+                                                                     .baseArrayLayer = 0,
+                                                                     .layerCount = 1 },
+                                                 .dstOffset = { .x = 0, .y = 0, .z = 0 },
+                                                 .extent = { .width = std::max(smaller.extent.width >> level, 1u),
+                                                             .height = std::max(smaller.extent.height >> level, 1u),
+                                                             .depth = 1 } });
+        }
+
+        _recordImageBarrier(commandBuffer, original.image, 1, original.mipLevels - 1,
+                            vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                            vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+        _recordImageBarrier(commandBuffer, smaller.image, 0, smaller.mipLevels,
+                            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                            vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags(),
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+
+        commandBuffer.copyImage(original.image, vk::ImageLayout::eTransferSrcOptimal,
+                                smaller.image, vk::ImageLayout::eTransferDstOptimal, copyRegions);
+
+        _recordImageBarrier(commandBuffer, smaller.image, 0, smaller.mipLevels,
+                            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                            vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+
+        expected += original.allocation.size - std::min(original.allocation.size, smaller.allocation.size);
+        replacementBytes += smaller.allocation.size;
+        replaced.push_back(original);
+        m_textures[handle] = smaller;
+    }
+
+    batch.Submit();
+
+    vk::DeviceSize freed = 0;
+    for (const auto& original : replaced) {
+        freed += original.allocation.size;
+        m_device.destroyImageView(original.view, m_allocationCallbacks);
+        m_allocator->DestroyImage(original.image, original.allocation);
+    }
+    m_droppedMipCount += static_cast<ui32>(replaced.size());
+
+    return freed - std::min(freed, replacementBytes);
+}
+
+ui32 TextureManager::GetDroppedMipCount() const
+{
+    return m_droppedMipCount;
+}
+
+
+// NOTE: Every texture can be a transfer source, DropTopMips() copies out of it
+Texture TextureManager::_CreateImage(vk::Format format, ui32 width, ui32 height, ui32 mipLevels, vk::ImageUsageFlags usage)
+{
+    vk::ImageCreateInfo imageInfo{ .imageType = vk::ImageType::e2D,
+                                   .format = format,
+                                   .extent = { .width = width, .height = height, .depth = 1 },
+                                   .mipLevels = mipLevels,
+                                   .arrayLayers = 1,
+                                   .samples = vk::SampleCountFlagBits::e1,
+                                   .tiling = vk::ImageTiling::eOptimal,
+                                   .usage = usage | vk::ImageUsageFlagBits::eTransferSrc,
+                                   .sharingMode = vk::SharingMode::eExclusive,
+                                   .initialLayout = vk::ImageLayout::eUndefined };
+
+    Texture texture{ .format = format,
+                     .extent = { .width = width, .height = height },
+                     .mipLevels = mipLevels };
+    texture.image = m_allocator->CreateImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Textures,
+                                             texture.allocation);
+
+    vk::ImageViewCreateInfo imageViewInfo{ .image = texture.image,
+                                           .viewType = vk::ImageViewType::e2D,
+                                           .format = format,
+                                           .subresourceRange = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                 .baseMipLevel = 0,
+                                                                 .levelCount = mipLevels,
+                                                                 .baseArrayLayer = 0,
+                                                                 .layerCount = 1 } };
+    texture.view = m_device.createImageView(imageViewInfo, m_allocationCallbacks);
+
+    return texture;
+}
+
+TextureHandle TextureManager::_AddTexture(const Texture& texture)
+{
+    for (TextureHandle i = 0; i < m_textures.size(); ++i) {
+        if (!m_textures[i].image) {
+            m_textures[i] = texture;
+            return i;
+        }
+    }
+
+    m_textures.push_back(texture);
+    return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+// NOTE: Block-compressed formats can be reported by the device and still be unusable if the feature wasn't enabled
+bool TextureManager::_IsFormatSampleable(vk::Format format) const
+{
+    if (format == vk::Format::eUndefined) {
+        return false;
+    }
+
+    const auto properties = m_physicalDevice.getFormatProperties(format);
+    if (!(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+        return false;
+    }
+
+    switch (format) {
+    case vk::Format::eBc1RgbaUnormBlock:
+    case vk::Format::eBc1RgbaSrgbBlock:
+    case vk::Format::eBc3UnormBlock:
+    case vk::Format::eBc3SrgbBlock:
+    case vk::Format::eBc5UnormBlock:
+    case vk::Format::eBc7UnormBlock:
+    case vk::Format::eBc7SrgbBlock:
+        return m_isBCEnabled;
+    case vk::Format::eAstc4x4UnormBlock:
+    case vk::Format::eAstc4x4SrgbBlock:
+        return m_isASTCEnabled;
+    default:
+        return true;
+    }
+}
+
+bool TextureManager::_CanBlitMips(vk::Format format) const
+{
+    constexpr auto requiredFeatures = vk::FormatFeatureFlagBits::eBlitSrc
+                                    | vk::FormatFeatureFlagBits::eBlitDst
+                                    | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+
+    const auto properties = m_physicalDevice.getFormatProperties(format);
+    return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+// NOTE: Every level is blitted from the previous one, which has to be transitioned to TransferSrc first.
+//  Levels go to ShaderReadOnly as soon as they are not needed as a blit source anymore.
+void TextureManager::_GenerateMipsGpu(vk::CommandBuffer commandBuffer, const Texture& texture) const
+{
+    auto width = static_cast<i32>(texture.extent.width);
+    auto height = static_cast<i32>(texture.extent.height);
+
+    for (ui32 level = 1; level < texture.mipLevels; ++level) {
+        _recordImageBarrier(commandBuffer, texture.image, level - 1, 1,
+                            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+
+        const i32 nextWidth = std::max(width / 2, 1);
+        const i32 nextHeight = std::max(height / 2, 1);
+
+        vk::ImageBlit blit{ .srcSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                .mipLevel = level - 1,
+                                                .baseArrayLayer = 0,
+                                                .layerCount = 1 },
+                            .dstSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                .mipLevel = level,
+                                                .baseArrayLayer = 0,
+                                                .layerCount = 1 } };
+        blit.srcOffsets[0] = vk::Offset3D{ .x = 0, .y = 0, .z = 0 };
+        blit.srcOffsets[1] = vk::Offset3D{ .x = width, .y = height, .z = 1 };
+        blit.dstOffsets[0] = vk::Offset3D{ .x = 0, .y = 0, .z = 0 };
+        blit.dstOffsets[1] = vk::Offset3D{ .x = nextWidth, .y = nextHeight, .z = 1 };
+
+        commandBuffer.blitImage(texture.image, vk::ImageLayout::eTransferSrcOptimal,
+                                texture.image, vk::ImageLayout::eTransferDstOptimal,
+                                1, &blit, vk::Filter::eLinear);
+
+        _recordImageBarrier(commandBuffer, texture.image, level - 1, 1,
+                            vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                            vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead,
+                            vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    _recordImageBarrier(commandBuffer, texture.image, texture.mipLevels - 1, 1,
+                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                        vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+}
+
+// NOTE: Fallback for formats the device can't blit with linear filtering, the whole chain is built on the CPU
+void TextureManager::_UploadMipsCpu(UploadBatch& batch, const Texture& texture, const void* pixels) const
+{
+    if (_getTexelSize(texture.format) != 4) {
+        throw std::runtime_error("TextureManager: CPU mip generation only supports 8-bit RGBA formats!");
+    }
+
+    std::vector<ContainerLevel> levels;
+    const auto chain = GenerateMipChain(static_cast<const ui8*>(pixels), texture.extent.width, texture.extent.height,
+                                        texture.mipLevels, levels);
+    _UploadLevels(batch, texture, chain.data(), chain.size(), levels);
+}
+
+void TextureManager::_UploadLevels(UploadBatch& batch, const Texture& texture, const ui8* data, ui64 size,
+                                   const std::vector<ContainerLevel>& levels) const
+{
+    const auto staging = batch.Stage(data, size);
+
+    std::vector<vk::BufferImageCopy> copyRegions;
+    copyRegions.reserve(levels.size());
+    for (ui32 level = 0; level < levels.size(); ++level) {
+        // NOTE: Block-compressed levels smaller than a block still use the real texel extent
+        copyRegions.push_back(vk::BufferImageCopy{ .bufferOffset = staging.offset + levels[level].offset,
+                                                   .bufferRowLength = 0,
+                                                   .bufferImageHeight = 0,
+                                                   .imageSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                                         .mipLevel = level,
+                                                                         .baseArrayLayer = 0,
+                                                                         .layerCount = 1 },
+                                                   .imageOffset = { .x = 0, .y = 0, .z = 0 },
+                                                   .imageExtent = { .width = levels[level].width,
+                                                                    .height = levels[level].height,
+                                                                    .depth = 1 } });
+    }
+
+    const auto commandBuffer = batch.GetCommandBuffer();
+
+    _recordImageBarrier(commandBuffer, texture.image, 0, texture.mipLevels,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                        vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags(),
+                        vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+
+    commandBuffer.copyBufferToImage(staging.buffer, texture.image, vk::ImageLayout::eTransferDstOptimal, copyRegions);
+
+    _recordImageBarrier(commandBuffer, texture.image, 0, texture.mipLevels,
+                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite,
+                        vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+}
+
+}
+
+
+
+ui32 _getTexelSize(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+        return 4;
+    default:
+        throw std::runtime_error("_getTexelSize(): Unsupported texture format!");
+    }
+}
+
+// NOTE: BC5 has no sRGB variant, it's meant for normal maps anyway
+vk::Format _toVkFormat(ContainerFormat format, bool isSrgb)
+{
+    switch (format) {
+    case ContainerFormat::RGBA8:   return isSrgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+    case ContainerFormat::BC1:     return isSrgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+    case ContainerFormat::BC3:     return isSrgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+    case ContainerFormat::BC5:     return isSrgb ? vk::Format::eUndefined : vk::Format::eBc5UnormBlock;
+    case ContainerFormat::BC7:     return isSrgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+    case ContainerFormat::ASTC4x4: return isSrgb ? vk::Format::eAstc4x4SrgbBlock : vk::Format::eAstc4x4UnormBlock;
+    }
+    return vk::Format::eUndefined;
+}
+
+ui64 _hashSamplerInfo(const vk::SamplerCreateInfo& samplerInfo)
+{
+    ui64 hash = 14695981039346656037ull;
+    auto combine = [&hash](ui64 value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    combine(static_cast<ui64>(samplerInfo.magFilter));
+    combine(static_cast<ui64>(samplerInfo.minFilter));
+    combine(static_cast<ui64>(samplerInfo.mipmapMode));
+    combine(static_cast<ui64>(samplerInfo.addressModeU));
+    combine(static_cast<ui64>(samplerInfo.addressModeV));
+    combine(static_cast<ui64>(samplerInfo.addressModeW));
+    combine(static_cast<ui64>(samplerInfo.anisotropyEnable));
+    combine(static_cast<ui64>(samplerInfo.maxAnisotropy * 16.0f));
+    combine(static_cast<ui64>(samplerInfo.compareEnable));
+    combine(static_cast<ui64>(samplerInfo.compareOp));
+    combine(static_cast<ui64>(samplerInfo.borderColor));
+
+    return hash;
+}
+
+void _recordImageBarrier(vk::CommandBuffer commandBuffer, vk::Image image,
+                         ui32 baseMipLevel, ui32 levelCount,
+                         vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                         vk::PipelineStageFlags srcStages, vk::AccessFlags srcAccess,
+                         vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess)
+{
+    vk::ImageMemoryBarrier barrier{ .srcAccessMask = srcAccess,
+                                    .dstAccessMask = dstAccess,
+                                    .oldLayout = oldLayout,
+                                    .newLayout = newLayout,
+                                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                    .image = image,
+                                    .subresourceRange = { .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                          .baseMipLevel = baseMipLevel,
+                                                          .levelCount = levelCount,
+                                                          .baseArrayLayer = 0,
+                                                          .layerCount = 1 } };
+
+    commandBuffer.pipelineBarrier(srcStages, dstStages, vk::DependencyFlags(), nullptr, nullptr, barrier);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "core.hpp"
+#include "DeviceAllocator.hpp"
+#include "UploadBatch.hpp"
+#include "TextureContainer.hpp"
+#include "JobSystem.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+
+namespace vulkan
+{
+
+using TextureHandle = ui32;
+constexpr TextureHandle kInvalidTexture = ~0u;
+
+struct TextureDesc
+{
+    ui32 width;
+    ui32 height;
+    vk::Format format;
+    bool generateMips;
+};
+
+struct Texture
+{
+    vk::Image image;
+    vk::ImageView view;
+    Allocation allocation;
+    vk::Format format;
+    vk::Extent2D extent;
+    ui32 mipLevels;
+};
+
+
+// NOTE: Samplers are immutable and there are only a handful of distinct ones, so everyone shares them
+class SamplerCache
+{
+public:
+    void Init(const vk::Device& device, const vk::AllocationCallbacks* allocationCallbacks);
+    void Shutdown();
+
+    vk::Sampler Get(const vk::SamplerCreateInfo& samplerInfo);
+    ui32 GetSamplerCount() const;
+
+private:
+    struct Entry
+    {
+        ui64 hash;
+        vk::SamplerCreateInfo info;
+        vk::Sampler sampler;
+    };
+
+    vk::Device m_device;
+    const vk::AllocationCallbacks* m_allocationCallbacks;
+    std::vector<Entry> m_entries;
+};
+
+
+class TextureManager
+{
+public:
+    TextureManager() = default;
+
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    // NOTE: 'enabledFeatures' tells which block-compressed formats the device was created with,
+    //  'jobSystem' runs the CPU transcoding
+    void Init(const vk::PhysicalDevice& physicalDevice, const vk::Device& device, DeviceAllocator& allocator,
+              const vk::PhysicalDeviceFeatures& enabledFeatures, JobSystem& jobSystem,
+              const vk::AllocationCallbacks* allocationCallbacks);
+    void Shutdown();
+
+    // NOTE: 'pixels' is the top mip level, tightly packed. The upload and mip generation are recorded into 'batch',
+    //  the texture can be sampled once the batch is submitted.
+    TextureHandle CreateTexture(UploadBatch& batch, const TextureDesc& desc, const void* pixels);
+    // NOTE: Uploads the first payload the device can sample. When there is none, the RGBA8 payload is transcoded
+    //  to BC7/BC3 on the CPU if the device supports those, and uploaded as is otherwise.
+    TextureHandle CreateTexture(UploadBatch& batch, const TextureContainer& container);
+    void DestroyTexture(TextureHandle handle);
+
+    const Texture& GetTexture(TextureHandle handle) const;
+    SamplerCache& GetSamplerCache();
+    const SamplerCache& GetSamplerCache() const;
+    // NOTE: Live textures, empty slots aren't counted
+    ui32 GetTextureCount() const;
+
+    // NOTE: Replaces the biggest mipmapped textures in heap 'heapIndex' with copies that start at their second level,
+    //  until about 'bytes' are freed. Submits 'batch' itself and waits for it, the textures mustn't be in use by the GPU.
+    //  Their image views change, descriptor sets have to be written again. Returns the bytes freed.
+    vk::DeviceSize DropTopMips(UploadBatch& batch, ui32 heapIndex, vk::DeviceSize bytes);
+    // NOTE: Levels dropped by DropTopMips() since Init()
+    ui32 GetDroppedMipCount() const;
+
+private:
+    Texture _CreateImage(vk::Format format, ui32 width, ui32 height, ui32 mipLevels, vk::ImageUsageFlags usage);
+    TextureHandle _AddTexture(const Texture& texture);
+
+    bool _IsFormatSampleable(vk::Format format) const;
+    bool _CanBlitMips(vk::Format format) const;
+    void _GenerateMipsGpu(vk::CommandBuffer commandBuffer, const Texture& texture) const;
+    void _UploadMipsCpu(UploadBatch& batch, const Texture& texture, const void* pixels) const;
+    // NOTE: Stages 'data' once and copies every level out of it, the texture ends up in ShaderReadOnlyOptimal
+    void _UploadLevels(UploadBatch& batch, const Texture& texture, const ui8* data, ui64 size,
+                       const std::vector<ContainerLevel>& levels) const;
+
+private:
+    vk::PhysicalDevice      m_physicalDevice;
+    vk::Device              m_device;
+    const vk::AllocationCallbacks* m_allocationCallbacks;
+    DeviceAllocator*        m_allocator;
+    JobSystem*              m_jobSystem;
+    bool                    m_isBCEnabled;
+    bool                    m_isASTCEnabled;
+
+    SamplerCache            m_samplerCache;
+    // NOTE: Destroyed textures leave an empty slot that is reused
+    std::vector<Texture>    m_textures;
+    ui32                    m_droppedMipCount;
+};
+
+}
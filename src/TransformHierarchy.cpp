@@ -0,0 +1,495 @@
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring> // std::memcpy
+
+#if LV_ARCH_X86
+    #include <immintrin.h>
+#elif LV_ARCH_ARM64
+    #include <arm_neon.h>
+#endif
+
+
+// NOTE: Below this many nodes in a level the threads cost more than the matrices
+constexpr ui32 kParallelUpdateThreshold = 16 * 1024;
+// NOTE: Nodes are processed in batches: compose the locals, multiply the whole batch with one kernel call,
+//  then upload the batch while it's still in cache
+constexpr ui32 kBatchSize = 64;
+constexpr ui32 kMatrixSize = 16;
+
+// NOTE: out[i] = lhs[i] * rhs[i], rhs is 'count' matrices back to back
+using MultiplyBatchKernel = void (*)(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out);
+
+
+auto _composeTRS(const f32* translation, const f32* rotation, const f32* scale, f32* out)              -> void;
+template<typename T>
+auto _permute(std::vector<T>& values, const std::vector<ui32>& order, ui32 stride)                     -> void;
+auto _getMultiplyBatchKernel(SimdLevel simdLevel)                                                       -> MultiplyBatchKernel;
+
+auto _multiplyBatchScalar(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)          -> void;
+#if LV_ARCH_X86
+auto _multiplyBatchSSE2(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)            -> void;
+LV_TARGET_AVX2
+auto _multiplyBatchAVX2(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)            -> void;
+#elif LV_ARCH_ARM64
+auto _multiplyBatchNEON(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)            -> void;
+#endif
+
+
+void TransformHierarchy::Reserve(ui32 count)
+{
+    m_translationX.reserve(count);
+    m_translationY.reserve(count);
+    m_translationZ.reserve(count);
+    m_rotationX.reserve(count);
+    m_rotationY.reserve(count);
+    m_rotationZ.reserve(count);
+    m_rotationW.reserve(count);
+    m_scaleX.reserve(count);
+    m_scaleY.reserve(count);
+    m_scaleZ.reserve(count);
+    m_parents.reserve(count);
+    m_depths.reserve(count);
+    m_isLocalDirty.reserve(count);
+    m_isWorldChanged.reserve(count);
+    m_changedVersions.reserve(count);
+    m_worldMatrices.reserve(static_cast<size_t>(count) * kMatrixSize);
+    m_indexToId.reserve(count);
+    m_idToIndex.reserve(count);
+}
+
+TransformId TransformHierarchy::Create(TransformId parent)
+{
+    constexpr f32 kIdentity[kMatrixSize] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                             0.0f, 1.0f, 0.0f, 0.0f,
+                                             0.0f, 0.0f, 1.0f, 0.0f,
+                                             0.0f, 0.0f, 0.0f, 1.0f };
+
+    const auto id = static_cast<TransformId>(m_idToIndex.size());
+    const auto index = static_cast<ui32>(m_indexToId.size());
+    const ui32 parentIndex = parent == kInvalidTransform ? kInvalidTransform : m_idToIndex[parent];
+
+    m_translationX.push_back(0.0f);
+    m_translationY.push_back(0.0f);
+    m_translationZ.push_back(0.0f);
+    m_rotationX.push_back(0.0f);
+    m_rotationY.push_back(0.0f);
+    m_rotationZ.push_back(0.0f);
+    m_rotationW.push_back(1.0f);
+    m_scaleX.push_back(1.0f);
+    m_scaleY.push_back(1.0f);
+    m_scaleZ.push_back(1.0f);
+    m_parents.push_back(parentIndex);
+    m_depths.push_back(parentIndex == kInvalidTransform ? 0 : m_depths[parentIndex] + 1);
+    m_isLocalDirty.push_back(1);
+    m_isWorldChanged.push_back(0);
+    m_changedVersions.push_back(0);
+    m_worldMatrices.insert(m_worldMatrices.end(), std::begin(kIdentity), std::end(kIdentity));
+    m_indexToId.push_back(id);
+    m_idToIndex.push_back(index);
+
+    m_isLayoutDirty = true;
+
+    return id;
+}
+
+void TransformHierarchy::SetLocal(TransformId id, const f32* translation, const f32* rotation, const f32* scale)
+{
+    SetTranslation(id, translation);
+    SetRotation(id, rotation);
+    SetScale(id, scale);
+}
+
+void TransformHierarchy::SetTranslation(TransformId id, const f32* translation)
+{
+    const ui32 index = m_idToIndex[id];
+
+    m_translationX[index] = translation[0];
+    m_translationY[index] = translation[1];
+    m_translationZ[index] = translation[2];
+    m_isLocalDirty[index] = 1;
+}
+
+void TransformHierarchy::SetRotation(TransformId id, const f32* rotation)
+{
+    const ui32 index = m_idToIndex[id];
+
+    m_rotationX[index] = rotation[0];
+    m_rotationY[index] = rotation[1];
+    m_rotationZ[index] = rotation[2];
+    m_rotationW[index] = rotation[3];
+    m_isLocalDirty[index] = 1;
+}
+
+void TransformHierarchy::SetScale(TransformId id, const f32* scale)
+{
+    const ui32 index = m_idToIndex[id];
+
+    m_scaleX[index] = scale[0];
+    m_scaleY[index] = scale[1];
+    m_scaleZ[index] = scale[2];
+    m_isLocalDirty[index] = 1;
+}
+
+const f32* TransformHierarchy::GetWorldMatrix(TransformId id) const
+{
+    return &m_worldMatrices[static_cast<size_t>(m_idToIndex[id]) * kMatrixSize];
+}
+
+ui32 TransformHierarchy::GetCount() const
+{
+    return static_cast<ui32>(m_indexToId.size());
+}
+
+void TransformHierarchy::SetSimdLevel(SimdLevel simdLevel)
+{
+    m_simdLevel = IsSimdLevelSupported(simdLevel) ? simdLevel : SimdLevel::Scalar;
+}
+
+SimdLevel TransformHierarchy::GetSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+void TransformHierarchy::Update(TransformUploadTarget* target, ui32 threadCount, const ParallelFor& parallelFor)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    if (m_isLayoutDirty) {
+        _RebuildLevels();
+    }
+
+    // NOTE: Versions start at 1, a target with version 0 has never been written and gets everything
+    ++m_version;
+
+    ui32 updatedCount = 0;
+    ui32 uploadedCount = 0;
+
+    for (size_t level = 0; level + 1 < m_levelOffsets.size(); ++level) {
+        const ui32 first = m_levelOffsets[level];
+        const ui32 last = m_levelOffsets[level + 1];
+        const ui32 count = last - first;
+
+        const ui32 chunkCount = (threadCount > 1 && count >= kParallelUpdateThreshold) ? threadCount : 1;
+        if (chunkCount == 1) {
+            _UpdateRange(first, last, target, updatedCount, uploadedCount);
+            continue;
+        }
+
+        const ui32 chunkSize = ((count + chunkCount - 1) / chunkCount + kBatchSize - 1) / kBatchSize * kBatchSize;
+        m_chunkCounts.assign(chunkCount * 2, 0);
+
+        auto updateChunk = [&](ui32 chunk) {
+            const ui32 chunkFirst = std::min(first + chunk * chunkSize, last);
+            const ui32 chunkLast = std::min(chunkFirst + chunkSize, last);
+            _UpdateRange(chunkFirst, chunkLast, target, m_chunkCounts[chunk * 2], m_chunkCounts[chunk * 2 + 1]);
+        };
+
+        if (parallelFor) {
+            parallelFor(chunkCount, updateChunk);
+        } else {
+            for (ui32 chunk = 0; chunk < chunkCount; ++chunk) {
+                updateChunk(chunk);
+            }
+        }
+
+        for (ui32 chunk = 0; chunk < chunkCount; ++chunk) {
+            updatedCount += m_chunkCounts[chunk * 2];
+            uploadedCount += m_chunkCounts[chunk * 2 + 1];
+        }
+    }
+
+    if (target != nullptr) {
+        target->version = m_version;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    m_stats = TransformStats{ .transformCount = GetCount(),
+                              .updatedCount = updatedCount,
+                              .uploadedCount = uploadedCount,
+                              .updateMilliseconds = std::chrono::duration<f32, std::milli>(end - start).count() };
+}
+
+const TransformStats& TransformHierarchy::GetStats() const
+{
+    return m_stats;
+}
+
+
+void TransformHierarchy::_RebuildLevels()
+{
+    m_isLayoutDirty = false;
+
+    const ui32 count = GetCount();
+    const ui32 levelCount = count == 0 ? 0 : *std::max_element(m_depths.begin(), m_depths.end()) + 1;
+
+    // NOTE: Counting sort by depth, stable, so nodes keep their relative order inside a level
+    m_levelOffsets.assign(levelCount + 1, 0);
+    for (const ui32 depth : m_depths) {
+        ++m_levelOffsets[depth + 1];
+    }
+    for (ui32 level = 0; level < levelCount; ++level) {
+        m_levelOffsets[level + 1] += m_levelOffsets[level];
+    }
+
+    if (std::is_sorted(m_depths.begin(), m_depths.end())) {
+        return;
+    }
+
+    // NOTE: order[newIndex] = oldIndex
+    std::vector<ui32> order(count);
+    std::vector<ui32> nextIndex(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+    std::vector<ui32> oldToNew(count);
+    for (ui32 oldIndex = 0; oldIndex < count; ++oldIndex) {
+        const ui32 newIndex = nextIndex[m_depths[oldIndex]]++;
+        order[newIndex] = oldIndex;
+        oldToNew[oldIndex] = newIndex;
+    }
+
+    _permute(m_translationX, order, 1);
+    _permute(m_translationY, order, 1);
+    _permute(m_translationZ, order, 1);
+    _permute(m_rotationX, order, 1);
+    _permute(m_rotationY, order, 1);
+    _permute(m_rotationZ, order, 1);
+    _permute(m_rotationW, order, 1);
+    _permute(m_scaleX, order, 1);
+    _permute(m_scaleY, order, 1);
+    _permute(m_scaleZ, order, 1);
+    _permute(m_parents, order, 1);
+    _permute(m_depths, order, 1);
+    _permute(m_isLocalDirty, order, 1);
+    _permute(m_isWorldChanged, order, 1);
+    _permute(m_changedVersions, order, 1);
+    _permute(m_worldMatrices, order, kMatrixSize);
+    _permute(m_indexToId, order, 1);
+
+    for (ui32 index = 0; index < count; ++index) {
+        if (m_parents[index] != kInvalidTransform) {
+            m_parents[index] = oldToNew[m_parents[index]];
+        }
+        m_idToIndex[m_indexToId[index]] = index;
+    }
+}
+
+// NOTE: A node is recomputed when its own TRS changed or its parent was recomputed in this update,
+//  the parent is one level up and was finished before this level started
+void TransformHierarchy::_UpdateRange(ui32 first, ui32 last, TransformUploadTarget* target, ui32& updatedCount, ui32& uploadedCount)
+{
+    const MultiplyBatchKernel multiplyBatch = _getMultiplyBatchKernel(m_simdLevel);
+
+    alignas(32) f32 locals[kBatchSize * kMatrixSize];
+    const f32* parentMatrices[kBatchSize];
+    f32* worldMatrices[kBatchSize];
+
+    for (ui32 batchFirst = first; batchFirst < last; batchFirst += kBatchSize) {
+        const ui32 batchLast = std::min(batchFirst + kBatchSize, last);
+        ui32 batchCount = 0;
+
+        for (ui32 i = batchFirst; i < batchLast; ++i) {
+            const ui32 parent = m_parents[i];
+            const bool isDirty = m_isLocalDirty[i] != 0 || (parent != kInvalidTransform && m_isWorldChanged[parent] != 0);
+
+            m_isWorldChanged[i] = isDirty ? 1 : 0;
+            if (isDirty == false) {
+                continue;
+            }
+
+            m_isLocalDirty[i] = 0;
+            m_changedVersions[i] = m_version;
+            ++updatedCount;
+
+            const f32 translation[3] = { m_translationX[i], m_translationY[i], m_translationZ[i] };
+            const f32 rotation[4] = { m_rotationX[i], m_rotationY[i], m_rotationZ[i], m_rotationW[i] };
+            const f32 scale[3] = { m_scaleX[i], m_scaleY[i], m_scaleZ[i] };
+            f32* world = &m_worldMatrices[static_cast<size_t>(i) * kMatrixSize];
+
+            // NOTE: Roots have nothing to multiply with
+            if (parent == kInvalidTransform) {
+                _composeTRS(translation, rotation, scale, world);
+                continue;
+            }
+
+            _composeTRS(translation, rotation, scale, &locals[batchCount * kMatrixSize]);
+            parentMatrices[batchCount] = &m_worldMatrices[static_cast<size_t>(parent) * kMatrixSize];
+            worldMatrices[batchCount] = world;
+            ++batchCount;
+        }
+
+        if (batchCount > 0) {
+            multiplyBatch(batchCount, parentMatrices, locals, worldMatrices);
+        }
+
+        if (target == nullptr) {
+            continue;
+        }
+
+        for (ui32 i = batchFirst; i < batchLast; ++i) {
+            if (m_changedVersions[i] > target->version) {
+                std::memcpy(target->worldMatrices + static_cast<size_t>(m_indexToId[i]) * kMatrixSize,
+                            &m_worldMatrices[static_cast<size_t>(i) * kMatrixSize], kMatrixSize * sizeof(f32));
+                ++uploadedCount;
+            }
+        }
+    }
+}
+
+
+void MultiplyMatrices(const f32* a, const f32* b, f32* out, SimdLevel simdLevel)
+{
+    _getMultiplyBatchKernel(simdLevel)(1, &a, b, &out);
+}
+
+
+
+
+// NOTE: Same result as glm::translate(t) * glm::mat4_cast(r) * glm::scale(s), 'rotation' has to be normalized
+void _composeTRS(const f32* translation, const f32* rotation, const f32* scale, f32* out)
+{
+    const f32 x = rotation[0];
+    const f32 y = rotation[1];
+    const f32 z = rotation[2];
+    const f32 w = rotation[3];
+
+    const f32 xx = x * x, yy = y * y, zz = z * z;
+    const f32 xy = x * y, xz = x * z, yz = y * z;
+    const f32 wx = w * x, wy = w * y, wz = w * z;
+
+    out[0]  = (1.0f - 2.0f * (yy + zz)) * scale[0];
+    out[1]  = 2.0f * (xy + wz) * scale[0];
+    out[2]  = 2.0f * (xz - wy) * scale[0];
+    out[3]  = 0.0f;
+
+    out[4]  = 2.0f * (xy - wz) * scale[1];
+    out[5]  = (1.0f - 2.0f * (xx + zz)) * scale[1];
+    out[6]  = 2.0f * (yz + wx) * scale[1];
+    out[7]  = 0.0f;
+
+    out[8]  = 2.0f * (xz + wy) * scale[2];
+    out[9]  = 2.0f * (yz - wx) * scale[2];
+    out[10] = (1.0f - 2.0f * (xx + yy)) * scale[2];
+    out[11] = 0.0f;
+
+    out[12] = translation[0];
+    out[13] = translation[1];
+    out[14] = translation[2];
+    out[15] = 1.0f;
+}
+
+template<typename T>
+void _permute(std::vector<T>& values, const std::vector<ui32>& order, ui32 stride)
+{
+    std::vector<T> permuted(values.size());
+
+    for (size_t newIndex = 0; newIndex < order.size(); ++newIndex) {
+        std::copy_n(values.begin() + static_cast<size_t>(order[newIndex]) * stride, stride,
+                    permuted.begin() + newIndex * stride);
+    }
+
+    values = std::move(permuted);
+}
+
+MultiplyBatchKernel _getMultiplyBatchKernel(SimdLevel simdLevel)
+{
+    switch (simdLevel) {
+#if LV_ARCH_X86
+    case SimdLevel::SSE2: return _multiplyBatchSSE2;
+    case SimdLevel::AVX2: return _multiplyBatchAVX2;
+#elif LV_ARCH_ARM64
+    case SimdLevel::NEON: return _multiplyBatchNEON;
+#endif
+    default: return _multiplyBatchScalar;
+    }
+}
+
+// NOTE: Every kernel computes column j of the result as ((a0 * b[j][0] + a1 * b[j][1]) + a2 * b[j][2]) + a3 * b[j][3],
+//  where aK are the columns of the left matrix, no FMA, so the levels agree to the bit
+void _multiplyBatchScalar(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)
+{
+    for (ui32 m = 0; m < count; ++m) {
+        const f32* a = lhs[m];
+        const f32* b = rhs + m * kMatrixSize;
+        f32* result = out[m];
+
+        for (ui32 column = 0; column < 4; ++column) {
+            for (ui32 row = 0; row < 4; ++row) {
+                result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+                                         + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+            }
+        }
+    }
+}
+
+#if LV_ARCH_X86
+void _multiplyBatchSSE2(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)
+{
+    for (ui32 m = 0; m < count; ++m) {
+        const f32* a = lhs[m];
+        const f32* b = rhs + m * kMatrixSize;
+
+        const __m128 a0 = _mm_loadu_ps(a);
+        const __m128 a1 = _mm_loadu_ps(a + 4);
+        const __m128 a2 = _mm_loadu_ps(a + 8);
+        const __m128 a3 = _mm_loadu_ps(a + 12);
+
+        for (ui32 column = 0; column < 4; ++column) {
+            const __m128 b0 = _mm_set1_ps(b[column * 4]);
+            const __m128 b1 = _mm_set1_ps(b[column * 4 + 1]);
+            const __m128 b2 = _mm_set1_ps(b[column * 4 + 2]);
+            const __m128 b3 = _mm_set1_ps(b[column * 4 + 3]);
+
+            __m128 result = _mm_add_ps(_mm_mul_ps(a0, b0), _mm_mul_ps(a1, b1));
+            result = _mm_add_ps(_mm_add_ps(result, _mm_mul_ps(a2, b2)), _mm_mul_ps(a3, b3));
+            _mm_storeu_ps(out[m] + column * 4, result);
+        }
+    }
+}
+
+// NOTE: Two result columns per register, the left columns are duplicated into both halves
+//  and the in-lane shuffle broadcasts b[j][k] and b[j + 1][k] into their halves
+LV_TARGET_AVX2
+void _multiplyBatchAVX2(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)
+{
+    for (ui32 m = 0; m < count; ++m) {
+        const f32* a = lhs[m];
+        const f32* b = rhs + m * kMatrixSize;
+
+        const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+        const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+        const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+        const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+        for (ui32 column = 0; column < 4; column += 2) {
+            const __m256 columns = _mm256_loadu_ps(b + column * 4);
+            const __m256 b0 = _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m256 b1 = _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m256 b2 = _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(2, 2, 2, 2));
+            const __m256 b3 = _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(3, 3, 3, 3));
+
+            __m256 result = _mm256_add_ps(_mm256_mul_ps(a0, b0), _mm256_mul_ps(a1, b1));
+            result = _mm256_add_ps(_mm256_add_ps(result, _mm256_mul_ps(a2, b2)), _mm256_mul_ps(a3, b3));
+            _mm256_storeu_ps(out[m] + column * 4, result);
+        }
+    }
+}
+#elif LV_ARCH_ARM64
+void _multiplyBatchNEON(ui32 count, const f32* const* lhs, const f32* rhs, f32* const* out)
+{
+    for (ui32 m = 0; m < count; ++m) {
+        const f32* a = lhs[m];
+        const f32* b = rhs + m * kMatrixSize;
+
+        const float32x4_t a0 = vld1q_f32(a);
+        const float32x4_t a1 = vld1q_f32(a + 4);
+        const float32x4_t a2 = vld1q_f32(a + 8);
+        const float32x4_t a3 = vld1q_f32(a + 12);
+
+        for (ui32 column = 0; column < 4; ++column) {
+            float32x4_t result = vaddq_f32(vmulq_n_f32(a0, b[column * 4]), vmulq_n_f32(a1, b[column * 4 + 1]));
+            result = vaddq_f32(vaddq_f32(result, vmulq_n_f32(a2, b[column * 4 + 2])), vmulq_n_f32(a3, b[column * 4 + 3]));
+            vst1q_f32(out[m] + column * 4, result);
+        }
+    }
+}
+#endif
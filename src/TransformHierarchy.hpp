@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core.hpp"
+#include "CpuFeatures.hpp"
+#include "JobSystem.hpp"
+
+#include <functional>
+#include <vector>
+
+
+using TransformId = ui32;
+constexpr TransformId kInvalidTransform = ~0u;
+
+// NOTE: Where Update() copies world matrices to, usually a persistently mapped buffer of one frame in flight.
+//  Matrices are indexed by TransformId. 'version' remembers which update the buffer last got,
+//  so every buffer receives every change even if the buffers aren't used in a fixed order.
+struct TransformUploadTarget
+{
+    f32* worldMatrices;
+    ui32 version;
+};
+
+struct TransformStats
+{
+    ui32 transformCount;
+    // NOTE: World matrices recomputed, i.e. dirty nodes and their subtrees
+    ui32 updatedCount;
+    // NOTE: World matrices written to the upload target
+    ui32 uploadedCount;
+    f32 updateMilliseconds;
+};
+
+
+// NOTE: Local TRS and world matrices of every node, structure-of-arrays sorted by depth in the hierarchy,
+//  so each level only reads parents that are already done and can be split across threads.
+//  Matrices are column-major 4x4 (glm layout), rotations are quaternions (x, y, z, w).
+class TransformHierarchy
+{
+public:
+    using ParallelFor = ::ParallelFor;
+
+    TransformHierarchy() = default;
+
+    void Reserve(ui32 count);
+    // NOTE: Parent has to exist already, the node starts as identity and dirty
+    TransformId Create(TransformId parent = kInvalidTransform);
+
+    void SetLocal(TransformId id, const f32* translation, const f32* rotation, const f32* scale);
+    void SetTranslation(TransformId id, const f32* translation);
+    void SetRotation(TransformId id, const f32* rotation);
+    void SetScale(TransformId id, const f32* scale);
+
+    // NOTE: Valid after Update()
+    const f32* GetWorldMatrix(TransformId id) const;
+    ui32 GetCount() const;
+
+    void SetSimdLevel(SimdLevel simdLevel);
+    SimdLevel GetSimdLevel() const;
+
+    // NOTE: Recomputes world matrices of dirty nodes and everything below them, level by level,
+    //  and copies every matrix the target hasn't seen yet. Big levels are split into chunks that run
+    //  through 'parallelFor' (one after another without it), the result doesn't depend on threadCount.
+    void Update(TransformUploadTarget* target = nullptr, ui32 threadCount = 1, const ParallelFor& parallelFor = nullptr);
+
+    const TransformStats& GetStats() const;
+
+private:
+    // NOTE: Called by Update() after nodes were created, nodes are only moved when a level got out of order
+    void _RebuildLevels();
+    void _UpdateRange(ui32 first, ui32 last, TransformUploadTarget* target, ui32& updatedCount, ui32& uploadedCount);
+
+private:
+    // NOTE: Everything below is in depth order, except m_idToIndex which maps stable ids into it
+    std::vector<f32> m_translationX;
+    std::vector<f32> m_translationY;
+    std::vector<f32> m_translationZ;
+    std::vector<f32> m_rotationX;
+    std::vector<f32> m_rotationY;
+    std::vector<f32> m_rotationZ;
+    std::vector<f32> m_rotationW;
+    std::vector<f32> m_scaleX;
+    std::vector<f32> m_scaleY;
+    std::vector<f32> m_scaleZ;
+    // NOTE: Index of the parent in this order, kInvalidTransform for roots
+    std::vector<ui32> m_parents;
+    std::vector<ui32> m_depths;
+    std::vector<ui8> m_isLocalDirty;
+    // NOTE: Set for nodes recomputed by the current Update(), children read it to see if they must follow
+    std::vector<ui8> m_isWorldChanged;
+    std::vector<ui32> m_changedVersions;
+    // NOTE: 16 floats per node
+    std::vector<f32> m_worldMatrices;
+    std::vector<TransformId> m_indexToId;
+    std::vector<ui32> m_idToIndex;
+
+    // NOTE: [m_levelOffsets[d], m_levelOffsets[d + 1]) are the nodes at depth d
+    std::vector<ui32> m_levelOffsets;
+    bool m_isLayoutDirty = false;
+    ui32 m_version = 0;
+
+    SimdLevel m_simdLevel = GetBestSimdLevel();
+    std::vector<ui32> m_chunkCounts;
+
+    TransformStats m_stats{};
+};
+
+
+// NOTE: out = a * b for column-major 4x4 matrices, 'out' must not alias the inputs.
+//  Exposed for the benchmark, every level gives bit-identical results.
+void MultiplyMatrices(const f32* a, const f32* b, f32* out, SimdLevel simdLevel);
@@ -0,0 +1,167 @@
+#include "UploadBatch.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <cstring> // std::memcpy
+#include <limits>
+
+
+constexpr vk::DeviceSize kStagingBlockSize = 16 * 1024 * 1024;
+
+
+namespace vulkan
+{
+
+void UploadBatch::Init(const vk::Device& device, DeviceAllocator& allocator, const vk::CommandPool& commandPool, const vk::Queue& queue,
+                       const vk::AllocationCallbacks* allocationCallbacks)
+{
+    m_device = device;
+    m_allocationCallbacks = allocationCallbacks;
+    m_allocator = &allocator;
+    m_commandPool = commandPool;
+    m_queue = queue;
+    m_isRecording = false;
+    m_uploadCount = 0;
+
+    vk::CommandBufferAllocateInfo allocateInfo{ .commandPool = commandPool,
+                                                .level = vk::CommandBufferLevel::ePrimary,
+                                                .commandBufferCount = 1 };
+    m_device.allocateCommandBuffers(&allocateInfo, &m_commandBuffer);
+
+    m_fence = m_device.createFence(vk::FenceCreateInfo{}, m_allocationCallbacks);
+}
+
+void UploadBatch::Shutdown()
+{
+    for (const auto& [buffer, allocation] : m_releasedBuffers) {
+        m_allocator->DestroyBuffer(buffer, allocation);
+    }
+    m_releasedBuffers.clear();
+
+    for (const auto& block : m_stagingBlocks) {
+        m_allocator->DestroyBuffer(block.buffer, block.allocation);
+    }
+    m_stagingBlocks.clear();
+
+    m_device.destroyFence(m_fence, m_allocationCallbacks);
+    m_device.freeCommandBuffers(m_commandPool, 1, &m_commandBuffer);
+}
+
+void UploadBatch::Begin()
+{
+    if (m_isRecording) {
+        throw std::runtime_error("UploadBatch::Begin(): batch is already recording!");
+    }
+
+    vk::CommandBufferBeginInfo beginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit };
+    m_commandBuffer.begin(beginInfo);
+
+    m_isRecording = true;
+    m_uploadCount = 0;
+}
+
+StagingRegion UploadBatch::Stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    StagingBlock* target = nullptr;
+    vk::DeviceSize offset = 0;
+
+    for (auto& block : m_stagingBlocks) {
+        offset = (block.used + alignment - 1) / alignment * alignment;
+        if (offset + size <= block.size) {
+            target = &block;
+            break;
+        }
+    }
+
+    if (target == nullptr) {
+        constexpr auto stagingProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        const auto blockSize = std::max(kStagingBlockSize, size);
+
+        StagingBlock block{ .size = blockSize, .used = 0 };
+        block.buffer = m_allocator->CreateBuffer(blockSize, vk::BufferUsageFlagBits::eTransferSrc, stagingProperties,
+                                                 MemoryCategory::Staging, block.allocation);
+        m_stagingBlocks.push_back(block);
+
+        target = &m_stagingBlocks.back();
+        offset = 0;
+    }
+
+    std::memcpy(target->allocation.mapped + offset, data, size);
+    target->used = offset + size;
+    ++m_uploadCount;
+
+    return StagingRegion{ .buffer = target->buffer,
+                          .offset = offset,
+                          .mapped = target->allocation.mapped + offset };
+}
+
+void UploadBatch::CopyToBuffer(const void* data, vk::DeviceSize size, vk::Buffer destination, vk::DeviceSize destinationOffset)
+{
+    const auto region = Stage(data, size);
+
+    vk::BufferCopy copyRegion{ .srcOffset = region.offset,
+                               .dstOffset = destinationOffset,
+                               .size = size };
+    m_commandBuffer.copyBuffer(region.buffer, destination, 1, &copyRegion);
+}
+
+vk::CommandBuffer UploadBatch::GetCommandBuffer() const
+{
+    return m_commandBuffer;
+}
+
+void UploadBatch::Submit()
+{
+    if (m_isRecording == false) {
+        throw std::runtime_error("UploadBatch::Submit(): nothing was recorded!");
+    }
+
+    m_commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{ .commandBufferCount = 1,
+                               .pCommandBuffers = &m_commandBuffer };
+
+    m_queue.submit(1, &submitInfo, m_fence);
+    m_device.waitForFences(1, &m_fence, VK_TRUE, std::numeric_limits<ui64>::max());
+    m_device.resetFences(1, &m_fence);
+
+    for (auto& block : m_stagingBlocks) {
+        block.used = 0;
+    }
+    for (const auto& [buffer, allocation] : m_releasedBuffers) {
+        m_allocator->DestroyBuffer(buffer, allocation);
+    }
+    m_releasedBuffers.clear();
+    m_isRecording = false;
+}
+
+void UploadBatch::ReleaseAfterSubmit(vk::Buffer buffer, const Allocation& allocation)
+{
+    m_releasedBuffers.emplace_back(buffer, allocation);
+}
+
+ui32 UploadBatch::GetUploadCount() const
+{
+    return m_uploadCount;
+}
+
+vk::DeviceSize UploadBatch::ReleaseStaging(ui32 heapIndex)
+{
+    if (m_isRecording) {
+        return 0;
+    }
+
+    vk::DeviceSize freed = 0;
+    std::erase_if(m_stagingBlocks, [&](const StagingBlock& block) {
+        if (m_allocator->GetHeapIndex(block.allocation) != heapIndex) {
+            return false;
+        }
+        freed += block.allocation.size;
+        m_allocator->DestroyBuffer(block.buffer, block.allocation);
+        return true;
+    });
+
+    return freed;
+}
+
+}
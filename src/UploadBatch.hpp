@@ -0,0 +1,80 @@
+#pragma once
+
+#include "core.hpp"
+#include "DeviceAllocator.hpp"
+
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
+#include <vulkan/vulkan.hpp>
+
+#include <utility> // std::pair
+#include <vector>
+
+
+namespace vulkan
+{
+
+struct StagingRegion
+{
+    vk::Buffer buffer;
+    vk::DeviceSize offset;
+    ui8* mapped;
+};
+
+
+// NOTE: Collects any number of uploads into one command buffer and submits them with a single fence wait.
+//  Staging memory is kept between batches, so loading many resources doesn't create/destroy a staging buffer each.
+class UploadBatch
+{
+public:
+    UploadBatch() = default;
+
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+    void Init(const vk::Device& device, DeviceAllocator& allocator, const vk::CommandPool& commandPool, const vk::Queue& queue,
+              const vk::AllocationCallbacks* allocationCallbacks);
+    void Shutdown();
+
+    void Begin();
+    // NOTE: Copies 'data' into staging memory, the returned region is valid until Submit() returns
+    StagingRegion Stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment = 16);
+    void CopyToBuffer(const void* data, vk::DeviceSize size, vk::Buffer destination, vk::DeviceSize destinationOffset = 0);
+    // NOTE: For uploads that need more than a plain copy (images, mip generation)
+    vk::CommandBuffer GetCommandBuffer() const;
+    // NOTE: Blocks until everything recorded since Begin() is done on the GPU
+    void Submit();
+    // NOTE: For buffers the recorded commands still read from, destroyed by the next Submit() once the GPU is done
+    void ReleaseAfterSubmit(vk::Buffer buffer, const Allocation& allocation);
+
+    ui32 GetUploadCount() const;
+
+    // NOTE: Gives the staging blocks in heap 'heapIndex' back to the allocator, the next Stage() creates new ones.
+    //  Does nothing while recording. Returns the bytes freed.
+    vk::DeviceSize ReleaseStaging(ui32 heapIndex);
+
+private:
+    struct StagingBlock
+    {
+        vk::Buffer buffer;
+        Allocation allocation;
+        vk::DeviceSize size;
+        vk::DeviceSize used;
+    };
+
+private:
+    vk::Device                  m_device;
+    const vk::AllocationCallbacks* m_allocationCallbacks;
+    DeviceAllocator*            m_allocator;
+    vk::CommandPool             m_commandPool;
+    vk::Queue                   m_queue;
+
+    vk::CommandBuffer           m_commandBuffer;
+    vk::Fence                   m_fence;
+    bool                        m_isRecording;
+    ui32                        m_uploadCount;
+
+    std::vector<StagingBlock>   m_stagingBlocks;
+    std::vector<std::pair<vk::Buffer, Allocation>> m_releasedBuffers;
+};
+
+}
@@ -9,25 +9,100 @@
 #include <limits>
 #include <unordered_set>
 #include <vector>
+#include <memory_resource>
 #include <array>
 #include <filesystem>
 #include <fstream>
 #include <chrono>
+#include <cmath>
+#include <bit> // std::bit_cast
 
-#define GLM_FORCE_RADIANS
 //#define GLM_FORCE_LEFT_HANDED
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 
 // TODO: Remove globals
 constexpr i32 kMaxFramesInFlight = 2;
+// NOTE: Headless render targets, more than frames in flight, so an image is never rendered to while it's still in use
+constexpr ui32 kOffscreenImageCount = 3;
+constexpr vk::Format kOffscreenFormat = vk::Format::eR8G8B8A8Unorm;
 constexpr i64 kSyncObjectTimeout = std::numeric_limits<ui64>::max();
+// NOTE: Starting sizes, what doesn't fit goes to the heap. Frame arenas grow to what a frame needed, the scratch stack doesn't.
+constexpr size_t kScratchCapacity = 1024 * 1024;
+constexpr size_t kFrameArenaCapacity = 64 * 1024;
+// NOTE: Start and end of the command buffer, then start and end of the Hi-Z build
+constexpr ui32 kTimestampsPerFrame = 4;
+// NOTE: Culled meshlets, culled triangles, occluded objects and occluded triangles
+constexpr ui32 kCullStatsPerFrame = 4;
+// NOTE: What every pass of the main view is measured with, results come in the order of the bits
+constexpr vk::QueryPipelineStatisticFlags kPipelineStatistics = vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices
+                                                              | vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives
+                                                              | vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations
+                                                              | vk::QueryPipelineStatisticFlagBits::eClippingPrimitives
+                                                              | vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations
+                                                              | vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+constexpr ui32 kPipelineStatisticCount = 6;
+// NOTE: One per frame in flight and two more, so a capture every frame survives an encoder that's a frame behind
+constexpr ui32 kCaptureReadbackCount = kMaxFramesInFlight + 2;
 
 const char* kShaderVertexPath = "shader.vspv";
 const char* kShaderFragmentPath = "shader.fspv";
+const char* kShaderOverdrawPath = "shader_overdraw.fspv";
+const char* kShaderMeshletCullPath = "meshlet_cull.cspv";
+const char* kShaderHiZBuildPath = "hiz_build.cspv";
+
+const char* kMeshletCullPassName = "MeshletCull";
+const char* kForwardPassName = "Forward";
+const char* kHiZPassName = "HiZBuild";
+const char* kMeshletCullLatePassName = "MeshletCullLate";
+const char* kForwardLatePassName = "ForwardLate";
+const char* kCapturePassName = "Capture";
+const char* kCacheFramePassName = "CacheFrame";
+
+constexpr f32 kNearPlane = 0.1f;
+constexpr f32 kFarPlane = 10.0f;
+// NOTE: Share of the pixel error a coarser level has to be under before an object switches to it
+constexpr f32 kLodHysteresis = 0.25f;
+// NOTE: Low latency, how much earlier than predicted the main thread starts a frame, covers jitter in the prediction
+constexpr f64 kPacingMarginMilliseconds = 1.0;
+
+// NOTE: Indices into VkBackend::m_pipelines, this is what DrawCommand::pipeline refers to
+enum PipelineId : ui32
+{
+    kPipelineOpaque = 0,
+    kPipelineTransparent,
+    kPipelineCount
+};
+
+// NOTE: MeshletCullConstants::phase, same values as in meshlet_cull.comp
+enum CullPhase : ui32
+{
+    kCullPhaseSingle = 0,
+    kCullPhaseEarly,
+    kCullPhaseLate
+};
+
+enum RenderLayer : ui32
+{
+    kLayerWorld = 0
+};
+
+// NOTE: Command cache, the draws of a forward pass are split into these and each is a secondary command buffer of its own.
+//  The queue sorts opaque draws before transparent ones, so both are one range of the draw list. Opaque draws only
+//  reorder when the camera moves far enough to change their depth bucket, transparent ones much sooner.
+enum DrawBucket : ui32
+{
+    kBucketOpaque = 0,
+    kBucketTransparent,
+    kBucketCount
+};
+// NOTE: Forward and ForwardLate, every view reserves slots for both
+constexpr ui32 kCachedPassCount = 2;
 
 #ifdef NDEBUG
     constexpr bool kEnableValidationLayers = false;
@@ -38,6 +113,15 @@ const char* kShaderFragmentPath = "shader.fspv";
 const std::vector<const char*> kValidationLayers{ "VK_LAYER_KHRONOS_validation", "VK_LAYER_LUNARG_monitor" };
 const std::vector<const char*> kDeviceExtensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+// NOTE: Eviction handlers, lower priorities are asked first. Staging is only needed for uploads and is simply recreated,
+//  a dropped mip level is lost for good, geometry in host-visible memory costs bandwidth every frame.
+enum EvictionPriority : ui32
+{
+    kEvictStaging = 0,
+    kEvictTextureMips,
+    kEvictMeshBuffers
+};
+
 
 // NOTE: Can be removed?
 // TODO: Separate transfer queue
@@ -54,8 +138,8 @@ struct QueueFamilyIndices
 
 struct SwapchainSupportDetails
 {
-    std::vector<vk::SurfaceFormatKHR> formats;
-    std::vector<vk::PresentModeKHR> presentModes;
+    std::pmr::vector<vk::SurfaceFormatKHR> formats;
+    std::pmr::vector<vk::PresentModeKHR> presentModes;
     vk::SurfaceCapabilitiesKHR capabilities;
 };
 
@@ -64,6 +148,7 @@ struct Vertex
 {
     glm::vec2 position;
     glm::vec3 color;
+    glm::vec2 texCoord;
 
     static constexpr vk::VertexInputBindingDescription GetBindingDescription() noexcept
     {
@@ -76,7 +161,7 @@ struct Vertex
         return bindingDescription;
     }
 
-    static constexpr std::array<vk::VertexInputAttributeDescription, 2> GetAttributeDescription() noexcept
+    static constexpr std::array<vk::VertexInputAttributeDescription, 3> GetAttributeDescription() noexcept
     {
         vk::VertexInputAttributeDescription positionAttribute{ .location = 0,
                                                                .binding = kBinding,
@@ -86,181 +171,757 @@ struct Vertex
                                                             .binding = kBinding,
                                                             .format = vk::Format::eR32G32B32Sfloat,
                                                             .offset = offsetof(Vertex, color) };
-        return { positionAttribute, colorAttribute };
+        vk::VertexInputAttributeDescription texCoordAttribute{ .location = 2,
+                                                               .binding = kBinding,
+                                                               .format = vk::Format::eR32G32Sfloat,
+                                                               .offset = offsetof(Vertex, texCoord) };
+        return { positionAttribute, colorAttribute, texCoordAttribute };
     }
 
 private:
     static const ui32 kBinding = 0; // FINDOUT: WTF is this
 };
 
-struct UBO_MVP
+// NOTE: Per-draw data, the model matrix is fetched by the vertex shader through firstInstance
+struct PushConstants
 {
-    glm::mat4 model;
-    glm::mat4 view;
-    glm::mat4 projection;
+    glm::vec4 color;
+    // NOTE: Frame in flight, which overdraw counter the fragments add to. Unused by shader.frag.
+    ui32 frameSlot;
+};
+
+// NOTE: std430 layouts of the meshlet cull shader's buffers
+struct GpuMeshlet
+{
+    glm::vec4 sphere;
+    glm::vec4 cone;
+    ui32 firstIndex;
+    ui32 indexCount;
+    ui32 padding[2];
+};
+
+// NOTE: One per draw. Geometry pool offsets are filled in every frame, eviction may move the pool.
+struct MeshletCullJob
+{
+    ui32 firstMeshlet;
+    ui32 meshletCount;
+    ui32 transform;
+    ui32 firstIndex;
+    i32 vertexOffset;
+    ui32 firstDraw;
+    // NOTE: Index into the visibility buffer
+    ui32 object;
+    ui32 isTransparent;
+};
+
+// NOTE: Frustum planes and eye in world space, the stats slot is the frame in flight.
+//  The late phase writes its draw commands 'drawBase' commands into the buffer, after the early phase's.
+struct MeshletCullConstants
+{
+    f32 planes[Frustum::kPlaneCount][4];
+    glm::vec4 eye;
+    ui32 statsSlot;
+    ui32 phase;
+    ui32 drawBase;
 };
 
 
 const std::vector<Vertex> kTriangleVertices = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{ 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{ 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}},
-    {{-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}}
+    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+    {{ 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+    {{-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
 };
 
 const std::vector<ui16> kTriangleIndices = {
     0, 1, 2, 2, 3, 0
 };
 
+// NOTE: Materials are just a tint for now, alpha < 1 goes to the transparent pipeline
+const std::vector<glm::vec4> kMaterialColors = {
+    {1.0f, 1.0f, 1.0f, 1.0f},
+    {1.0f, 0.5f, 0.5f, 1.0f},
+    {0.5f, 1.0f, 0.5f, 1.0f},
+    {0.5f, 0.5f, 1.0f, 0.5f}
+};
+
 
-auto _checkAPIVersionSupport(const ui32 requestedVersion)   -> void;
-auto _getRequiredExtensions()                               -> std::vector<const char*>;
-auto _checkValidationLayersSupport()                        -> bool;
-auto _makeDebugUtilsMessengerCreateInfo()                   -> vk::DebugUtilsMessengerCreateInfoEXT;
+// NOTE: Helpers that return or use containers take the memory for them, the backend passes its scratch stack
+auto _checkAPIVersionSupport(const ui32 requestedVersion)                           -> void;
+auto _getRequiredExtensions(bool isHeadless, std::pmr::memory_resource* memory)     -> std::pmr::vector<const char*>;
+auto _checkValidationLayersSupport(std::pmr::memory_resource* memory)               -> bool;
+auto _makeDebugUtilsMessengerCreateInfo()                                           -> vk::DebugUtilsMessengerCreateInfoEXT;
 
+auto _queryDeviceCapabilities(const vk::PhysicalDevice& device,
+                              std::pmr::memory_resource* memory)             -> vulkan::DeviceCapabilities;
 auto _isDeviceSuitable(const vk::PhysicalDevice& device,
-                       const vk::SurfaceKHR& surface)                        -> bool;
+                       const vk::SurfaceKHR& surface,
+                       QueueFamilyIndices indices,
+                       std::pmr::memory_resource* memory)                    -> bool;
 auto _getRequiredQueueFamilies(const vk::PhysicalDevice& device,
-                               const vk::SurfaceKHR& surface)                -> QueueFamilyIndices;
-auto _checkPhysicalDeviceExtensionSupport(const vk::PhysicalDevice& device)  -> bool;
+                               const vk::SurfaceKHR& surface,
+                               std::pmr::memory_resource* memory)            -> QueueFamilyIndices;
+auto _checkPhysicalDeviceExtensionSupport(const vk::PhysicalDevice& device,
+                                          std::pmr::memory_resource* memory) -> bool;
+
+auto _chooseDepthFormat(const vk::PhysicalDevice& device)                  -> vk::Format;
 
 auto _querySwapchainSupport(const vk::PhysicalDevice& device,
-                            const vk::SurfaceKHR& surface)              -> SwapchainSupportDetails;
-auto _chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats)    -> vk::SurfaceFormatKHR;
-auto _choosePresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)   -> vk::PresentModeKHR;
+                            const vk::SurfaceKHR& surface,
+                            std::pmr::memory_resource* memory)          -> SwapchainSupportDetails;
+auto _chooseSurfaceFormat(std::span<const vk::SurfaceFormatKHR> availableFormats)    -> vk::SurfaceFormatKHR;
+auto _choosePresentMode(std::span<const vk::PresentModeKHR> availablePresentModes, bool isVsync) -> vk::PresentModeKHR;
 auto _chooseSurfaceExtent(const vk::SurfaceCapabilitiesKHR& capabilities, ui32 width, ui32 height) -> vk::Extent2D;
 
-auto _readShaderFile(const std::string_view shaderPath)         -> std::vector<char>;
-auto _createShaderModule(const std::vector<char>& shaderCode,
-                         const vk::Device& device)              -> vk::UniqueShaderModule;
+auto _isPipelineCacheCompatible(std::span<const char> data,
+                                const vk::PhysicalDeviceProperties& properties) -> bool;
 
-auto _findMemoryTypeIndex(const vk::PhysicalDevice& physicalDevice,
-                          const ui32 memoryTypeBits,
-                          const vk::MemoryPropertyFlags properties)                             -> ui32;
-// NOTE: I think i should make it private method or a friend function
-auto _createBuffer(const vk::PhysicalDevice& physicalDevice, const vk::Device& device,
-                   const vk::DeviceSize bufferSize,
-                   const vk::BufferUsageFlags usage, const vk::MemoryPropertyFlags properties,
-                   vk::Buffer& buffer, vk::DeviceMemory& bufferMemory)                          -> void;
-auto _copyBuffer(const vk::CommandPool& commandPool, const vk::Device& device, const vk::Queue& queue,
-                 vk::Buffer& source, vk::Buffer& destination, vk::DeviceSize size)              -> void;
+auto _makeCheckerboard(ui32 size, ui32 cellSize, std::pmr::memory_resource* memory) -> std::pmr::vector<ui8>;
+auto _makeFullImageCopy(vk::Extent2D extent)                                       -> vk::ImageCopy;
+auto _hashDraws(std::span<const DrawCommand> draws, vk::DeviceSize drawOffset)      -> ui64;
 
 
 
 namespace vulkan
 {
 
-void VkBackend::Init(const Window& window)
+void VkBackend::Init(const BackendConfig& config, JobSystem& jobSystem)
 {
+    m_initStart = std::chrono::steady_clock::now();
+    m_firstFrameNanoseconds.store(-1, std::memory_order_relaxed);
     m_frameCounter = 0;
     m_currentFrameData = 0;
+    m_jobSystem = &jobSystem;
+    m_isHeadless = config.window == nullptr;
+    m_fixedTimeStep = config.fixedTimeStep;
+    m_lodPixelError = config.lodPixelError;
+    m_useMeshletCulling = config.meshletCulling;
+    m_useCommandCache = config.commandCache;
+    m_useFrameCapture = config.frameCapture;
+    m_captureSchedule = config.captureSchedule;
+    m_captureScheduleStart = 0;
+    m_isOnDemand = config.onDemand && m_isHeadless == false;
+    m_isAnimating = true;
+    m_isDirty = true;
+    m_hasCachedFrame = false;
+    m_animationTime = 0.0;
+    m_lastAnimationTick = std::chrono::steady_clock::now();
+    m_useLowLatency = config.lowLatency;
+    m_usePresentWait = false;
+    m_waitForPresent = nullptr;
+    m_presentId = 0;
+    m_framePacer.Init(kPacingMarginMilliseconds);
+    m_frameTimings = {};
+    m_frameTimingsStart = 0;
+
+    m_scratch.Init(kScratchCapacity);
+    m_frameArenas = std::make_unique<LinearArena[]>(kMaxFramesInFlight);
+    for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
+        m_frameArenas[i].Init(kFrameArenaCapacity);
+    }
 
-    _CreateInstance(/*VK_API_VERSION_1_2*/VK_MAKE_VERSION(1, 2, 135));
-    _SetupDebugMessenger();
-    _CreateSurface(window.GetWindowHandle());
-    _SelectPhysicalDevice();
-    _CreateLogicalDeviceAndQueues();
-    _CreateSwapchain(window.GetWidth(), window.GetHeight());
-    _CreateImageViews();
-    _CreateRenderPass();
-
-    _CreateDescriptorSetLayout();
-    _CreateGraphicsPipeline();
-
-    _CreateFramebuffers();
-    _CreateCommandPool();
-
-    _CreateVertexBuffer();
-    _CreateIndexBuffer();
-    _CreateUniformBuffers();
-
-    _CreateDescriptorPool();
-    _CreateDescriptorSets();
+    m_hostAllocator.Init(config.hostAllocatorBackend);
+    m_allocationCallbacks = config.trackHostAllocations ? m_hostAllocator.GetCallbacks() : nullptr;
+
+    // NOTE: A headless instance has no surface extensions and its device no swapchain extension
+    m_viewCount = 1 + static_cast<ui32>(config.views.size());
+    m_views = std::make_unique<RenderView[]>(m_viewCount);
+    m_views[0].window = config.window;
+    for (ui32 i = 1; i < m_viewCount; ++i) {
+        m_views[i].window = config.views[i - 1].window;
+        if (m_views[i].window != nullptr && m_isHeadless) {
+            throw std::runtime_error("VkBackend::Init(): Views with a window need a main window!");
+        }
+    }
 
-    _CreateCommandBuffers();
-    _CreateSyncPrimitives();
+    // NOTE: Two chains meet at the uploads. One creates the device, the views and then the pipelines, the other builds
+    //  the scene, its mesh LODs and meshlets and the compressed textures on the CPU. Steps without a dependency between
+    //  them must not share anything that isn't thread-safe: m_scratch, m_allocator, m_uploadBatch, the sampler cache
+    //  and m_shaderRegistry are each only used by steps that are ordered one after another.
+    InitGraph graph;
+
+    // NOTE: 1.3 is the highest version we use, dynamic rendering is still optional and depends on the device
+    const InitStep instance = graph.Add("instance", [this]() {
+        _CreateInstance(VK_API_VERSION_1_3);
+        _SetupDebugMessenger();
+        for (ui32 i = 0; i < m_viewCount; ++i) {
+            if (m_views[i].window != nullptr) {
+                _CreateSurface(i);
+            }
+        }
+    });
+    const InitStep physicalDevice = graph.Add("physical_device", [this, &config]() {
+        _SelectPhysicalDevice(config.deviceType);
+        m_usePresentWait = m_useLowLatency && m_isHeadless == false && m_capabilities.presentWait;
+        m_usePipelineStatistics = config.pipelineStatistics && m_capabilities.pipelineStatisticsQuery;
+        m_useOverdraw = config.overdraw && m_capabilities.fragmentStoresAndAtomics;
+        // NOTE: Secondary command buffers can only draw inside a statistics query when they inherit it
+        m_useCommandCache = m_useCommandCache && (m_usePipelineStatistics == false || m_capabilities.inheritedQueries);
+        m_useMeshletCulling = m_useMeshletCulling && m_capabilities.drawIndirectFirstInstance;
+        m_useOcclusionCulling = config.occlusionCulling && m_useMeshletCulling && m_capabilities.depthSampling;
+    }, { instance });
+    const InitStep device = graph.Add("device", [this, &config]() {
+        _CreateLogicalDeviceAndQueues();
+        m_allocator.SetBudgetLimit(config.deviceMemoryBudget);
+    }, { physicalDevice });
+    const InitStep pipelineCache = graph.Add("pipeline_cache", [this, &config]() {
+        _CreatePipelineCache(config.pipelineCachePath);
+    }, { device });
+
+    // NOTE: The main view goes first, the others take its format so they can share its pipelines
+    const InitStep views = graph.Add("views", [this, &config]() {
+        m_swapchainCount = 0;
+        for (ui32 i = 0; i < m_viewCount; ++i) {
+            if (m_views[i].window != nullptr) {
+                _CreateSwapchain(i);
+                ++m_swapchainCount;
+            } else if (i == 0) {
+                _CreateOffscreenImages(i, config.width, config.height, kOffscreenFormat);
+            } else {
+                _CreateOffscreenImages(i, config.views[i - 1].width, config.views[i - 1].height, m_views[0].format);
+            }
+            _CreateImageViews(i);
+        }
+        m_useFrameCapture = m_useFrameCapture && IsCaptureFormatSupported(m_views[0].format);
+        _CreateFrameCache();
+        for (ui32 i = 0; i < m_viewCount; ++i) {
+            _CreateRenderGraph(i);
+        }
+        m_presentStats = PresentStats{ .framesDrawn = 0, .framesRepresented = 0, .isOnDemand = m_isOnDemand };
+    }, { pipelineCache });
+    const InitStep descriptorSetLayout = graph.Add("descriptor_set_layout", [this]() {
+        _CreateDescriptorSetLayout();
+    }, { device });
+    const InitStep pipelines = graph.Add("pipelines", [this]() {
+        _CreateGraphicsPipeline();
+        _CreateMeshletCullPipeline();
+    }, { views, descriptorSetLayout });
+    const InitStep commandPool = graph.Add("command_pool", [this]() {
+        _CreateCommandPool();
+        m_uploadBatch.Init(m_device, m_allocator, m_commandPool, m_graphicsQueue, m_allocationCallbacks);
+    }, { views });
+
+    // NOTE: The mesh buffers and the transform buffers are sized by the scene
+    const InitStep scene = graph.Add("scene", [this, &config]() {
+        _CreateScene(config.scene);
+        _CreateViewCameras(config.views);
+    });
+    const InitStep meshLods = graph.Add("mesh_lods", [this, &config]() {
+        _BuildMeshLods(config.scene, config.meshLods);
+    });
+    const InitStep textures = graph.Add("textures", [this]() {
+        _BuildTextures();
+    });
+
+    const InitStep uploads = graph.Add("uploads", [this, &config]() {
+        m_uploadBatch.Begin();
+        _CreateMeshBuffers(config.scene);
+        _CreateTextures();
+        m_uploadBatch.Submit();
+        m_initAssets = InitAssets{};
+    }, { commandPool, scene, meshLods, textures });
+    const InitStep buffers = graph.Add("buffers", [this, &config]() {
+        _CreateUniformBuffers();
+        _CreateTransformBuffers();
+        _CreateMeshletBuffers();
+        _CreateOverdrawBuffer();
+        if (m_useFrameCapture) {
+            m_frameCapture.Init(m_allocator, m_views[0].extent, m_views[0].format, kCaptureReadbackCount, kMaxFramesInFlight,
+                                config.captureFormat, config.captureDirectory);
+        }
+    }, { uploads });
+    // NOTE: Every pipeline exists, the SPIR-V stays for pipelines created later
+    const InitStep depthPyramid = graph.Add("depth_pyramid", [this]() {
+        _CreateDepthPyramid();
+        m_shaderRegistry.ReleaseModules();
+    }, { buffers, pipelines });
+    const InitStep frameResources = graph.Add("frame_resources", [this]() {
+        _CreateCommandBuffers();
+        _CreateSyncPrimitives();
+        _CreateQueryPool();
+    }, { uploads });
+    // NOTE: Last, once the eviction handlers are in any allocation may record into m_commandPool through the upload batch
+    graph.Add("descriptor_sets", [this]() {
+        _CreateDescriptorPool();
+        _CreateDescriptorSets();
+        _RegisterEvictionHandlers();
+    }, { depthPyramid, frameResources });
+
+    graph.Run(jobSystem);
+    m_initStats = graph.GetStats();
+
+    _CreateSnapshots();
+    m_renderThread = std::thread([this]() { _RenderThreadLoop(); });
 }
 
 void VkBackend::Shutdown()
 {
+    _StopRenderThread();
+
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        auto& view = m_views[v];
+        for (size_t i = 0; i < view.imageAvailableSemaphores.size(); ++i) {
+            m_device.destroySemaphore(view.imageAvailableSemaphores[i], m_allocationCallbacks);
+            m_device.destroySemaphore(view.renderFinishedSemaphores[i], m_allocationCallbacks);
+        }
+        view.imageAvailableSemaphores.clear();
+        view.renderFinishedSemaphores.clear();
+    }
     for (int i = 0; i < kMaxFramesInFlight; ++i) {
-        m_device.destroySemaphore(m_imageAvailableSemaphores[i]);
-        m_device.destroySemaphore(m_renderFinishedSemaphores[i]);
-        m_device.destroyFence(m_inFlightFences[i]);
+        m_device.destroyFence(m_inFlightFences[i], m_allocationCallbacks);
+    }
+    m_inFlightFences.clear();
+    if (m_timestampQueryPool) {
+        m_device.destroyQueryPool(m_timestampQueryPool, m_allocationCallbacks);
+    }
+    if (m_statisticsQueryPool) {
+        m_device.destroyQueryPool(m_statisticsQueryPool, m_allocationCallbacks);
     }
 
-    m_device.destroyBuffer(m_indexBuffer);
-    m_device.freeMemory(m_indexBufferMemory);
-    m_device.destroyBuffer(m_vertexBuffer);
-    m_device.freeMemory(m_vertexBufferMemory);
+    m_frameCapture.Shutdown();
+    m_textureManager.Shutdown();
+    m_uploadBatch.Shutdown();
+    m_geometryPool.Shutdown();
+    if (m_meshletBuffer) {
+        m_allocator.DestroyBuffer(m_meshletBuffer, m_meshletAllocation);
+        m_allocator.DestroyBuffer(m_meshletStatsBuffer, m_meshletStatsAllocation);
+        m_allocator.DestroyBuffer(m_visibilityBuffer, m_visibilityAllocation);
+    }
+    if (m_overdrawBuffer) {
+        m_allocator.DestroyBuffer(m_overdrawBuffer, m_overdrawAllocation);
+    }
 
     _CleanupSwapchain();
 
-    m_device.destroyDescriptorSetLayout(m_descriptorSetLayout);
+    m_device.destroyDescriptorSetLayout(m_descriptorSetLayout, m_allocationCallbacks);
+    m_shaderRegistry.Shutdown();
+    _SavePipelineCache();
+    m_device.destroyPipelineCache(m_pipelineCache, m_allocationCallbacks);
 
-    m_device.destroyCommandPool(m_commandPool);
-    m_device.destroy();
+    m_commandCache.Shutdown();
+    m_device.destroyCommandPool(m_commandPool, m_allocationCallbacks);
+    m_allocator.Shutdown();
+    m_device.destroy(m_allocationCallbacks);
 
     if (kEnableValidationLayers) {
-        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger);
+        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger, m_allocationCallbacks);
+    }
+
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        if (m_views[i].surface) {
+            m_instance.destroySurfaceKHR(m_views[i].surface, m_allocationCallbacks);
+        }
     }
+    m_views.reset();
+    m_instance.destroy(m_allocationCallbacks);
 
-    m_instance.destroySurfaceKHR(m_surface);
-    m_instance.destroy();
+    m_hostAllocator.Shutdown();
+
+    m_frameArenas.reset();
+    m_scratch.Shutdown();
 }
 
 
+// NOTE: Waiting for a free slot is the only place the main thread can block on the GPU,
+//  and only when the render thread is kMaxQueuedFrames frames behind
 void VkBackend::DrawFrame()
 {
-    m_device.waitForFences(1, &m_inFlightFences[m_currentFrameData], VK_TRUE, kSyncObjectTimeout);
-    m_device.resetFences(1, &m_inFlightFences[m_currentFrameData]);
+    if (m_useLowLatency) {
+        m_framePacer.WaitForStart(m_frameCounter);
+    }
 
-    const ui32 imageIndex = m_device.acquireNextImageKHR(m_swapchain, kSyncObjectTimeout,
-                                                         m_imageAvailableSemaphores[m_currentFrameData], nullptr);
+    // NOTE: What the handlers free may still be in use by frames in flight, so eviction waits for the device first.
+    //  A full stall, but it only happens when a heap crosses the pressure threshold.
+    m_allocator.UpdateBudget();
+    if (m_allocator.NeedsEviction()) {
+        WaitIdle();
+        if (m_allocator.EnforceBudget() > 0) {
+            _WriteDescriptorSets();
+        }
+        ++m_evictionStats.stalls;
+    }
 
-    _UpdateUniformBuffers(imageIndex);
+    const ui32 slot = m_freeSnapshots.Pop();
+    if (m_hasRenderThreadError.load(std::memory_order_acquire)) {
+        m_freeSnapshots.Push(slot);
+        std::rethrow_exception(m_renderThreadError);
+    }
 
-    // NOTE: I guess constexpr is useless because of &dstStageMask
-    constexpr vk::PipelineStageFlags dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    const auto start = std::chrono::steady_clock::now();
+
+    FrameSnapshot& snapshot = m_snapshots[slot];
+    snapshot.frameIndex = m_frameCounter;
+    snapshot.simulationStart = start;
+    snapshot.isCaptured = m_useFrameCapture && IsCaptureFrame(m_captureSchedule, m_frameCounter - m_captureScheduleStart);
+    snapshot.isRepresent = false;
+    snapshot.timing = nullptr;
+    if (m_frameCounter - m_frameTimingsStart < m_frameTimings.size()) {
+        snapshot.timing = &m_frameTimings[m_frameCounter - m_frameTimingsStart];
+        *snapshot.timing = FrameTiming{ .cpuMilliseconds = 0.0, .renderMilliseconds = 0.0, .gpuMilliseconds = -1.0, .hizMilliseconds = -1.0,
+                                        .latencyMilliseconds = -1.0 };
+    }
 
-    vk::SubmitInfo submitInfo{ .waitSemaphoreCount = 1,
-                               .pWaitSemaphores = &m_imageAvailableSemaphores[m_currentFrameData],
-                               .pWaitDstStageMask = &dstStageMask,
-                               .commandBufferCount = 1,
-                               .pCommandBuffers = &m_commandBuffers[imageIndex],
-                               .signalSemaphoreCount = 1,
-                               .pSignalSemaphores = &m_renderFinishedSemaphores[m_currentFrameData] };
+    _UpdateTransforms(snapshot);
 
-    m_graphicsQueue.submit(submitInfo, m_inFlightFences[m_currentFrameData]);
+    // NOTE: One render queue, each view culls, picks levels and sorts in it and copies the result out
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        auto& viewSnapshot = snapshot.views[i];
+        viewSnapshot.uniforms = m_views[i].uniforms;
+        _BuildRenderQueue(i);
 
-    vk::PresentInfoKHR presentInfo{ .waitSemaphoreCount = 1,
-                                    .pWaitSemaphores = &m_renderFinishedSemaphores[m_currentFrameData],
-                                    .swapchainCount = 1,
-                                    .pSwapchains = &m_swapchain,
-                                    .pImageIndices = &imageIndex };
+        viewSnapshot.draws.clear();
+        for (const auto& item : m_renderQueue.GetItems()) {
+            viewSnapshot.draws.push_back(m_renderQueue.GetCommand(item));
+        }
+    }
 
-    m_presentQueue.presentKHR(presentInfo);
+    if (snapshot.timing != nullptr || m_useLowLatency) {
+        const auto end = std::chrono::steady_clock::now();
+        const f64 milliseconds = std::chrono::duration<f64, std::milli>(end - start).count();
+        if (snapshot.timing != nullptr) {
+            snapshot.timing->cpuMilliseconds = milliseconds;
+        }
+        if (m_useLowLatency) {
+            m_framePacer.OnFrameWork(milliseconds);
+        }
+    }
 
+    m_queuedSnapshots.Push(slot);
     ++m_frameCounter;
-    m_currentFrameData = m_frameCounter % kMaxFramesInFlight;
-    //std::cout << m_frameCounter << ' ' << m_currentFrameData << '\n';
+
+    m_isDirty = false;
+    m_hasCachedFrame = m_isOnDemand;
+    ++m_presentStats.framesDrawn;
+}
+
+// NOTE: Queued like any other frame, so it stays in order with the ones drawn before it
+void VkBackend::PresentLastFrame()
+{
+    if (m_isHeadless) {
+        return;
+    }
+    if (m_hasCachedFrame == false) {
+        DrawFrame();
+        return;
+    }
+
+    const ui32 slot = m_freeSnapshots.Pop();
+    if (m_hasRenderThreadError.load(std::memory_order_acquire)) {
+        m_freeSnapshots.Push(slot);
+        std::rethrow_exception(m_renderThreadError);
+    }
+
+    FrameSnapshot& snapshot = m_snapshots[slot];
+    snapshot.frameIndex = m_frameCounter;
+    snapshot.isCaptured = false;
+    snapshot.isRepresent = true;
+    snapshot.timing = nullptr;
+
+    m_queuedSnapshots.Push(slot);
+    ++m_presentStats.framesRepresented;
 }
 
-void VkBackend::WaitIdle() const
+// NOTE: Taking every slot back means the render thread has finished with all of them and is waiting for the next frame,
+//  so it doesn't touch the queues or the capture ring while the device waits
+void VkBackend::WaitIdle()
 {
+    std::array<ui32, kMaxQueuedFrames> slots;
+    for (auto& slot : slots) {
+        slot = m_freeSnapshots.Pop();
+    }
+    for (const ui32 slot : slots) {
+        m_freeSnapshots.Push(slot);
+    }
+
     m_device.waitIdle();
+
+    for (ui32 i = 0; i < static_cast<ui32>(m_pendingGpuTimings.size()); ++i) {
+        _ReadGpuTiming(i);
+    }
+    for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
+        _ReadMeshletStats(static_cast<ui32>(i));
+        _ReadPipelineStatistics(static_cast<ui32>(i));
+        _ReadOverdraw(static_cast<ui32>(i));
+    }
+
+    if (m_useFrameCapture) {
+        for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
+            m_frameCapture.Complete(static_cast<ui32>(i));
+        }
+        m_frameCapture.Flush();
+    }
+}
+
+void VkBackend::SetFrameTimings(std::span<FrameTiming> timings)
+{
+    m_frameTimings = timings;
+    m_frameTimingsStart = m_frameCounter;
+}
+
+void VkBackend::SetCaptureSchedule(const CaptureSchedule& schedule)
+{
+    m_captureSchedule = schedule;
+    m_captureScheduleStart = m_frameCounter;
+}
+
+void VkBackend::SetAnimating(bool isAnimating)
+{
+    if (isAnimating == m_isAnimating) {
+        return;
+    }
+
+    // NOTE: The time spent stopped isn't animated through when it starts again
+    m_isAnimating = isAnimating;
+    m_lastAnimationTick = std::chrono::steady_clock::now();
+    m_isDirty = true;
+}
+
+void VkBackend::SetCamera(const SyntheticCamera& camera, ui32 view)
+{
+    if (view >= m_viewCount) {
+        throw std::runtime_error("VkBackend::SetCamera(): No such view!");
+    }
+
+    auto& renderView = m_views[view];
+    renderView.cameraEye = glm::make_vec3(camera.eye);
+    renderView.cameraTarget = glm::make_vec3(camera.target);
+    renderView.cameraUp = glm::make_vec3(camera.up);
+    renderView.cameraFovY = camera.fovY;
+    _UpdateUniforms(view);
+    m_isDirty = true;
+}
+
+void VkBackend::MarkDirty()
+{
+    m_isDirty = true;
+}
+
+bool VkBackend::NeedsRedraw() const
+{
+    return m_isAnimating || m_isDirty;
+}
+
+void VkBackend::SetDeviceMemoryBudget(vk::DeviceSize budget)
+{
+    m_allocator.SetBudgetLimit(budget);
+}
+
+void VkBackend::SetHostAllocatorBackend(HostAllocatorBackend backend)
+{
+    m_hostAllocator.SetBackend(backend);
+}
+
+BackendStats VkBackend::GetStats() const
+{
+    ArenaStats frameArena{ .capacity = 0, .peakBytes = 0, .spillCount = 0 };
+    for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
+        const auto arena = m_frameArenas[i].GetStats();
+        frameArena.capacity = std::max(frameArena.capacity, arena.capacity);
+        frameArena.peakBytes = std::max(frameArena.peakBytes, arena.peakBytes);
+        frameArena.spillCount += arena.spillCount;
+    }
+    const i64 firstFrameNanoseconds = m_firstFrameNanoseconds.load(std::memory_order_relaxed);
+
+    return { .renderGraph = m_views[0].renderGraph.GetStats(),
+             .renderQueue = m_renderQueue.GetStats(),
+             .allocator = m_allocator.GetStats(),
+             .hostAllocations = m_hostAllocator.GetStats(),
+             .frameArena = frameArena,
+             .scratch = m_scratch.GetStats(),
+             .eviction = m_evictionStats,
+             .geometry = m_geometryPool.GetStats(),
+             .lod = m_lodStats,
+             .meshlets = { .meshletsTested = m_meshletsTested.load(std::memory_order_relaxed),
+                           .meshletsCulled = m_meshletsCulled.load(std::memory_order_relaxed),
+                           .trianglesCulled = m_meshletTrianglesCulled.load(std::memory_order_relaxed),
+                           .meshletCount = m_meshletCount,
+                           .isEnabled = m_useMeshletCulling },
+             .occlusion = { .objectsOccluded = m_objectsOccluded.load(std::memory_order_relaxed),
+                            .trianglesOccluded = m_trianglesOccluded.load(std::memory_order_relaxed),
+                            .pyramidLevels = m_useOcclusionCulling ? m_depthPyramid.GetLevelCount() : 0,
+                            .isEnabled = m_useOcclusionCulling },
+             .capture = m_frameCapture.GetStats(),
+             .present = m_presentStats,
+             .latency = { .pacing = m_framePacer.GetStats(),
+                          .usesPresentWait = m_usePresentWait,
+                          .isEnabled = m_useLowLatency },
+             .views = { .viewCount = m_viewCount,
+                        .swapchainCount = m_swapchainCount,
+                        .pipelineCacheBytesLoaded = m_pipelineCacheBytesLoaded },
+             .shaders = m_shaderRegistry.GetStats(),
+             .commands = m_commandCache.GetStats(),
+             .pipelineStatistics = _GetPipelineStatistics(),
+             .overdraw = { .fragmentsShaded = m_overdrawFragments.load(std::memory_order_relaxed),
+                           .pixels = m_overdrawPixels.load(std::memory_order_relaxed),
+                           .framesMeasured = m_overdrawFrames.load(std::memory_order_relaxed),
+                           .lastFrameOverdraw = std::bit_cast<f64>(m_lastFrameOverdraw.load(std::memory_order_relaxed)),
+                           .isEnabled = m_useOverdraw },
+             .culling = m_frustumCuller.GetStats(),
+             .transforms = m_transforms.GetStats(),
+             .objects = _GetDriverObjectStats(),
+             .init = { .graph = m_initStats,
+                       .firstFrameMilliseconds = firstFrameNanoseconds < 0 ? -1.0 : static_cast<f64>(firstFrameNanoseconds) / 1e6 } };
+}
+
+std::string VkBackend::GetDeviceName() const
+{
+    return m_deviceProperties.deviceName;
+}
+
+
+void VkBackend::_RenderThreadLoop()
+{
+    while (true) {
+        const ui32 slot = m_queuedSnapshots.Pop();
+        const FrameSnapshot& snapshot = m_snapshots[slot];
+
+        if (snapshot.isShutdown) {
+            break;
+        }
+
+        // NOTE: After a failure the snapshots are only handed back, so the main thread never waits for a slot forever
+        if (m_hasRenderThreadError.load(std::memory_order_relaxed) == false) {
+            try {
+                _RenderFrame(snapshot);
+            }
+            catch (...) {
+                m_renderThreadError = std::current_exception();
+                m_hasRenderThreadError.store(true, std::memory_order_release);
+            }
+        }
+
+        m_freeSnapshots.Push(slot);
+    }
+}
+
+void VkBackend::_RenderFrame(const FrameSnapshot& snapshot)
+{
+    m_device.waitForFences(1, &m_inFlightFences[m_currentFrameData], VK_TRUE, kSyncObjectTimeout);
+    m_device.resetFences(1, &m_inFlightFences[m_currentFrameData]);
+    _ReadGpuTiming(m_currentFrameData);
+    _ReadMeshletStats(m_currentFrameData);
+    _ReadPipelineStatistics(m_currentFrameData);
+    _ReadOverdraw(m_currentFrameData);
+    if (m_useFrameCapture) {
+        m_frameCapture.Complete(m_currentFrameData);
+    }
+
+    // NOTE: The fence also covers everything recorded with this arena the last time
+    auto& frameArena = m_frameArenas[m_currentFrameData];
+    frameArena.Reset();
+
+    // NOTE: Every view gets its image first, they're all rendered by one submit and presented by one presentKHR.
+    //  A re-present only shows the main view's cached frame, the other views keep what they have.
+    //  Offscreen images are used round-robin, there are more of them than frames in flight,
+    //  so the fence above also covers the last frame that rendered into this one.
+    const ui32 viewCount = snapshot.isRepresent ? 1 : m_viewCount;
+    std::pmr::vector<vk::Semaphore> waitSemaphores(&frameArena);
+    std::pmr::vector<vk::Semaphore> signalSemaphores(&frameArena);
+    std::pmr::vector<vk::SwapchainKHR> swapchains(&frameArena);
+    std::pmr::vector<ui32> imageIndices(&frameArena);
+    waitSemaphores.reserve(viewCount);
+    signalSemaphores.reserve(viewCount);
+    swapchains.reserve(viewCount);
+    imageIndices.reserve(viewCount);
+    for (ui32 i = 0; i < viewCount; ++i) {
+        auto& view = m_views[i];
+        if (view.swapchain) {
+            view.imageIndex = m_device.acquireNextImageKHR(view.swapchain, kSyncObjectTimeout,
+                                                           view.imageAvailableSemaphores[m_currentFrameData], nullptr);
+            waitSemaphores.push_back(view.imageAvailableSemaphores[m_currentFrameData]);
+            signalSemaphores.push_back(view.renderFinishedSemaphores[m_currentFrameData]);
+            swapchains.push_back(view.swapchain);
+            imageIndices.push_back(view.imageIndex);
+        } else {
+            view.imageIndex = (view.imageIndex + 1) % static_cast<ui32>(view.images.size());
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto& commandBuffer = m_commandBuffers[m_currentFrameData];
+    m_pendingGpuTimings[m_currentFrameData] = m_timestampQueryPool ? snapshot.timing : nullptr;
+    m_pendingStatistics[m_currentFrameData] = m_statisticsQueryPool && snapshot.isRepresent == false;
+    m_pendingOverdrawPixels[m_currentFrameData] = 0;
+    if (m_useOverdraw && snapshot.isRepresent == false) {
+        for (ui32 i = 0; i < viewCount; ++i) {
+            m_pendingOverdrawPixels[m_currentFrameData] += static_cast<ui64>(m_views[i].extent.width) * m_views[i].extent.height;
+        }
+    }
+    if (snapshot.isRepresent) {
+        _RecordRepresent(commandBuffer);
+    } else {
+        _UploadSnapshot(snapshot);
+        m_renderSnapshot = &snapshot;
+        _RecordCommandBuffer(commandBuffer, &frameArena);
+    }
+
+    // NOTE: A re-present writes the image with a copy instead of a color attachment
+    const vk::PipelineStageFlags dstStageMask = snapshot.isRepresent ? vk::PipelineStageFlagBits::eTransfer
+                                                                     : vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    const std::pmr::vector<vk::PipelineStageFlags> dstStageMasks(waitSemaphores.size(), dstStageMask, &frameArena);
+
+    if (m_useLowLatency && snapshot.isRepresent == false) {
+        _LatchUniforms();
+    }
+
+    // NOTE: Nothing to wait for or to signal without a swapchain
+    const auto semaphoreCount = static_cast<ui32>(waitSemaphores.size());
+    vk::SubmitInfo submitInfo{ .waitSemaphoreCount = semaphoreCount,
+                               .pWaitSemaphores = waitSemaphores.data(),
+                               .pWaitDstStageMask = dstStageMasks.data(),
+                               .commandBufferCount = 1,
+                               .pCommandBuffers = &commandBuffer,
+                               .signalSemaphoreCount = semaphoreCount,
+                               .pSignalSemaphores = signalSemaphores.data() };
+
+    m_graphicsQueue.submit(submitInfo, m_inFlightFences[m_currentFrameData]);
+    if (m_firstFrameNanoseconds.load(std::memory_order_relaxed) < 0) {
+        const auto sinceInit = std::chrono::steady_clock::now() - m_initStart;
+        m_firstFrameNanoseconds.store(std::chrono::duration_cast<std::chrono::nanoseconds>(sinceInit).count(), std::memory_order_relaxed);
+    }
+
+    // NOTE: Every swapchain presents the frame under the same id
+    const ui64 presentId = ++m_presentId;
+    if (swapchains.empty() == false) {
+        const std::pmr::vector<ui64> presentIds(swapchains.size(), presentId, &frameArena);
+        const vk::PresentIdKHR presentIdInfo{ .swapchainCount = static_cast<ui32>(swapchains.size()),
+                                              .pPresentIds = presentIds.data() };
+        vk::PresentInfoKHR presentInfo{ .pNext = m_usePresentWait ? &presentIdInfo : nullptr,
+                                        .waitSemaphoreCount = semaphoreCount,
+                                        .pWaitSemaphores = signalSemaphores.data(),
+                                        .swapchainCount = static_cast<ui32>(swapchains.size()),
+                                        .pSwapchains = swapchains.data(),
+                                        .pImageIndices = imageIndices.data() };
+
+        m_presentQueue.presentKHR(presentInfo);
+    }
+
+    if (snapshot.timing != nullptr) {
+        const auto end = std::chrono::steady_clock::now();
+        snapshot.timing->renderMilliseconds = std::chrono::duration<f64, std::milli>(end - start).count();
+    }
+
+    if (m_useLowLatency && snapshot.isRepresent == false) {
+        _WaitForFrameCompletion(snapshot, presentId);
+    }
+
+    m_renderSnapshot = nullptr;
+    m_currentFrameData = (m_currentFrameData + 1) % kMaxFramesInFlight;
 }
 
 
 void VkBackend::_CreateInstance(const ui32 apiVersion)
 {
-    if (kEnableValidationLayers && _checkValidationLayersSupport() == false) {
+    ScratchScope scratch(m_scratch);
+
+    if (kEnableValidationLayers && _checkValidationLayersSupport(&m_scratch) == false) {
         throw std::runtime_error("Validation layers requested but not available!");
     }
 
     _checkAPIVersionSupport(apiVersion);
 
-    const auto extensions = _getRequiredExtensions();
+    const auto extensions = _getRequiredExtensions(m_isHeadless, &m_scratch);
 
     const vk::ApplicationInfo appInfo{ .pApplicationName = "VkTriangle",
                                        .applicationVersion = VK_MAKE_VERSION(0, 1, 0),
@@ -282,7 +943,7 @@ void VkBackend::_CreateInstance(const ui32 apiVersion)
         instanceInfo.enabledLayerCount = 0;
     }
 
-    m_instance = vk::createInstance(instanceInfo);
+    m_instance = vk::createInstance(instanceInfo, m_allocationCallbacks);
 }
 
 void VkBackend::_SetupDebugMessenger()
@@ -292,33 +953,43 @@ void VkBackend::_SetupDebugMessenger()
     }
 
     const auto messengerInfo = _makeDebugUtilsMessengerCreateInfo();
-    m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(messengerInfo);
+    m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(messengerInfo, m_allocationCallbacks);
 }
 
 // NOTE: Depends on Window class (GLFWindow)
 // TODO: Move glfwCreateWindowSurface() to Window class ?
-void VkBackend::_CreateSurface(GLFWwindow* windowHandle)
+void VkBackend::_CreateSurface(ui32 viewIndex)
 {
+    auto& view = m_views[viewIndex];
     // NOTE: Don't know if there is a way to make it without 'tmp'
     VkSurfaceKHR tmp;
 
-    if (glfwCreateWindowSurface(m_instance, windowHandle, nullptr, &tmp) != VK_SUCCESS) {
+    if (glfwCreateWindowSurface(m_instance, view.window->GetWindowHandle(), reinterpret_cast<const VkAllocationCallbacks*>(m_allocationCallbacks), &tmp) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create a window surface!");
     }
 
-    m_surface = tmp;
+    view.surface = tmp;
 }
 
-void VkBackend::_SelectPhysicalDevice()
+void VkBackend::_SelectPhysicalDevice(std::optional<vk::PhysicalDeviceType> deviceType)
 {
-    const auto physicalDevices = m_instance.enumeratePhysicalDevices();
+    ScratchScope scratch(m_scratch);
+
+    std::pmr::polymorphic_allocator<vk::PhysicalDevice> allocator(&m_scratch);
+    const auto physicalDevices = m_instance.enumeratePhysicalDevices(allocator);
     // NOTE: Do I need to check this? Or vulkan.hpp will do this for me?
     if (physicalDevices.size() == 0) {
         throw std::runtime_error("Failed to find GPUs with Vulkan support!");
     }
 
+    // NOTE: The queue families are only looked up here, the rest of Init() takes them from m_capabilities
+    QueueFamilyIndices indices;
     for (const auto& device : physicalDevices) {
-        if (_isDeviceSuitable(device, m_surface)) {
+        if (deviceType.has_value() && device.getProperties().deviceType != deviceType.value()) {
+            continue;
+        }
+        indices = _getRequiredQueueFamilies(device, m_views[0].surface, &m_scratch);
+        if (_isDeviceSuitable(device, m_views[0].surface, indices, &m_scratch)) {
             m_physicalDevice = device;
             break;
         }
@@ -327,16 +998,27 @@ void VkBackend::_SelectPhysicalDevice()
     if (m_physicalDevice == vk::PhysicalDevice()) {
         throw std::runtime_error("Failed to find a suitable GPU!");
     }
+
+    m_deviceProperties = m_physicalDevice.getProperties();
+    m_capabilities = _queryDeviceCapabilities(m_physicalDevice, &m_scratch);
+    m_capabilities.depthFormat = _chooseDepthFormat(m_physicalDevice);
+    const auto depthFeatures = m_physicalDevice.getFormatProperties(m_capabilities.depthFormat).optimalTilingFeatures;
+    m_capabilities.depthSampling = static_cast<bool>(depthFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+
+    m_capabilities.graphicsQueueFamily = indices.graphicsFamily.value();
+    m_capabilities.presentQueueFamily = indices.presentFamily.value();
+    std::pmr::polymorphic_allocator<vk::QueueFamilyProperties> familyAllocator(&m_scratch);
+    const auto queueFamilies = m_physicalDevice.getQueueFamilyProperties(familyAllocator);
+    m_capabilities.timestampValidBits = queueFamilies[m_capabilities.graphicsQueueFamily].timestampValidBits;
 }
 
 void VkBackend::_CreateLogicalDeviceAndQueues()
 {
-    // TODO: We get queue indices when we select physicalDevice. Need to remove this redundant work.
-    const auto indices = _getRequiredQueueFamilies(m_physicalDevice, m_surface);
+    ScratchScope scratch(m_scratch);
 
-    const std::unordered_set<ui32> uniqueQueueFamilies{ indices.graphicsFamily.value(),
-                                                        indices.presentFamily.value() };
-    std::vector<vk::DeviceQueueCreateInfo> queueInfos;
+    const std::pmr::unordered_set<ui32> uniqueQueueFamilies({ m_capabilities.graphicsQueueFamily,
+                                                              m_capabilities.presentQueueFamily }, 0, &m_scratch);
+    std::pmr::vector<vk::DeviceQueueCreateInfo> queueInfos(&m_scratch);
     queueInfos.reserve(uniqueQueueFamilies.size());
 
     constexpr f32 queuePriority = 1.0f; // NOTE: same for every queue
@@ -346,30 +1028,145 @@ void VkBackend::_CreateLogicalDeviceAndQueues()
                                                         .pQueuePriorities = &queuePriority });
     }
 
-    vk::PhysicalDeviceFeatures device_features{}; // NOTE: empty for now
+    // NOTE: Indirect draws for the meshlets, anisotropic filtering and compressed textures, if the device can do it.
+    //  The analysis modes only ask for what they use.
+    vk::PhysicalDeviceFeatures device_features{ .multiDrawIndirect = m_capabilities.multiDrawIndirect,
+                                                .drawIndirectFirstInstance = m_capabilities.drawIndirectFirstInstance,
+                                                .samplerAnisotropy = m_capabilities.samplerAnisotropy,
+                                                .textureCompressionASTC_LDR = m_capabilities.textureCompressionASTC,
+                                                .textureCompressionBC = m_capabilities.textureCompressionBC,
+                                                .pipelineStatisticsQuery = m_usePipelineStatistics,
+                                                .fragmentStoresAndAtomics = m_useOverdraw,
+                                                .inheritedQueries = m_usePipelineStatistics && m_capabilities.inheritedQueries };
+
+    vk::PhysicalDeviceVulkan13Features vulkan13Features{ .pipelineCreationCacheControl = m_capabilities.shaderModuleIdentifier,
+                                                         .synchronization2 = m_capabilities.dynamicRendering,
+                                                         .dynamicRendering = m_capabilities.dynamicRendering };
+    vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ .presentId = VK_TRUE };
+    vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ .pNext = &presentIdFeatures,
+                                                                  .presentWait = VK_TRUE };
+    vk::PhysicalDeviceShaderModuleIdentifierFeaturesEXT shaderModuleIdentifierFeatures{ .shaderModuleIdentifier = VK_TRUE };
+    void* featureChain = nullptr;
+    if (m_usePresentWait) {
+        featureChain = &presentWaitFeatures;
+    }
+    if (m_capabilities.shaderModuleIdentifier) {
+        shaderModuleIdentifierFeatures.pNext = featureChain;
+        featureChain = &shaderModuleIdentifierFeatures;
+    }
+    if (m_capabilities.dynamicRendering || m_capabilities.shaderModuleIdentifier) {
+        vulkan13Features.pNext = featureChain;
+        featureChain = &vulkan13Features;
+    }
+
+    // NOTE: Headless doesn't need VK_KHR_swapchain
+    std::pmr::vector<const char*> extensions(&m_scratch);
+    if (m_isHeadless == false) {
+        extensions.insert(extensions.end(), kDeviceExtensions.begin(), kDeviceExtensions.end());
+    }
+    if (m_capabilities.memoryBudget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (m_usePresentWait) {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+    if (m_capabilities.shaderModuleIdentifier) {
+        extensions.push_back(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME);
+    }
 
     // DIFFERENCE: Skipped enabling validation layers for device, since there is no need to do that in modern Vulkan
-    vk::DeviceCreateInfo deviceinfo{ .queueCreateInfoCount = static_cast<ui32>(queueInfos.size()),
+    vk::DeviceCreateInfo deviceinfo{ .pNext = featureChain,
+                                     .queueCreateInfoCount = static_cast<ui32>(queueInfos.size()),
                                      .pQueueCreateInfos = queueInfos.data(),
-                                     .enabledExtensionCount = static_cast<ui32>(kDeviceExtensions.size()),
-                                     .ppEnabledExtensionNames = kDeviceExtensions.data(),
+                                     .enabledExtensionCount = static_cast<ui32>(extensions.size()),
+                                     .ppEnabledExtensionNames = extensions.data(),
                                      .pEnabledFeatures = &device_features };
 
-    m_device = m_physicalDevice.createDevice(deviceinfo);
+    m_device = m_physicalDevice.createDevice(deviceinfo, m_allocationCallbacks);
 
     // NOTE: m_graphicsQueue and m_presentQueue can hold the same value
-    m_graphicsQueue = m_device.getQueue(indices.graphicsFamily.value(), 0);
-    m_presentQueue = m_device.getQueue(indices.presentFamily.value(), 0);
+    m_graphicsQueue = m_device.getQueue(m_capabilities.graphicsQueueFamily, 0);
+    m_presentQueue = m_device.getQueue(m_capabilities.presentQueueFamily, 0);
+
+    // NOTE: Extension entry points aren't exported by the loader, with the static dispatcher they're fetched by hand
+    if (m_usePresentWait) {
+        m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(m_device.getProcAddr("vkWaitForPresentKHR"));
+        m_usePresentWait = m_waitForPresent != nullptr;
+    }
+    PFN_vkGetShaderModuleCreateInfoIdentifierEXT getShaderIdentifier = nullptr;
+    if (m_capabilities.shaderModuleIdentifier) {
+        getShaderIdentifier = reinterpret_cast<PFN_vkGetShaderModuleCreateInfoIdentifierEXT>(
+            m_device.getProcAddr("vkGetShaderModuleCreateInfoIdentifierEXT"));
+    }
+    m_shaderRegistry.Init(m_device, getShaderIdentifier, m_allocationCallbacks);
+
+    m_allocator.Init(m_physicalDevice, m_device, m_allocationCallbacks, m_capabilities.memoryBudget);
+    m_textureManager.Init(m_physicalDevice, m_device, m_allocator, device_features, *m_jobSystem, m_allocationCallbacks);
+}
+
+// NOTE: A file that can't be read or is for another device or driver is ignored, the cache just starts out empty
+void VkBackend::_CreatePipelineCache(const std::string& path)
+{
+    ScratchScope scratch(m_scratch);
+
+    m_pipelineCachePath = path;
+    m_pipelineCacheBytesLoaded = 0;
+
+    std::pmr::vector<char> data(&m_scratch);
+    if (path.empty() == false) {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+        std::ifstream file(path, std::ios::binary | std::ios::in);
+        if (!error && file) {
+            data.resize(size);
+            file.read(data.data(), static_cast<std::streamsize>(size));
+            if (!file || _isPipelineCacheCompatible(data, m_deviceProperties) == false) {
+                data.clear();
+            }
+        }
+    }
+
+    const vk::PipelineCacheCreateInfo pipelineCacheInfo{ .initialDataSize = data.size(),
+                                                         .pInitialData = data.data() };
+    m_pipelineCache = m_device.createPipelineCache(pipelineCacheInfo, m_allocationCallbacks);
+    m_pipelineCacheBytesLoaded = data.size();
 }
 
-// TODO: Remove this width/height shit
-void VkBackend::_CreateSwapchain(ui32 width, ui32 height)
+// NOTE: Shutdown can't fail, a cache that isn't written only costs the next run its pipeline compiles
+void VkBackend::_SavePipelineCache()
 {
-    const auto swapchainSupport = _querySwapchainSupport(m_physicalDevice, m_surface);
+    if (m_pipelineCachePath.empty()) {
+        return;
+    }
+
+    const auto data = m_device.getPipelineCacheData(m_pipelineCache);
+    std::ofstream file(m_pipelineCachePath, std::ios::binary | std::ios::out | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
 
-    const auto surfaceFormat = _chooseSurfaceFormat(swapchainSupport.formats);
-    const auto presentMode = _choosePresentMode(swapchainSupport.presentModes);
-    const auto extent = _chooseSurfaceExtent(swapchainSupport.capabilities, width, height);
+// NOTE: Captures and on-demand copies only ever use the main view, the other views' images are only rendered to
+void VkBackend::_CreateSwapchain(ui32 viewIndex)
+{
+    ScratchScope scratch(m_scratch);
+
+    auto& view = m_views[viewIndex];
+    const bool isMainView = viewIndex == 0;
+    const auto swapchainSupport = _querySwapchainSupport(m_physicalDevice, view.surface, &m_scratch);
+
+    // NOTE: Every view has to share the main view's pipelines, so the other surfaces have to take its format
+    auto surfaceFormat = _chooseSurfaceFormat(swapchainSupport.formats);
+    if (isMainView == false) {
+        const auto format = std::find_if(swapchainSupport.formats.begin(), swapchainSupport.formats.end(),
+                                         [this](const vk::SurfaceFormatKHR& available) {
+                                             return available.format == m_views[0].format;
+                                         });
+        if (format == swapchainSupport.formats.end()) {
+            throw std::runtime_error("VkBackend::_CreateSwapchain(): A view's surface doesn't support the main view's format!");
+        }
+        surfaceFormat = *format;
+    }
+    const auto extent = _chooseSurfaceExtent(swapchainSupport.capabilities, view.window->GetWidth(), view.window->GetHeight());
     // NOTE: Quiestionable
     // TODO: Shouldn't imageCount be in sync with kMaxFramesInFlight ?
     ui32 imageCount = swapchainSupport.capabilities.minImageCount + 1;
@@ -377,24 +1174,44 @@ void VkBackend::_CreateSwapchain(ui32 width, ui32 height)
         imageCount = swapchainSupport.capabilities.maxImageCount;
     }
 
-    vk::SwapchainCreateInfoKHR swapchainInfo{ .surface = m_surface,
+    // NOTE: Captures copy out of the swapchain images and on-demand rendering copies both ways,
+    //  each is turned off when the surface doesn't allow that
+    const auto supportedUsage = swapchainSupport.capabilities.supportedUsageFlags;
+    const auto copyUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+    auto imageUsage = vk::ImageUsageFlags(vk::ImageUsageFlagBits::eColorAttachment);
+    if (isMainView) {
+        m_useFrameCapture = m_useFrameCapture && (supportedUsage & vk::ImageUsageFlagBits::eTransferSrc);
+        m_isOnDemand = m_isOnDemand && (supportedUsage & copyUsage) == copyUsage;
+        if (m_useFrameCapture) {
+            imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+        }
+        if (m_isOnDemand) {
+            imageUsage |= copyUsage;
+        }
+    }
+    const auto presentMode = _choosePresentMode(swapchainSupport.presentModes, m_isOnDemand);
+
+    vk::SwapchainCreateInfoKHR swapchainInfo{ .surface = view.surface,
                                               .minImageCount = imageCount,
                                               .imageFormat = surfaceFormat.format,
                                               .imageColorSpace = surfaceFormat.colorSpace,
                                               .imageExtent = extent,
                                               .imageArrayLayers = 1, // NOTE: Always 1, unless it's 3D stereoscopic app
-                                              .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+                                              .imageUsage = imageUsage,
                                               .preTransform = swapchainSupport.capabilities.currentTransform, // NOTE: Seems like this is for mobile
                                               .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque, // NOTE: 'Opaque' is not guaranteed to be supported
                                               .presentMode = presentMode,
                                               .clipped = VK_TRUE,
                                               .oldSwapchain = nullptr };
 
-    // TODO: Nice one tutorial, query same shit for third time
-    const auto indices = _getRequiredQueueFamilies(m_physicalDevice, m_surface);
-    const ui32 familyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    const ui32 familyIndices[] = { m_capabilities.graphicsQueueFamily, m_capabilities.presentQueueFamily };
+
+    // NOTE: Every swapchain is presented from the main view's present queue
+    if (m_physicalDevice.getSurfaceSupportKHR(m_capabilities.presentQueueFamily, view.surface) == VK_FALSE) {
+        throw std::runtime_error("VkBackend::_CreateSwapchain(): A view's surface can't be presented from the present queue!");
+    }
 
-    if (indices.graphicsFamily != indices.presentFamily) {
+    if (m_capabilities.graphicsQueueFamily != m_capabilities.presentQueueFamily) {
         swapchainInfo.imageSharingMode = vk::SharingMode::eConcurrent;
         swapchainInfo.queueFamilyIndexCount = 2;
         swapchainInfo.pQueueFamilyIndices = familyIndices;
@@ -402,15 +1219,45 @@ void VkBackend::_CreateSwapchain(ui32 width, ui32 height)
         swapchainInfo.imageSharingMode = vk::SharingMode::eExclusive;
     }
 
-    m_swapchain = m_device.createSwapchainKHR(swapchainInfo);
-    m_swapchainFormat = surfaceFormat.format;
-    m_swapchainExtent = extent;
+    view.swapchain = m_device.createSwapchainKHR(swapchainInfo, m_allocationCallbacks);
+    view.format = surfaceFormat.format;
+    view.extent = extent;
+
+    view.images = m_device.getSwapchainImagesKHR(view.swapchain);
+}
 
-    m_swapchainImages = m_device.getSwapchainImagesKHR(m_swapchain);
+// NOTE: Stands in for the swapchain when there is no window, the rest of the backend can't tell the difference
+void VkBackend::_CreateOffscreenImages(ui32 viewIndex, ui32 width, ui32 height, vk::Format format)
+{
+    auto& view = m_views[viewIndex];
+    view.format = format;
+    view.extent = vk::Extent2D{ .width = width, .height = height };
+
+    const vk::ImageCreateInfo imageInfo{ .imageType = vk::ImageType::e2D,
+                                         .format = view.format,
+                                         .extent = { .width = width, .height = height, .depth = 1 },
+                                         .mipLevels = 1,
+                                         .arrayLayers = 1,
+                                         .samples = vk::SampleCountFlagBits::e1,
+                                         .tiling = vk::ImageTiling::eOptimal,
+                                         .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                                         .sharingMode = vk::SharingMode::eExclusive,
+                                         .initialLayout = vk::ImageLayout::eUndefined };
+
+    view.images.resize(kOffscreenImageCount);
+    view.offscreenAllocations.resize(kOffscreenImageCount);
+    for (ui32 i = 0; i < kOffscreenImageCount; ++i) {
+        view.images[i] = m_allocator.CreateImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::RenderTargets,
+                                                 view.offscreenAllocations[i]);
+    }
+    // NOTE: The render thread moves on before rendering, so the first frame gets image 0
+    view.imageIndex = kOffscreenImageCount - 1;
 }
 
-void VkBackend::_CreateImageViews()
+void VkBackend::_CreateImageViews(ui32 viewIndex)
 {
+    auto& view = m_views[viewIndex];
+
     vk::ComponentMapping componentMapping{ .r = vk::ComponentSwizzle::eIdentity,
                                            .g = vk::ComponentSwizzle::eIdentity,
                                            .b = vk::ComponentSwizzle::eIdentity,
@@ -423,53 +1270,273 @@ void VkBackend::_CreateImageViews()
                                                 .layerCount = 1 };
 
     vk::ImageViewCreateInfo imageViewInfo{ .viewType = vk::ImageViewType::e2D,
-                                           .format = m_swapchainFormat,
+                                           .format = view.format,
                                            .components = componentMapping,
                                            .subresourceRange = subresourceRange };
 
-    m_swapchainImageViews.reserve(m_swapchainImages.size());
+    view.imageViews.reserve(view.images.size());
 
-    for (const auto& swapchainImage : m_swapchainImages) {
+    for (const auto& swapchainImage : view.images) {
         imageViewInfo.image = swapchainImage;
-        m_swapchainImageViews.push_back(m_device.createImageView(imageViewInfo));
+        view.imageViews.push_back(m_device.createImageView(imageViewInfo, m_allocationCallbacks));
+    }
+}
+
+// NOTE: Same size and format as the swapchain images, only ever copied to and from
+void VkBackend::_CreateFrameCache()
+{
+    if (m_isOnDemand == false) {
+        return;
     }
+
+    const auto& mainView = m_views[0];
+    const vk::ImageCreateInfo imageInfo{ .imageType = vk::ImageType::e2D,
+                                         .format = mainView.format,
+                                         .extent = { .width = mainView.extent.width, .height = mainView.extent.height, .depth = 1 },
+                                         .mipLevels = 1,
+                                         .arrayLayers = 1,
+                                         .samples = vk::SampleCountFlagBits::e1,
+                                         .tiling = vk::ImageTiling::eOptimal,
+                                         .usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
+                                         .sharingMode = vk::SharingMode::eExclusive,
+                                         .initialLayout = vk::ImageLayout::eUndefined };
+
+    m_frameCacheImage = m_allocator.CreateImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::RenderTargets,
+                                                m_frameCacheAllocation);
 }
 
-void VkBackend::_CreateRenderPass()
+// NOTE: The frame is declared as a graph of passes, the graph creates render passes, framebuffers and barriers.
+//  It is declared and compiled once here, the render thread only executes it into every frame's command buffer.
+//  Pipelines and cached secondaries are created against its render passes, so its shape stays fixed after Init().
+// NOTE: The main view's graph has every pass, the other views' only the forward pass, drawn without meshlet culling
+void VkBackend::_CreateRenderGraph(ui32 viewIndex)
 {
-    vk::AttachmentDescription colorAttachment{ .format = m_swapchainFormat,
-                                               .samples = vk::SampleCountFlagBits::e1,
-                                               .loadOp = vk::AttachmentLoadOp::eClear,
-                                               .storeOp = vk::AttachmentStoreOp::eStore,
-                                               .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
-                                               .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-                                               .initialLayout = vk::ImageLayout::eUndefined,    // NOTE: undefined ???
-                                               .finalLayout = vk::ImageLayout::ePresentSrcKHR };
-    // NOTE: This attachment references fragment shader 'layout(location=0) out vec4 outColor' string
-    vk::AttachmentReference colorRef{ .attachment = 0,
-                                      .layout = vk::ImageLayout::eColorAttachmentOptimal };
+    auto& view = m_views[viewIndex];
+    auto& renderGraph = view.renderGraph;
+    const bool isMainView = viewIndex == 0;
+
+    renderGraph.Reset();
+    renderGraph.SetDynamicRendering(m_capabilities.dynamicRendering);
+    renderGraph.SetAllocationCallbacks(m_allocationCallbacks);
+
+    const RGImageDesc backbufferDesc{ .format = view.format,
+                                      .extent = view.extent };
+    // NOTE: Offscreen frames end up ready to be copied out instead of presented
+    const auto backbufferLayout = view.swapchain ? vk::ImageLayout::ePresentSrcKHR : vk::ImageLayout::eTransferSrcOptimal;
+    view.backbuffer = renderGraph.ImportImage("Backbuffer", backbufferDesc, backbufferLayout);
+    if (isMainView && m_isOnDemand) {
+        m_frameCache = renderGraph.ImportImage("FrameCache", backbufferDesc, vk::ImageLayout::eTransferSrcOptimal);
+    }
+
+    // NOTE: Without occlusion culling it only lives inside the forward pass, so the graph makes it a lazily allocated
+    //  transient attachment. With it the Hi-Z build samples it between the two forward passes.
+    const RGImageDesc depthDesc{ .format = m_capabilities.depthFormat,
+                                 .extent = view.extent };
+    view.depthBuffer = renderGraph.CreateImage("Depth", depthDesc);
+
+    // NOTE: Writes buffers only, which the graph doesn't track, so the barrier is recorded here and the pass is kept alive
+    auto addMeshletCullPass = [this, &renderGraph](const char* name, ui32 phase) {
+        renderGraph.AddPass(name,
+            [](RenderGraph::PassBuilder& builder) {
+                builder.SideEffect();
+            },
+            [this, phase](const RGContext& context) {
+                const auto& commandBuffer = context.commandBuffer;
+                const auto& viewSnapshot = m_renderSnapshot->views[0];
+                const auto jobCount = static_cast<ui32>(viewSnapshot.draws.size());
+                if (jobCount == 0) {
+                    return;
+                }
+
+                const auto& uniforms = viewSnapshot.uniforms;
+                const glm::mat4 viewProjection = uniforms.projection * uniforms.view;
+                const Frustum frustum = ExtractFrustumPlanes(&viewProjection[0][0]);
+
+                MeshletCullConstants constants{ .planes = {},
+                                                .eye = glm::inverse(uniforms.view)[3],
+                                                .statsSlot = m_currentFrameData,
+                                                .phase = phase,
+                                                .drawBase = phase == kCullPhaseLate ? m_meshletDrawCapacity : 0 };
+                std::memcpy(constants.planes, frustum.planes, sizeof(constants.planes));
+
+                // NOTE: The visibility the early phase reads was written by the previous frame's late phase
+                if (phase == kCullPhaseEarly) {
+                    const vk::MemoryBarrier visibilityBarrier{ .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                                               .dstAccessMask = vk::AccessFlagBits::eShaderRead };
+                    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                                  vk::DependencyFlags(), visibilityBarrier, nullptr, nullptr);
+                }
+
+                commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_meshletCullPipeline);
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_meshletCullLayout, 0, 1, &m_views[0].descriptorSets[context.imageIndex], 0, nullptr);
+                commandBuffer.pushConstants(m_meshletCullLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+                commandBuffer.dispatch(jobCount, 1, 1);
+
+                const vk::MemoryBarrier barrier{ .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                                 .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead };
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                              vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost,
+                                              vk::DependencyFlags(), barrier, nullptr, nullptr);
+            });
+    };
+
+    // NOTE: The early phase only draws opaque objects, the late one everything the early phase didn't
+    const bool isMeshletCulled = isMainView && m_useMeshletCulling;
+    auto recordDraws = [this, viewIndex, isMeshletCulled](const RGContext& context, ui32 phase) {
+        const auto& commandBuffer = context.commandBuffer;
+        const auto& view = m_views[viewIndex];
+        const auto& draws = m_renderSnapshot->views[viewIndex].draws;
+
+        const auto transparentBegin = std::partition_point(draws.begin(), draws.end(), [this](const DrawCommand& command) {
+            return m_sceneObjects[command.object].isTransparent == false;
+        });
+        const std::array<std::span<const DrawCommand>, kBucketCount> buckets{ std::span(draws.begin(), transparentBegin),
+                                                                              std::span(transparentBegin, draws.end()) };
+        const ui32 bucketCount = phase == kCullPhaseEarly ? 1 : kBucketCount;
+
+        // NOTE: Same order the cull jobs were written in, so every draw finds its meshlets' commands at these offsets
+        constexpr auto drawStride = static_cast<vk::DeviceSize>(sizeof(vk::DrawIndexedIndirectCommand));
+        std::array<vk::DeviceSize, kBucketCount> drawOffsets{};
+        drawOffsets[kBucketOpaque] = phase == kCullPhaseLate ? m_meshletDrawCapacity * drawStride : 0;
+        drawOffsets[kBucketTransparent] = drawOffsets[kBucketOpaque];
+        if (isMeshletCulled) {
+            for (const auto& command : buckets[kBucketOpaque]) {
+                drawOffsets[kBucketTransparent] += m_meshLods[command.mesh].meshletCount[command.lod] * drawStride;
+            }
+        }
+
+        if (m_useCommandCache == false) {
+            _RecordDrawState(commandBuffer, viewIndex, context.imageIndex);
+            for (ui32 i = 0; i < bucketCount; ++i) {
+                _RecordDraws(commandBuffer, buckets[i], context.imageIndex, isMeshletCulled, drawOffsets[i]);
+            }
+            return;
+        }
+
+        // NOTE: The frame's fence was waited for, so none of its slots is pending. A bucket that draws the same as the last
+        //  time this frame slot rendered this image is executed without recording anything.
+        const auto& formats = view.forwardFormats;
+        const vk::CommandBufferInheritanceRenderingInfo renderingInfo{ .colorAttachmentCount = formats.colorCount,
+                                                                       .pColorAttachmentFormats = formats.colorFormats.data(),
+                                                                       .depthAttachmentFormat = formats.depthFormat,
+                                                                       .rasterizationSamples = vk::SampleCountFlagBits::e1 };
+        const vk::CommandBufferInheritanceInfo inheritance{ .pNext = m_capabilities.dynamicRendering ? &renderingInfo : nullptr,
+                                                            .renderPass = phase == kCullPhaseLate ? view.forwardLateRenderPass
+                                                                                                  : view.forwardRenderPass,
+                                                            .subpass = 0,
+                                                            .pipelineStatistics = m_usePipelineStatistics && viewIndex == 0
+                                                                                ? kPipelineStatistics
+                                                                                : vk::QueryPipelineStatisticFlags() };
+
+        const ui32 imageSlot = m_currentFrameData * static_cast<ui32>(view.images.size()) + context.imageIndex;
+        const ui32 passSlot = phase == kCullPhaseLate ? 1 : 0;
+        const ui32 firstSlot = view.commandCacheSlot + (imageSlot * kCachedPassCount + passSlot) * kBucketCount;
+        for (ui32 i = 0; i < bucketCount; ++i) {
+            if (buckets[i].empty()) {
+                continue;
+            }
+
+            const auto cached = m_commandCache.Acquire(firstSlot + i, _hashDraws(buckets[i], drawOffsets[i]),
+                                                       static_cast<ui32>(buckets[i].size()), inheritance);
+            if (cached.isRecording) {
+                _RecordDrawState(cached.commandBuffer, viewIndex, context.imageIndex);
+                _RecordDraws(cached.commandBuffer, buckets[i], context.imageIndex, isMeshletCulled, drawOffsets[i]);
+                m_commandCache.EndRecording();
+            }
+            commandBuffer.executeCommands(cached.commandBuffer);
+        }
+    };
+
+    const ui32 firstPhase = isMainView && m_useOcclusionCulling ? kCullPhaseEarly : kCullPhaseSingle;
+    if (isMeshletCulled) {
+        addMeshletCullPass(kMeshletCullPassName, firstPhase);
+    }
 
-    // NOTE: I'm not quite sure what this shit does
-    //vk::SubpassDependency dependency{ .srcSubpass = VK_SUBPASS_EXTERNAL,
-    //                                  .dstSubpass = 0,
-    //                                  .srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
-    //                                  .dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
-    //                                  /*.srcAccessMask = vk::AccessFlags(),*/ // TODO: I DONT FUCKING KNOW WHAT FLAG CORRESPONDS TO '0' NICE TUTORIAL
-    //                                  .srcAccessMask = vk::AccessFlagBits::eColorAttachmentRead,
-    //                                  .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite };
+    renderGraph.AddPass(kForwardPassName,
+        [this, &view](RenderGraph::PassBuilder& builder) {
+            builder.WriteColor(view.backbuffer, vk::AttachmentLoadOp::eClear);
+            builder.WriteDepth(view.depthBuffer, vk::AttachmentLoadOp::eClear);
+            if (m_useCommandCache) {
+                builder.ExecuteSecondaries();
+            }
+        },
+        [recordDraws, firstPhase](const RGContext& context) {
+            recordDraws(context, firstPhase);
+        });
+
+    if (isMainView == false) {
+        renderGraph.Compile(m_physicalDevice, m_device);
+        view.forwardRenderPass = renderGraph.GetRenderPass(kForwardPassName);
+        view.forwardFormats = renderGraph.GetAttachmentFormats(kForwardPassName);
+        return;
+    }
+
+    if (m_useOcclusionCulling) {
+        // NOTE: Timestamps go around the dispatches only, the depth barrier the graph records before them isn't included
+        renderGraph.AddPass(kHiZPassName,
+            [&view](RenderGraph::PassBuilder& builder) {
+                builder.ReadTexture(view.depthBuffer, vk::PipelineStageFlagBits::eComputeShader);
+                builder.SideEffect();
+            },
+            [this](const RGContext& context) {
+                const ui32 firstQuery = kTimestampsPerFrame * m_currentFrameData + 2;
+                if (m_timestampQueryPool) {
+                    context.commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_timestampQueryPool, firstQuery);
+                }
+                m_depthPyramid.Build(context.commandBuffer);
+                if (m_timestampQueryPool) {
+                    context.commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_timestampQueryPool, firstQuery + 1);
+                }
+            });
+
+        addMeshletCullPass(kMeshletCullLatePassName, kCullPhaseLate);
+
+        renderGraph.AddPass(kForwardLatePassName,
+            [this, &view](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(view.backbuffer, vk::AttachmentLoadOp::eLoad);
+                builder.WriteDepth(view.depthBuffer, vk::AttachmentLoadOp::eLoad);
+                if (m_useCommandCache) {
+                    builder.ExecuteSecondaries();
+                }
+            },
+            [recordDraws](const RGContext& context) {
+                recordDraws(context, kCullPhaseLate);
+            });
+    }
 
-    vk::SubpassDescription subpass{ .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
-                                    .colorAttachmentCount = 1,
-                                    .pColorAttachments = &colorRef };
+    // NOTE: The graph moves the backbuffer to eTransferSrcOptimal every frame, the copy is only recorded for captured frames
+    if (m_useFrameCapture) {
+        renderGraph.AddPass(kCapturePassName,
+            [&view](RenderGraph::PassBuilder& builder) {
+                builder.ReadTransfer(view.backbuffer);
+                builder.SideEffect();
+            },
+            [this, &view](const RGContext& context) {
+                if (m_renderSnapshot->isCaptured) {
+                    m_frameCapture.Record(context.commandBuffer, view.images[context.imageIndex], m_currentFrameData,
+                                          m_renderSnapshot->frameIndex);
+                }
+            });
+    }
 
-    vk::RenderPassCreateInfo renderPassInfo{ .attachmentCount = 1,
-                                             .pAttachments = &colorAttachment,
-                                             .subpassCount = 1,
-                                             .pSubpasses = &subpass,
-                                             /*.dependencyCount = 1,
-                                             .pDependencies = &dependency*/ };
+    // NOTE: Every drawn frame is kept, PresentLastFrame() copies it back without rendering anything
+    if (m_isOnDemand) {
+        renderGraph.AddPass(kCacheFramePassName,
+            [this, &view](RenderGraph::PassBuilder& builder) {
+                builder.ReadTransfer(view.backbuffer);
+                builder.WriteTransfer(m_frameCache);
+            },
+            [this, &view](const RGContext& context) {
+                const vk::ImageCopy region = _makeFullImageCopy(view.extent);
+                context.commandBuffer.copyImage(view.images[context.imageIndex], vk::ImageLayout::eTransferSrcOptimal,
+                                                m_frameCacheImage, vk::ImageLayout::eTransferDstOptimal, region);
+            });
+    }
 
-    m_renderPass = m_device.createRenderPass(renderPassInfo);
+    renderGraph.Compile(m_physicalDevice, m_device);
+    view.forwardRenderPass = renderGraph.GetRenderPass(kForwardPassName);
+    view.forwardLateRenderPass = m_useOcclusionCulling ? renderGraph.GetRenderPass(kForwardLatePassName) : nullptr;
+    view.forwardFormats = renderGraph.GetAttachmentFormats(kForwardPassName);
 }
 
 
@@ -479,30 +1546,68 @@ void VkBackend::_CreateDescriptorSetLayout()
     vk::DescriptorSetLayoutBinding uboLayoutBinding{ .binding = 0,
                                                      .descriptorType = vk::DescriptorType::eUniformBuffer,
                                                      .descriptorCount = 1,
-                                                     .stageFlags = vk::ShaderStageFlagBits::eVertex,
+                                                     .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute,
                                                      .pImmutableSamplers = nullptr};
+    vk::DescriptorSetLayoutBinding albedoLayoutBinding{ .binding = 1,
+                                                        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                                        .descriptorCount = 1,
+                                                        .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                                                        .pImmutableSamplers = nullptr };
+    vk::DescriptorSetLayoutBinding transformsLayoutBinding{ .binding = 2,
+                                                            .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                                            .descriptorCount = 1,
+                                                            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute,
+                                                            .pImmutableSamplers = nullptr };
+    // NOTE: Meshlets, cull jobs, indirect draws, culled counts and object visibility, only the meshlet cull pass uses them
+    vk::DescriptorSetLayoutBinding meshletLayoutBindings[5];
+    for (ui32 i = 0; i < 5; ++i) {
+        meshletLayoutBindings[i] = vk::DescriptorSetLayoutBinding{ .binding = 3 + i,
+                                                                   .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                                                   .descriptorCount = 1,
+                                                                   .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                                                                   .pImmutableSamplers = nullptr };
+    }
+    vk::DescriptorSetLayoutBinding depthPyramidLayoutBinding{ .binding = 8,
+                                                              .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                                              .descriptorCount = 1,
+                                                              .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                                                              .pImmutableSamplers = nullptr };
+    // NOTE: Fragment counters of the overdraw shader
+    vk::DescriptorSetLayoutBinding overdrawLayoutBinding{ .binding = 9,
+                                                          .descriptorType = vk::DescriptorType::eStorageBuffer,
+                                                          .descriptorCount = 1,
+                                                          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                                                          .pImmutableSamplers = nullptr };
+    vk::DescriptorSetLayoutBinding layoutBindings[] = { uboLayoutBinding, albedoLayoutBinding, transformsLayoutBinding,
+                                                        meshletLayoutBindings[0], meshletLayoutBindings[1],
+                                                        meshletLayoutBindings[2], meshletLayoutBindings[3],
+                                                        meshletLayoutBindings[4], depthPyramidLayoutBinding,
+                                                        overdrawLayoutBinding };
+
+    // NOTE: Binding numbers don't have to be contiguous, the overdraw one follows whatever bindings are there
+    ui32 bindingCount = m_useMeshletCulling ? 9u : 3u;
+    if (m_useOverdraw) {
+        layoutBindings[bindingCount++] = overdrawLayoutBinding;
+    }
 
-    vk::DescriptorSetLayoutCreateInfo descriptorLayoutInfo{ .bindingCount = 1,
-                                                            .pBindings = &uboLayoutBinding };
+    vk::DescriptorSetLayoutCreateInfo descriptorLayoutInfo{ .bindingCount = bindingCount,
+                                                            .pBindings = layoutBindings };
 
-    m_descriptorSetLayout = m_device.createDescriptorSetLayout(descriptorLayoutInfo);
+    m_descriptorSetLayout = m_device.createDescriptorSetLayout(descriptorLayoutInfo, m_allocationCallbacks);
 }
 
 void VkBackend::_CreateGraphicsPipeline()
 {
-    const auto vertShaderCode = _readShaderFile(kShaderVertexPath);
-    const auto fragShaderCode = _readShaderFile(kShaderFragmentPath);
-
-    const auto vertShaderModule = _createShaderModule(vertShaderCode, m_device);
-    const auto fragShaderModule = _createShaderModule(fragShaderCode, m_device);
+    // NOTE: The registry fills in the modules, or the identifiers when the pipelines may be in the cache already
+    //  The overdraw shader replaces the shading of both pipelines
+    const ShaderHandle shaders[] = { m_shaderRegistry.Load(kShaderVertexPath),
+                                     m_shaderRegistry.Load(m_useOverdraw ? kShaderOverdrawPath : kShaderFragmentPath) };
 
     // NOTE: .pSpecializationInfo allows specify values for shader constants, it can be more efficient
     vk::PipelineShaderStageCreateInfo vertShaderStage{ .stage = vk::ShaderStageFlagBits::eVertex,
-                                                       .module = vertShaderModule.get(),
                                                        .pName = "main" };
 
     vk::PipelineShaderStageCreateInfo fragShaderStage{ .stage = vk::ShaderStageFlagBits::eFragment,
-                                                       .module = fragShaderModule.get(),
                                                        .pName = "main" };
     vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStage, fragShaderStage };
 
@@ -516,20 +1621,11 @@ void VkBackend::_CreateGraphicsPipeline()
 
     vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState{ .topology = vk::PrimitiveTopology::eTriangleList,
                                                                  .primitiveRestartEnable = VK_FALSE };
-    vk::Viewport viewport{ .x = 0.0f,
-                           .y = 0.0f,
-                           .width = static_cast<f32>(m_swapchainExtent.width),
-                           .height = static_cast<f32>(m_swapchainExtent.height),
-                           .minDepth = 0.0f,
-                           .maxDepth = 1.0f };
-
-    vk::Rect2D scissor{ .offset = {0, 0},
-                        .extent = m_swapchainExtent };
-
+    // NOTE: Viewport and scissor are dynamic, the forward pass sets them to its view's extent
     vk::PipelineViewportStateCreateInfo viewportState{ .viewportCount = 1,
-                                                       .pViewports = &viewport,
+                                                       .pViewports = nullptr,
                                                        .scissorCount = 1,
-                                                       .pScissors = &scissor };
+                                                       .pScissors = nullptr };
     // NOTE: How the fuck the inversion of Y-axis affects frontFace (or it can be fixed by changing cullMode to eFront)
     vk::PipelineRasterizationStateCreateInfo rasterizationState{ .depthClampEnable = VK_FALSE,
                                                                  .rasterizerDiscardEnable = VK_FALSE,
@@ -545,123 +1641,314 @@ void VkBackend::_CreateGraphicsPipeline()
     vk::PipelineMultisampleStateCreateInfo multisampleState{ .rasterizationSamples = vk::SampleCountFlagBits::e1,
                                                              .sampleShadingEnable = VK_FALSE };
 
-    //vk::PipelineDepthStencilStateCreateInfo
+    vk::PipelineDepthStencilStateCreateInfo depthStencilState{ .depthTestEnable = VK_TRUE,
+                                                               .depthWriteEnable = VK_TRUE,
+                                                               .depthCompareOp = vk::CompareOp::eLess,
+                                                               .depthBoundsTestEnable = VK_FALSE,
+                                                               .stencilTestEnable = VK_FALSE };
 
     vk::ColorComponentFlags colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
         | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
     vk::PipelineColorBlendAttachmentState colorBlendAttachment{ .blendEnable = VK_FALSE,
                                                                 .colorWriteMask = colorWriteMask };
+    // NOTE: Overdraw, every fragment that passes the depth test adds its step to the pixel, opaque or not
+    if (m_useOverdraw) {
+        colorBlendAttachment = vk::PipelineColorBlendAttachmentState{ .blendEnable = VK_TRUE,
+                                                                      .srcColorBlendFactor = vk::BlendFactor::eOne,
+                                                                      .dstColorBlendFactor = vk::BlendFactor::eOne,
+                                                                      .colorBlendOp = vk::BlendOp::eAdd,
+                                                                      .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+                                                                      .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+                                                                      .alphaBlendOp = vk::BlendOp::eAdd,
+                                                                      .colorWriteMask = colorWriteMask };
+    }
 
     vk::PipelineColorBlendStateCreateInfo colorBlendState{ .logicOpEnable = VK_FALSE,
                                                            .logicOp = vk::LogicOp::eCopy,
                                                            .attachmentCount = 1,
                                                            .pAttachments = &colorBlendAttachment };
 
+    vk::PushConstantRange pushConstantRange{ .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                                             .offset = 0,
+                                             .size = sizeof(PushConstants) };
+
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo{ .setLayoutCount = 1,
-                                                     .pSetLayouts = &m_descriptorSetLayout };
+                                                     .pSetLayouts = &m_descriptorSetLayout,
+                                                     .pushConstantRangeCount = 1,
+                                                     .pPushConstantRanges = &pushConstantRange };
 
-    m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
+    m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo, m_allocationCallbacks);
 
-    /*vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+    vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
 
     vk::PipelineDynamicStateCreateInfo dynamicStateInfo{ .dynamicStateCount = sizeof(dynamicStates) / sizeof(dynamicStates[0]),
-                                                         .pDynamicStates = dynamicStates };*/
-
-    vk::GraphicsPipelineCreateInfo graphicsPipelineInfo{ .stageCount = 2,
+                                                         .pDynamicStates = dynamicStates };
+
+    // NOTE: With dynamic rendering the pipeline only needs to know attachment formats instead of a render pass.
+    //  Every view's forward pass has the same formats, so its render pass is compatible with the main view's.
+    const auto& renderGraph = m_views[0].renderGraph;
+    const auto attachmentFormats = renderGraph.GetAttachmentFormats(kForwardPassName);
+    vk::PipelineRenderingCreateInfo renderingInfo{ .colorAttachmentCount = attachmentFormats.colorCount,
+                                                   .pColorAttachmentFormats = attachmentFormats.colorFormats.data(),
+                                                   .depthAttachmentFormat = attachmentFormats.depthFormat };
+
+    vk::GraphicsPipelineCreateInfo graphicsPipelineInfo{ .pNext = m_capabilities.dynamicRendering ? &renderingInfo : nullptr,
+                                                         .stageCount = 2,
                                                          .pStages = shaderStages,
                                                          .pVertexInputState = &vertexInputState,
                                                          .pInputAssemblyState = &inputAssemblyState,
                                                          .pViewportState = &viewportState,
                                                          .pRasterizationState = &rasterizationState,
                                                          .pMultisampleState = &multisampleState,
-                                                         .pDepthStencilState = nullptr,
+                                                         .pDepthStencilState = &depthStencilState,
                                                          .pColorBlendState = &colorBlendState,
-                                                         .pDynamicState = nullptr,
+                                                         .pDynamicState = &dynamicStateInfo,
                                                          .layout = m_pipelineLayout,
-                                                         .renderPass = m_renderPass,
+                                                         .renderPass = renderGraph.GetRenderPass(kForwardPassName),
                                                          .subpass = 0 };
+    m_pipelines.resize(kPipelineCount);
     // NOTE: Idk why I need this cast only there, everywhere else it just works LOOOOOOOOOOOOOOOOOOOOOOOOOOOL
-    m_pipeline = (vk::Pipeline&&)m_device.createGraphicsPipeline(nullptr, graphicsPipelineInfo);
-}
+    m_pipelines[kPipelineOpaque] = m_shaderRegistry.CreateGraphicsPipeline(m_pipelineCache, graphicsPipelineInfo, shaders);
+
+    // NOTE: Transparent draws are sorted back-to-front, they test against opaque depth but don't write it
+    if (m_useOverdraw == false) {
+        colorBlendAttachment.blendEnable = VK_TRUE;
+        colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+        colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+        colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+        colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+    }
+    depthStencilState.depthWriteEnable = VK_FALSE;
 
+    m_pipelines[kPipelineTransparent] = m_shaderRegistry.CreateGraphicsPipeline(m_pipelineCache, graphicsPipelineInfo, shaders);
+}
 
-void VkBackend::_CreateFramebuffers()
+void VkBackend::_CreateMeshletCullPipeline()
 {
-    m_framebuffers.reserve(m_swapchainImageViews.size());
+    m_meshletCullLayout = nullptr;
+    m_meshletCullPipeline = nullptr;
+    if (m_useMeshletCulling == false) {
+        return;
+    }
 
-    vk::ImageView attachments[1];
+    const ShaderHandle shader = m_shaderRegistry.Load(kShaderMeshletCullPath);
 
-    vk::FramebufferCreateInfo framebufferInfo{ .renderPass = m_renderPass,
-                                               .attachmentCount = 1,
-                                               .pAttachments = attachments,
-                                               .width = m_swapchainExtent.width,
-                                               .height = m_swapchainExtent.height,
-                                               .layers = 1 };
+    vk::PushConstantRange pushConstantRange{ .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                                             .offset = 0,
+                                             .size = sizeof(MeshletCullConstants) };
 
-    for (const auto& imageView : m_swapchainImageViews) {
-        attachments[0] = imageView;
-        m_framebuffers.push_back(m_device.createFramebuffer(framebufferInfo));
-    }
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{ .setLayoutCount = 1,
+                                                     .pSetLayouts = &m_descriptorSetLayout,
+                                                     .pushConstantRangeCount = 1,
+                                                     .pPushConstantRanges = &pushConstantRange };
+
+    m_meshletCullLayout = m_device.createPipelineLayout(pipelineLayoutInfo, m_allocationCallbacks);
+
+    vk::ComputePipelineCreateInfo computePipelineInfo{ .stage = { .stage = vk::ShaderStageFlagBits::eCompute,
+                                                                  .pName = "main" },
+                                                       .layout = m_meshletCullLayout };
+    m_meshletCullPipeline = m_shaderRegistry.CreateComputePipeline(m_pipelineCache, computePipelineInfo, shader);
 }
 
-void VkBackend::_CreateCommandPool()
+// NOTE: Sized to the main view and reads its graph's depth view, so it's rebuilt with them
+void VkBackend::_CreateDepthPyramid()
 {
-    // NOTE: Query same shit for the 4th time
-    const auto queueFamilyIndices = _getRequiredQueueFamilies(m_physicalDevice, m_surface);
-
-    vk::CommandPoolCreateInfo commandPoolInfo{ .flags = vk::CommandPoolCreateFlags(),
-                                               .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value() };
+    if (m_useOcclusionCulling == false) {
+        return;
+    }
 
-    m_commandPool = m_device.createCommandPool(commandPoolInfo);
+    const auto& mainView = m_views[0];
+    m_depthPyramid.Init(m_device, m_allocator, m_textureManager.GetSamplerCache(), mainView.extent, m_shaderRegistry,
+                        m_shaderRegistry.Load(kShaderHiZBuildPath), m_pipelineCache, m_allocationCallbacks);
+    m_depthPyramid.SetDepthView(mainView.renderGraph.GetImageView(mainView.depthBuffer));
 }
 
 
-void VkBackend::_CreateVertexBuffer()
+void VkBackend::_CreateCommandPool()
 {
-    vk::DeviceSize bufferSize = sizeof(kTriangleVertices[0]) * kTriangleVertices.size();
-
-    constexpr auto stagingProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    _createBuffer(m_physicalDevice, m_device, bufferSize, vk::BufferUsageFlagBits::eTransferSrc, stagingProperties, stagingBuffer, stagingBufferMemory);
+    vk::CommandPoolCreateInfo commandPoolInfo{ .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                               .queueFamilyIndex = m_capabilities.graphicsQueueFamily };
+
+    m_commandPool = m_device.createCommandPool(commandPoolInfo, m_allocationCallbacks);
+
+    // NOTE: A pool of its own, only the render thread records into it
+    if (m_useCommandCache) {
+        ui32 slotCount = 0;
+        for (ui32 i = 0; i < m_viewCount; ++i) {
+            auto& view = m_views[i];
+            view.commandCacheSlot = slotCount;
+            slotCount += static_cast<ui32>(kMaxFramesInFlight * view.images.size()) * kCachedPassCount * kBucketCount;
+        }
+        m_commandCache.Init(m_device, m_capabilities.graphicsQueueFamily, slotCount, m_allocationCallbacks);
+    }
+}
 
-    ui8* data = static_cast<ui8*>(m_device.mapMemory(stagingBufferMemory, 0, bufferSize));
-    std::memcpy(data, kTriangleVertices.data(), bufferSize);
-    //std::copy(kTriangleVertices.data(), kTriangleVertices.data() + bufferSize, data);
-    m_device.unmapMemory(stagingBufferMemory);
 
-    constexpr auto bufferUsage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer;
-    _createBuffer(m_physicalDevice, m_device, bufferSize, bufferUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, m_vertexBuffer, m_vertexBufferMemory);
+// NOTE: Every mesh gets its LOD chain appended to its indices, so the geometry pool can be sized for the whole scene
+//  up front and never grows. Without a scene it's just the quad, which has nothing to simplify.
+//  Every level is then split into meshlets, which reorders its triangles but keeps its index range.
+void VkBackend::_BuildMeshLods(const SyntheticScene* scene, const MeshLodDesc& lodDesc)
+{
+    auto& meshIndices = m_initAssets.meshIndices;
+    auto& meshlets = m_initAssets.meshlets;
+    meshIndices.clear();
+    meshlets.clear();
+    m_meshLods.clear();
+    m_lodStats = LodStats{ .trianglesSubmitted = 0, .trianglesWithoutLod = 0, .lodSwitches = 0, .levelCount = 0 };
+
+    auto addLods = [&](const std::vector<MeshLod>& lods, const f32* positions, ui32 vertexCount, std::vector<ui16>& indices) {
+        MeshLods meshLods{ .lodCount = static_cast<ui32>(lods.size()), .lods = {}, .firstMeshlet = {}, .meshletCount = {} };
+        for (ui32 lod = 0; lod < meshLods.lodCount; ++lod) {
+            meshLods.lods[lod] = lods[lod];
+            meshLods.firstMeshlet[lod] = static_cast<ui32>(meshlets.size());
+            BuildMeshlets(positions, vertexCount, 3, indices.data(), lods[lod].firstIndex, lods[lod].indexCount, meshlets);
+            meshLods.meshletCount[lod] = static_cast<ui32>(meshlets.size()) - meshLods.firstMeshlet[lod];
+        }
+        m_meshLods.push_back(meshLods);
+        m_lodStats.levelCount += meshLods.lodCount;
+    };
+
+    // NOTE: Scene meshes are flat, the simplifier and the meshlet bounds want xyz
+    std::vector<f32> positions;
+
+    if (scene == nullptr) {
+        for (const auto& vertex : kTriangleVertices) {
+            positions.insert(positions.end(), { vertex.position.x, vertex.position.y, 0.0f });
+        }
+        meshIndices.push_back(kTriangleIndices);
+        addLods({ MeshLod{ .firstIndex = 0, .indexCount = static_cast<ui32>(kTriangleIndices.size()), .error = 0.0f } },
+                positions.data(), static_cast<ui32>(kTriangleVertices.size()), meshIndices[0]);
+        return;
+    }
+
+    meshIndices.resize(scene->meshes.size());
+    std::vector<MeshLod> lods;
+    for (size_t i = 0; i < scene->meshes.size(); ++i) {
+        const auto& mesh = scene->meshes[i];
+        const auto meshVertexCount = static_cast<ui32>(mesh.positions.size() / 2);
+
+        positions.clear();
+        for (ui32 vertex = 0; vertex < meshVertexCount; ++vertex) {
+            positions.insert(positions.end(), { mesh.positions[2 * vertex], mesh.positions[2 * vertex + 1], 0.0f });
+        }
 
-    _copyBuffer(m_commandPool, m_device, m_graphicsQueue, stagingBuffer, m_vertexBuffer, bufferSize);
+        meshIndices[i] = mesh.indices;
+        BuildMeshLods(positions.data(), meshVertexCount, 3, meshIndices[i], lodDesc, lods);
+        addLods(lods, positions.data(), meshVertexCount, meshIndices[i]);
+    }
+}
+
+// NOTE: No image loading yet, so the albedo is a procedural checkerboard. Real assets would be compressed offline
+//  by tools/TextureCompressor and loaded with TextureContainer::Load(), here the container is built in place.
+void VkBackend::_BuildTextures()
+{
+    constexpr ui32 kTextureSize = 256;
+    constexpr ui32 kCellSize = 32;
 
-    m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+    const auto pixels = _makeCheckerboard(kTextureSize, kCellSize, std::pmr::get_default_resource());
+    m_initAssets.albedo = TextureContainer::Build(pixels.data(), kTextureSize, kTextureSize, true, true,
+                                                  { BlockFormat::BC7, BlockFormat::BC1 },
+                                                  GetBestSimdLevel(), m_jobSystem->GetThreadCount(), m_jobSystem->GetParallelFor());
 }
 
-// TODO: Why do we need an almost identical to _CreateVertexBuffer() function?
-//  Although it seems like I need to use templates for that and put this code to header so fuck that for now
-void VkBackend::_CreateIndexBuffer()
+// NOTE: All meshes go into the geometry pool, draws pick theirs with firstIndex/vertexOffset. Their indices and
+//  meshlets come from _BuildMeshLods().
+void VkBackend::_CreateMeshBuffers(const SyntheticScene* scene)
 {
-    const vk::DeviceSize bufferSize = sizeof(kTriangleIndices[0]) * kTriangleIndices.size();
+    ScratchScope scratch(m_scratch);
+    m_meshes.clear();
+    // NOTE: Objects start at LOD 0 in every view, hysteresis takes them from there
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        m_views[i].objectLods.assign(m_sceneObjects.size(), 0);
+    }
 
-    constexpr auto memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
-    _createBuffer(m_physicalDevice, m_device, bufferSize, vk::BufferUsageFlagBits::eTransferSrc, memoryProperties, stagingBuffer, stagingBufferMemory);
+    const auto& meshIndices = m_initAssets.meshIndices;
+    if (scene == nullptr) {
+        m_geometryPool.Init(m_allocator, sizeof(Vertex), vk::IndexType::eUint16,
+                            static_cast<ui32>(kTriangleVertices.size()), static_cast<ui32>(meshIndices[0].size()));
+        m_meshes.push_back(m_geometryPool.AddMesh(m_uploadBatch, kTriangleVertices.data(), static_cast<ui32>(kTriangleVertices.size()),
+                                                  meshIndices[0].data(), static_cast<ui32>(meshIndices[0].size())));
+        _UploadMeshlets(m_initAssets.meshlets);
+        return;
+    }
+
+    ui32 vertexCount = 0;
+    ui32 indexCount = 0;
+    for (size_t i = 0; i < scene->meshes.size(); ++i) {
+        vertexCount += static_cast<ui32>(scene->meshes[i].positions.size() / 2);
+        indexCount += static_cast<ui32>(meshIndices[i].size());
+    }
+    m_geometryPool.Init(m_allocator, sizeof(Vertex), vk::IndexType::eUint16, vertexCount, indexCount);
+
+    std::pmr::vector<Vertex> meshVertices(&m_scratch);
+    for (size_t i = 0; i < scene->meshes.size(); ++i) {
+        const auto& mesh = scene->meshes[i];
+
+        meshVertices.clear();
+        for (size_t vertex = 0; vertex < mesh.positions.size() / 2; ++vertex) {
+            meshVertices.push_back(Vertex{ .position = { mesh.positions[2 * vertex], mesh.positions[2 * vertex + 1] },
+                                           .color = { 1.0f, 1.0f, 1.0f },
+                                           .texCoord = { mesh.texCoords[2 * vertex], mesh.texCoords[2 * vertex + 1] } });
+        }
+        m_meshes.push_back(m_geometryPool.AddMesh(m_uploadBatch, meshVertices.data(), static_cast<ui32>(meshVertices.size()),
+                                                  meshIndices[i].data(), static_cast<ui32>(meshIndices[i].size())));
+    }
+    _UploadMeshlets(m_initAssets.meshlets);
+}
+
+// NOTE: Index ranges stay relative to the mesh, the cull jobs add the mesh's place in the geometry pool
+void VkBackend::_UploadMeshlets(std::span<const Meshlet> meshlets)
+{
+    m_meshletCount = static_cast<ui32>(meshlets.size());
+    m_meshletBuffer = nullptr;
+    if (m_useMeshletCulling == false) {
+        return;
+    }
 
-    ui8* data = static_cast<ui8*>(m_device.mapMemory(stagingBufferMemory, 0, bufferSize));
-    std::memcpy(data, kTriangleIndices.data(), bufferSize);
-    //std::copy(kTriangleVertices.data(), kTriangleVertices.data() + bufferSize, data);
-    m_device.unmapMemory(stagingBufferMemory);
+    ScratchScope scratch(m_scratch);
 
-    constexpr auto bufferUsage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer;
-    _createBuffer(m_physicalDevice, m_device, bufferSize, bufferUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, m_indexBuffer, m_indexBufferMemory);
+    std::pmr::vector<GpuMeshlet> gpuMeshlets(&m_scratch);
+    gpuMeshlets.reserve(meshlets.size());
+    for (const auto& meshlet : meshlets) {
+        gpuMeshlets.push_back(GpuMeshlet{ .sphere = glm::vec4(glm::make_vec3(meshlet.center), meshlet.radius),
+                                          .cone = glm::vec4(glm::make_vec3(meshlet.coneAxis), meshlet.coneCutoff),
+                                          .firstIndex = meshlet.firstIndex,
+                                          .indexCount = meshlet.indexCount,
+                                          .padding = { 0, 0 } });
+    }
 
-    _copyBuffer(m_commandPool, m_device, m_graphicsQueue, stagingBuffer, m_indexBuffer, bufferSize);
+    const vk::DeviceSize bufferSize = sizeof(GpuMeshlet) * gpuMeshlets.size();
+    m_meshletBuffer = m_allocator.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                               vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Geometry, m_meshletAllocation);
+    m_uploadBatch.CopyToBuffer(gpuMeshlets.data(), bufferSize, m_meshletBuffer, 0);
+}
 
-    m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+void VkBackend::_CreateTextures()
+{
+    m_albedoTexture = m_textureManager.CreateTexture(m_uploadBatch, m_initAssets.albedo);
+
+    const auto maxAnisotropy = m_capabilities.samplerAnisotropy
+                             ? std::min(16.0f, m_deviceProperties.limits.maxSamplerAnisotropy)
+                             : 1.0f;
+
+    vk::SamplerCreateInfo samplerInfo{ .magFilter = vk::Filter::eLinear,
+                                       .minFilter = vk::Filter::eLinear,
+                                       .mipmapMode = vk::SamplerMipmapMode::eLinear,
+                                       .addressModeU = vk::SamplerAddressMode::eRepeat,
+                                       .addressModeV = vk::SamplerAddressMode::eRepeat,
+                                       .addressModeW = vk::SamplerAddressMode::eRepeat,
+                                       .mipLodBias = 0.0f,
+                                       .anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE,
+                                       .maxAnisotropy = maxAnisotropy,
+                                       .compareEnable = VK_FALSE,
+                                       .compareOp = vk::CompareOp::eAlways,
+                                       .minLod = 0.0f,
+                                       .maxLod = VK_LOD_CLAMP_NONE,
+                                       .borderColor = vk::BorderColor::eIntOpaqueBlack,
+                                       .unnormalizedCoordinates = VK_FALSE };
+    m_albedoSampler = m_textureManager.GetSamplerCache().Get(samplerInfo);
 }
 
 void VkBackend::_CreateUniformBuffers()
@@ -669,144 +1956,564 @@ void VkBackend::_CreateUniformBuffers()
     const vk::DeviceSize bufferSize = sizeof(UBO_MVP);
     constexpr auto memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
 
-    const auto size = m_swapchainImages.size();
-    m_uniformBuffers.resize(size);
-    m_uniformBuffersMemory.resize(size);
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        auto& view = m_views[v];
+        const auto size = view.images.size();
+        view.uniformBuffers.resize(size);
+        view.uniformBufferAllocations.resize(size);
+
+        for (size_t i = 0; i < size; ++i) {
+            view.uniformBuffers[i] = m_allocator.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, memoryProperties,
+                                                              MemoryCategory::Uniforms, view.uniformBufferAllocations[i]);
+        }
+
+        _UpdateUniforms(v);
+    }
+}
+
+void VkBackend::_CreateTransformBuffers()
+{
+    const vk::DeviceSize bufferSize = sizeof(glm::mat4) * m_transforms.GetCount();
+    constexpr auto memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        auto& view = m_views[v];
+        const auto size = view.images.size();
+        view.transformBuffers.resize(size);
+        view.transformBufferAllocations.resize(size);
+
+        for (size_t i = 0; i < size; ++i) {
+            view.transformBuffers[i] = m_allocator.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer, memoryProperties,
+                                                                MemoryCategory::Uniforms, view.transformBufferAllocations[i]);
+        }
+    }
+}
+
+// NOTE: A frame never draws more meshlets than every object drawing the level with the most of them.
+//  With occlusion culling each phase has that many draw commands of its own.
+void VkBackend::_CreateMeshletBuffers()
+{
+    m_meshletsTested.store(0, std::memory_order_relaxed);
+    m_meshletsCulled.store(0, std::memory_order_relaxed);
+    m_meshletTrianglesCulled.store(0, std::memory_order_relaxed);
+    m_objectsOccluded.store(0, std::memory_order_relaxed);
+    m_trianglesOccluded.store(0, std::memory_order_relaxed);
+    m_meshletDrawCapacity = 0;
+    m_meshletStatsBuffer = nullptr;
+    m_visibilityBuffer = nullptr;
+    if (m_useMeshletCulling == false) {
+        return;
+    }
+
+    for (const auto& object : m_sceneObjects) {
+        const auto& meshLods = m_meshLods[object.mesh];
+        m_meshletDrawCapacity += *std::max_element(meshLods.meshletCount.begin(), meshLods.meshletCount.begin() + meshLods.lodCount);
+    }
+
+    const vk::DeviceSize phaseCount = m_useOcclusionCulling ? 2 : 1;
+    const vk::DeviceSize jobBufferSize = sizeof(MeshletCullJob) * std::max<size_t>(m_sceneObjects.size(), 1);
+    const vk::DeviceSize drawBufferSize = sizeof(vk::DrawIndexedIndirectCommand) * phaseCount * std::max<ui32>(m_meshletDrawCapacity, 1);
+    constexpr auto memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    const auto size = m_views[0].images.size();
+    m_cullJobBuffers.resize(size);
+    m_cullJobAllocations.resize(size);
+    m_meshletDrawBuffers.resize(size);
+    m_meshletDrawAllocations.resize(size);
 
     for (size_t i = 0; i < size; ++i) {
-        _createBuffer(m_physicalDevice, m_device, bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, memoryProperties,
-                      m_uniformBuffers[i], m_uniformBuffersMemory[i]);
+        m_cullJobBuffers[i] = m_allocator.CreateBuffer(jobBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, memoryProperties,
+                                                       MemoryCategory::Uniforms, m_cullJobAllocations[i]);
+        m_meshletDrawBuffers[i] = m_allocator.CreateBuffer(drawBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                                                           vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Geometry, m_meshletDrawAllocations[i]);
+    }
+
+    constexpr vk::DeviceSize statsBufferSize = kCullStatsPerFrame * sizeof(ui32) * kMaxFramesInFlight;
+    m_meshletStatsBuffer = m_allocator.CreateBuffer(statsBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, memoryProperties,
+                                                    MemoryCategory::Uniforms, m_meshletStatsAllocation);
+    std::memset(m_meshletStatsAllocation.mapped, 0, statsBufferSize);
+
+    // NOTE: Written by the GPU only, host-visible so it can be zeroed here without an upload
+    const vk::DeviceSize visibilityBufferSize = sizeof(ui32) * std::max<size_t>(m_sceneObjects.size(), 1);
+    m_visibilityBuffer = m_allocator.CreateBuffer(visibilityBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, memoryProperties,
+                                                  MemoryCategory::Uniforms, m_visibilityAllocation);
+    std::memset(m_visibilityAllocation.mapped, 0, visibilityBufferSize);
+}
+
+
+// NOTE: One fragment counter per frame in flight, the frame's draws push which one they add to
+void VkBackend::_CreateOverdrawBuffer()
+{
+    m_overdrawFragments.store(0, std::memory_order_relaxed);
+    m_overdrawPixels.store(0, std::memory_order_relaxed);
+    m_overdrawFrames.store(0, std::memory_order_relaxed);
+    m_lastFrameOverdraw.store(0, std::memory_order_relaxed);
+    m_pendingOverdrawPixels.assign(kMaxFramesInFlight, 0);
+    m_overdrawBuffer = nullptr;
+    if (m_useOverdraw == false) {
+        return;
     }
+
+    constexpr vk::DeviceSize bufferSize = sizeof(ui32) * kMaxFramesInFlight;
+    m_overdrawBuffer = m_allocator.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer,
+                                                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                MemoryCategory::Uniforms, m_overdrawAllocation);
+    std::memset(m_overdrawAllocation.mapped, 0, bufferSize);
 }
 
 
+// NOTE: Sized as if every view's sets had all bindings, only the main view's write the meshlet ones
 void VkBackend::_CreateDescriptorPool()
 {
-    const auto descriptorCount = static_cast<ui32>(m_swapchainImages.size());
+    ui32 descriptorCount = 0;
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        descriptorCount += static_cast<ui32>(m_views[i].images.size());
+    }
 
-    vk::DescriptorPoolSize poolSize{ .type = vk::DescriptorType::eUniformBuffer,
-                                     .descriptorCount = descriptorCount };
+    const vk::DescriptorPoolSize poolSizes[] = {
+        { .type = vk::DescriptorType::eUniformBuffer, .descriptorCount = descriptorCount },
+        // NOTE: Albedo and the depth pyramid
+        { .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 2 * descriptorCount },
+        // NOTE: Transforms, plus meshlets, cull jobs, indirect draws, culled counts, visibility and the overdraw counters
+        { .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 7 * descriptorCount }
+    };
 
     vk::DescriptorPoolCreateInfo poolInfo{ //.flags = vk::DescriptorPoolCreateFlagBits,
                                            .maxSets = descriptorCount,
-                                           .poolSizeCount = 1,
-                                           .pPoolSizes = &poolSize };
+                                           .poolSizeCount = 3,
+                                           .pPoolSizes = poolSizes };
 
-    m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+    m_descriptorPool = m_device.createDescriptorPool(poolInfo, m_allocationCallbacks);
 }
 
 void VkBackend::_CreateDescriptorSets()
 {
-    const auto descriptorCount = static_cast<ui32>(m_swapchainImages.size());
+    ScratchScope scratch(m_scratch);
+
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        auto& view = m_views[i];
+        const auto descriptorCount = static_cast<ui32>(view.images.size());
+        const std::pmr::vector<vk::DescriptorSetLayout> layouts(descriptorCount, m_descriptorSetLayout, &m_scratch);
 
-    std::vector<vk::DescriptorSetLayout> layouts(descriptorCount, m_descriptorSetLayout);
+        vk::DescriptorSetAllocateInfo descriptorSetInfo{ .descriptorPool = m_descriptorPool,
+                                                         .descriptorSetCount = descriptorCount,
+                                                         .pSetLayouts = layouts.data() };
 
-    vk::DescriptorSetAllocateInfo descriptorSetInfo{ .descriptorPool = m_descriptorPool,
-                                                     .descriptorSetCount = descriptorCount,
-                                                     .pSetLayouts = layouts.data() };
+        view.descriptorSets = m_device.allocateDescriptorSets(descriptorSetInfo);
+    }
+
+    _WriteDescriptorSets();
+}
 
-    m_descriptorSets = m_device.allocateDescriptorSets(descriptorSetInfo);
+// NOTE: Again after eviction, the texture view may have changed. Cached draws bind these sets and none of them is
+//  update-after-bind, so rewriting them invalidates every recorded slot.
+void VkBackend::_WriteDescriptorSets()
+{
+    m_commandCache.Invalidate();
 
     vk::DescriptorBufferInfo descriptorBuffer{ .offset = 0,
                                                .range = sizeof(UBO_MVP) };
 
-    vk::WriteDescriptorSet descriptorWrite{ .dstBinding = 0,
-                                            .dstArrayElement = 0,
-                                            .descriptorCount = 1,
-                                            .descriptorType = vk::DescriptorType::eUniformBuffer,
-                                            .pBufferInfo = &descriptorBuffer };
+    vk::DescriptorBufferInfo descriptorTransforms{ .offset = 0,
+                                                   .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorBufferInfo descriptorMeshlets{ .buffer = m_meshletBuffer,
+                                                 .offset = 0,
+                                                 .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorBufferInfo descriptorCullJobs{ .offset = 0,
+                                                 .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorBufferInfo descriptorMeshletDraws{ .offset = 0,
+                                                     .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorBufferInfo descriptorMeshletStats{ .buffer = m_meshletStatsBuffer,
+                                                     .offset = 0,
+                                                     .range = VK_WHOLE_SIZE };
 
-    for (ui32 i = 0; i < descriptorCount; ++i) {
-        descriptorBuffer.buffer = m_uniformBuffers[i];
-        descriptorWrite.dstSet = m_descriptorSets[i];
-        m_device.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+    vk::DescriptorBufferInfo descriptorVisibility{ .buffer = m_visibilityBuffer,
+                                                   .offset = 0,
+                                                   .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorBufferInfo descriptorOverdraw{ .buffer = m_overdrawBuffer,
+                                                 .offset = 0,
+                                                 .range = VK_WHOLE_SIZE };
+
+    vk::DescriptorImageInfo descriptorImage{ .sampler = m_albedoSampler,
+                                             .imageView = m_textureManager.GetTexture(m_albedoTexture).view,
+                                             .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+
+    // NOTE: Without occlusion culling the shader still declares the pyramid but never reads it, the albedo texture stands in
+    vk::DescriptorImageInfo descriptorDepthPyramid = descriptorImage;
+    if (m_useOcclusionCulling) {
+        descriptorDepthPyramid = vk::DescriptorImageInfo{ .sampler = m_depthPyramid.GetSampler(),
+                                                          .imageView = m_depthPyramid.GetView(),
+                                                          .imageLayout = vk::ImageLayout::eGeneral };
+    }
+
+    vk::WriteDescriptorSet descriptorWrites[] = {
+        { .dstBinding = 0,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eUniformBuffer,
+          .pBufferInfo = &descriptorBuffer },
+        { .dstBinding = 1,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+          .pImageInfo = &descriptorImage },
+        { .dstBinding = 2,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorTransforms },
+        { .dstBinding = 3,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorMeshlets },
+        { .dstBinding = 4,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorCullJobs },
+        { .dstBinding = 5,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorMeshletDraws },
+        { .dstBinding = 6,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorMeshletStats },
+        { .dstBinding = 7,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorVisibility },
+        { .dstBinding = 8,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+          .pImageInfo = &descriptorDepthPyramid },
+        { .dstBinding = 9,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .pBufferInfo = &descriptorOverdraw }
+    };
+
+    // NOTE: The meshlet bindings only exist in the layout with meshlet culling. Only the main view's cull pass uses them,
+    //  the other views' sets leave them unwritten, their shaders never touch them. Every view counts its overdraw.
+    std::array<vk::WriteDescriptorSet, 10> writes;
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        const auto& view = m_views[v];
+        ui32 writeCount = m_useMeshletCulling && v == 0 ? 9 : 3;
+        std::copy_n(descriptorWrites, writeCount, writes.begin());
+        if (m_useOverdraw) {
+            writes[writeCount++] = descriptorWrites[9];
+        }
+        for (size_t i = 0; i < view.descriptorSets.size(); ++i) {
+            descriptorBuffer.buffer = view.uniformBuffers[i];
+            descriptorTransforms.buffer = view.transformBuffers[i];
+            if (m_useMeshletCulling && v == 0) {
+                descriptorCullJobs.buffer = m_cullJobBuffers[i];
+                descriptorMeshletDraws.buffer = m_meshletDrawBuffers[i];
+            }
+            for (ui32 write = 0; write < writeCount; ++write) {
+                writes[write].dstSet = view.descriptorSets[i];
+            }
+            m_device.updateDescriptorSets(writeCount, writes.data(), 0, nullptr);
+        }
     }
 }
 
+// NOTE: Handlers run from DrawFrame() after WaitIdle(), nothing they replace is in use by the GPU anymore
+void VkBackend::_RegisterEvictionHandlers()
+{
+    m_evictionStats = EvictionStats{ .stagingReleases = 0,
+                                     .droppedTextureMips = 0,
+                                     .demotedBuffers = 0,
+                                     .stalls = 0 };
+
+    m_allocator.AddEvictionHandler(kEvictStaging, [this](ui32 heapIndex, vk::DeviceSize /*bytes*/) {
+        const auto freed = m_uploadBatch.ReleaseStaging(heapIndex);
+        m_evictionStats.stagingReleases += freed > 0 ? 1 : 0;
+        return freed;
+    });
+    m_allocator.AddEvictionHandler(kEvictTextureMips, [this](ui32 heapIndex, vk::DeviceSize bytes) {
+        const ui32 dropped = m_textureManager.GetDroppedMipCount();
+        const auto freed = m_textureManager.DropTopMips(m_uploadBatch, heapIndex, bytes);
+        m_evictionStats.droppedTextureMips += m_textureManager.GetDroppedMipCount() - dropped;
+        return freed;
+    });
+    // NOTE: The pool moves as a whole, the copy goes through the upload batch, which waits for it
+    m_allocator.AddEvictionHandler(kEvictMeshBuffers, [this](ui32 heapIndex, vk::DeviceSize /*bytes*/) {
+        m_uploadBatch.Begin();
+        const auto freed = m_geometryPool.Demote(m_uploadBatch, heapIndex);
+        m_uploadBatch.Submit();
+        m_evictionStats.demotedBuffers += freed > 0 ? 2 : 0;
+        // NOTE: Cached draws bind the old buffers
+        if (freed > 0) {
+            m_commandCache.Invalidate();
+        }
+        return freed;
+    });
+}
 
 void VkBackend::_CreateCommandBuffers()
 {
     vk::CommandBufferAllocateInfo commandBufferInfo{ .commandPool = m_commandPool,
                                                      .level = vk::CommandBufferLevel::ePrimary,
-                                                     .commandBufferCount = static_cast<ui32>(m_framebuffers.size()) };
+                                                     .commandBufferCount = static_cast<ui32>(kMaxFramesInFlight) };
 
     m_commandBuffers = m_device.allocateCommandBuffers(commandBufferInfo);
+}
+
+// NOTE: Semaphores only for views with a swapchain, one fence per frame covers every view
+void VkBackend::_CreateSyncPrimitives()
+{
+    m_inFlightFences.reserve(kMaxFramesInFlight);
+
+    vk::SemaphoreCreateInfo semaphoreInfo{};
+    // NOTE: It's strange that without specifying 'eSignaled' flag it still worked
+    vk::FenceCreateInfo fenceInfo{ .flags = vk::FenceCreateFlagBits::eSignaled };
+
+    for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
+        for (ui32 v = 0; v < m_viewCount; ++v) {
+            auto& view = m_views[v];
+            if (view.swapchain) {
+                view.imageAvailableSemaphores.push_back(m_device.createSemaphore(semaphoreInfo, m_allocationCallbacks));
+                view.renderFinishedSemaphores.push_back(m_device.createSemaphore(semaphoreInfo, m_allocationCallbacks));
+            }
+        }
+        m_inFlightFences.push_back(m_device.createFence(fenceInfo, m_allocationCallbacks));
+    }
+}
+
+// NOTE: Queue families without timestamp support report 0 valid bits, GPU times are just not measured then
+void VkBackend::_CreateQueryPool()
+{
+    const ui32 validBits = m_capabilities.timestampValidBits;
+
+    m_pendingGpuTimings.assign(kMaxFramesInFlight, nullptr);
+    m_timestampQueryPool = nullptr;
+    if (validBits != 0) {
+        m_timestampPeriod = m_deviceProperties.limits.timestampPeriod;
+        m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        vk::QueryPoolCreateInfo queryPoolInfo{ .queryType = vk::QueryType::eTimestamp,
+                                               .queryCount = kTimestampsPerFrame * kMaxFramesInFlight };
+        m_timestampQueryPool = m_device.createQueryPool(queryPoolInfo, m_allocationCallbacks);
+    }
+
+    for (auto& pass : m_passStatistics) {
+        for (auto& statistic : pass) {
+            statistic.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_statisticsFrames.store(0, std::memory_order_relaxed);
+    m_pendingStatistics.assign(kMaxFramesInFlight, false);
+    m_statisticsQueryPool = nullptr;
+    if (m_usePipelineStatistics == false) {
+        return;
+    }
 
-    vk::Rect2D renderArea{ .offset = {0, 0},
-                           .extent = m_swapchainExtent };
+    // NOTE: Every declared pass gets a query, culled ones just never begin theirs
+    if (m_views[0].renderGraph.GetPassCount() > kMaxStatisticsPasses) {
+        throw std::runtime_error("VkBackend::_CreateQueryPool(): The main view has more passes than kMaxStatisticsPasses!");
+    }
 
-    vk::ClearValue clearColor = vk::ClearColorValue(std::array<f32, 4>{ 0.0f, 0.0f, 0.0f, 0.0f });
+    vk::QueryPoolCreateInfo statisticsPoolInfo{ .queryType = vk::QueryType::ePipelineStatistics,
+                                                .queryCount = kMaxStatisticsPasses * kMaxFramesInFlight,
+                                                .pipelineStatistics = kPipelineStatistics };
+    m_statisticsQueryPool = m_device.createQueryPool(statisticsPoolInfo, m_allocationCallbacks);
+}
+
+// NOTE: Without a scene it's a grid of quads at different heights, every fourth one transparent.
+//  Either way every object is a child of the spinning root.
+void VkBackend::_CreateScene(const SyntheticScene* scene)
+{
+    auto addObject = [&](const glm::vec3& position, f32 scale, ui32 mesh, ui32 material) {
+        const glm::vec3 scale3(scale);
 
-    // NOTE: This should be moved to its own method (StartFrame() ?)
-    for (int i = 0; i < m_commandBuffers.size(); ++i) {
-        const auto& commandBuffer = m_commandBuffers[i];
+        const TransformId transform = m_transforms.Create(m_sceneRoot);
+        m_transforms.SetTranslation(transform, &position.x);
+        m_transforms.SetScale(transform, &scale3.x);
 
-        vk::CommandBufferBeginInfo beginInfo{};
+        m_sceneObjects.push_back(SceneObject{ .transform = transform,
+                                              .mesh = mesh,
+                                              .material = material,
+                                              .isTransparent = m_materialColors[material].a < 1.0f });
 
-        vk::RenderPassBeginInfo renderPassInfo{ .renderPass = m_renderPass,
-                                                .framebuffer = m_framebuffers[i],
-                                                .renderArea = renderArea,
-                                                .clearValueCount = 1,
-                                                .pClearValues = &clearColor };
+        // NOTE: Meshes stay inside [-0.5, 0.5] in XY before scaling
+        const f32 halfExtents[3] = { 0.5f * scale, 0.5f * scale, 0.0f };
+        m_cullingBounds.Add(&position.x, 0.5f * scale * std::sqrt(2.0f), halfExtents);
+    };
 
-        commandBuffer.begin(beginInfo);
-        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-        {
-            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipeline);
+    auto& mainView = m_views[0];
+    if (scene != nullptr) {
+        const auto& camera = scene->camera;
+        mainView.cameraEye = glm::make_vec3(camera.eye);
+        mainView.cameraTarget = glm::make_vec3(camera.target);
+        mainView.cameraUp = glm::make_vec3(camera.up);
+        mainView.cameraFovY = camera.fovY;
+
+        m_materialColors.clear();
+        for (const auto& material : scene->materials) {
+            m_materialColors.push_back(glm::make_vec4(material.color));
+        }
 
-            commandBuffer.bindVertexBuffers(0, m_vertexBuffer, { 0 });
-            commandBuffer.bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint16);
-            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0, 1, &m_descriptorSets[i], 0, nullptr);
+        const auto objectCount = static_cast<ui32>(scene->objects.size());
+        m_transforms.Reserve(objectCount + 1);
+        m_sceneRoot = m_transforms.Create();
+        m_cullingBounds.Reserve(objectCount);
+        m_sceneObjects.reserve(objectCount);
 
-            commandBuffer.drawIndexed(static_cast<ui32>(kTriangleIndices.size()), 1, 0, 0, 0);
+        for (const auto& object : scene->objects) {
+            addObject(glm::make_vec3(object.position), object.scale, object.mesh, object.material);
+        }
+        return;
+    }
+
+    constexpr i32 kGridHalfSize = 3;
+    constexpr f32 kSpacing = 0.35f;
+    constexpr f32 kQuadScale = 0.3f;
+
+    constexpr ui32 kObjectCount = (2 * kGridHalfSize + 1) * (2 * kGridHalfSize + 1);
+
+    mainView.cameraEye = glm::vec3(2.0f);
+    mainView.cameraTarget = glm::vec3(0.0f);
+    mainView.cameraUp = glm::vec3(0.0f, 0.0f, 1.0f);
+    mainView.cameraFovY = glm::radians(45.0f);
+    m_materialColors = kMaterialColors;
+
+    m_transforms.Reserve(kObjectCount + 1);
+    m_sceneRoot = m_transforms.Create();
+    m_cullingBounds.Reserve(kObjectCount);
+
+    for (i32 y = -kGridHalfSize; y <= kGridHalfSize; ++y) {
+        for (i32 x = -kGridHalfSize; x <= kGridHalfSize; ++x) {
+            const auto index = static_cast<ui32>(m_sceneObjects.size());
+            const glm::vec3 position{ x * kSpacing, y * kSpacing, 0.1f * ((x + y) % 3) };
+
+            addObject(position, kQuadScale, 0, index % static_cast<ui32>(m_materialColors.size()));
         }
-        commandBuffer.endRenderPass();
-        commandBuffer.end();
     }
 }
 
-void VkBackend::_CreateSyncPrimitives()
+// NOTE: After _CreateScene(), which sets the main view's camera
+void VkBackend::_CreateViewCameras(std::span<const ViewConfig> views)
 {
-    m_imageAvailableSemaphores.reserve(kMaxFramesInFlight);
-    m_renderFinishedSemaphores.reserve(kMaxFramesInFlight);
-    m_inFlightFences.reserve(kMaxFramesInFlight);
+    const auto& mainView = m_views[0];
+    for (ui32 i = 1; i < m_viewCount; ++i) {
+        auto& view = m_views[i];
+        const auto& config = views[i - 1];
+        if (config.camera.has_value()) {
+            const auto& camera = config.camera.value();
+            view.cameraEye = glm::make_vec3(camera.eye);
+            view.cameraTarget = glm::make_vec3(camera.target);
+            view.cameraUp = glm::make_vec3(camera.up);
+            view.cameraFovY = camera.fovY;
+            continue;
+        }
 
-    vk::SemaphoreCreateInfo semaphoreInfo{};
-    // NOTE: It's strange that without specifying 'eSignaled' flag it still worked
-    vk::FenceCreateInfo fenceInfo{ .flags = vk::FenceCreateFlagBits::eSignaled };
+        const glm::quat orbit = glm::angleAxis(config.orbit, glm::normalize(mainView.cameraUp));
+        view.cameraEye = mainView.cameraTarget + orbit * (mainView.cameraEye - mainView.cameraTarget);
+        view.cameraTarget = mainView.cameraTarget;
+        view.cameraUp = mainView.cameraUp;
+        view.cameraFovY = mainView.cameraFovY;
+    }
+}
 
-    for (i32 i = 0; i < kMaxFramesInFlight; ++i) {
-        m_imageAvailableSemaphores.push_back(m_device.createSemaphore(semaphoreInfo));
-        m_renderFinishedSemaphores.push_back(m_device.createSemaphore(semaphoreInfo));
-        m_inFlightFences.push_back(m_device.createFence(fenceInfo));
+// NOTE: All slots start out free. Allocated once, so steady-state frames don't allocate.
+void VkBackend::_CreateSnapshots()
+{
+    m_freeSnapshots.Init(kMaxQueuedFrames);
+    m_queuedSnapshots.Init(kMaxQueuedFrames);
+    m_renderSnapshot = nullptr;
+    m_renderThreadError = nullptr;
+    m_hasRenderThreadError.store(false, std::memory_order_relaxed);
+
+    for (ui32 i = 0; i < kMaxQueuedFrames; ++i) {
+        auto& snapshot = m_snapshots[i];
+        snapshot.views.resize(m_viewCount);
+        for (auto& viewSnapshot : snapshot.views) {
+            viewSnapshot.draws.clear();
+            viewSnapshot.draws.reserve(m_sceneObjects.size());
+        }
+        snapshot.worldMatrices.assign(static_cast<size_t>(m_transforms.GetCount()) * 16, 0.0f);
+        // NOTE: Version 0, so the first update writes every matrix
+        snapshot.transforms = TransformUploadTarget{ .worldMatrices = snapshot.worldMatrices.data(),
+                                                     .version = 0 };
+        snapshot.timing = nullptr;
+        snapshot.isCaptured = false;
+        snapshot.isShutdown = false;
+
+        m_freeSnapshots.Push(i);
     }
 }
 
 
 void VkBackend::_CleanupSwapchain()
 {
-    m_device.destroyDescriptorPool(m_descriptorPool);
+    m_device.destroyDescriptorPool(m_descriptorPool, m_allocationCallbacks);
 
-    for (size_t i = 0; i < m_swapchainImages.size(); ++i) {
-        m_device.destroyBuffer(m_uniformBuffers[i]);
-        m_device.freeMemory(m_uniformBuffersMemory[i]);
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        auto& view = m_views[v];
+        for (size_t i = 0; i < view.uniformBuffers.size(); ++i) {
+            m_allocator.DestroyBuffer(view.uniformBuffers[i], view.uniformBufferAllocations[i]);
+            m_allocator.DestroyBuffer(view.transformBuffers[i], view.transformBufferAllocations[i]);
+        }
+        view.uniformBuffers.clear();
+        view.transformBuffers.clear();
+        view.descriptorSets.clear();
     }
-
-    for (auto framebuffer : m_framebuffers) {
-        m_device.destroyFramebuffer(framebuffer);
+    for (size_t i = 0; i < m_cullJobBuffers.size(); ++i) {
+        m_allocator.DestroyBuffer(m_cullJobBuffers[i], m_cullJobAllocations[i]);
+        m_allocator.DestroyBuffer(m_meshletDrawBuffers[i], m_meshletDrawAllocations[i]);
     }
+    m_cullJobBuffers.clear();
+    m_meshletDrawBuffers.clear();
 
     m_device.freeCommandBuffers(m_commandPool, static_cast<ui32>(m_commandBuffers.size()), m_commandBuffers.data());
 
-    m_device.destroyPipeline(m_pipeline);
-    m_device.destroyPipelineLayout(m_pipelineLayout);
-    m_device.destroyRenderPass(m_renderPass);
-
-    for (auto imageView : m_swapchainImageViews) {
-        m_device.destroyImageView(imageView);
+    for (auto pipeline : m_pipelines) {
+        m_device.destroyPipeline(pipeline, m_allocationCallbacks);
     }
+    m_pipelines.clear();
+    m_device.destroyPipelineLayout(m_pipelineLayout, m_allocationCallbacks);
+    if (m_meshletCullPipeline) {
+        m_device.destroyPipeline(m_meshletCullPipeline, m_allocationCallbacks);
+        m_device.destroyPipelineLayout(m_meshletCullLayout, m_allocationCallbacks);
+    }
+    m_depthPyramid.Shutdown();
+    if (m_frameCacheImage) {
+        m_allocator.DestroyImage(m_frameCacheImage, m_frameCacheAllocation);
+        m_frameCacheImage = nullptr;
+    }
+
+    for (ui32 v = 0; v < m_viewCount; ++v) {
+        auto& view = m_views[v];
+        view.renderGraph.Destroy(m_device);
 
-    m_device.destroySwapchainKHR(m_swapchain);
+        for (auto imageView : view.imageViews) {
+            m_device.destroyImageView(imageView, m_allocationCallbacks);
+        }
+        view.imageViews.clear();
+
+        if (view.swapchain) {
+            m_device.destroySwapchainKHR(view.swapchain, m_allocationCallbacks);
+            view.swapchain = nullptr;
+        } else {
+            for (size_t i = 0; i < view.images.size(); ++i) {
+                m_allocator.DestroyImage(view.images[i], view.offscreenAllocations[i]);
+            }
+            view.offscreenAllocations.clear();
+        }
+        view.images.clear();
+    }
 }
 
 //void VkBackend::_RecreateSwapchain()
@@ -817,11 +2524,10 @@ void VkBackend::_CleanupSwapchain()
 //
 //    _CreateSwapchain(1, 1);
 //    _CreateImageViews();
-//    _CreateRenderPass();
+//    _CreateRenderGraph();
 //    // NOTE: Possible to avoid recreation of pipeline, by using dynamic state for viewports and scissor rectnagles
 //    // NOTE: May be there are more stuff that can be avoided
 //    _CreateGraphicsPipeline();
-//    _CreateFramebuffers();
 //    _CreateCommandBuffers();
 //    _CreateUniformBuffers();
 //    _CreateDescriptorPool();
@@ -829,25 +2535,482 @@ void VkBackend::_CleanupSwapchain()
 //}
 
 
-// NOTE: There are more efficient ways to pass data to shaders, like "push constants"
-// NOTE: Only model matrix changes every frame, and projection changes when window is resized
-void VkBackend::_UpdateUniformBuffers(ui32 imageIndex)
+// NOTE: Only the root spins, the objects follow it through the hierarchy.
+//  Matrices go into the snapshot, the ones it still has from the last time it was used are skipped.
+void VkBackend::_UpdateTransforms(FrameSnapshot& snapshot)
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
+    const auto currentTime = std::chrono::steady_clock::now();
+    if (m_isAnimating && m_fixedTimeStep <= 0.0f) {
+        m_animationTime += std::chrono::duration<f64>(currentTime - m_lastAnimationTick).count();
+    }
+    m_lastAnimationTick = currentTime;
+    const auto duration = static_cast<f32>(m_animationTime);
+
+    const glm::quat rotation = glm::angleAxis(duration * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    const f32 rotationXYZW[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+    m_transforms.SetRotation(m_sceneRoot, rotationXYZW);
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration<f32, std::chrono::seconds::period>(currentTime - startTime).count();
+    m_transforms.Update(&snapshot.transforms, m_jobSystem->GetThreadCount(), m_jobSystem->GetParallelFor());
 
+    // NOTE: Added after the frame used it, so frame N is at N steps
+    if (m_isAnimating && m_fixedTimeStep > 0.0f) {
+        m_animationTime += m_fixedTimeStep;
+    }
+}
+
+void VkBackend::_UpdateUniforms(ui32 viewIndex)
+{
+    auto& view = m_views[viewIndex];
+    view.uniforms = UBO_MVP{ .view = glm::lookAt(view.cameraEye, view.cameraTarget, view.cameraUp),
+                             .projection = glm::perspective(view.cameraFovY, f32(view.extent.width) / view.extent.height, kNearPlane, kFarPlane) };
     // NOTE: Y axis inversion in projection matrix
-    UBO_MVP mvp{ .model = glm::rotate(glm::mat4(1.0f), duration * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-                 .view = glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-                 .projection = glm::perspective(glm::radians(45.0f), f32(m_swapchainExtent.width) / m_swapchainExtent.height, 0.1f, 10.0f) };
+    view.uniforms.projection[1][1] *= -1.0f;
+
+    std::lock_guard lock(m_latchMutex);
+    view.latchedUniforms = view.uniforms;
+}
+
+// NOTE: One view at a time, the queue and the visible list are reused by the next view
+void VkBackend::_BuildRenderQueue(ui32 viewIndex)
+{
+    auto& view = m_views[viewIndex];
+    const UBO_MVP& uniforms = view.uniforms;
+    const glm::mat4 rootViewProjection = uniforms.projection * uniforms.view * glm::make_mat4(m_transforms.GetWorldMatrix(m_sceneRoot));
+
+    // NOTE: Same matrices the shader gets, so a culled object would have been clipped anyway
+    const Frustum frustum = ExtractFrustumPlanes(&rootViewProjection[0][0]);
+    m_frustumCuller.Cull(frustum, m_cullingBounds, CullVolume::AABB, m_visibleObjects,
+                         m_jobSystem->GetThreadCount(), m_jobSystem->GetParallelFor());
+
+    m_renderQueue.Clear();
+    m_renderQueue.SetDepthRange(kNearPlane, kFarPlane);
+
+    // NOTE: Pixels one unit covers at view depth 1, from the same projection the shader uses
+    const f32 pixelsPerUnitAtDepthOne = 0.5f * static_cast<f32>(view.extent.height) * std::abs(uniforms.projection[1][1]);
+
+    for (const ui32 i : m_visibleObjects) {
+        const auto& object = m_sceneObjects[i];
+        const f32* worldMatrix = m_transforms.GetWorldMatrix(object.transform);
+        const auto& meshLods = m_meshLods[object.mesh];
+
+        // NOTE: View space looks down -Z
+        const f32 viewDepth = -(uniforms.view * glm::make_vec4(worldMatrix + 12)).z;
+
+        // NOTE: Uniform scale, the length of the first column. Objects reaching the near plane get the finest level.
+        ui32 lod = 0;
+        if (m_lodPixelError > 0.0f) {
+            const f32 scale = glm::length(glm::make_vec3(worldMatrix));
+            const f32 pixelsPerUnit = pixelsPerUnitAtDepthOne * scale / std::max(viewDepth, kNearPlane);
+            lod = SelectMeshLod(meshLods.lods.data(), meshLods.lodCount, pixelsPerUnit, m_lodPixelError, kLodHysteresis, view.objectLods[i]);
+        }
+        if (lod != view.objectLods[i]) {
+            view.objectLods[i] = static_cast<ui8>(lod);
+            ++m_lodStats.lodSwitches;
+        }
+        m_lodStats.trianglesSubmitted += meshLods.lods[lod].indexCount / 3;
+        m_lodStats.trianglesWithoutLod += meshLods.lods[0].indexCount / 3;
+
+        const DrawCommand command{ .pipeline = object.isTransparent ? kPipelineTransparent : kPipelineOpaque,
+                                   .material = object.material,
+                                   .mesh = object.mesh,
+                                   .lod = lod,
+                                   .object = i };
 
-    mvp.projection[1][1] *= -1.0f;
+        m_renderQueue.Submit(command, kLayerWorld, object.isTransparent, viewDepth);
+    }
+
+    m_renderQueue.Sort(m_jobSystem->GetThreadCount(), m_jobSystem->GetParallelFor());
+}
+
+// NOTE: Counted from what the backend holds, objects created and destroyed inside Init() aren't included
+DriverObjectStats VkBackend::_GetDriverObjectStats() const
+{
+    ui32 imageCount = 0;
+    ui32 transientImageCount = 0;
+    ui32 viewBufferCount = 0;
+    ui32 descriptorSetCount = 0;
+    ui32 semaphoreCount = 0;
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        const auto& view = m_views[i];
+        imageCount += static_cast<ui32>(view.images.size());
+        transientImageCount += view.renderGraph.GetStats().transientImageCount;
+        viewBufferCount += static_cast<ui32>(view.uniformBuffers.size() + view.transformBuffers.size());
+        descriptorSetCount += static_cast<ui32>(view.descriptorSets.size());
+        semaphoreCount += static_cast<ui32>(view.imageAvailableSemaphores.size() + view.renderFinishedSemaphores.size());
+    }
+    const ui32 textureCount = m_textureManager.GetTextureCount();
+    // NOTE: The pyramid has a view of every level and one of them all, a descriptor set per level
+    const ui32 pyramidLevels = m_useOcclusionCulling ? m_depthPyramid.GetLevelCount() : 0;
+    const ui32 pyramidImages = m_useOcclusionCulling ? 1 : 0;
+
+    return { .deviceMemoryBlocks = m_allocator.GetStats().blockCount,
+             // NOTE: Geometry pool vertex and index buffer plus a uniform and a transform buffer per view image,
+             //  with meshlet culling the meshlet, stats and visibility buffers plus a cull job and a draw buffer per image,
+             //  the capture ring's readback buffers and the overdraw counters
+             .buffers = 2 + viewBufferCount
+                      + (m_useMeshletCulling ? 3 + static_cast<ui32>(m_cullJobBuffers.size() + m_meshletDrawBuffers.size()) : 0)
+                      + m_frameCapture.GetStats().readbackCount + (m_overdrawBuffer ? 1 : 0),
+             .images = imageCount + textureCount + transientImageCount + pyramidImages + (m_frameCacheImage ? 1 : 0),
+             .imageViews = imageCount + textureCount + transientImageCount
+                         + pyramidImages + pyramidLevels,
+             .samplers = m_textureManager.GetSamplerCache().GetSamplerCount(),
+             .pipelines = static_cast<ui32>(m_pipelines.size()) + (m_meshletCullPipeline ? 1 : 0) + pyramidImages,
+             .descriptorSets = descriptorSetCount + pyramidLevels,
+             .commandBuffers = static_cast<ui32>(m_commandBuffers.size()) + m_commandCache.GetSlotCount(),
+             .semaphores = semaphoreCount,
+             .fences = static_cast<ui32>(m_inFlightFences.size()) };
+}
+
+PipelineStatisticsStats VkBackend::_GetPipelineStatistics() const
+{
+    PipelineStatisticsStats stats{ .passes = {},
+                                   .passCount = 0,
+                                   .framesMeasured = m_statisticsFrames.load(std::memory_order_relaxed),
+                                   .isEnabled = m_usePipelineStatistics };
+    if (m_usePipelineStatistics == false) {
+        return stats;
+    }
+
+    const auto& renderGraph = m_views[0].renderGraph;
+    stats.passCount = renderGraph.GetPassCount();
+    for (ui32 pass = 0; pass < stats.passCount; ++pass) {
+        const auto& counters = m_passStatistics[pass];
+        stats.passes[pass] = PassStatistics{ .name = renderGraph.GetPassName(pass),
+                                             .inputAssemblyVertices = counters[0].load(std::memory_order_relaxed),
+                                             .inputAssemblyPrimitives = counters[1].load(std::memory_order_relaxed),
+                                             .vertexShaderInvocations = counters[2].load(std::memory_order_relaxed),
+                                             .clippingPrimitives = counters[3].load(std::memory_order_relaxed),
+                                             .fragmentShaderInvocations = counters[4].load(std::memory_order_relaxed),
+                                             .computeShaderInvocations = counters[5].load(std::memory_order_relaxed) };
+    }
+    return stats;
+}
+
+// NOTE: The last snapshot sent to the render thread, it exits after the frames queued before it
+void VkBackend::_StopRenderThread()
+{
+    if (m_renderThread.joinable() == false) {
+        return;
+    }
+
+    const ui32 slot = m_freeSnapshots.Pop();
+    m_snapshots[slot].isShutdown = true;
+    m_queuedSnapshots.Push(slot);
+
+    m_renderThread.join();
+}
+
+// NOTE: Whole copies, every slot holds a complete set of matrices.
+//  There are more efficient ways to pass data to shaders, like "push constants"
+void VkBackend::_UploadSnapshot(const FrameSnapshot& snapshot)
+{
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        const auto& view = m_views[i];
+        // NOTE: Low latency writes the uniforms later, in _LatchUniforms()
+        if (m_useLowLatency == false) {
+            std::memcpy(view.uniformBufferAllocations[view.imageIndex].mapped, &snapshot.views[i].uniforms, sizeof(UBO_MVP));
+        }
+        std::memcpy(view.transformBufferAllocations[view.imageIndex].mapped, snapshot.worldMatrices.data(),
+                    snapshot.worldMatrices.size() * sizeof(f32));
+    }
+
+    if (m_useMeshletCulling == false) {
+        return;
+    }
+
+    // NOTE: Draws get their indirect commands back to back, the forward pass walks them in the same order.
+    //  Only the main view is meshlet culled.
+    auto* jobs = static_cast<MeshletCullJob*>(m_cullJobAllocations[m_views[0].imageIndex].mapped);
+    ui32 firstDraw = 0;
+    for (const auto& command : snapshot.views[0].draws) {
+        const auto& mesh = m_geometryPool.GetMesh(m_meshes[command.mesh]);
+        const auto& meshLods = m_meshLods[command.mesh];
+
+        *jobs++ = MeshletCullJob{ .firstMeshlet = meshLods.firstMeshlet[command.lod],
+                                  .meshletCount = meshLods.meshletCount[command.lod],
+                                  .transform = m_sceneObjects[command.object].transform,
+                                  .firstIndex = mesh.firstIndex,
+                                  .vertexOffset = mesh.vertexOffset,
+                                  .firstDraw = firstDraw,
+                                  .object = command.object,
+                                  .isTransparent = m_sceneObjects[command.object].isTransparent ? 1u : 0u };
+        firstDraw += meshLods.meshletCount[command.lod];
+    }
+    m_meshletsTested.fetch_add(firstDraw, std::memory_order_relaxed);
+}
+
+// NOTE: Views are recorded one after another into the same command buffer, the main view first
+void VkBackend::_RecordCommandBuffer(const vk::CommandBuffer& commandBuffer, std::pmr::memory_resource* frameMemory)
+{
+    vk::CommandBufferBeginInfo beginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit };
+
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        auto& view = m_views[i];
+        view.renderGraph.SetImportedImage(view.backbuffer, view.images[view.imageIndex], view.imageViews[view.imageIndex]);
+    }
+    if (m_isOnDemand) {
+        m_views[0].renderGraph.SetImportedImage(m_frameCache, m_frameCacheImage, nullptr);
+    }
+
+    const ui32 firstQuery = kTimestampsPerFrame * m_currentFrameData;
+    const ui32 firstStatisticsQuery = kMaxStatisticsPasses * m_currentFrameData;
+
+    commandBuffer.begin(beginInfo);
+    if (m_timestampQueryPool) {
+        commandBuffer.resetQueryPool(m_timestampQueryPool, firstQuery, kTimestampsPerFrame);
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_timestampQueryPool, firstQuery);
+    }
+    if (m_statisticsQueryPool) {
+        commandBuffer.resetQueryPool(m_statisticsQueryPool, firstStatisticsQuery, kMaxStatisticsPasses);
+    }
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        auto& view = m_views[i];
+        // NOTE: Only the main view is measured, the other views' passes would need queries of their own
+        view.renderGraph.Execute(RGContext{ .commandBuffer = commandBuffer,
+                                            .imageIndex = view.imageIndex,
+                                            .frameMemory = frameMemory,
+                                            .statisticsQueryPool = i == 0 ? m_statisticsQueryPool : nullptr,
+                                            .firstStatisticsQuery = firstStatisticsQuery });
+    }
+    // NOTE: The host reads the overdraw counter once the fence is signaled
+    if (m_useOverdraw) {
+        const vk::MemoryBarrier barrier{ .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                                         .dstAccessMask = vk::AccessFlagBits::eHostRead };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eHost,
+                                      vk::DependencyFlags(), barrier, nullptr, nullptr);
+    }
+    if (m_timestampQueryPool) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_timestampQueryPool, firstQuery + 1);
+    }
+    commandBuffer.end();
+}
+
+// NOTE: The graph's final barrier left the cache in eTransferSrcOptimal and waits on nothing after it, so the cache's
+//  barrier here starts from the bottom of the pipe. The swapchain image's waits for the semaphore, which blocks transfers.
+void VkBackend::_RecordRepresent(const vk::CommandBuffer& commandBuffer)
+{
+    vk::CommandBufferBeginInfo beginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit };
+
+    const auto& mainView = m_views[0];
+    const vk::Image image = mainView.images[mainView.imageIndex];
+
+    const vk::ImageSubresourceRange colorRange{ .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                .baseMipLevel = 0,
+                                                .levelCount = 1,
+                                                .baseArrayLayer = 0,
+                                                .layerCount = 1 };
+    const vk::ImageMemoryBarrier copyBarriers[] = {
+        { .srcAccessMask = vk::AccessFlags(),
+          .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+          .oldLayout = vk::ImageLayout::eUndefined,
+          .newLayout = vk::ImageLayout::eTransferDstOptimal,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = image,
+          .subresourceRange = colorRange },
+        { .srcAccessMask = vk::AccessFlags(),
+          .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+          .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+          .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = m_frameCacheImage,
+          .subresourceRange = colorRange } };
+    const vk::ImageMemoryBarrier presentBarrier{ .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                                 .dstAccessMask = vk::AccessFlags(),
+                                                 .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                                                 .newLayout = vk::ImageLayout::ePresentSrcKHR,
+                                                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                                 .image = image,
+                                                 .subresourceRange = colorRange };
+
+    commandBuffer.begin(beginInfo);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eBottomOfPipe,
+                                  vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), nullptr, nullptr, copyBarriers);
+    commandBuffer.copyImage(m_frameCacheImage, vk::ImageLayout::eTransferSrcOptimal, image,
+                            vk::ImageLayout::eTransferDstOptimal, _makeFullImageCopy(mainView.extent));
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                  vk::DependencyFlags(), nullptr, nullptr, presentBarrier);
+    commandBuffer.end();
+}
+
+void VkBackend::_RecordDrawState(const vk::CommandBuffer& commandBuffer, ui32 viewIndex, ui32 imageIndex)
+{
+    const auto& view = m_views[viewIndex];
+
+    // NOTE: One vertex layout, so one bind for the whole scene
+    m_geometryPool.Bind(commandBuffer);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0, 1, &view.descriptorSets[imageIndex], 0, nullptr);
+
+    // NOTE: Dynamic, so views of any size draw with the same pipelines
+    const vk::Viewport viewport{ .x = 0.0f,
+                                 .y = 0.0f,
+                                 .width = static_cast<f32>(view.extent.width),
+                                 .height = static_cast<f32>(view.extent.height),
+                                 .minDepth = 0.0f,
+                                 .maxDepth = 1.0f };
+    const vk::Rect2D scissor{ .offset = { 0, 0 },
+                              .extent = view.extent };
+    commandBuffer.setViewport(0, viewport);
+    commandBuffer.setScissor(0, scissor);
+}
+
+void VkBackend::_RecordDraws(const vk::CommandBuffer& commandBuffer, std::span<const DrawCommand> draws, ui32 imageIndex,
+                             bool isMeshletCulled, vk::DeviceSize drawOffset)
+{
+    // NOTE: The queue is sorted by state, so pipelines are only rebound at group boundaries
+    ui32 boundPipeline = ~0u;
+    constexpr auto drawStride = static_cast<ui32>(sizeof(vk::DrawIndexedIndirectCommand));
+    for (const auto& command : draws) {
+        const auto& meshLods = m_meshLods[command.mesh];
+
+        if (command.pipeline != boundPipeline) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[command.pipeline]);
+            boundPipeline = command.pipeline;
+        }
 
-    auto data = m_device.mapMemory(m_uniformBuffersMemory[imageIndex], 0, sizeof(mvp));
-    std::memcpy(data, &mvp, sizeof(mvp));
-    m_device.unmapMemory(m_uniformBuffersMemory[imageIndex]);
+        const PushConstants pushConstants{ .color = m_materialColors[command.material], .frameSlot = m_currentFrameData };
+        commandBuffer.pushConstants(m_pipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(pushConstants), &pushConstants);
+
+        // NOTE: One indirect command per meshlet, the cull pass zeroed the instance count of the culled ones
+        if (isMeshletCulled) {
+            const auto& drawBuffer = m_meshletDrawBuffers[imageIndex];
+            const ui32 meshletCount = meshLods.meshletCount[command.lod];
+            if (m_capabilities.multiDrawIndirect) {
+                commandBuffer.drawIndexedIndirect(drawBuffer, drawOffset, meshletCount, drawStride);
+            } else {
+                for (ui32 i = 0; i < meshletCount; ++i) {
+                    commandBuffer.drawIndexedIndirect(drawBuffer, drawOffset + i * drawStride, 1, drawStride);
+                }
+            }
+            drawOffset += meshletCount * drawStride;
+            continue;
+        }
+
+        // NOTE: gl_InstanceIndex starts at firstInstance, the shader uses it to index the transform buffer
+        const auto& mesh = m_geometryPool.GetMesh(m_meshes[command.mesh]);
+        const auto& lod = meshLods.lods[command.lod];
+        commandBuffer.drawIndexed(lod.indexCount, 1, mesh.firstIndex + lod.firstIndex, mesh.vertexOffset, m_sceneObjects[command.object].transform);
+    }
+}
+
+// NOTE: After recording, right before the submit. Host-coherent writes made before a submit are visible to it.
+void VkBackend::_LatchUniforms()
+{
+    std::lock_guard lock(m_latchMutex);
+    for (ui32 i = 0; i < m_viewCount; ++i) {
+        const auto& view = m_views[i];
+        std::memcpy(view.uniformBufferAllocations[view.imageIndex].mapped, &view.latchedUniforms, sizeof(UBO_MVP));
+    }
+}
+
+// NOTE: The next frame isn't taken before this one is done, so nothing queues up behind it. Present wait returns once
+//  the image is on screen, the fence only once the GPU is done with it, which leaves out the wait for the display.
+void VkBackend::_WaitForFrameCompletion(const FrameSnapshot& snapshot, ui64 presentId)
+{
+    if (m_usePresentWait) {
+        // NOTE: A timeout or an out of date swapchain ends the wait too, the frame counts as presented then
+        const VkResult result = m_waitForPresent(m_device, m_views[0].swapchain, presentId, kSyncObjectTimeout);
+        if (result == VK_ERROR_DEVICE_LOST) {
+            throw std::runtime_error("VkBackend::_WaitForFrameCompletion(): Device lost!");
+        }
+    } else {
+        m_device.waitForFences(1, &m_inFlightFences[m_currentFrameData], VK_TRUE, kSyncObjectTimeout);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    m_framePacer.OnFrameComplete(snapshot.frameIndex, now);
+    if (snapshot.timing != nullptr) {
+        snapshot.timing->latencyMilliseconds = std::chrono::duration<f64, std::milli>(now - snapshot.simulationStart).count();
+    }
+}
+
+void VkBackend::_ReadGpuTiming(ui32 frameData)
+{
+    FrameTiming* timing = m_pendingGpuTimings[frameData];
+    if (timing == nullptr) {
+        return;
+    }
+    m_pendingGpuTimings[frameData] = nullptr;
+
+    // NOTE: The Hi-Z pair is only written with occlusion culling, reading it otherwise would never succeed
+    const ui32 queryCount = m_useOcclusionCulling ? kTimestampsPerFrame : 2;
+    ui64 timestamps[kTimestampsPerFrame];
+    const auto result = m_device.getQueryPoolResults(m_timestampQueryPool, kTimestampsPerFrame * frameData, queryCount,
+                                                     sizeof(timestamps), timestamps, sizeof(ui64), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    auto toMilliseconds = [this](ui64 start, ui64 end) {
+        return static_cast<f64>((end - start) & m_timestampMask) * m_timestampPeriod * 1e-6;
+    };
+    timing->gpuMilliseconds = toMilliseconds(timestamps[0], timestamps[1]);
+    if (m_useOcclusionCulling) {
+        timing->hizMilliseconds = toMilliseconds(timestamps[2], timestamps[3]);
+    }
+}
+
+void VkBackend::_ReadMeshletStats(ui32 frameData)
+{
+    if (m_useMeshletCulling == false) {
+        return;
+    }
+
+    auto* counts = static_cast<ui32*>(m_meshletStatsAllocation.mapped) + kCullStatsPerFrame * frameData;
+    m_meshletsCulled.fetch_add(counts[0], std::memory_order_relaxed);
+    m_meshletTrianglesCulled.fetch_add(counts[1], std::memory_order_relaxed);
+    m_objectsOccluded.fetch_add(counts[2], std::memory_order_relaxed);
+    m_trianglesOccluded.fetch_add(counts[3], std::memory_order_relaxed);
+    std::memset(counts, 0, kCullStatsPerFrame * sizeof(ui32));
+}
+
+// NOTE: Queries of passes culled this frame were reset but never begun, they stay unavailable and add nothing
+void VkBackend::_ReadPipelineStatistics(ui32 frameData)
+{
+    if (m_pendingStatistics[frameData] == false) {
+        return;
+    }
+    m_pendingStatistics[frameData] = false;
+
+    // NOTE: The statistics of each query in bit order, then its availability
+    constexpr ui32 stride = kPipelineStatisticCount + 1;
+    std::array<ui64, stride * kMaxStatisticsPasses> results;
+    const ui32 passCount = m_views[0].renderGraph.GetPassCount();
+    const auto result = m_device.getQueryPoolResults(m_statisticsQueryPool, kMaxStatisticsPasses * frameData, passCount,
+                                                     passCount * stride * sizeof(ui64), results.data(), stride * sizeof(ui64),
+                                                     vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+    if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+        return;
+    }
+
+    for (ui32 pass = 0; pass < passCount; ++pass) {
+        const ui64* statistics = results.data() + pass * stride;
+        if (statistics[kPipelineStatisticCount] == 0) {
+            continue;
+        }
+        for (ui32 i = 0; i < kPipelineStatisticCount; ++i) {
+            m_passStatistics[pass][i].fetch_add(statistics[i], std::memory_order_relaxed);
+        }
+    }
+    m_statisticsFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VkBackend::_ReadOverdraw(ui32 frameData)
+{
+    const ui64 pixels = m_pendingOverdrawPixels[frameData];
+    if (pixels == 0) {
+        return;
+    }
+    m_pendingOverdrawPixels[frameData] = 0;
+
+    auto* fragments = static_cast<ui32*>(m_overdrawAllocation.mapped) + frameData;
+    m_overdrawFragments.fetch_add(*fragments, std::memory_order_relaxed);
+    m_overdrawPixels.fetch_add(pixels, std::memory_order_relaxed);
+    m_overdrawFrames.fetch_add(1, std::memory_order_relaxed);
+    m_lastFrameOverdraw.store(std::bit_cast<ui64>(static_cast<f64>(*fragments) / static_cast<f64>(pixels)), std::memory_order_relaxed);
+    *fragments = 0;
 }
 
 }
@@ -876,13 +3039,16 @@ void _checkAPIVersionSupport(const ui32 requestedVersion)
     }
 }
 
-// NOTE: Depends on Window class (GLFWindow)
-std::vector<const char*> _getRequiredExtensions()
+// NOTE: Depends on Window class (GLFWindow), headless runs don't need GLFW or any surface extension
+std::pmr::vector<const char*> _getRequiredExtensions(bool isHeadless, std::pmr::memory_resource* memory)
 {
-    ui32 glfwExtensionCount = 0;
-    const auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::pmr::vector<const char*> extensions(memory);
+    if (isHeadless == false) {
+        ui32 glfwExtensionCount = 0;
+        const auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
     if (kEnableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
@@ -890,9 +3056,10 @@ std::vector<const char*> _getRequiredExtensions()
     return extensions;
 }
 
-bool _checkValidationLayersSupport()
+bool _checkValidationLayersSupport(std::pmr::memory_resource* memory)
 {
-    const auto availableLayers = vk::enumerateInstanceLayerProperties();
+    std::pmr::polymorphic_allocator<vk::LayerProperties> allocator(memory);
+    const auto availableLayers = vk::enumerateInstanceLayerProperties(allocator);
 
     return std::all_of(kValidationLayers.begin(), kValidationLayers.end(),
                        [&availableLayers](const char* required) {
@@ -918,14 +3085,73 @@ vk::DebugUtilsMessengerCreateInfoEXT _makeDebugUtilsMessengerCreateInfo()
 }
 
 
-// NOTE: Fuckin surface
-bool _isDeviceSuitable(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface)
+vulkan::DeviceCapabilities _queryDeviceCapabilities(const vk::PhysicalDevice& device, std::pmr::memory_resource* memory)
 {
-    bool isQueueFamiliesSupported = _getRequiredQueueFamilies(device, surface).isComplete();
-    bool isExtensionsSupported = _checkPhysicalDeviceExtensionSupport(device);
+    const auto features = device.getFeatures();
+
+    std::pmr::polymorphic_allocator<vk::ExtensionProperties> allocator(memory);
+    const auto availableExtensions = device.enumerateDeviceExtensionProperties(nullptr, allocator);
+    auto hasExtension = [&availableExtensions](const char* name) {
+        return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+                           [name](const vk::ExtensionProperties& available) {
+                               return std::strcmp(available.extensionName, name) == 0;
+                           });
+    };
+    const bool hasMemoryBudget = hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    vulkan::DeviceCapabilities capabilities{ .apiVersion = device.getProperties().apiVersion,
+                                             .dynamicRendering = false,
+                                             .textureCompressionBC = features.textureCompressionBC == VK_TRUE,
+                                             .textureCompressionASTC = features.textureCompressionASTC_LDR == VK_TRUE,
+                                             .memoryBudget = hasMemoryBudget,
+                                             .drawIndirectFirstInstance = features.drawIndirectFirstInstance == VK_TRUE,
+                                             .multiDrawIndirect = features.multiDrawIndirect == VK_TRUE };
+    capabilities.pipelineStatisticsQuery = features.pipelineStatisticsQuery == VK_TRUE;
+    capabilities.inheritedQueries = features.inheritedQueries == VK_TRUE;
+    capabilities.fragmentStoresAndAtomics = features.fragmentStoresAndAtomics == VK_TRUE;
+    capabilities.samplerAnisotropy = features.samplerAnisotropy == VK_TRUE;
+
+    // NOTE: Only the core 1.3 path is used, the KHR extensions would need their own function pointers with the static dispatcher
+    if (capabilities.apiVersion >= VK_API_VERSION_1_3) {
+        const auto features2 = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features>();
+        const auto& vulkan13Features = features2.get<vk::PhysicalDeviceVulkan13Features>();
+        capabilities.dynamicRendering = vulkan13Features.dynamicRendering && vulkan13Features.synchronization2;
+    }
+
+    capabilities.presentWait = false;
+    if (capabilities.apiVersion >= VK_API_VERSION_1_1 && hasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME)
+        && hasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        const auto features2 = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR,
+                                                   vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        capabilities.presentWait = features2.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId
+                                && features2.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
+
+    // NOTE: Failing on a cache miss instead of compiling is pipelineCreationCacheControl, only asked for on 1.3 here
+    capabilities.shaderModuleIdentifier = false;
+    if (capabilities.apiVersion >= VK_API_VERSION_1_3 && hasExtension(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME)) {
+        const auto features2 = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features,
+                                                   vk::PhysicalDeviceShaderModuleIdentifierFeaturesEXT>();
+        capabilities.shaderModuleIdentifier = features2.get<vk::PhysicalDeviceVulkan13Features>().pipelineCreationCacheControl
+                                           && features2.get<vk::PhysicalDeviceShaderModuleIdentifierFeaturesEXT>().shaderModuleIdentifier;
+    }
+
+    return capabilities;
+}
+
+// NOTE: Fuckin surface. Without one (headless) only a graphics queue is needed.
+bool _isDeviceSuitable(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface, QueueFamilyIndices indices,
+                       std::pmr::memory_resource* memory)
+{
+    bool isQueueFamiliesSupported = indices.isComplete();
+    if (!surface) {
+        return isQueueFamiliesSupported;
+    }
+
+    bool isExtensionsSupported = _checkPhysicalDeviceExtensionSupport(device, memory);
     bool isSwapChainAdequate = false;
     if (isExtensionsSupported) {
-        auto swapChainSupport = _querySwapchainSupport(device, surface);
+        auto swapChainSupport = _querySwapchainSupport(device, surface, memory);
         // NOTE: Move this to a SwapChainSupportDetails method? Similar to isComplete()
         isSwapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -933,18 +3159,20 @@ bool _isDeviceSuitable(const vk::PhysicalDevice& device, const vk::SurfaceKHR& s
     return isQueueFamiliesSupported && isExtensionsSupported && isSwapChainAdequate;
 }
 
-// NOTE: Depends on m_surface, make it private method ?
-QueueFamilyIndices _getRequiredQueueFamilies(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface)
+// NOTE: Depends on m_surface, make it private method ? Without a surface the graphics family stands in for present.
+QueueFamilyIndices _getRequiredQueueFamilies(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface,
+                                             std::pmr::memory_resource* memory)
 {
     QueueFamilyIndices indices;
+    std::pmr::polymorphic_allocator<vk::QueueFamilyProperties> allocator(memory);
 
     // NOTE: This can replace indices for the queues already found, may be add smth like:
     //   if (indices.graphics_family.has_value() == false && queue_family.queueFlags & vk::QueueFlagBits::eGraphics)
-    for (ui32 i = 0; const auto & queueFamily : device.getQueueFamilyProperties()) {
+    for (ui32 i = 0; const auto & queueFamily : device.getQueueFamilyProperties(allocator)) {
         if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
             indices.graphicsFamily = i;
         }
-        if (device.getSurfaceSupportKHR(i, surface)) {
+        if (surface ? device.getSurfaceSupportKHR(i, surface) == VK_TRUE : indices.graphicsFamily == i) {
             indices.presentFamily = i;
         }
 
@@ -957,9 +3185,10 @@ QueueFamilyIndices _getRequiredQueueFamilies(const vk::PhysicalDevice& device, c
     return indices;
 }
 
-bool _checkPhysicalDeviceExtensionSupport(const vk::PhysicalDevice& device)
+bool _checkPhysicalDeviceExtensionSupport(const vk::PhysicalDevice& device, std::pmr::memory_resource* memory)
 {
-    const auto availableExtensions = device.enumerateDeviceExtensionProperties();
+    std::pmr::polymorphic_allocator<vk::ExtensionProperties> allocator(memory);
+    const auto availableExtensions = device.enumerateDeviceExtensionProperties(nullptr, allocator);
 
     return std::all_of(kDeviceExtensions.begin(), kDeviceExtensions.end(),
                        [&availableExtensions](const char* required) {
@@ -971,14 +3200,32 @@ bool _checkPhysicalDeviceExtensionSupport(const vk::PhysicalDevice& device)
 }
 
 
-SwapchainSupportDetails _querySwapchainSupport(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface)
+SwapchainSupportDetails _querySwapchainSupport(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface,
+                                               std::pmr::memory_resource* memory)
 {
-    return { .formats = device.getSurfaceFormatsKHR(surface),
-             .presentModes = device.getSurfacePresentModesKHR(surface),
+    std::pmr::polymorphic_allocator<vk::SurfaceFormatKHR> formatAllocator(memory);
+    std::pmr::polymorphic_allocator<vk::PresentModeKHR> presentModeAllocator(memory);
+
+    return { .formats = device.getSurfaceFormatsKHR(surface, formatAllocator),
+             .presentModes = device.getSurfacePresentModesKHR(surface, presentModeAllocator),
              .capabilities = device.getSurfaceCapabilitiesKHR(surface) };
 }
 
-vk::SurfaceFormatKHR _chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats)
+vk::Format _chooseDepthFormat(const vk::PhysicalDevice& device)
+{
+    constexpr vk::Format candidates[] = { vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint };
+
+    for (const auto format : candidates) {
+        const auto properties = device.getFormatProperties(format);
+        if (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a supported depth format!");
+}
+
+vk::SurfaceFormatKHR _chooseSurfaceFormat(std::span<const vk::SurfaceFormatKHR> availableFormats)
 {
     for (const auto& format : availableFormats) {
         if (format.format == vk::Format::eB8G8R8A8Srgb && format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
@@ -992,15 +3239,15 @@ vk::SurfaceFormatKHR _chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR
     return availableFormats.front();
 }
 
-vk::PresentModeKHR _choosePresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)
+// NOTE: Immediate doesn't wait for vblank, which is what the benchmarks want, but it's optional.
+//  FIFO always exists and blocks presents to the refresh rate.
+vk::PresentModeKHR _choosePresentMode(std::span<const vk::PresentModeKHR> availablePresentModes, bool isVsync)
 {
-    // TODO: Rewrite with ranges?
-    /*auto mode = std::find(availablePresentModes.begin(), availablePresentModes.end(), vk::PresentModeKHR::eMailbox);
-    if (mode != availablePresentModes.end())
-        return *mode;
-
-    return vk::PresentModeKHR::eFifo;*/
-    return vk::PresentModeKHR::eImmediate;
+    if (isVsync == false
+        && std::find(availablePresentModes.begin(), availablePresentModes.end(), vk::PresentModeKHR::eImmediate) != availablePresentModes.end()) {
+        return vk::PresentModeKHR::eImmediate;
+    }
+    return vk::PresentModeKHR::eFifo;
 }
 
 // NOTE: This 'width', 'height' shit looks ugly
@@ -1015,87 +3262,71 @@ vk::Extent2D _chooseSurfaceExtent(const vk::SurfaceCapabilitiesKHR& capabilities
 }
 
 
-std::vector<char> _readShaderFile(const std::string_view shaderPath)
+// NOTE: VkPipelineCacheHeaderVersionOne. Drivers are supposed to reject data that isn't theirs,
+//  not all of them survive a file from another GPU or driver version though.
+bool _isPipelineCacheCompatible(std::span<const char> data, const vk::PhysicalDeviceProperties& properties)
 {
-    auto size = std::filesystem::file_size(shaderPath);
-    std::vector<char> buffer(size);
-
-    std::ifstream shaderFile(shaderPath, std::ios::binary | std::ios::in);
-    shaderFile.read(buffer.data(), size);
-
-    return buffer;
-}
-
-vk::UniqueShaderModule _createShaderModule(const std::vector<char>& shaderCode, const vk::Device& device)
-{
-    // NOTE: May be read shader file as 'ui32' instead of 'char'
-    vk::ShaderModuleCreateInfo shaderModuleInfo{ .codeSize = shaderCode.size(),
-                                                 .pCode = reinterpret_cast<const ui32*>(shaderCode.data()) };
+    constexpr size_t kHeaderSize = 4 * sizeof(ui32) + VK_UUID_SIZE;
+    if (data.size() < kHeaderSize) {
+        return false;
+    }
 
-    return device.createShaderModuleUnique(shaderModuleInfo);
+    ui32 header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+    return header[0] >= kHeaderSize
+        && header[1] == static_cast<ui32>(vk::PipelineCacheHeaderVersion::eOne)
+        && header[2] == properties.vendorID
+        && header[3] == properties.deviceID
+        && std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
 }
 
-
-ui32 _findMemoryTypeIndex(const vk::PhysicalDevice& physicalDevice, const ui32 memoryTypeBits, const vk::MemoryPropertyFlags properties)
+std::pmr::vector<ui8> _makeCheckerboard(ui32 size, ui32 cellSize, std::pmr::memory_resource* memory)
 {
-    auto memoryProperties = physicalDevice.getMemoryProperties();
-
-    for (ui32 i = 0; i < memoryProperties.memoryTypeCount; ++i) {
-        if (memoryTypeBits & (1 << i) && properties == (memoryProperties.memoryTypes[i].propertyFlags & properties)) {
-            return i;
+    std::pmr::vector<ui8> pixels(static_cast<size_t>(size) * size * 4, memory);
+
+    for (ui32 y = 0; y < size; ++y) {
+        for (ui32 x = 0; x < size; ++x) {
+            const ui8 value = ((x / cellSize + y / cellSize) % 2 == 0) ? 255 : 64;
+            ui8* pixel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+            pixel[0] = value;
+            pixel[1] = value;
+            pixel[2] = value;
+            pixel[3] = 255;
         }
     }
 
-    throw std::runtime_error("_findMemoryType(): Failed to find suitable memory type!");
+    return pixels;
 }
 
-// NOTE: This function is called many times, and every time it calls getBufferMemoryRequirements() and findMemoryTypeIndex,
-//  which is most likely redundant and I should just store this memory things
-void _createBuffer(const vk::PhysicalDevice& physicalDevice, const vk::Device& device,
-                   const vk::DeviceSize bufferSize,
-                   const vk::BufferUsageFlags usage, const vk::MemoryPropertyFlags properties,
-                   vk::Buffer& buffer, vk::DeviceMemory& bufferMemory)
+vk::ImageCopy _makeFullImageCopy(vk::Extent2D extent)
 {
-    vk::BufferCreateInfo bufferInfo{ .size = bufferSize,
-                                     .usage = usage,
-                                     .sharingMode = vk::SharingMode::eExclusive };
-
-    buffer = device.createBuffer(bufferInfo);
-
-    const auto memoryRequirements = device.getBufferMemoryRequirements(buffer);
-    const auto memoryTypeIndex = _findMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits, properties);
-
-    vk::MemoryAllocateInfo allocateInfo{ .allocationSize = memoryRequirements.size,
-                                         .memoryTypeIndex = memoryTypeIndex };
-
-    bufferMemory = device.allocateMemory(allocateInfo);
-    device.bindBufferMemory(buffer, bufferMemory, 0);
+    const vk::ImageSubresourceLayers colorLayer{ .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                 .mipLevel = 0,
+                                                 .baseArrayLayer = 0,
+                                                 .layerCount = 1 };
+    return { .srcSubresource = colorLayer,
+             .srcOffset = { .x = 0, .y = 0, .z = 0 },
+             .dstSubresource = colorLayer,
+             .dstOffset = { .x = 0, .y = 0, .z = 0 },
+             .extent = { .width = extent.width, .height = extent.height, .depth = 1 } };
 }
 
-void _copyBuffer(const vk::CommandPool& commandPool, const vk::Device& device, const vk::Queue& queue,
-                 vk::Buffer& source, vk::Buffer& destination, vk::DeviceSize size)
+// NOTE: FNV-1a over every field of every draw, the version of a command cache bucket
+ui64 _hashDraws(std::span<const DrawCommand> draws, vk::DeviceSize drawOffset)
 {
-    vk::CommandBufferAllocateInfo allocateInfo{ .commandPool = commandPool,
-                                                .level = vk::CommandBufferLevel::ePrimary,
-                                                .commandBufferCount = 1 };
-
-    vk::CommandBuffer commandBuffer;
-    device.allocateCommandBuffers(&allocateInfo, &commandBuffer);
-
-    vk::CommandBufferBeginInfo beginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit };
+    ui64 hash = 14695981039346656037ull;
+    auto combine = [&hash](ui64 value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
 
-    commandBuffer.begin(beginInfo);
-    {
-        vk::BufferCopy copyRegion{ .size = size };
-        commandBuffer.copyBuffer(source, destination, 1, &copyRegion);
+    combine(drawOffset);
+    for (const auto& command : draws) {
+        combine(command.pipeline);
+        combine(command.material);
+        combine(command.mesh);
+        combine(command.lod);
+        combine(command.object);
     }
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo{ .commandBufferCount = 1,
-                              .pCommandBuffers = &commandBuffer };
-
-    queue.submit(1, &submitInfo, nullptr);
-    queue.waitIdle();
-
-    device.freeCommandBuffers(commandPool, 1, &commandBuffer);
+    return hash;
 }
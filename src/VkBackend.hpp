@@ -6,7 +6,42 @@
 #include <vulkan/vulkan.hpp>
 
 #include "Window.hpp"
-
+#include "RenderGraph.hpp"
+#include "RenderQueue.hpp"
+#include "DeviceAllocator.hpp"
+#include "HostAllocator.hpp"
+#include "LinearAllocator.hpp"
+#include "UploadBatch.hpp"
+#include "GeometryPool.hpp"
+#include "MeshLod.hpp"
+#include "Meshlet.hpp"
+#include "DepthPyramid.hpp"
+#include "ShaderRegistry.hpp"
+#include "CommandCache.hpp"
+#include "FrameCapture.hpp"
+#include "FramePacer.hpp"
+#include "TextureManager.hpp"
+#include "FrustumCulling.hpp"
+#include "TransformHierarchy.hpp"
+#include "JobSystem.hpp"
+#include "InitGraph.hpp"
+#include "SpscQueue.hpp"
+#include "SyntheticScene.hpp"
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
 #include <iostream> // TODO: Remove
 
 
@@ -51,6 +86,419 @@ vkDestroyDebugUtilsMessengerEXT(VkInstance instance,
 namespace vulkan
 {
 
+// NOTE: What the selected physical device can do, queried once in _SelectPhysicalDevice()
+struct DeviceCapabilities
+{
+    ui32 apiVersion;
+    // NOTE: Vulkan 1.3 dynamicRendering + synchronization2, no render pass and framebuffer objects needed
+    bool dynamicRendering;
+    // NOTE: Block-compressed texture families, individual formats are still checked with getFormatProperties()
+    bool textureCompressionBC;
+    bool textureCompressionASTC;
+    // NOTE: VK_EXT_memory_budget, real heap budgets instead of an estimate
+    bool memoryBudget;
+    // NOTE: Indirect draws that start at an instance other than 0, the meshlet cull pass needs it
+    bool drawIndirectFirstInstance;
+    // NOTE: More than one draw per vkCmdDrawIndexedIndirect, otherwise meshlets are drawn one call each
+    bool multiDrawIndirect;
+    // NOTE: depthFormat can be sampled, the Hi-Z pyramid is built from it
+    bool depthSampling;
+    // NOTE: VK_KHR_present_id and VK_KHR_present_wait, the host can wait until a given present is on screen
+    bool presentWait;
+    // NOTE: VK_EXT_shader_module_identifier with pipelineCreationCacheControl, pipelines in the cache are found
+    //  without creating their shader modules
+    bool shaderModuleIdentifier;
+    // NOTE: Pipeline statistics queries, and inheritedQueries so they also count what secondary command buffers draw
+    bool pipelineStatisticsQuery;
+    bool inheritedQueries;
+    // NOTE: Fragment shaders may write storage buffers, the overdraw shader counts its invocations with atomics
+    bool fragmentStoresAndAtomics;
+    bool samplerAnisotropy;
+    vk::Format depthFormat;
+    // NOTE: Found once when the device is selected, without a surface the graphics family stands in for present
+    ui32 graphicsQueueFamily;
+    ui32 presentQueueFamily;
+    // NOTE: Of the graphics family, 0 when it can't write timestamps
+    ui32 timestampValidBits;
+};
+
+// NOTE: Model matrices come from the transform buffer, indexed by the draw's instance index
+struct UBO_MVP
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+};
+
+// NOTE: Every object is one of the meshes with its own transform and material
+struct SceneObject
+{
+    TransformId transform;
+    ui32 mesh;
+    ui32 material;
+    bool isTransparent;
+};
+
+// NOTE: Levels of one scene mesh, ranges relative to the mesh's firstIndex in the geometry pool.
+//  Every level is split into meshlets, a range of the scene's meshlet list.
+struct MeshLods
+{
+    ui32 lodCount;
+    std::array<MeshLod, kMaxMeshLods> lods;
+    std::array<ui32, kMaxMeshLods> firstMeshlet;
+    std::array<ui32, kMaxMeshLods> meshletCount;
+};
+
+// NOTE: What the CPU steps of Init() build while the device is still being created, uploaded once it exists and freed then
+struct InitAssets
+{
+    // NOTE: Per scene mesh, its indices with the LOD chain appended and every level reordered into meshlets
+    std::vector<std::vector<ui16>> meshIndices;
+    std::vector<Meshlet> meshlets;
+    TextureContainer albedo;
+};
+
+// NOTE: A view besides the main one, drawn by every DrawFrame() from its own camera. It shares the device, pipelines,
+//  geometry and textures with the main view. Meshlet and occlusion culling, captures and PresentLastFrame() stay with
+//  the main view, other views draw the LOD levels the CPU culling picked for them directly.
+struct ViewConfig
+{
+    // NOTE: Needs BackendConfig::window too, a headless backend has no surface support.
+    //  Its surface has to support the main view's format and present queue.
+    const Window* window = nullptr;
+    // NOTE: Size of the offscreen images, only used without a window
+    ui32 width = 800;
+    ui32 height = 600;
+    // NOTE: Without one it's the scene's camera with the eye turned 'orbit' radians around the target, about the up axis
+    std::optional<SyntheticCamera> camera;
+    f32 orbit = 0.0f;
+};
+
+// NOTE: What Init() builds. Without a window the backend renders into its own images and never presents.
+struct BackendConfig
+{
+    const Window* window = nullptr;
+    // NOTE: Size of the offscreen images, only used without a window
+    ui32 width = 800;
+    ui32 height = 600;
+    // NOTE: Only devices of this type are considered, e.g. eCpu picks lavapipe or SwiftShader
+    std::optional<vk::PhysicalDeviceType> deviceType;
+    // NOTE: Replaces the built-in grid of quads, only read during Init()
+    const SyntheticScene* scene = nullptr;
+    // NOTE: Seconds the animation advances per frame, so runs are repeatable. 0 follows the clock.
+    f32 fixedTimeStep = 0.0f;
+    // NOTE: Driver host allocations go through the backend's HostAllocator and show up in BackendStats::hostAllocations.
+    //  Off, the driver uses its own allocator and those stats stay zero.
+    bool trackHostAllocations = true;
+    HostAllocatorBackend hostAllocatorBackend = HostAllocatorBackend::Heap;
+    // NOTE: Caps the budget of the device-local heaps in bytes, so the eviction policy kicks in on any GPU. 0 is no cap.
+    vk::DeviceSize deviceMemoryBudget = 0;
+    // NOTE: How the mesh LOD chains are generated, only read during Init()
+    MeshLodDesc meshLods;
+    // NOTE: Screen-space error in pixels an object may have, the coarsest level within it is drawn. 0 always draws LOD 0.
+    f32 lodPixelError = 1.0f;
+    // NOTE: Meshlets are culled against the frustum and their normal cones on the GPU and drawn indirectly.
+    //  Ignored when the device can't start indirect draws at an instance other than 0.
+    bool meshletCulling = true;
+    // NOTE: Two-phase, what was visible last frame is drawn first, then everything else is tested against a Hi-Z pyramid
+    //  of that depth and drawn if it isn't behind it. Needs meshletCulling and a depth format that can be sampled.
+    bool occlusionCulling = true;
+    // NOTE: Frames picked by 'captureSchedule' are copied into a ring of readback buffers and written to 'captureDirectory'
+    //  by a background thread. Off, none of that exists and SetCaptureSchedule() does nothing. Also off when the
+    //  swapchain can't be copied from or its format isn't 8-bit RGBA/BGRA.
+    bool frameCapture = false;
+    ImageFileFormat captureFormat = ImageFileFormat::Png;
+    std::string captureDirectory = ".";
+    CaptureSchedule captureSchedule;
+    // NOTE: For callers that only draw when NeedsRedraw(). Presents with FIFO instead of immediate, so even an animating
+    //  scene is only rendered at the display rate, and keeps a copy of the last frame for PresentLastFrame().
+    //  Needs a window, the copy also needs a swapchain that can be copied to and from.
+    bool onDemand = false;
+    // NOTE: Trades throughput for latency. The uniforms are written right before the submit from the newest camera,
+    //  the render thread waits for each frame to be presented (VK_KHR_present_wait) or finished on the GPU before the
+    //  next, and DrawFrame() sleeps until just before the frame in front of it is predicted to be done.
+    bool lowLatency = false;
+    // NOTE: More views next to the main one, their swapchains are presented together with the main one in one presentKHR
+    std::vector<ViewConfig> views;
+    // NOTE: Pipeline cache file, read by Init() when it exists and was written for this device, written back by Shutdown().
+    //  Empty keeps the cache in memory, it's still shared by every pipeline the backend creates.
+    std::string pipelineCachePath;
+    // NOTE: The forward passes execute secondary command buffers, one per bucket of draws (opaque, transparent), which are
+    //  only recorded again when the bucket's draws changed. Off, every draw is recorded into the frame's command buffer.
+    bool commandCache = true;
+    // NOTE: Every pass of the main view's graph is wrapped in a pipeline statistics query, read back per frame into
+    //  BackendStats::pipelineStatistics. Ignored when the device has no pipeline statistics queries. Without
+    //  inheritedQueries the command cache is turned off, its secondary command buffers would draw outside the queries.
+    bool pipelineStatistics = false;
+    // NOTE: Debug view, every fragment that passes the depth test adds to the pixel's brightness instead of shading it and
+    //  is counted on the GPU, BackendStats::overdraw has the average per pixel. Ignored without fragmentStoresAndAtomics.
+    bool overdraw = false;
+};
+
+struct FrameTiming
+{
+    // NOTE: DrawFrame() on the main thread: simulation, culling, sorting and publishing
+    f64 cpuMilliseconds;
+    // NOTE: Render thread from the acquired image to the submit/present, waiting on the fence isn't included
+    f64 renderMilliseconds;
+    // NOTE: Between timestamps at the start and end of the command buffer, negative when the queue has no timestamps
+    f64 gpuMilliseconds;
+    // NOTE: Hi-Z pyramid build, between timestamps around its dispatches. Negative when it isn't measured.
+    f64 hizMilliseconds;
+    // NOTE: From DrawFrame() starting the simulation until the frame was presented, or finished on the GPU without
+    //  present wait. Only measured with BackendConfig::lowLatency, the render thread doesn't wait for frames otherwise.
+    f64 latencyMilliseconds;
+};
+
+// NOTE: Vulkan objects the backend currently owns, directly or through its allocator, texture manager and render graph
+struct DriverObjectStats
+{
+    ui32 deviceMemoryBlocks;
+    ui32 buffers;
+    ui32 images;
+    ui32 imageViews;
+    ui32 samplers;
+    ui32 pipelines;
+    ui32 descriptorSets;
+    ui32 commandBuffers;
+    ui32 semaphores;
+    ui32 fences;
+};
+
+// NOTE: Passes of the main view's graph that get a pipeline statistics query
+constexpr ui32 kMaxStatisticsPasses = 8;
+
+// NOTE: How many frames the main thread may publish before the render thread has picked them up,
+//  DrawFrame() blocks once it is that far ahead
+constexpr ui32 kMaxQueuedFrames = 2;
+
+// NOTE: Everything the render thread needs for one frame. The main thread fills it, after that nobody writes it
+//  until the render thread hands the slot back.
+struct ViewSnapshot
+{
+    UBO_MVP uniforms;
+    // NOTE: Sorted, copied out of the render queue
+    std::vector<DrawCommand> draws;
+};
+
+struct FrameSnapshot
+{
+    ui64 frameIndex;
+    // NOTE: Parallel to VkBackend::m_views, the main view first
+    std::vector<ViewSnapshot> views;
+    // NOTE: World matrices of every transform, the hierarchy only rewrites the ones this slot hasn't received yet
+    std::vector<f32> worldMatrices;
+    TransformUploadTarget transforms;
+    // NOTE: Where the render thread writes this frame's timings, nullptr when nobody asked for them
+    FrameTiming* timing;
+    // NOTE: Copied into the capture ring, unless no readback buffer is free
+    bool isCaptured;
+    // NOTE: PresentLastFrame(), nothing is rendered, the cached frame is copied to the next swapchain image
+    bool isRepresent;
+    // NOTE: When DrawFrame() started the simulation, latency is measured from here
+    std::chrono::steady_clock::time_point simulationStart;
+    // NOTE: Last snapshot, the render thread exits instead of rendering it
+    bool isShutdown;
+};
+
+// NOTE: What the eviction handlers did since Init()
+struct EvictionStats
+{
+    // NOTE: Calls that gave idle staging blocks back
+    ui32 stagingReleases;
+    // NOTE: One per texture that lost its top level
+    ui32 droppedTextureMips;
+    // NOTE: Geometry pool buffers moved to host-visible memory
+    ui32 demotedBuffers;
+    // NOTE: Frames that waited for the device before evicting
+    ui32 stalls;
+};
+
+// NOTE: Totals since Init() over the draws of every view that survived culling, divide by the frame count for per-frame numbers
+struct LodStats
+{
+    ui64 trianglesSubmitted;
+    // NOTE: What the same draws would have cost at LOD 0
+    ui64 trianglesWithoutLod;
+    // NOTE: Objects that drew a different level than in their previous frame
+    ui64 lodSwitches;
+    // NOTE: Levels over all meshes, LOD 0 included
+    ui32 levelCount;
+};
+
+// NOTE: Totals since Init() of the meshlet cull pass. Culled counts are read back from the GPU a few frames late,
+//  all of them are in after WaitIdle().
+struct MeshletStats
+{
+    ui64 meshletsTested;
+    ui64 meshletsCulled;
+    // NOTE: Out of LodStats::trianglesSubmitted, what was left for the vertex shader is the difference
+    ui64 trianglesCulled;
+    // NOTE: Over every level of every mesh
+    ui32 meshletCount;
+    // NOTE: False when the config or the device turned the cull pass off, the counters stay zero then
+    bool isEnabled;
+};
+
+// NOTE: Totals since Init() of the late cull phase, read back like MeshletStats. Only counts what occlusion kept from
+//  being drawn, objects drawn in the early phase were drawn whole.
+struct OcclusionStats
+{
+    // NOTE: Inside the frustum, but every meshlet that survived the cone test was behind the pyramid
+    ui64 objectsOccluded;
+    ui64 trianglesOccluded;
+    ui32 pyramidLevels;
+    bool isEnabled;
+};
+
+// NOTE: Totals since Init(), main thread
+struct PresentStats
+{
+    ui64 framesDrawn;
+    // NOTE: PresentLastFrame() calls that presented the cached frame instead of rendering
+    ui64 framesRepresented;
+    bool isOnDemand;
+};
+
+struct LatencyStats
+{
+    FramePacingStats pacing;
+    bool usesPresentWait;
+    bool isEnabled;
+};
+
+// NOTE: Totals since Init() of one render graph pass, in declaration order. Passes culled in a frame count nothing then.
+struct PassStatistics
+{
+    std::string name;
+    ui64 inputAssemblyVertices;
+    ui64 inputAssemblyPrimitives;
+    ui64 vertexShaderInvocations;
+    // NOTE: Primitives that reached clipping, culled meshlets and off-screen triangles never get here
+    ui64 clippingPrimitives;
+    ui64 fragmentShaderInvocations;
+    ui64 computeShaderInvocations;
+};
+
+// NOTE: Only the main view is measured, PresentLastFrame() frames don't count. Read back like MeshletStats.
+struct PipelineStatisticsStats
+{
+    std::array<PassStatistics, kMaxStatisticsPasses> passes;
+    ui32 passCount;
+    ui64 framesMeasured;
+    bool isEnabled;
+};
+
+// NOTE: Totals since Init() of BackendConfig::overdraw, every view counts. Read back like MeshletStats.
+struct OverdrawStats
+{
+    // NOTE: Fragments that passed the depth test
+    ui64 fragmentsShaded;
+    // NOTE: Pixels of the frames measured, fragmentsShaded / pixels is the average overdraw
+    ui64 pixels;
+    ui64 framesMeasured;
+    f64 lastFrameOverdraw;
+    bool isEnabled;
+};
+
+// NOTE: Of Init(), its steps ran as a dependency graph on the job system
+struct InitStats
+{
+    InitGraphStats graph;
+    // NOTE: From the start of Init() until the first frame was submitted, negative before that
+    f64 firstFrameMilliseconds;
+};
+
+struct ViewStats
+{
+    // NOTE: The main view included
+    ui32 viewCount;
+    // NOTE: Views with a window, all presented by one presentKHR
+    ui32 swapchainCount;
+    // NOTE: Read from BackendConfig::pipelineCachePath by Init(), 0 without a file or when it was for another device
+    size_t pipelineCacheBytesLoaded;
+};
+
+struct BackendStats
+{
+    RenderGraphStats renderGraph;
+    RenderQueueStats renderQueue;
+    DeviceAllocatorStats allocator;
+    HostAllocatorStats hostAllocations;
+    // NOTE: The largest of the per-frame arenas, spills summed over all of them
+    ArenaStats frameArena;
+    // NOTE: Init-time temporaries
+    ArenaStats scratch;
+    EvictionStats eviction;
+    GeometryPoolStats geometry;
+    LodStats lod;
+    MeshletStats meshlets;
+    OcclusionStats occlusion;
+    CaptureStats capture;
+    PresentStats present;
+    LatencyStats latency;
+    ViewStats views;
+    ShaderRegistryStats shaders;
+    CommandCacheStats commands;
+    PipelineStatisticsStats pipelineStatistics;
+    OverdrawStats overdraw;
+    CullingStats culling;
+    TransformStats transforms;
+    DriverObjectStats objects;
+    InitStats init;
+};
+
+// NOTE: Everything one output of the backend owns, a window's surface and swapchain or offscreen images standing in
+//  for them, the graph that renders into them and the per-image resources that hold its camera. The device, pipelines,
+//  geometry, textures and scene are the backend's and shared by every view.
+struct RenderView
+{
+    // NOTE: Null for offscreen views, they have no surface, swapchain or semaphores
+    const Window*                   window = nullptr;
+    vk::SurfaceKHR                  surface;
+    vk::SwapchainKHR                swapchain;
+    vk::Format                      format;
+    vk::Extent2D                    extent;
+    std::vector<vk::Image>          images;
+    std::vector<vk::ImageView>      imageViews;
+    // NOTE: Offscreen only
+    std::vector<Allocation>         offscreenAllocations;
+    // NOTE: Render thread, the image of the frame being recorded. Offscreen images are used round-robin.
+    ui32                            imageIndex = 0;
+    // NOTE: One per frame in flight
+    std::vector<vk::Semaphore>      imageAvailableSemaphores;
+    std::vector<vk::Semaphore>      renderFinishedSemaphores;
+
+    // NOTE: Owns render passes, framebuffers and transient attachments
+    RenderGraph                     renderGraph;
+    RGResource                      backbuffer;
+    RGResource                      depthBuffer;
+    // NOTE: With the command cache, what the forward passes' secondary command buffers inherit and the view's first
+    //  slot in it. The render passes are null with dynamic rendering, the formats are inherited instead.
+    vk::RenderPass                  forwardRenderPass;
+    vk::RenderPass                  forwardLateRenderPass;
+    RGAttachmentFormats             forwardFormats;
+    ui32                            commandCacheSlot = 0;
+
+    // NOTE: Per image and persistently mapped. Every view gets its own copy of the world matrices, so its descriptor
+    //  sets never change while a frame may still use them.
+    std::vector<vk::Buffer>         uniformBuffers;
+    std::vector<Allocation>         uniformBufferAllocations;
+    std::vector<vk::Buffer>         transformBuffers;
+    std::vector<Allocation>         transformBufferAllocations;
+    std::vector<vk::DescriptorSet>  descriptorSets;
+
+    // NOTE: Main thread
+    glm::vec3                       cameraEye;
+    glm::vec3                       cameraTarget;
+    glm::vec3                       cameraUp;
+    f32                             cameraFovY;
+    UBO_MVP                         uniforms;
+    // NOTE: Parallel to the scene objects, the level each object drew last in this view, where hysteresis starts from
+    std::vector<ui8>                objectLods;
+    // NOTE: Low latency, the newest uniforms, guarded by VkBackend::m_latchMutex
+    UBO_MVP                         latchedUniforms;
+};
+
 class VkBackend
 {
 public:
@@ -63,49 +511,203 @@ public:
     VkBackend(const VkBackend&) = delete;
     VkBackend& operator=(const VkBackend&) = delete;
 
-    void Init(const Window& window);
+    // NOTE: Culling, transforms, sorting and texture transcoding run through 'jobSystem', it has to outlive the backend.
+    //  Starts the render thread, Init(), DrawFrame(), WaitIdle() and Shutdown() must be called from the thread that owns 'jobSystem'.
+    //  Init() itself is a graph of steps on 'jobSystem', so device creation, pipeline compiles and building the scene's
+    //  meshes and textures overlap. BackendStats::init has what each step took.
+    void Init(const BackendConfig& config, JobSystem& jobSystem);
     void Shutdown();
 
+    // NOTE: Simulates the scene, culls and sorts, then hands the frame to the render thread.
+    //  Only blocks when kMaxQueuedFrames frames are still waiting to be submitted.
     void DrawFrame();
-    // NOTE: Questionable method
-    void WaitIdle() const;
+    // NOTE: Waits until the render thread has submitted every published frame, then for the device
+    //  and for the captures of those frames to be written
+    void WaitIdle();
+
+    // NOTE: The next timings.size() frames write their timings into 'timings', which has to stay alive until they're done.
+    //  GPU times arrive a few frames late, all of them are in after WaitIdle().
+    void SetFrameTimings(std::span<FrameTiming> timings);
+    // NOTE: Replaces BackendConfig::captureSchedule, its frames count from the next DrawFrame()
+    void SetCaptureSchedule(const CaptureSchedule& schedule);
+
+    // NOTE: The scene spins while animating. Stopped, its clock stops too, so drawing again gives the same frame.
+    void SetAnimating(bool isAnimating);
+    // NOTE: Something that changes the frame happened outside the backend, the next NeedsRedraw() is true
+    void MarkDirty();
+    // NOTE: Animating, or something changed since the last DrawFrame(). The first frame always needs drawing.
+    bool NeedsRedraw() const;
+    // NOTE: Shows the last drawn frame again without rendering, for when the window lost its contents.
+    //  Draws a frame instead when there is no cached frame yet or BackendConfig::onDemand didn't get one,
+    //  does nothing without a window.
+    void PresentLastFrame();
+    // NOTE: Replaces the camera of 'view', 0 is the main view and BackendConfig::views follow in order.
+    //  With BackendConfig::lowLatency frames already handed to the render thread but not submitted yet pick it up too,
+    //  culling and LOD selection still used the one from their DrawFrame().
+    void SetCamera(const SyntheticCamera& camera, ui32 view = 0);
+    // NOTE: Replaces BackendConfig::deviceMemoryBudget, the next DrawFrame() evicts when a heap is over it. 0 removes the cap.
+    void SetDeviceMemoryBudget(vk::DeviceSize budget);
+    // NOTE: Any time, allocations made before the switch are still freed by the backend they came from.
+    //  Does nothing when the config didn't track host allocations.
+    void SetHostAllocatorBackend(HostAllocatorBackend backend);
+
+    // NOTE: Main thread side, the render graph stats are the main view's and only written when it's compiled
+    BackendStats GetStats() const;
+    std::string GetDeviceName() const;
 
 private:
     void _CreateInstance(ui32 apiVersion);
     void _SetupDebugMessenger();
-    void _CreateSurface(GLFWwindow* windowHandle);
-    void _SelectPhysicalDevice();
+    void _CreateSurface(ui32 viewIndex);
+    void _SelectPhysicalDevice(std::optional<vk::PhysicalDeviceType> deviceType);
     void _CreateLogicalDeviceAndQueues();
-    void _CreateSwapchain(ui32 width, ui32 height);
-    void _CreateImageViews();
-    void _CreateRenderPass();
+    void _CreatePipelineCache(const std::string& path);
+    void _SavePipelineCache();
+    void _CreateSwapchain(ui32 viewIndex);
+    void _CreateOffscreenImages(ui32 viewIndex, ui32 width, ui32 height, vk::Format format);
+    void _CreateImageViews(ui32 viewIndex);
+    void _CreateFrameCache();
+    void _CreateRenderGraph(ui32 viewIndex);
 
     void _CreateDescriptorSetLayout();
     void _CreateGraphicsPipeline();
+    void _CreateMeshletCullPipeline();
+    void _CreateDepthPyramid();
 
-    void _CreateFramebuffers();
     void _CreateCommandPool();
 
-    void _CreateVertexBuffer();
-    void _CreateIndexBuffer();
+    // NOTE: CPU only, into m_initAssets, they neither touch the device nor m_scratch
+    void _BuildMeshLods(const SyntheticScene* scene, const MeshLodDesc& lodDesc);
+    void _BuildTextures();
+    void _CreateMeshBuffers(const SyntheticScene* scene);
+    void _UploadMeshlets(std::span<const Meshlet> meshlets);
+    void _CreateTextures();
     void _CreateUniformBuffers();
+    void _CreateTransformBuffers();
+    void _CreateMeshletBuffers();
 
     void _CreateDescriptorPool();
     void _CreateDescriptorSets();
+    void _WriteDescriptorSets();
+    void _RegisterEvictionHandlers();
 
     void _CreateCommandBuffers();
     void _CreateSyncPrimitives();
+    void _CreateQueryPool();
+    void _CreateOverdrawBuffer();
+
+    void _CreateScene(const SyntheticScene* scene);
+    void _CreateViewCameras(std::span<const ViewConfig> views);
+    void _CreateSnapshots();
 
 
     void _CleanupSwapchain();
     //void _RecreateSwapchain();
 
-    void _UpdateUniformBuffers(ui32 imageIndex);
+    // NOTE: Main thread
+    void _UpdateTransforms(FrameSnapshot& snapshot);
+    // NOTE: From the view's camera and extent, also publishes them to the render thread's latch
+    void _UpdateUniforms(ui32 viewIndex);
+    void _BuildRenderQueue(ui32 viewIndex);
+    void _StopRenderThread();
+    DriverObjectStats _GetDriverObjectStats() const;
+    PipelineStatisticsStats _GetPipelineStatistics() const;
+
+    // NOTE: Render thread
+    void _RenderThreadLoop();
+    void _RenderFrame(const FrameSnapshot& snapshot);
+    // NOTE: These go by every view's RenderView::imageIndex
+    void _UploadSnapshot(const FrameSnapshot& snapshot);
+    void _RecordCommandBuffer(const vk::CommandBuffer& commandBuffer, std::pmr::memory_resource* frameMemory);
+    void _RecordRepresent(const vk::CommandBuffer& commandBuffer);
+    // NOTE: Geometry, descriptor set, viewport and scissor of a view, secondary command buffers inherit none of them
+    void _RecordDrawState(const vk::CommandBuffer& commandBuffer, ui32 viewIndex, ui32 imageIndex);
+    // NOTE: 'drawOffset' is where the first draw's meshlet commands start in the image's meshlet draw buffer
+    void _RecordDraws(const vk::CommandBuffer& commandBuffer, std::span<const DrawCommand> draws, ui32 imageIndex,
+                      bool isMeshletCulled, vk::DeviceSize drawOffset);
+    void _LatchUniforms();
+    // NOTE: Low latency, blocks the render thread until the frame is on screen or done on the GPU
+    void _WaitForFrameCompletion(const FrameSnapshot& snapshot, ui64 presentId);
+    // NOTE: The frame's fence must have been waited for
+    void _ReadGpuTiming(ui32 frameData);
+    // NOTE: Same, adds the frame's culled and occluded counts to the totals and zeroes them for its next use
+    void _ReadMeshletStats(ui32 frameData);
+    // NOTE: Same, add the frame's pass statistics and fragment count to the totals
+    void _ReadPipelineStatistics(ui32 frameData);
+    void _ReadOverdraw(ui32 frameData);
 
 private:
+    // NOTE: Frames published by the main thread
     ui64 m_frameCounter;
+    // NOTE: Render thread only
     ui32 m_currentFrameData;
 
+    JobSystem*                      m_jobSystem;
+    // NOTE: The main view has no surface and swapchain, its images are the backend's own
+    bool                            m_isHeadless;
+    f32                             m_fixedTimeStep;
+    f32                             m_lodPixelError;
+    // NOTE: BackendConfig::meshletCulling and the device supports it
+    bool                            m_useMeshletCulling;
+    // NOTE: Same for BackendConfig::occlusionCulling, implies m_useMeshletCulling
+    bool                            m_useOcclusionCulling;
+    // NOTE: BackendConfig::frameCapture and the swapchain can be copied from
+    bool                            m_useFrameCapture;
+    // NOTE: Main thread, decides FrameSnapshot::isCaptured
+    CaptureSchedule                 m_captureSchedule;
+    ui64                            m_captureScheduleStart;
+    // NOTE: BackendConfig::onDemand with a window, m_frameCacheImage exists when it's set
+    bool                            m_isOnDemand;
+    // NOTE: Main thread, what NeedsRedraw() and PresentLastFrame() go by
+    bool                            m_isAnimating;
+    bool                            m_isDirty;
+    bool                            m_hasCachedFrame;
+    // NOTE: Seconds the scene has animated, only advances while m_isAnimating
+    f64                             m_animationTime;
+    std::chrono::steady_clock::time_point m_lastAnimationTick;
+    PresentStats                    m_presentStats;
+    bool                            m_useLowLatency;
+    bool                            m_usePresentWait;
+    PFN_vkWaitForPresentKHR         m_waitForPresent;
+    // NOTE: Render thread, increases with every present
+    ui64                            m_presentId;
+    FramePacer                      m_framePacer;
+    // NOTE: Low latency, guards every view's latched uniforms. The main thread writes them, the render thread copies them
+    //  right before the submit, so a camera change reaches frames that were already simulated.
+    std::mutex                      m_latchMutex;
+
+    std::span<FrameTiming>          m_frameTimings;
+    ui64                            m_frameTimingsStart;
+
+    // NOTE: Slots go main thread -> m_queuedSnapshots -> render thread -> m_freeSnapshots -> main thread,
+    //  so each snapshot is owned by exactly one thread at a time
+    std::array<FrameSnapshot, kMaxQueuedFrames> m_snapshots;
+    SpscQueue                       m_freeSnapshots;
+    SpscQueue                       m_queuedSnapshots;
+    std::thread                     m_renderThread;
+    // NOTE: Snapshot being recorded, read by the forward pass
+    const FrameSnapshot*            m_renderSnapshot;
+    // NOTE: First exception of the render thread, rethrown by the next DrawFrame()
+    std::exception_ptr              m_renderThreadError;
+    std::atomic<bool>               m_hasRenderThreadError;
+
+
+    // NOTE: Temporaries of Init(), every method that uses it opens its own ScratchScope. Init() steps run on any thread,
+    //  the ones using it depend on each other so only one does at a time.
+    ScratchStack                    m_scratch;
+    InitAssets                      m_initAssets;
+    // NOTE: Steps of the last Init(), timed while they ran
+    InitGraphStats                  m_initStats;
+    std::chrono::steady_clock::time_point m_initStart;
+    // NOTE: Render thread writes it once, GetStats() reads. From m_initStart to the first submit, negative before it.
+    std::atomic<i64>                m_firstFrameNanoseconds;
+    // NOTE: Render thread only, one per frame in flight, reset once the frame's fence is signaled
+    std::unique_ptr<LinearArena[]>  m_frameArenas;
+
+    // NOTE: The driver calls into it from any thread until m_instance is destroyed
+    HostAllocator                   m_hostAllocator;
+    // NOTE: m_hostAllocator's callbacks, nullptr when host allocations aren't tracked. Passed to every create/destroy call.
+    const vk::AllocationCallbacks*  m_allocationCallbacks;
 
     vk::Instance                    m_instance;
 
@@ -113,48 +715,141 @@ private:
     //  although probably with more optimization options enabled it will be removed.
     vk::DebugUtilsMessengerEXT      m_debugMessenger;
 
-    vk::SurfaceKHR                  m_surface;
-
     vk::PhysicalDevice              m_physicalDevice;
+    // NOTE: Both queried once by _SelectPhysicalDevice()
+    vk::PhysicalDeviceProperties    m_deviceProperties;
+    DeviceCapabilities              m_capabilities;
     vk::Device                      m_device;
 
     vk::Queue                       m_graphicsQueue;
     vk::Queue                       m_presentQueue;
-
-    vk::SwapchainKHR                m_swapchain;
-    vk::Format                      m_swapchainFormat;
-    vk::Extent2D                    m_swapchainExtent;
-
-
-    std::vector<vk::Image>          m_swapchainImages;
-    std::vector<vk::ImageView>      m_swapchainImageViews;
-    std::vector<vk::Framebuffer>    m_framebuffers;
-
-
-    vk::RenderPass                  m_renderPass;
+    // NOTE: Every pipeline is created through it, so pipelines already built once, in this run or one before it
+    //  when there's a file, come from the cache instead of the shader compiler
+    vk::PipelineCache               m_pipelineCache;
+    std::string                     m_pipelineCachePath;
+    size_t                          m_pipelineCacheBytesLoaded;
+    // NOTE: Every pipeline's shaders, read once. Modules only exist while pipelines are being created.
+    ShaderRegistry                  m_shaderRegistry;
+
+    // NOTE: The main view first, then BackendConfig::views, a view's passes capture its index
+    std::unique_ptr<RenderView[]>   m_views;
+    ui32                            m_viewCount;
+    ui32                            m_swapchainCount;
+
+    // NOTE: Copy of the main view's last rendered frame, kept in eTransferSrcOptimal. Only with m_isOnDemand.
+    RGResource                      m_frameCache;
+    vk::Image                       m_frameCacheImage;
+    Allocation                      m_frameCacheAllocation;
     vk::DescriptorSetLayout         m_descriptorSetLayout;
-    // TODO: Move this and all stuff about shaders to its own class, as done in DOOM3 ?
     vk::PipelineLayout              m_pipelineLayout;
-    vk::Pipeline                    m_pipeline;
+    // NOTE: Indexed by DrawCommand::pipeline. Viewport and scissor are dynamic, every view has the main view's
+    //  attachment formats, so all of them draw with the same pipelines.
+    std::vector<vk::Pipeline>       m_pipelines;
+    // NOTE: Null without meshlet culling, shares m_descriptorSetLayout with the graphics pipelines
+    vk::PipelineLayout              m_meshletCullLayout;
+    vk::Pipeline                    m_meshletCullPipeline;
 
 
     vk::CommandPool                 m_commandPool;
+    // NOTE: One per frame in flight, re-recorded every frame from the render queue. Every view is recorded into it.
     std::vector<vk::CommandBuffer>  m_commandBuffers;
-    std::vector<vk::Semaphore>      m_imageAvailableSemaphores;
-    std::vector<vk::Semaphore>      m_renderFinishedSemaphores;
     std::vector<vk::Fence>          m_inFlightFences;
-
-    // NOTE: The 'Index buffer' chapter of vulkan-tutorial says that it may be more efficient to store vertex nad index buffers in one vk::Buffer
-    vk::Buffer                      m_vertexBuffer;
-    vk::DeviceMemory                m_vertexBufferMemory;
-    vk::Buffer                      m_indexBuffer;
-    vk::DeviceMemory                m_indexBufferMemory;
-
-    std::vector<vk::Buffer>         m_uniformBuffers;
-    std::vector<vk::DeviceMemory>   m_uniformBuffersMemory;
-
+    // NOTE: BackendConfig::commandCache. Slots go per view, frame in flight, image, forward pass and bucket.
+    bool                            m_useCommandCache;
+    CommandCache                    m_commandCache;
+
+    // NOTE: Four timestamps per frame in flight, the frame's and the Hi-Z build's, null when the graphics queue doesn't support them
+    vk::QueryPool                   m_timestampQueryPool;
+    f64                             m_timestampPeriod;
+    ui64                            m_timestampMask;
+    // NOTE: Render thread only, per frame in flight: whose timing the queries belong to
+    std::vector<FrameTiming*>       m_pendingGpuTimings;
+    // NOTE: BackendConfig::pipelineStatistics and the device supports it. kMaxStatisticsPasses queries per frame in flight.
+    bool                            m_usePipelineStatistics;
+    vk::QueryPool                   m_statisticsQueryPool;
+    // NOTE: Render thread only, per frame in flight: whether its queries were written, re-presents record none
+    std::vector<bool>               m_pendingStatistics;
+    // NOTE: Render thread writes, GetStats() reads. Per pass and statistic, in PassStatistics order.
+    std::array<std::array<std::atomic<ui64>, 6>, kMaxStatisticsPasses> m_passStatistics;
+    std::atomic<ui64>               m_statisticsFrames;
+
+    // NOTE: Every buffer and image is sub-allocated from a few big vk::DeviceMemory blocks
+    DeviceAllocator                 m_allocator;
+    // NOTE: Init-time uploads are recorded into one command buffer and submitted once
+    UploadBatch                     m_uploadBatch;
+    TextureManager                  m_textureManager;
+    // NOTE: Main thread, written by the eviction handlers
+    EvictionStats                   m_evictionStats;
+
+    // NOTE: Every mesh of the scene in one vertex and one index buffer, bound once per frame.
+    //  The 'Index buffer' chapter of vulkan-tutorial says that it may be more efficient to store vertex nad index buffers in one vk::Buffer
+    GeometryPool                    m_geometryPool;
+    // NOTE: Scene mesh index to pool handle
+    std::vector<MeshHandle>         m_meshes;
+    // NOTE: Parallel to m_meshes
+    std::vector<MeshLods>           m_meshLods;
+    // NOTE: Every meshlet of every level, device-local and never rewritten. Null without meshlet culling.
+    vk::Buffer                      m_meshletBuffer;
+    Allocation                      m_meshletAllocation;
+    ui32                            m_meshletCount;
+
+    TextureHandle                   m_albedoTexture;
+    vk::Sampler                     m_albedoSampler;
+
+    // NOTE: Per image of the main view, one cull job per draw written by the render thread, and one indirect command
+    //  per meshlet of those draws written by the cull pass. Sized for every object drawing its largest level.
+    std::vector<vk::Buffer>         m_cullJobBuffers;
+    std::vector<Allocation>         m_cullJobAllocations;
+    std::vector<vk::Buffer>         m_meshletDrawBuffers;
+    std::vector<Allocation>         m_meshletDrawAllocations;
+    // NOTE: Draw commands per phase, the late phase's start this many commands in
+    ui32                            m_meshletDrawCapacity;
+    // NOTE: Culled counts of every frame in flight, persistently mapped
+    vk::Buffer                      m_meshletStatsBuffer;
+    Allocation                      m_meshletStatsAllocation;
+    // NOTE: Render thread writes, GetStats() reads
+    std::atomic<ui64>               m_meshletsTested;
+    std::atomic<ui64>               m_meshletsCulled;
+    std::atomic<ui64>               m_meshletTrianglesCulled;
+    // NOTE: Per scene object, set by the late cull phase when the object was visible. Persistently mapped, so it
+    //  starts out zeroed and the first frame draws everything late. Exists with meshlet culling, the shader declares it.
+    vk::Buffer                      m_visibilityBuffer;
+    Allocation                      m_visibilityAllocation;
+    // NOTE: Sized to the main view, same as m_visibilityBuffer, only built with occlusion culling
+    DepthPyramid                    m_depthPyramid;
+    std::atomic<ui64>               m_objectsOccluded;
+    std::atomic<ui64>               m_trianglesOccluded;
+    // NOTE: BackendConfig::overdraw and the device supports it. One fragment counter per frame in flight, persistently
+    //  mapped and zeroed by the render thread once it's read, bound to every descriptor set.
+    bool                            m_useOverdraw;
+    vk::Buffer                      m_overdrawBuffer;
+    Allocation                      m_overdrawAllocation;
+    // NOTE: Render thread only, per frame in flight: pixels its views drew, 0 for re-presents
+    std::vector<ui64>               m_pendingOverdrawPixels;
+    std::atomic<ui64>               m_overdrawFragments;
+    std::atomic<ui64>               m_overdrawPixels;
+    std::atomic<ui64>               m_overdrawFrames;
+    // NOTE: Of the last frame read back, as f64 bits
+    std::atomic<ui64>               m_lastFrameOverdraw;
+    // NOTE: Sized to the main view, only initialized with m_useFrameCapture
+    FrameCapture                    m_frameCapture;
+
+    // NOTE: Every view's descriptor sets, one per image
     vk::DescriptorPool              m_descriptorPool;
-    std::vector<vk::DescriptorSet>  m_descriptorSets;
+
+    // NOTE: Scene state below is the main thread's, the render thread only reads m_sceneObjects and m_materialColors,
+    //  which never change after Init()
+    std::vector<glm::vec4>          m_materialColors;
+    TransformHierarchy              m_transforms;
+    // NOTE: Rotating parent of every scene object
+    TransformId                     m_sceneRoot;
+    std::vector<SceneObject>        m_sceneObjects;
+    // NOTE: Parallel to m_sceneObjects, bounds are in the space of m_sceneRoot, its world matrix goes into the frustum instead
+    CullingBounds                   m_cullingBounds;
+    FrustumCuller                   m_frustumCuller;
+    std::vector<ui32>               m_visibleObjects;
+    LodStats                        m_lodStats;
+    RenderQueue                     m_renderQueue;
 };
 
 }
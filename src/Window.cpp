@@ -3,6 +3,10 @@
 #include <stdexcept>
 
 
+// NOTE: GLFW is initialized once for every window, only the last one to go terminates it
+static ui32 s_windowCount = 0;
+
+
 void Window::Init(ui32 width, ui32 height, const char* title)
 {
     glfwInit();
@@ -17,12 +21,21 @@ void Window::Init(ui32 width, ui32 height, const char* title)
     m_width = width;
     m_height = height;
     m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+
+    m_isDamaged = false;
+    ++s_windowCount;
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* handle) {
+        static_cast<Window*>(glfwGetWindowUserPointer(handle))->m_isDamaged = true;
+    });
 }
 
 void Window::Shutdown()
 {
     glfwDestroyWindow(m_window);
-    glfwTerminate();
+    if (--s_windowCount == 0) {
+        glfwTerminate();
+    }
 }
 
 GLFWwindow* Window::GetWindowHandle() const
@@ -50,3 +63,20 @@ void Window::PollEvents() const
 {
     glfwPollEvents();
 }
+
+void Window::WaitEvents(f64 timeoutSeconds) const
+{
+    glfwWaitEventsTimeout(timeoutSeconds);
+}
+
+bool Window::ConsumeDamage()
+{
+    const bool isDamaged = m_isDamaged;
+    m_isDamaged = false;
+    return isDamaged;
+}
+
+bool Window::IsIconified() const
+{
+    return glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) == GLFW_TRUE;
+}
@@ -20,10 +20,18 @@ public:
 
     bool ShouldClose() const;
     void PollEvents() const;
+    // NOTE: Sleeps until an event arrives or 'timeoutSeconds' pass, then processes the events like PollEvents()
+    void WaitEvents(f64 timeoutSeconds) const;
+
+    // NOTE: True once after the window's contents were lost (exposed, restored), the last frame has to be shown again
+    bool ConsumeDamage();
+    bool IsIconified() const;
 
 private:
     GLFWwindow* m_window;
 
     ui32 m_width;
     ui32 m_height;
+    // NOTE: Set by the refresh callback during event processing
+    bool m_isDamaged;
 };
@@ -11,3 +11,4 @@ using ui32 = std::uint32_t;
 using ui64 = std::uint64_t;
 
 using f32 = float;
+using f64 = double;
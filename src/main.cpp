@@ -7,48 +7,126 @@
 
 #include "VkBackend.hpp"
 #include "Window.hpp"
+#include "JobSystem.hpp"
+#include "CpuFeatures.hpp"
+
+#include <charconv> // std::from_chars
+#include <stdexcept> // std::runtime_error
+#include <string_view>
+#include <string>
+#include <vector>
+#include <numbers>
 
 
 constexpr ui32 kWindowWidth = 800;
 constexpr ui32 kWindowHeight = 600;
+// NOTE: On-demand mode wakes up at least this often even without events
+constexpr f64 kIdleTimeoutSeconds = 0.1;
 
 
 
 class TriangleApp
 {
 public:
-    TriangleApp()
+    // NOTE: On demand frames are only drawn when something changed, a paused scene is drawn once and then sleeps.
+    //  Low latency paces the frames, so each one is simulated as late as possible.
+    //  Every window after the first shows the scene from a camera orbited a bit further around it.
+    TriangleApp(bool isOnDemand, bool isPaused, bool isLowLatency, ui32 windowCount)
+        : m_isOnDemand(isOnDemand)
     {
+        // NOTE: The main thread is one of the job threads, it helps while it waits
+        m_jobSystem.Init(GetCpuFeatures().hardwareThreads - 1);
         m_window.Init(kWindowWidth, kWindowHeight, "Vulkan");
-        m_vkBackend.Init(m_window);
+
+        // NOTE: Sized once, the backend and GLFW keep pointers to the windows
+        m_extraWindows.resize(windowCount > 1 ? windowCount - 1 : 0);
+        std::vector<vulkan::ViewConfig> views;
+        for (size_t i = 0; i < m_extraWindows.size(); ++i) {
+            const std::string title = "Vulkan " + std::to_string(i + 1);
+            m_extraWindows[i].Init(kWindowWidth, kWindowHeight, title.c_str());
+            views.push_back({ .window = &m_extraWindows[i],
+                              .width = kWindowWidth,
+                              .height = kWindowHeight,
+                              .orbit = 2.0f * std::numbers::pi_v<f32> * static_cast<f32>(i + 1) / static_cast<f32>(windowCount) });
+        }
+
+        m_vkBackend.Init({ .window = &m_window, .onDemand = isOnDemand, .lowLatency = isLowLatency, .views = std::move(views) },
+                         m_jobSystem);
+        m_vkBackend.SetAnimating(isPaused == false);
     }
 
     ~TriangleApp()
     {
         m_vkBackend.Shutdown();
+        for (auto& window : m_extraWindows) {
+            window.Shutdown();
+        }
         m_window.Shutdown();
+        m_jobSystem.Shutdown();
     }
 
+    // NOTE: Events and simulation stay on this thread, the backend's render thread does the waiting on the GPU
     void run()
     {
         while (m_window.ShouldClose() == false) {
-            m_window.PollEvents();
-            m_vkBackend.DrawFrame();
+            if (m_isOnDemand == false) {
+                m_window.PollEvents();
+                m_vkBackend.DrawFrame();
+                continue;
+            }
+
+            // NOTE: A new frame covers any damage. With nothing to draw the thread sleeps in WaitEvents(),
+            //  a window that lost its contents gets the last frame again instead of a new one.
+            if (m_vkBackend.NeedsRedraw() && m_window.IsIconified() == false) {
+                m_window.PollEvents();
+                m_window.ConsumeDamage();
+                m_vkBackend.DrawFrame();
+            } else {
+                m_window.WaitEvents(kIdleTimeoutSeconds);
+                if (m_window.ConsumeDamage() && m_window.IsIconified() == false) {
+                    m_vkBackend.PresentLastFrame();
+                }
+            }
         }
         m_vkBackend.WaitIdle();
     }
 
 private:
+    bool m_isOnDemand;
+    JobSystem m_jobSystem;
     Window m_window;
+    std::vector<Window> m_extraWindows;
     vulkan::VkBackend m_vkBackend;
 };
 
 
-int main()
+// NOTE: --on-demand only draws when something changed, --paused starts with the scene stopped,
+//  --low-latency paces frames for the shortest simulation-to-present time, --windows N opens N windows on the same scene
+int main(int argc, char** argv)
 {
-
     try {
-        TriangleApp app;
+        bool isOnDemand = false;
+        bool isPaused = false;
+        bool isLowLatency = false;
+        ui32 windowCount = 1;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--on-demand") {
+                isOnDemand = true;
+            } else if (arg == "--paused") {
+                isPaused = true;
+            } else if (arg == "--low-latency") {
+                isLowLatency = true;
+            } else if (arg == "--windows" && i + 1 < argc) {
+                const std::string_view value = argv[++i];
+                const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), windowCount);
+                if (error != std::errc() || end != value.data() + value.size() || windowCount == 0) {
+                    throw std::runtime_error("--windows needs a window count above 0, not '" + std::string(value) + "'!");
+                }
+            }
+        }
+
+        TriangleApp app(isOnDemand, isPaused, isLowLatency, windowCount);
         app.run();
     }
     catch (const std::exception& e) {
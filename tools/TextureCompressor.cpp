@@ -0,0 +1,181 @@
+// NOTE: Offline texture compression into the renderer's texture container.
+//  Usage: TextureCompressor <input.ppm> <output.lvtex> [--formats bc7,bc3,bc1,bc5] [--linear] [--no-mips]
+//                           [--threads N] [--astc <levels.astc>]
+//  '--formats' order is the order of preference at load time. '--astc' takes raw 4x4 ASTC blocks of every mip level
+//  back to back (e.g. astcenc output without the header), it's stored as is and used on devices that support ASTC.
+
+#include "TextureContainer.hpp"
+
+#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <cstdlib> // std::atoi
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+auto _readPPM(const std::string& path, ui32& width, ui32& height)       -> std::vector<ui8>;
+auto _readFile(const std::string& path)                                 -> std::vector<ui8>;
+auto _parseFormats(std::string_view list)                               -> std::vector<BlockFormat>;
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: TextureCompressor <input.ppm> <output.lvtex> [--formats bc7,bc3,bc1,bc5] [--linear] [--no-mips]"
+                     " [--threads N] [--astc <levels.astc>]\n";
+        return -1;
+    }
+
+    const std::string inputPath = argv[1];
+    const std::string outputPath = argv[2];
+
+    std::vector<BlockFormat> formats{ BlockFormat::BC7, BlockFormat::BC1 };
+    bool isSrgb = true;
+    bool generateMips = true;
+    ui32 threadCount = GetCpuFeatures().hardwareThreads;
+    std::string astcPath;
+
+    try {
+        for (int i = 3; i < argc; ++i) {
+            const std::string_view argument = argv[i];
+
+            if (argument == "--formats" && i + 1 < argc) {
+                formats = _parseFormats(argv[++i]);
+            } else if (argument == "--linear") {
+                isSrgb = false;
+            } else if (argument == "--no-mips") {
+                generateMips = false;
+            } else if (argument == "--threads" && i + 1 < argc) {
+                threadCount = static_cast<ui32>(std::max(std::atoi(argv[++i]), 1));
+            } else if (argument == "--astc" && i + 1 < argc) {
+                astcPath = argv[++i];
+            } else {
+                throw std::runtime_error("Unknown argument: " + std::string(argument));
+            }
+        }
+
+        ui32 width = 0;
+        ui32 height = 0;
+        const auto pixels = _readPPM(inputPath, width, height);
+
+        JobSystem jobSystem;
+        jobSystem.Init(threadCount - 1);
+        auto container = TextureContainer::Build(pixels.data(), width, height, isSrgb, generateMips, formats,
+                                                 GetBestSimdLevel(), threadCount, jobSystem.GetParallelFor());
+        jobSystem.Shutdown();
+        if (astcPath.empty() == false) {
+            const auto astcData = _readFile(astcPath);
+            container.AddPayload(ContainerFormat::ASTC4x4, astcData.data(), astcData.size());
+        }
+
+        container.Save(outputPath);
+
+        std::cout << outputPath << ": " << width << 'x' << height << ", " << container.GetMipCount() << " mips,";
+        for (const auto& payload : container.GetPayloads()) {
+            std::cout << ' ' << GetContainerFormatName(payload.format) << " (" << payload.size << " bytes)";
+        }
+        std::cout << '\n';
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+// NOTE: Binary PPM (P6) with 8-bit channels, alpha is set to 255
+std::vector<ui8> _readPPM(const std::string& path, ui32& width, ui32& height)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    auto skipWhitespaceAndComments = [&file]() {
+        while (true) {
+            const int c = file.peek();
+            if (c == '#') {
+                file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                file.get();
+            } else {
+                break;
+            }
+        }
+    };
+
+    std::string magic;
+    ui32 maxValue = 0;
+    file >> magic;
+    skipWhitespaceAndComments();
+    file >> width;
+    skipWhitespaceAndComments();
+    file >> height;
+    skipWhitespaceAndComments();
+    file >> maxValue;
+    file.get();
+
+    if (!file || magic != "P6" || maxValue != 255 || width == 0 || height == 0) {
+        throw std::runtime_error(path + " is not an 8-bit binary PPM (P6)");
+    }
+
+    std::vector<ui8> rgb(static_cast<size_t>(width) * height * 3);
+    file.read(reinterpret_cast<char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+    if (!file) {
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    std::vector<ui8> pixels(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+        pixels[i * 4 + 0] = rgb[i * 3 + 0];
+        pixels[i * 4 + 1] = rgb[i * 3 + 1];
+        pixels[i * 4 + 2] = rgb[i * 3 + 2];
+        pixels[i * 4 + 3] = 255;
+    }
+
+    return pixels;
+}
+
+std::vector<ui8> _readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::in);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    return std::vector<ui8>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::vector<BlockFormat> _parseFormats(std::string_view list)
+{
+    std::vector<BlockFormat> formats;
+
+    while (list.empty() == false) {
+        const auto comma = list.find(',');
+        const auto name = list.substr(0, comma);
+
+        if (name == "bc1") {
+            formats.push_back(BlockFormat::BC1);
+        } else if (name == "bc3") {
+            formats.push_back(BlockFormat::BC3);
+        } else if (name == "bc5") {
+            formats.push_back(BlockFormat::BC5);
+        } else if (name == "bc7") {
+            formats.push_back(BlockFormat::BC7);
+        } else {
+            throw std::runtime_error("Unknown format: " + std::string(name));
+        }
+
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+
+    return formats;
+}